@@ -0,0 +1,67 @@
+/** @file capture.h
+ */
+
+#pragma once
+
+#include <stdint.h> /* for uint32_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+#include "panel.h"
+
+/** @typedef canary_capture_t
+ * Records every frame's panel draw lists to a file, to be replayed without
+ * the Wasm runtime with a #canary_replay_t. Each frame is one chunk of the
+ * file, so a capture cut short still replays up to its last whole frame.
+ */
+typedef struct canary_capture_s canary_capture_t;
+
+/** @typedef canary_capture_flags_t
+ */
+typedef enum canary_capture_flags_e
+{
+  /** Compresses each frame with LZ4. Replaying then has to decompress
+   * frames instead of using them in place. Ignored, with a warning, if
+   * canary was built without LZ4. */
+  CANARY_CAPTURE_COMPRESS = 1 << 0,
+} canary_capture_flags_t;
+
+/** @function canary_capture_create
+ * @param capture
+ * @param alloc
+ * @param filename Overwritten if it exists.
+ * @param flags #canary_capture_flags_t.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_capture_create (canary_capture_t **,
+                                    const mdo_allocator_t *, const char *,
+                                    uint32_t);
+
+/** @function canary_capture_delete
+ * Closes the file. A frame that was begun but not ended is dropped.
+ * @param capture
+ */
+void canary_capture_delete (canary_capture_t *);
+
+/** @function canary_capture_begin_frame
+ * @param capture
+ */
+void canary_capture_begin_frame (canary_capture_t *);
+
+/** @function canary_capture_write_panel
+ * Adds a panel's current draw list, color, and size to the frame. Compact
+ * draw lists are stored unpacked, so that replay always hands out
+ * #canary_draw_vertex_t and #canary_draw_index_t.
+ * @param capture
+ * @param id Identifies the panel in the replay.
+ * @param panel
+ */
+void canary_capture_write_panel (canary_capture_t *, uint32_t,
+                                 canary_panel_t *);
+
+/** @function canary_capture_end_frame
+ * @param capture
+ * @return Zero on success, or nonzero if the frame couldn't be written.
+ */
+int canary_capture_end_frame (canary_capture_t *);
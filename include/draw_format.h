@@ -0,0 +1,64 @@
+/** @file draw_format.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for int16_t, uint8_t, uint16_t, uint32_t */
+
+/** @typedef canary_draw_format_t
+ * The layout of a draw list's buffers, chosen when the list is created.
+ */
+typedef enum canary_draw_format_e
+{
+  /** #canary_draw_vertex_t vertices and #canary_draw_index_t indices. */
+  CANARY_DRAW_FORMAT_FLOAT = 0,
+
+  /** #canary_draw_compact_vertex_t vertices, and
+   * #canary_draw_compact_index_t indices while the list has fewer than
+   * 65536 vertices. */
+  CANARY_DRAW_FORMAT_COMPACT,
+} canary_draw_format_t;
+
+/** @typedef canary_draw_vertex_t
+ */
+typedef struct canary_draw_vertex_s
+{
+  float position[2];
+  float color[4];
+} canary_draw_vertex_t;
+
+/** @typedef canary_draw_index_t
+ */
+typedef uint32_t canary_draw_index_t;
+
+/** @typedef canary_draw_compact_vertex_t
+ * Positions are signed normalized over [-1, 1], and colors are unsigned
+ * normalized over [0, 1]; both are clamped when packed.
+ */
+typedef struct canary_draw_compact_vertex_s
+{
+  int16_t position[2];
+  uint8_t color[4];
+} canary_draw_compact_vertex_t;
+
+/** @typedef canary_draw_compact_index_t
+ */
+typedef uint16_t canary_draw_compact_index_t;
+
+/** @function canary_draw_pack_vertices
+ * @param dst
+ * @param src
+ * @param vertex_num
+ */
+void canary_draw_pack_vertices (canary_draw_compact_vertex_t *,
+                                const canary_draw_vertex_t *, size_t);
+
+/** @function canary_draw_unpack_vertices
+ * @param dst
+ * @param src
+ * @param vertex_num
+ */
+void canary_draw_unpack_vertices (canary_draw_vertex_t *,
+                                  const canary_draw_compact_vertex_t *,
+                                  size_t);
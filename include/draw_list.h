@@ -3,26 +3,26 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h> /* for uint32_t */
 
 #include <mdo-utils/allocator.h>
 #include <mdo-utils/result.h>
 
+#include "draw_format.h"
+#include "frame_arena.h"
+
 /** @typedef canary_draw_list_t
  */
 typedef struct canary_draw_list_s canary_draw_list_t;
 
-/** @typedef canary_draw_vertex_t
+/** @typedef canary_draw_weld_stats_t
  */
-typedef struct canary_draw_vertex_s
+typedef struct canary_draw_weld_stats_s
 {
-  float position[2];
-  float color[4];
-} canary_draw_vertex_t;
-
-/** @typedef canary_draw_index_t
- */
-typedef uint32_t canary_draw_index_t;
+  size_t vertices_before;
+  size_t vertices_after;
+} canary_draw_weld_stats_t;
 
 /** @typedef canary_draw_list_create
  * @param draw_list
@@ -32,25 +32,75 @@ typedef uint32_t canary_draw_index_t;
 mdo_result_t canary_draw_list_create (canary_draw_list_t **,
                                       const mdo_allocator_t *);
 
+/** @function canary_draw_list_create_with_format
+ * @param draw_list
+ * @param alloc
+ * @param format #canary_draw_format_t.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_draw_list_create_with_format (canary_draw_list_t **,
+                                                  const mdo_allocator_t *,
+                                                  canary_draw_format_t);
+
+/** @function canary_draw_list_create_in_arena
+ * Creates a draw list whose buffers are allocated from a frame arena.
+ * Outgrown buffers are left for the arena to reclaim.
+ * @param draw_list
+ * @param alloc Allocates the draw list object itself.
+ * @param arena
+ * @param format #canary_draw_format_t.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_draw_list_create_in_arena (canary_draw_list_t **,
+                                               const mdo_allocator_t *,
+                                               canary_frame_arena_t *,
+                                               canary_draw_format_t);
+
 /** @function canary_draw_list_delete
  * @param ui_draw
  */
 void canary_draw_list_delete (canary_draw_list_t *);
 
 /** @function canary_draw_list_concat
- * Concatenates two #canary_draw_list.
+ * Concatenates two #canary_draw_list. The second list's indices are
+ * rebased onto the end of the first, and its vertices are converted if the
+ * formats differ.
  * @param ui_draw_a The first draw list. Receives concatenated data.
  * @param ui_draw_b The second draw list.
  */
 void canary_draw_list_concat (canary_draw_list_t *,
                               const canary_draw_list_t *);
 
+/** @function canary_draw_list_concat_many
+ * Concatenates several lists onto the end of one, reserving space for all
+ * of them up front, for example to upload every panel in a single buffer.
+ * @param ui_draw Receives concatenated data. Must not be one of the
+ * sources.
+ * @param srcs
+ * @param src_num
+ * @param vertex_offsets Receives where each source's vertices start in
+ * the list. May be NULL.
+ * @param index_offsets Receives where each source's indices start in the
+ * list. May be NULL.
+ */
+void canary_draw_list_concat_many (canary_draw_list_t *,
+                                   const canary_draw_list_t *const *, size_t,
+                                   size_t *, size_t *);
+
 /** @function canary_draw_list_clear
  * @param ui_draw
  */
 void canary_draw_list_clear (canary_draw_list_t *);
 
+/** @function canary_draw_list_reset
+ * Clears the list. Arena lists must be reset right after their arena is,
+ * which reserves their previous capacity from the arena up front.
+ * @param ui_draw
+ */
+void canary_draw_list_reset (canary_draw_list_t *);
+
 /** @function canary_draw_vertex
+ * Compact lists pack the vertex as it is added.
  * @param ui_draw
  * @param vertex #canary_draw_vertex_t.
  * @return #canary_draw_index_t.
@@ -66,7 +116,8 @@ size_t canary_draw_list_vertex_count (canary_draw_list_t *);
 
 /** @function canary_draw_list_vertex_buffer
  * @param ui_draw
- * @return A pointer to the vertex buffer in the list.
+ * @return A pointer to the vertex buffer in the list, or NULL if the list
+ * is compact.
  */
 canary_draw_vertex_t *canary_draw_list_vertex_buffer (canary_draw_list_t *);
 
@@ -78,10 +129,35 @@ size_t canary_draw_list_index_count (canary_draw_list_t *);
 
 /** @function canary_draw_list_index_buffer
  * @param ui_draw
- * @return A pointer to the index buffer in the list.
+ * @return A pointer to the index buffer in the list, or NULL if the list
+ * currently has 16-bit indices.
  */
 canary_draw_index_t *canary_draw_list_index_buffer (canary_draw_list_t *);
 
+/** @function canary_draw_list_get_format
+ * @param ui_draw
+ * @return #canary_draw_format_t.
+ */
+canary_draw_format_t canary_draw_list_get_format (canary_draw_list_t *);
+
+/** @function canary_draw_list_compact_vertex_buffer
+ * @param ui_draw
+ * @return A pointer to the vertex buffer in the list, or NULL if the list
+ * is not compact.
+ */
+canary_draw_compact_vertex_t *
+canary_draw_list_compact_vertex_buffer (canary_draw_list_t *);
+
+/** @function canary_draw_list_compact_index_buffer
+ * Compact lists have 16-bit indices until they reach 65536 vertices, and
+ * again after they are cleared.
+ * @param ui_draw
+ * @return A pointer to the index buffer in the list, or NULL if the list
+ * currently has 32-bit indices.
+ */
+canary_draw_compact_index_t *
+canary_draw_list_compact_index_buffer (canary_draw_list_t *);
+
 /** @function canary_draw_triangle
  * @param ui_draw
  * @param vertex1
@@ -90,3 +166,44 @@ canary_draw_index_t *canary_draw_list_index_buffer (canary_draw_list_t *);
  */
 void canary_draw_triangle (canary_draw_list_t *, canary_draw_index_t,
                            canary_draw_index_t, canary_draw_index_t);
+
+/** @function canary_draw_buffers
+ * Appends a whole vertex and index buffer to the list with a single copy.
+ * Indices are relative to the start of the given vertex buffer, and are
+ * rebased onto the end of the list. Nothing is appended on error.
+ * @param ui_draw
+ * @param vertices
+ * @param vertex_num
+ * @param indices
+ * @param index_num
+ * @return Zero on success, or nonzero if an index is out of range.
+ */
+int canary_draw_buffers (canary_draw_list_t *, const canary_draw_vertex_t *,
+                         size_t, const canary_draw_index_t *, size_t);
+
+/** @function canary_draw_list_append_range
+ * Appends the tail of another list, from the given vertex and index
+ * onwards. The copied indices must only refer to the copied vertices, and
+ * are rebased onto the end of the list. Nothing is appended on error.
+ * @param ui_draw
+ * @param src
+ * @param vertex_start
+ * @param index_start
+ * @return Zero on success, or nonzero if an index is out of range.
+ */
+int canary_draw_list_append_range (canary_draw_list_t *, canary_draw_list_t *,
+                                   size_t, size_t);
+
+/** @function canary_draw_list_weld
+ * Merges identical vertices and rewrites the index buffer to match, for
+ * example after triangles were drawn one at a time. Meant to run once a
+ * list is finished, before it is rendered.
+ * @param ui_draw
+ * @param reorder If true, also reorders triangles so that consecutive ones
+ * share vertices, for the renderer's post-transform vertex cache.
+ * @param stats Receives vertex counts before and after. May be NULL.
+ * @return Zero on success, or nonzero if the list has out-of-range
+ * indices, in which case it is left unchanged.
+ */
+int canary_draw_list_weld (canary_draw_list_t *, bool,
+                           canary_draw_weld_stats_t *);
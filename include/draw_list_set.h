@@ -0,0 +1,58 @@
+/** @file draw_list_set.h
+ */
+
+#pragma once
+
+#include <stdint.h> /* for uint32_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+#include "draw_list.h"
+#include "panel.h"
+
+/** @typedef canary_draw_list_set_t
+ * A double or triple buffered set of draw lists, each backed by its own
+ * frame arena. Scripts write into the back list while the renderer reads
+ * the front list, and no heap allocations are made in steady state.
+ */
+typedef struct canary_draw_list_set_s canary_draw_list_set_t;
+
+/** @function canary_draw_list_set_create
+ * @param set
+ * @param alloc
+ * @param panel If not NULL, the panel is pointed at the back list on
+ * every swap.
+ * @param buffer_num The number of draw lists; at least 2.
+ * @param format #canary_draw_format_t.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_draw_list_set_create (canary_draw_list_set_t **,
+                                          const mdo_allocator_t *,
+                                          canary_panel_t *, uint32_t,
+                                          canary_draw_format_t);
+
+/** @function canary_draw_list_set_delete
+ * @param set
+ */
+void canary_draw_list_set_delete (canary_draw_list_set_t *);
+
+/** @function canary_draw_list_set_get_back
+ * @param set
+ * @return The list being written this frame.
+ */
+canary_draw_list_t *canary_draw_list_set_get_back (canary_draw_list_set_t *);
+
+/** @function canary_draw_list_set_get_front
+ * @param set
+ * @return The most recently finished list, for rendering.
+ */
+canary_draw_list_t *canary_draw_list_set_get_front (canary_draw_list_set_t *);
+
+/** @function canary_draw_list_set_swap
+ * Publishes the back list as the front list, and recycles the oldest list
+ * as the new, empty back list. Nothing may still be reading the oldest
+ * list; with two buffers that is the current front list.
+ * @param set
+ */
+void canary_draw_list_set_swap (canary_draw_list_set_t *);
@@ -0,0 +1,50 @@
+/** @file frame_arena.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+/** @typedef canary_frame_arena_t
+ * A linear allocator that is reset all at once, usually every frame.
+ * Allocations that don't fit are served from the heap until the next reset,
+ * which then grows the arena to the frame's total, so that a steady
+ * workload stops touching the heap after its first frames.
+ */
+typedef struct canary_frame_arena_s canary_frame_arena_t;
+
+/** @function canary_frame_arena_create
+ * @param arena
+ * @param alloc
+ * @param capacity The initial capacity in bytes. May be zero.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_frame_arena_create (canary_frame_arena_t **,
+                                        const mdo_allocator_t *, size_t);
+
+/** @function canary_frame_arena_delete
+ * @param arena
+ */
+void canary_frame_arena_delete (canary_frame_arena_t *);
+
+/** @function canary_frame_arena_alloc
+ * @param arena
+ * @param size
+ * @return Memory aligned for any type, valid until the next reset.
+ */
+void *canary_frame_arena_alloc (canary_frame_arena_t *, size_t);
+
+/** @function canary_frame_arena_reset
+ * Frees every allocation at once.
+ * @param arena
+ */
+void canary_frame_arena_reset (canary_frame_arena_t *);
+
+/** @function canary_frame_arena_get_capacity
+ * @param arena
+ * @return The size of the arena's block, not counting overflow.
+ */
+size_t canary_frame_arena_get_capacity (canary_frame_arena_t *);
@@ -0,0 +1,77 @@
+/** @file hit_grid.h
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint32_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+/** @typedef canary_hit_grid_t
+ * A set of rectangles and circles in panel space, each tagged with an id,
+ * bucketed into a uniform grid so that finding the region under a point
+ * only tests the regions sharing its cell.
+ */
+typedef struct canary_hit_grid_s canary_hit_grid_t;
+
+/** @function canary_hit_grid_create
+ * @param grid
+ * @param alloc
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_hit_grid_create (canary_hit_grid_t **,
+                                     const mdo_allocator_t *);
+
+/** @function canary_hit_grid_delete
+ * @param grid
+ */
+void canary_hit_grid_delete (canary_hit_grid_t *);
+
+/** @function canary_hit_grid_add_rect
+ * @param grid
+ * @param id Several regions may share an id, making up one larger region.
+ * @param position The minimum corner.
+ * @param size
+ */
+void canary_hit_grid_add_rect (canary_hit_grid_t *, uint32_t, const float[2],
+                               const float[2]);
+
+/** @function canary_hit_grid_add_circle
+ * @param grid
+ * @param id
+ * @param center
+ * @param radius
+ */
+void canary_hit_grid_add_circle (canary_hit_grid_t *, uint32_t,
+                                 const float[2], float);
+
+/** @function canary_hit_grid_remove
+ * Removes every region with the given id.
+ * @param grid
+ * @param id
+ */
+void canary_hit_grid_remove (canary_hit_grid_t *, uint32_t);
+
+/** @function canary_hit_grid_clear
+ * @param grid
+ */
+void canary_hit_grid_clear (canary_hit_grid_t *);
+
+/** @function canary_hit_grid_get_region_num
+ * @param grid
+ * @return The number of regions.
+ */
+size_t canary_hit_grid_get_region_num (canary_hit_grid_t *);
+
+/** @function canary_hit_grid_test
+ * Finds the region under a point. Where regions overlap, the one added last
+ * wins. The grid is rebuilt here if regions changed since the last test.
+ * @param grid
+ * @param point
+ * @param id Set to the region's id, if there is one.
+ * @return True if the point is inside a region.
+ */
+bool canary_hit_grid_test (canary_hit_grid_t *, const float[2], uint32_t *);
@@ -0,0 +1,52 @@
+/** @file module_cache.h
+ */
+
+#pragma once
+
+#include <stdint.h> /* for uint8_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+#include <wasmtime.h>
+
+/** @typedef canary_module_cache_t
+ * An on-disk cache of compiled Wasm modules, keyed by the content of the
+ * module and the configuration of the engine that compiled it. Several
+ * processes may share one cache directory.
+ */
+typedef struct canary_module_cache_s canary_module_cache_t;
+
+/** @function canary_module_cache_create
+ * @param cache
+ * @param alloc
+ * @param directory The cache directory. Created if it does not exist.
+ * @param max_size The total size in bytes that compiled modules may take up
+ * before the least recently used ones are evicted.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_module_cache_create (canary_module_cache_t **,
+                                         const mdo_allocator_t *,
+                                         const char *, size_t);
+
+/** @function canary_module_cache_delete
+ * Frees the cache object. Cached modules are left on disk.
+ * @param cache
+ */
+void canary_module_cache_delete (canary_module_cache_t *);
+
+/** @function canary_module_cache_compile
+ * A drop-in replacement for `wasmtime_module_new` that loads the compiled
+ * module from the cache if possible, and stores it otherwise. Cache I/O
+ * failures are logged, and fall back to compiling.
+ * @param cache
+ * @param engine
+ * @param engine_key Identifies the engine's configuration.
+ * @param wasm
+ * @param wasm_size
+ * @param module
+ * @return The error returned by `wasmtime_module_new`, if any.
+ */
+wasmtime_error_t *canary_module_cache_compile (canary_module_cache_t *,
+                                               wasm_engine_t *, const char *,
+                                               const uint8_t *, size_t,
+                                               wasmtime_module_t **);
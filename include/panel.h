@@ -3,11 +3,14 @@
 
 #pragma once
 
+#include <stdint.h> /* for uint32_t */
+
 #include <mdo-utils/allocator.h>
 #include <mdo-utils/result.h>
 #include <wasmtime.h> /* for script API */
 
 #include "draw_list.h"
+#include "hit_grid.h"
 
 /** @typedef canary_panel_t
  */
@@ -41,7 +44,22 @@ void canary_panel_set_size (canary_panel_t *, const float[2]);
  */
 void canary_panel_get_size (canary_panel_t *, float[2]);
 
+/** @function canary_panel_set_pixel_scale
+ * Sets how many pixels one panel unit covers on screen, which decides how
+ * finely curves drawn to the panel are tessellated.
+ * @param panel
+ * @param pixel_scale
+ */
+void canary_panel_set_pixel_scale (canary_panel_t *, float);
+
+/** @function canary_panel_get_pixel_scale
+ * @param panel
+ * @return The pixel scale.
+ */
+float canary_panel_get_pixel_scale (canary_panel_t *);
+
 /** @function canary_panel_set_draw_list
+ * Changing the draw list abandons any segment being recorded.
  * @param panel
  * @param ui_draw
  */
@@ -53,3 +71,58 @@ void canary_panel_set_draw_list (canary_panel_t *, canary_draw_list_t *);
  */
 canary_draw_list_t *canary_panel_get_draw_list (canary_panel_t *);
 
+/** @function canary_panel_get_hit_grid
+ * The panel's hit regions, which filter the hover events that reach its
+ * script.
+ * @param panel
+ * @return #canary_hit_grid_t.
+ */
+canary_hit_grid_t *canary_panel_get_hit_grid (canary_panel_t *);
+
+/** @function canary_panel_begin_segment
+ * Starts recording a retained segment from everything drawn to the panel's
+ * current draw list until #canary_panel_end_segment.
+ * @param panel
+ * @param id Replaces any segment with the same id once recorded.
+ * @return Zero on success, or nonzero if a segment is already being
+ * recorded or the panel has no draw list.
+ */
+int canary_panel_begin_segment (canary_panel_t *, uint32_t);
+
+/** @function canary_panel_end_segment
+ * The segment's duplicate vertices are welded, but its triangles keep the
+ * order they were drawn in.
+ * @param panel
+ * @return Zero on success, or nonzero if no segment was being recorded or
+ * the draw list changed while recording.
+ */
+int canary_panel_end_segment (canary_panel_t *);
+
+/** @function canary_panel_abandon_segment
+ * Stops recording the segment being recorded, if any, without keeping it.
+ * Scripts stopped partway through a call may have left one open.
+ * @param panel
+ */
+void canary_panel_abandon_segment (canary_panel_t *);
+
+/** @function canary_panel_draw_segment
+ * Splices a previously recorded segment into the current draw list.
+ * @param panel
+ * @param id
+ * @return Zero on success, or nonzero if there is no valid segment with
+ * that id.
+ */
+int canary_panel_draw_segment (canary_panel_t *, uint32_t);
+
+/** @function canary_panel_invalidate_segment
+ * Marks a segment as stale, keeping its buffers for re-recording.
+ * @param panel
+ * @param id
+ */
+void canary_panel_invalidate_segment (canary_panel_t *, uint32_t);
+
+/** @function canary_panel_invalidate_segments
+ * Marks every segment as stale, and abandons any being recorded.
+ * @param panel
+ */
+void canary_panel_invalidate_segments (canary_panel_t *);
@@ -0,0 +1,55 @@
+/** @file profile.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint64_t */
+
+/** @def CANARY_PROFILE_BUCKET_NUM
+ * Histogram buckets are powers of two in microseconds: the first counts
+ * calls under 1 us, bucket i counts calls under 2^i us, and the last one
+ * counts everything slower.
+ */
+#define CANARY_PROFILE_BUCKET_NUM 20
+
+/** @typedef canary_profile_stats_t
+ * Timing for every call to a single function.
+ */
+typedef struct canary_profile_stats_s
+{
+  uint64_t call_num;
+  uint64_t total_ns;
+  uint64_t max_ns;
+  uint64_t histogram[CANARY_PROFILE_BUCKET_NUM];
+} canary_profile_stats_t;
+
+/** @typedef canary_profile_draw_stats_t
+ * The size of a panel's draw list after each update.
+ */
+typedef struct canary_profile_draw_stats_s
+{
+  size_t vertex_num;
+  size_t index_num;
+  size_t peak_vertex_num;
+  size_t peak_index_num;
+} canary_profile_draw_stats_t;
+
+/** @function canary_profile_now
+ * @return A monotonic timestamp in nanoseconds.
+ */
+uint64_t canary_profile_now (void);
+
+/** @function canary_profile_record
+ * @param stats
+ * @param duration_ns
+ */
+void canary_profile_record (canary_profile_stats_t *, uint64_t);
+
+/** @function canary_profile_record_draw
+ * @param stats
+ * @param vertex_num
+ * @param index_num
+ */
+void canary_profile_record_draw (canary_profile_draw_stats_t *, size_t,
+                                 size_t);
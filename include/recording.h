@@ -0,0 +1,116 @@
+/** @file recording.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint32_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+/** @typedef canary_recorder_t
+ * Writes every call the host makes into a script to a file, so that the
+ * same calls can later be replayed with the same dt and input, for example
+ * by canary-trace-runner. Attached with #canary_script_set_recorder.
+ */
+typedef struct canary_recorder_s canary_recorder_t;
+
+/** @typedef canary_recording_t
+ * The calls read back from a file written by a #canary_recorder_t.
+ */
+typedef struct canary_recording_s canary_recording_t;
+
+/** @typedef canary_recording_event_type_t
+ */
+typedef enum canary_recording_event_type_e
+{
+  /** The panel's color, size, and pixel scale are recorded as they were
+   * when it was bound. */
+  CANARY_RECORDING_BIND_PANEL = 1,
+  CANARY_RECORDING_UNBIND_PANEL,
+  CANARY_RECORDING_INPUT,
+  CANARY_RECORDING_SET_INPUT_MODE,
+  CANARY_RECORDING_FLUSH_INPUT,
+  CANARY_RECORDING_UPDATE,
+} canary_recording_event_type_t;
+
+/** @typedef canary_recording_event_t
+ * Only the fields used by the event's type are set.
+ */
+typedef struct canary_recording_event_s
+{
+  canary_recording_event_type_t type;
+
+  /** The key the panel was bound with while recording, which a replay may
+   * not get again. */
+  uint32_t panel_key;
+
+  /** A #canary_input_event_t. */
+  uint32_t input_event;
+  float coords[2];
+
+  /** A #canary_input_mode_t. */
+  uint32_t input_mode;
+
+  float dt;
+
+  float color[4];
+  float size[2];
+  float pixel_scale;
+} canary_recording_event_t;
+
+/** @function canary_recorder_create
+ * @param recorder
+ * @param alloc
+ * @param filename Overwritten if it exists.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_recorder_create (canary_recorder_t **,
+                                     const mdo_allocator_t *, const char *);
+
+/** @function canary_recorder_delete
+ * Detach the recorder from its script first.
+ * @param recorder
+ */
+void canary_recorder_delete (canary_recorder_t *);
+
+/** @function canary_recorder_write
+ * @param recorder
+ * @param event
+ * @return Zero on success, or nonzero if the event couldn't be written.
+ */
+int canary_recorder_write (canary_recorder_t *,
+                           const canary_recording_event_t *);
+
+/** @function canary_recording_create
+ * Reads the whole file up front, so that replaying doesn't wait on it. A
+ * partial event at the end is ignored.
+ * @param recording
+ * @param alloc
+ * @param filename
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_recording_create (canary_recording_t **,
+                                      const mdo_allocator_t *, const char *);
+
+/** @function canary_recording_delete
+ * @param recording
+ */
+void canary_recording_delete (canary_recording_t *);
+
+/** @function canary_recording_get_event_num
+ * @param recording
+ * @return The number of recorded calls.
+ */
+size_t canary_recording_get_event_num (canary_recording_t *);
+
+/** @function canary_recording_get_event
+ * @param recording
+ * @param index
+ * @param event
+ * @return Zero on success, or nonzero if the index is out of range or the
+ * event is of an unknown type.
+ */
+int canary_recording_get_event (canary_recording_t *, size_t,
+                                canary_recording_event_t *);
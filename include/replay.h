@@ -0,0 +1,89 @@
+/** @file replay.h
+ * Built into its own library, canary-capture-reader, which renderers and
+ * tools can link without pulling in the Wasm runtime.
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint32_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+#include "draw_format.h"
+
+/** @typedef canary_replay_t
+ * Memory-maps a capture written by a #canary_capture_t and hands out views
+ * of its frames. Uncompressed frames are used in place.
+ */
+typedef struct canary_replay_s canary_replay_t;
+
+/** @typedef canary_replay_frame_t
+ */
+typedef struct canary_replay_frame_s
+{
+  size_t panel_num;
+
+  /* private */
+  const uint8_t *payload;
+  size_t size;
+} canary_replay_frame_t;
+
+/** @typedef canary_replay_panel_t
+ */
+typedef struct canary_replay_panel_s
+{
+  uint32_t id;
+  float color[4];
+  float size[2];
+
+  const canary_draw_vertex_t *vertices;
+  size_t vertex_num;
+
+  const canary_draw_index_t *indices;
+  size_t index_num;
+} canary_replay_panel_t;
+
+/** @function canary_replay_create
+ * Finds every whole frame in the capture up front, ignoring a partial one
+ * at the end.
+ * @param replay
+ * @param alloc
+ * @param filename
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_replay_create (canary_replay_t **,
+                                   const mdo_allocator_t *, const char *);
+
+/** @function canary_replay_delete
+ * @param replay
+ */
+void canary_replay_delete (canary_replay_t *);
+
+/** @function canary_replay_get_frame_num
+ * @param replay
+ * @return The number of frames in the capture.
+ */
+size_t canary_replay_get_frame_num (canary_replay_t *);
+
+/** @function canary_replay_get_frame
+ * @param replay
+ * @param index
+ * @param frame Valid until the replay is deleted, or, for compressed
+ * frames, until the next call.
+ * @return Zero on success, or nonzero if the frame is corrupt or can't be
+ * decompressed.
+ */
+int canary_replay_get_frame (canary_replay_t *, size_t,
+                             canary_replay_frame_t *);
+
+/** @function canary_replay_get_panel
+ * @param replay
+ * @param frame
+ * @param index Less than the frame's panel_num.
+ * @param panel Points into the frame.
+ * @return Zero on success, or nonzero if the panel's record is corrupt.
+ */
+int canary_replay_get_panel (canary_replay_t *, const canary_replay_frame_t *,
+                             size_t, canary_replay_panel_t *);
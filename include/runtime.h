@@ -0,0 +1,182 @@
+/** @file runtime.h
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h> /* for uint8_t, uint32_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+#include <wasmtime.h>
+
+#include "module_cache.h"
+#include "trace.h"
+#include "watchdog.h"
+
+/** @typedef canary_runtime_t
+ * Owns the Wasm engine and the linker with every host function defined,
+ * shared by all scripts created from it. Compiled modules are also shared
+ * between scripts loading the same bytes.
+ */
+typedef struct canary_runtime_s canary_runtime_t;
+
+/** @typedef canary_runtime_config_t
+ * Limits for hosts that create and delete many scripts, such as one per
+ * user in a world. Zero leaves a limit unset, or a feature disabled.
+ */
+typedef struct canary_runtime_config_s
+{
+  /** The most scripts that may exist at once. */
+  size_t max_scripts;
+
+  /** The most 64 KiB pages a script's memory may grow to. Every memory a
+   * module defines or imports must declare a maximum of at most this many
+   * pages, or the module fails to load. Each memory then only reserves this
+   * much address space, instead of 6 GiB, which makes creating and deleting
+   * scripts cheaper, but costs a bounds check on memory accesses.
+   * Precompiled modules are only checked for the memories they import or
+   * export. */
+  uint32_t max_memory_pages;
+
+  /** Lets #canary_script_set_budget interrupt scripts. Compiled code then
+   * checks for interrupts at every loop header and call, and the runtime
+   * runs a watchdog thread, so runtimes that never set a budget are better
+   * off without it. */
+  bool enable_budgets;
+} canary_runtime_config_t;
+
+/** @function canary_runtime_create
+ * Creates a runtime without limits or budgets.
+ * @param runtime
+ * @param alloc
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_runtime_create (canary_runtime_t **,
+                                    const mdo_allocator_t *);
+
+/** @function canary_runtime_create_with_config
+ * @param runtime
+ * @param alloc
+ * @param config Only read during the call.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_runtime_create_with_config (
+    canary_runtime_t **, const mdo_allocator_t *,
+    const canary_runtime_config_t *);
+
+/** @function canary_runtime_delete
+ * Every script created from the runtime must be deleted first.
+ * @param runtime
+ */
+void canary_runtime_delete (canary_runtime_t *);
+
+/** @function canary_runtime_set_module_cache
+ * Subsequent compiles go through the cache. The cache is not owned by the
+ * runtime.
+ * @param runtime
+ * @param cache The cache to use, or NULL to always compile.
+ */
+void canary_runtime_set_module_cache (canary_runtime_t *,
+                                      canary_module_cache_t *);
+
+/** @function canary_runtime_set_trace
+ * Scripts created from the runtime record their calls, and calls to host
+ * functions, into the trace. The trace is not owned by the runtime. May be
+ * called while scripts are running on other threads, but calls already in
+ * progress may still record into the previous trace, so it must outlive
+ * them.
+ * @param runtime
+ * @param trace The trace to record into, or NULL to stop recording.
+ */
+void canary_runtime_set_trace (canary_runtime_t *, canary_trace_t *);
+
+/** @function canary_runtime_get_trace
+ * @param runtime
+ * @return The trace scripts record into, or NULL.
+ */
+canary_trace_t *canary_runtime_get_trace (canary_runtime_t *);
+
+/** @function canary_runtime_get_allocator
+ * @param runtime
+ * @return #mdo_allocator_t.
+ */
+const mdo_allocator_t *canary_runtime_get_allocator (canary_runtime_t *);
+
+/** @function canary_runtime_get_engine
+ * @param runtime
+ * @return The shared engine.
+ */
+wasm_engine_t *canary_runtime_get_engine (canary_runtime_t *);
+
+/** @function canary_runtime_get_linker
+ * @param runtime
+ * @return The shared linker.
+ */
+const wasmtime_linker_t *canary_runtime_get_linker (canary_runtime_t *);
+
+/** @function canary_runtime_get_watchdog
+ * @param runtime
+ * @return The watchdog that enforces script CPU budgets, or NULL unless
+ * the runtime was created with budgets enabled.
+ */
+canary_watchdog_t *canary_runtime_get_watchdog (canary_runtime_t *);
+
+/** @function canary_runtime_add_script
+ * Counts a script against the runtime's limit. Safe to call from any
+ * thread.
+ * @param runtime
+ * @return Zero if there was room for another script.
+ */
+int canary_runtime_add_script (canary_runtime_t *);
+
+/** @function canary_runtime_remove_script
+ * @param runtime
+ */
+void canary_runtime_remove_script (canary_runtime_t *);
+
+/** @function canary_runtime_get_import_num
+ * @param runtime
+ * @return The number of host functions linked for scripts.
+ */
+size_t canary_runtime_get_import_num (canary_runtime_t *);
+
+/** @function canary_runtime_get_import_name
+ * @param runtime
+ * @param index
+ * @return The host function's name, or NULL if the index is out of range.
+ */
+const char *canary_runtime_get_import_name (canary_runtime_t *, size_t);
+
+/** @function canary_runtime_compile
+ * Compiles a module, or shares a module previously compiled from the same
+ * bytes. Each successful call must be paired with
+ * #canary_runtime_release_module. Safe to call from any thread.
+ * @param runtime
+ * @param wasm
+ * @param wasm_size
+ * @param module Set to NULL if the module is over the runtime's limits.
+ * @return The error returned by `wasmtime_module_new`, if any.
+ */
+wasmtime_error_t *canary_runtime_compile (canary_runtime_t *, const uint8_t *,
+                                          size_t, wasmtime_module_t **);
+
+/** @function canary_runtime_deserialize
+ * Like #canary_runtime_compile, but for a module precompiled with
+ * `wasmtime_module_serialize` by an engine configured like the runtime's.
+ * Precompiled modules are native code, and must come from a trusted source.
+ * @param runtime
+ * @param data
+ * @param size
+ * @param module
+ * @return The error returned by `wasmtime_module_deserialize`, if any.
+ */
+wasmtime_error_t *canary_runtime_deserialize (canary_runtime_t *,
+                                              const uint8_t *, size_t,
+                                              wasmtime_module_t **);
+
+/** @function canary_runtime_release_module
+ * @param runtime
+ * @param module
+ */
+void canary_runtime_release_module (canary_runtime_t *, wasmtime_module_t *);
@@ -0,0 +1,47 @@
+/** @file scheduler.h
+ */
+
+#pragma once
+
+#include <stdint.h> /* for uint32_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+#include "script.h"
+
+/** @typedef canary_scheduler_t
+ * A worker pool that updates many scripts concurrently. Each script owns
+ * its own store, so scripts may run on different threads as long as no
+ * two of them share a panel or draw list.
+ */
+typedef struct canary_scheduler_s canary_scheduler_t;
+
+/** @function canary_scheduler_create
+ * @param scheduler
+ * @param alloc
+ * @param thread_num The number of threads to update scripts on, including
+ * the thread that calls #canary_scheduler_update.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_scheduler_create (canary_scheduler_t **,
+                                      const mdo_allocator_t *, uint32_t);
+
+/** @function canary_scheduler_delete
+ * @param scheduler
+ */
+void canary_scheduler_delete (canary_scheduler_t *);
+
+/** @function canary_scheduler_update
+ * Calls #canary_script_update on every script, which also flushes queued
+ * input, spread over the worker pool. Returns once every update is done,
+ * so draw lists may be consumed right after.
+ * @param scheduler
+ * @param scripts
+ * @param script_num
+ * @param dt
+ * @param statuses Receives each script's #canary_script_status_t, at the
+ * script's index. May be NULL.
+ */
+void canary_scheduler_update (canary_scheduler_t *, canary_script_t *const *,
+                              size_t, float, canary_script_status_t *);
@@ -3,18 +3,23 @@
 
 #pragma once
 
-#include <stdint.h> /* for uint32_t */
+#include <stdint.h> /* for uint8_t, uint32_t */
 
 #include <mdo-utils/allocator.h>
 #include <mdo-utils/result.h>
 
 #include "panel.h"
+#include "profile.h"
+#include "recording.h"
+#include "runtime.h"
 
 /** @typedef canary_script_t
  */
 typedef struct canary_script_s canary_script_t;
 
 /** @typedef canary_panel_key_t
+ * Identifies a panel bound to a script. A key that outlives its binding
+ * fails to look up, instead of finding whichever panel took over its slot.
  */
 typedef uint32_t canary_panel_key_t;
 
@@ -28,13 +33,32 @@ typedef enum
   CANARY_DESELECT,
 } canary_input_event_t;
 
+/** @typedef canary_input_mode_t
+ */
+typedef enum
+{
+  CANARY_INPUT_IMMEDIATE,
+  CANARY_INPUT_QUEUED,
+} canary_input_mode_t;
+
+/** @typedef canary_script_status_t
+ */
+typedef enum
+{
+  CANARY_SCRIPT_OK,
+  /** The script trapped, or couldn't be called. */
+  CANARY_SCRIPT_TRAPPED,
+  /** The script ran out of budget and was interrupted. */
+  CANARY_SCRIPT_PREEMPTED,
+} canary_script_status_t;
+
 /** @function canary_script_create
  * @param script
- * @param alloc
+ * @param runtime The runtime to create the script's store from. Must
+ * outlive the script.
  * @return #mdo_result_t.
  */
-mdo_result_t canary_script_create (canary_script_t **,
-                                   const mdo_allocator_t *);
+mdo_result_t canary_script_create (canary_script_t **, canary_runtime_t *);
 
 /** @function canary_script_delete
  * @param script
@@ -48,6 +72,46 @@ void canary_script_delete (canary_script_t *);
  */
 mdo_result_t canary_script_load (canary_script_t *, const char *);
 
+/** @function canary_script_load_precompiled
+ * Loads a module precompiled with `wasmtime_module_serialize`, skipping
+ * compilation. Scripts loading the same file share one module. Precompiled
+ * modules are native code, so only load files from a trusted source.
+ * @param script
+ * @param filename
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_script_load_precompiled (canary_script_t *, const char *);
+
+/** @function canary_script_load_buffer
+ * For hosts that fetch scripts themselves instead of from a file.
+ * @param script
+ * @param wasm Only read during the call.
+ * @param wasm_size
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_script_load_buffer (canary_script_t *, const uint8_t *,
+                                        size_t);
+
+/** @function canary_script_reload
+ * Compiles a new version of the script on a background thread while the
+ * current one keeps running. The first #canary_script_update after the
+ * compile finishes swaps the new instance in and calls its bind_panel for
+ * every bound panel, keeping their keys; the old instance's state, hit
+ * regions, and retained segments are dropped. If the new version fails to
+ * compile or instantiate, the error is logged and the old one stays loaded.
+ * @param script
+ * @param filename
+ * @return #mdo_result_t. Fails if a reload is already in progress.
+ */
+mdo_result_t canary_script_reload (canary_script_t *, const char *);
+
+/** @function canary_script_reload_pending
+ * @param script
+ * @return True from #canary_script_reload until the update that finishes
+ * it.
+ */
+bool canary_script_reload_pending (canary_script_t *);
+
 /** @function canary_script_new_trap
  * @param script
  * @param message
@@ -58,10 +122,39 @@ wasm_trap_t *canary_script_new_trap (canary_script_t *, const char *);
 /** @function canary_script_update
  * @param script
  * @param dt
+ * @return #canary_script_status_t.
+ */
+canary_script_status_t canary_script_update (canary_script_t *, float);
+
+/** @function canary_script_set_budget
+ * Limits how long each call from the host into the script may run,
+ * including #canary_script_update together with the input it flushes. A
+ * call that runs over is interrupted, returns #CANARY_SCRIPT_PREEMPTED,
+ * and counts as an overrun. The script stays loaded and may be called
+ * again, but whatever it was doing when interrupted is left unfinished.
+ * Ignored unless the runtime was created with
+ * #canary_runtime_config_t.enable_budgets.
+ * @param script
+ * @param seconds The budget per call, or zero for no limit.
+ */
+void canary_script_set_budget (canary_script_t *, float);
+
+/** @function canary_script_get_overruns
+ * @param script
+ * @return The number of calls that were preempted so far.
+ */
+size_t canary_script_get_overruns (canary_script_t *);
+
+/** @function canary_script_get_consecutive_overruns
+ * For deciding when to throttle or unload a script that keeps running
+ * over.
+ * @param script
+ * @return The number of calls preempted since the last one that wasn't.
  */
-void canary_script_update (canary_script_t *, float);
+size_t canary_script_get_consecutive_overruns (canary_script_t *);
 
 /** @function canary_script_bind_panel
+ * Binding and unbinding take constant time, and unbound slots are recycled.
  * @param script
  * @param panel
  * @param panel_key
@@ -79,16 +172,93 @@ void canary_script_unbind_panel (canary_script_t *, canary_panel_key_t);
 /** @function canary_script_lookup_panel
  * @param script
  * @param panel_key
- * @return A pointer to the panel, or NULL on error.
+ * @return A pointer to the panel, or NULL if the key is invalid or its
+ * panel has been unbound.
  */
 canary_panel_t *canary_script_lookup_panel (canary_script_t *,
                                             canary_panel_key_t);
 
 /** @function canary_script_on_input
+ * If the panel has hit regions, hover events only call the script's
+ * on_enter, on_leave, and on_region_hover callbacks with the id of the
+ * region under the pointer, and are dropped over empty panel area.
  * @param script
  * @param panel_key
  * @param event_type
  * @param coords
+ * @return #canary_script_status_t. Always #CANARY_SCRIPT_OK when queued.
+ */
+canary_script_status_t canary_script_on_input (canary_script_t *,
+                                               canary_panel_key_t,
+                                               canary_input_event_t,
+                                               const float[2]);
+
+/** @function canary_script_set_input_mode
+ * In #CANARY_INPUT_QUEUED mode, input events are queued instead of being
+ * sent to the script right away. Consecutive hover or drag events on the
+ * same panel are coalesced into the latest one, and the queue is flushed by
+ * #canary_script_update or #canary_script_flush_input. Switching back to
+ * #CANARY_INPUT_IMMEDIATE flushes any queued events.
+ * @param script
+ * @param mode
+ */
+void canary_script_set_input_mode (canary_script_t *, canary_input_mode_t);
+
+/** @function canary_script_flush_input
+ * @param script
+ * @return #canary_script_status_t.
+ */
+canary_script_status_t canary_script_flush_input (canary_script_t *);
+
+/** @function canary_script_get_coalesced_input
+ * @param script
+ * @return The total number of input events dropped by coalescing.
+ */
+size_t canary_script_get_coalesced_input (canary_script_t *);
+
+/** @function canary_script_set_profiling
+ * While profiling, the script times every call to its callbacks and to
+ * host functions, and records the size of each panel's draw list after
+ * every update. Enabling resets the statistics, and disabling frees them.
+ * @param script
+ * @param enabled
+ */
+void canary_script_set_profiling (canary_script_t *, bool);
+
+/** @function canary_script_get_callback_stats
+ * @param script
+ * @param name The exported callback, such as "update" or "on_hover".
+ * @param stats
+ * @return False if profiling is disabled or there is no such callback.
+ */
+bool canary_script_get_callback_stats (canary_script_t *, const char *,
+                                       canary_profile_stats_t *);
+
+/** @function canary_script_get_import_stats
+ * @param script
+ * @param name The host function, such as "UiPanel_drawTriangle".
+ * @param stats
+ * @return False if profiling is disabled or there is no such function.
+ */
+bool canary_script_get_import_stats (canary_script_t *, const char *,
+                                     canary_profile_stats_t *);
+
+/** @function canary_script_get_draw_stats
+ * @param script
+ * @param panel_key
+ * @param stats
+ * @return False if profiling is disabled or the key is stale.
+ */
+bool canary_script_get_draw_stats (canary_script_t *, canary_panel_key_t,
+                                   canary_profile_draw_stats_t *);
+
+/** @function canary_script_set_recorder
+ * Records every later call to #canary_script_bind_panel,
+ * #canary_script_unbind_panel, #canary_script_on_input,
+ * #canary_script_set_input_mode, #canary_script_flush_input, and
+ * #canary_script_update.
+ * @param script
+ * @param recorder Must outlive the script, or be detached first. May be
+ * NULL to stop recording.
  */
-void canary_script_on_input (canary_script_t *, canary_panel_key_t,
-                             canary_input_event_t, const float[2]);
+void canary_script_set_recorder (canary_script_t *, canary_recorder_t *);
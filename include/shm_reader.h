@@ -0,0 +1,105 @@
+/** @file shm_reader.h
+ * Built into its own library, canary-shm-reader, which renderers can link
+ * without pulling in the Wasm runtime.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint32_t, uint64_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+#include "draw_format.h"
+
+/** @typedef canary_shm_reader_t
+ * Maps the memfd of a #canary_shm_writer_t read-only, and hands out views
+ * of its frames without copying them.
+ */
+typedef struct canary_shm_reader_s canary_shm_reader_t;
+
+/** @typedef canary_shm_frame_t
+ */
+typedef struct canary_shm_frame_s
+{
+  /** Counts up from one with every frame the writer publishes. */
+  uint64_t generation;
+  size_t panel_num;
+
+  /* private */
+  uint32_t slot;
+  uint64_t sequence;
+} canary_shm_frame_t;
+
+/** @typedef canary_shm_panel_t
+ * Points straight into the shared mapping.
+ */
+typedef struct canary_shm_panel_s
+{
+  uint32_t id;
+  float color[4];
+  float size[2];
+
+  /** #canary_draw_vertex_t or #canary_draw_compact_vertex_t. */
+  canary_draw_format_t format;
+  const void *vertices;
+  size_t vertex_num;
+
+  /** 4 for #canary_draw_index_t, or 2 for #canary_draw_compact_index_t. */
+  size_t index_size;
+  const void *indices;
+  size_t index_num;
+} canary_shm_panel_t;
+
+/** @function canary_shm_reader_create
+ * @param reader
+ * @param alloc
+ * @param fd From #canary_shm_writer_get_fd. Still owned by the caller,
+ * and may be closed once the reader is created.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_shm_reader_create (canary_shm_reader_t **,
+                                       const mdo_allocator_t *, int);
+
+/** @function canary_shm_reader_delete
+ * @param reader
+ */
+void canary_shm_reader_delete (canary_shm_reader_t *);
+
+/** @function canary_shm_reader_acquire
+ * Starts reading the latest frame. Nothing is copied, so the writer may
+ * overwrite the frame while it is in use; check with
+ * #canary_shm_reader_release before trusting anything read from it.
+ * @param reader
+ * @param frame
+ * @return Zero on success, or nonzero if no frame has been published yet
+ * or the writer is already reusing the latest frame's slot, in which case
+ * trying again gets a newer one.
+ */
+int canary_shm_reader_acquire (canary_shm_reader_t *, canary_shm_frame_t *);
+
+/** @function canary_shm_reader_get_panel
+ * Views are bounds-checked against the slot, so even a torn frame can't
+ * point outside of the mapping.
+ * @param reader
+ * @param frame
+ * @param index Less than the frame's panel_num.
+ * @param panel
+ * @return Zero on success, or nonzero if the panel's record is invalid,
+ * which can only happen if the frame was overwritten.
+ */
+int canary_shm_reader_get_panel (canary_shm_reader_t *,
+                                 const canary_shm_frame_t *, size_t,
+                                 canary_shm_panel_t *);
+
+/** @function canary_shm_reader_release
+ * Finishes reading a frame, for example once its buffers are uploaded.
+ * @param reader
+ * @param frame
+ * @return True if the frame stayed intact the whole time, or false if the
+ * writer overwrote it and what was read must be thrown away.
+ */
+bool canary_shm_reader_release (canary_shm_reader_t *,
+                                const canary_shm_frame_t *);
@@ -0,0 +1,70 @@
+/** @file shm_writer.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint32_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+#include "panel.h"
+
+/** @typedef canary_shm_writer_t
+ * Publishes the draw lists of a set of panels, once per frame, into a ring
+ * of slots in a memfd, for a renderer in another process to read with a
+ * #canary_shm_reader_t. Each slot is guarded by a seqlock, so the writer
+ * never waits on readers; a reader that falls a whole ring behind is told
+ * that its frame was overwritten.
+ */
+typedef struct canary_shm_writer_s canary_shm_writer_t;
+
+/** @function canary_shm_writer_create
+ * @param writer
+ * @param alloc
+ * @param slot_size The most bytes a single frame can take, including a
+ * record for each panel.
+ * @param slot_num How many frames the ring holds, at least two.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_shm_writer_create (canary_shm_writer_t **,
+                                       const mdo_allocator_t *, size_t,
+                                       uint32_t);
+
+/** @function canary_shm_writer_delete
+ * Readers keep their mappings, which stay valid.
+ * @param writer
+ */
+void canary_shm_writer_delete (canary_shm_writer_t *);
+
+/** @function canary_shm_writer_get_fd
+ * The memfd to hand to the reading process, for example over a Unix
+ * socket. Its size is sealed, so readers can trust it.
+ * @param writer
+ * @return A file descriptor owned by the writer.
+ */
+int canary_shm_writer_get_fd (canary_shm_writer_t *);
+
+/** @function canary_shm_writer_begin_frame
+ * @param writer
+ */
+void canary_shm_writer_begin_frame (canary_shm_writer_t *);
+
+/** @function canary_shm_writer_write_panel
+ * Copies a panel's draw list, color, and size into the current frame, in
+ * whichever format the draw list has.
+ * @param writer
+ * @param id Identifies the panel to the reader.
+ * @param panel
+ * @return Zero on success, or nonzero if the panel doesn't fit into the
+ * rest of the slot, in which case the frame goes out without it.
+ */
+int canary_shm_writer_write_panel (canary_shm_writer_t *, uint32_t,
+                                   canary_panel_t *);
+
+/** @function canary_shm_writer_end_frame
+ * Publishes the current frame to readers.
+ * @param writer
+ */
+void canary_shm_writer_end_frame (canary_shm_writer_t *);
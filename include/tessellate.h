@@ -0,0 +1,66 @@
+/** @file tessellate.h
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h> /* for uint32_t */
+
+#include "draw_list.h"
+
+/** @def CANARY_TESSELLATE_MAX_SEGMENTS
+ * The most segments a full circle is split into.
+ */
+#define CANARY_TESSELLATE_MAX_SEGMENTS 256
+
+/** @function canary_tessellate_segments
+ * Picks how many segments a full circle needs to look round on screen.
+ * @param radius The radius in panel units.
+ * @param pixel_scale The number of pixels one panel unit covers.
+ * @return The segment count, a multiple of 4.
+ */
+uint32_t canary_tessellate_segments (float, float);
+
+/** @function canary_draw_rect
+ * @param ui_draw
+ * @param position The minimum corner.
+ * @param size
+ * @param color
+ */
+void canary_draw_rect (canary_draw_list_t *, const float[2], const float[2],
+                       const float[4]);
+
+/** @function canary_draw_rounded_rect
+ * @param ui_draw
+ * @param position The minimum corner.
+ * @param size
+ * @param radius The corner radius, clamped to half of the smaller side.
+ * @param color
+ * @param segments Segments for a full circle of the corner radius; see
+ * #canary_tessellate_segments.
+ */
+void canary_draw_rounded_rect (canary_draw_list_t *, const float[2],
+                               const float[2], float, const float[4],
+                               uint32_t);
+
+/** @function canary_draw_circle
+ * @param ui_draw
+ * @param center
+ * @param radius
+ * @param color
+ * @param segments See #canary_tessellate_segments.
+ */
+void canary_draw_circle (canary_draw_list_t *, const float[2], float,
+                         const float[4], uint32_t);
+
+/** @function canary_draw_polyline
+ * Strokes a line through the given points, with mitered joins.
+ * @param ui_draw
+ * @param points Interleaved x and y coordinates.
+ * @param point_num
+ * @param width
+ * @param closed Whether the last point connects back to the first.
+ * @param color
+ */
+void canary_draw_polyline (canary_draw_list_t *, const float *, size_t,
+                           float, bool, const float[4]);
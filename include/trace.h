@@ -0,0 +1,54 @@
+/** @file trace.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+/** @typedef canary_trace_t
+ * Records begin and end events from any number of threads into per-thread
+ * rings, and writes them out as a Chrome trace, which can be opened in
+ * chrome://tracing or Perfetto. Recording never takes a lock, except the
+ * first time each thread records an event.
+ */
+typedef struct canary_trace_s canary_trace_t;
+
+/** @function canary_trace_create
+ * @param trace
+ * @param alloc
+ * @param event_num How many of the latest events to keep per thread.
+ * Rounded up to a power of two.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_trace_create (canary_trace_t **, const mdo_allocator_t *,
+                                  size_t);
+
+/** @function canary_trace_delete
+ * No thread may be recording into the trace.
+ * @param trace
+ */
+void canary_trace_delete (canary_trace_t *);
+
+/** @function canary_trace_begin
+ * @param trace
+ * @param name Must outlive the trace, like a string literal.
+ */
+void canary_trace_begin (canary_trace_t *, const char *);
+
+/** @function canary_trace_end
+ * @param trace
+ * @param name The name given to the matching #canary_trace_begin.
+ */
+void canary_trace_end (canary_trace_t *, const char *);
+
+/** @function canary_trace_write_json
+ * Writes every event still in the rings. Safe to call while other threads
+ * are recording; events overwritten during the write are left out.
+ * @param trace
+ * @param filename
+ * @return Zero on success.
+ */
+int canary_trace_write_json (canary_trace_t *, const char *);
@@ -0,0 +1,73 @@
+/** @file watchdog.h
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+#include <wasmtime.h>
+
+/** @typedef canary_watchdog_t
+ * A background thread that interrupts Wasm code once it runs past a
+ * deadline. One watchdog serves every store created from a runtime.
+ */
+typedef struct canary_watchdog_s canary_watchdog_t;
+
+/** @typedef canary_watchdog_timer_t
+ * A deadline for a single store, armed around each call into the store.
+ */
+typedef struct canary_watchdog_timer_s canary_watchdog_timer_t;
+
+/** @function canary_watchdog_create
+ * @param watchdog
+ * @param alloc
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_watchdog_create (canary_watchdog_t **,
+                                     const mdo_allocator_t *);
+
+/** @function canary_watchdog_delete
+ * Every timer created from the watchdog must be deleted first.
+ * @param watchdog
+ */
+void canary_watchdog_delete (canary_watchdog_t *);
+
+/** @function canary_watchdog_timer_create
+ * @param timer
+ * @param watchdog
+ * @param handle The store's interrupt handle. Owned by the timer.
+ * @return #mdo_result_t.
+ */
+mdo_result_t canary_watchdog_timer_create (canary_watchdog_timer_t **,
+                                           canary_watchdog_t *,
+                                           wasmtime_interrupt_handle_t *);
+
+/** @function canary_watchdog_timer_delete
+ * @param timer
+ */
+void canary_watchdog_timer_delete (canary_watchdog_timer_t *);
+
+/** @function canary_watchdog_timer_arm
+ * Interrupts the store once the given time has passed, unless the timer is
+ * disarmed first.
+ * @param timer
+ * @param seconds
+ */
+void canary_watchdog_timer_arm (canary_watchdog_timer_t *, float);
+
+/** @function canary_watchdog_timer_disarm
+ * @param timer
+ * @return True if the timer fired while it was armed.
+ */
+bool canary_watchdog_timer_disarm (canary_watchdog_timer_t *);
+
+/** @function canary_watchdog_timer_fired
+ * Doesn't take the watchdog's lock, so it is cheap enough to check around
+ * every call into the store. Must be called from the thread that arms the
+ * timer.
+ * @param timer
+ * @return True if the timer is armed and has already fired.
+ */
+bool canary_watchdog_timer_fired (canary_watchdog_timer_t *);
@@ -3,6 +3,7 @@
 
 #include <wasmtime.h>
 
+#include "profile.h"
 #include "script.h"
 
 /**
@@ -12,3 +13,18 @@
   wasm_trap_t *name (void *env, wasmtime_caller_t *caller,                    \
                      const wasmtime_val_t *args, size_t arg_num,              \
                      wasmtime_val_t *results, size_t result_num)
+
+/** @function canary_script_from_caller
+ * @param caller
+ * @return The script that a callback's caller belongs to.
+ */
+canary_script_t *canary_script_from_caller (wasmtime_caller_t *);
+
+/** @function canary_script_get_import_profile
+ * @param script
+ * @param index The import's index in the script's runtime.
+ * @return Where to record the import's calls, or NULL if the script isn't
+ * being profiled.
+ */
+canary_profile_stats_t *canary_script_get_import_profile (canary_script_t *,
+                                                          size_t);
@@ -0,0 +1,337 @@
+/** @file capture.c
+ */
+
+#include "capture.h"
+
+#include <stdio.h>
+#include <string.h> /* for memcpy, memset */
+
+#ifdef CANARY_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include "capture_format.h"
+
+/* TODO(marceline-cramer): use mdo-utils vector */
+typedef struct capture_buffer_s
+{
+  uint8_t *vals;
+  size_t size;
+  size_t capacity;
+} capture_buffer_t;
+
+struct canary_capture_s
+{
+  const mdo_allocator_t *alloc;
+  FILE *file;
+  uint32_t flags;
+
+  /* the frame being recorded */
+  capture_buffer_t records;
+  capture_buffer_t data;
+
+  /* only used when compressing */
+  capture_buffer_t payload;
+  capture_buffer_t compressed;
+};
+
+static const uint8_t ZEROS[CAPTURE_ALIGN] = { 0 };
+
+static void
+reserve (const mdo_allocator_t *alloc, capture_buffer_t *buffer,
+         size_t capacity)
+{
+  if (buffer->vals && capacity <= buffer->capacity)
+    return;
+
+  size_t new_capacity = buffer->capacity ? buffer->capacity : 4096;
+  while (new_capacity < capacity)
+    new_capacity = new_capacity << 1;
+
+  if (buffer->vals)
+    buffer->vals = mdo_allocator_realloc (alloc, buffer->vals, new_capacity);
+  else
+    buffer->vals = mdo_allocator_malloc (alloc, new_capacity);
+
+  buffer->capacity = new_capacity;
+}
+
+/* appends room for the given size, zero-padded to the capture alignment */
+static void *
+push_aligned (const mdo_allocator_t *alloc, capture_buffer_t *buffer,
+              size_t size)
+{
+  size_t aligned = CAPTURE_ALIGN_UP (size);
+  reserve (alloc, buffer, buffer->size + aligned);
+
+  uint8_t *dst = buffer->vals + buffer->size;
+  memset (dst + size, 0, aligned - size);
+  buffer->size += aligned;
+
+  return dst;
+}
+
+static void
+free_buffer (const mdo_allocator_t *alloc, capture_buffer_t *buffer)
+{
+  if (buffer->vals)
+    mdo_allocator_free (alloc, buffer->vals);
+}
+
+mdo_result_t
+canary_capture_create (canary_capture_t **capture,
+                       const mdo_allocator_t *alloc, const char *filename,
+                       uint32_t flags)
+{
+  canary_capture_t *new_capture
+      = mdo_allocator_calloc (alloc, 1, sizeof (canary_capture_t));
+  *capture = new_capture;
+
+  new_capture->alloc = alloc;
+
+#ifndef CANARY_HAVE_LZ4
+  if (flags & CANARY_CAPTURE_COMPRESS)
+    {
+      LOG_ERR ("canary was built without LZ4; capturing uncompressed");
+      flags &= ~CANARY_CAPTURE_COMPRESS;
+    }
+#endif
+
+  new_capture->flags = flags;
+
+  new_capture->file = fopen (filename, "wb");
+  if (!new_capture->file)
+    {
+      mdo_result_t result = mdo_result_create (
+          MDO_LOG_ERROR, "failed to open capture %s", 1, false);
+      return LOG_RESULT (result, filename);
+    }
+
+  capture_header_t header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, CAPTURE_MAGIC, sizeof (CAPTURE_MAGIC));
+  header.version = CAPTURE_VERSION;
+
+  if (fwrite (&header, sizeof (header), 1, new_capture->file) != 1)
+    {
+      mdo_result_t result = mdo_result_create (
+          MDO_LOG_ERROR, "failed to write capture %s", 1, false);
+      return LOG_RESULT (result, filename);
+    }
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_capture_delete (canary_capture_t *capture)
+{
+  const mdo_allocator_t *alloc = capture->alloc;
+
+  if (capture->file)
+    fclose (capture->file);
+
+  free_buffer (alloc, &capture->records);
+  free_buffer (alloc, &capture->data);
+  free_buffer (alloc, &capture->payload);
+  free_buffer (alloc, &capture->compressed);
+
+  mdo_allocator_free (alloc, capture);
+}
+
+void
+canary_capture_begin_frame (canary_capture_t *capture)
+{
+  capture->records.size = 0;
+  capture->data.size = 0;
+}
+
+void
+canary_capture_write_panel (canary_capture_t *capture, uint32_t id,
+                            canary_panel_t *panel)
+{
+  const mdo_allocator_t *alloc = capture->alloc;
+  canary_draw_list_t *draw_list = canary_panel_get_draw_list (panel);
+
+  size_t vertex_num = 0;
+  size_t index_num = 0;
+
+  if (draw_list)
+    {
+      vertex_num = canary_draw_list_vertex_count (draw_list);
+      index_num = canary_draw_list_index_count (draw_list);
+    }
+
+  capture_panel_t *record
+      = push_aligned (alloc, &capture->records, sizeof (capture_panel_t));
+  memset (record, 0, sizeof (capture_panel_t));
+
+  record->id = id;
+  canary_panel_get_color (panel, record->color);
+  canary_panel_get_size (panel, record->size);
+
+  /* relative to the data for now, until the frame's size is known */
+  record->vertex_offset = capture->data.size;
+  record->vertex_num = vertex_num;
+
+  canary_draw_vertex_t *vertices = push_aligned (
+      alloc, &capture->data, vertex_num * sizeof (canary_draw_vertex_t));
+
+  if (vertex_num > 0)
+    {
+      if (canary_draw_list_get_format (draw_list)
+          == CANARY_DRAW_FORMAT_COMPACT)
+        canary_draw_unpack_vertices (
+            vertices, canary_draw_list_compact_vertex_buffer (draw_list),
+            vertex_num);
+      else
+        memcpy (vertices, canary_draw_list_vertex_buffer (draw_list),
+                vertex_num * sizeof (canary_draw_vertex_t));
+    }
+
+  record->index_offset = capture->data.size;
+  record->index_num = index_num;
+
+  canary_draw_index_t *indices = push_aligned (
+      alloc, &capture->data, index_num * sizeof (canary_draw_index_t));
+
+  if (index_num > 0)
+    {
+      const canary_draw_index_t *src
+          = canary_draw_list_index_buffer (draw_list);
+
+      if (src)
+        {
+          memcpy (indices, src, index_num * sizeof (canary_draw_index_t));
+        }
+      else
+        {
+          const canary_draw_compact_index_t *compact
+              = canary_draw_list_compact_index_buffer (draw_list);
+
+          for (size_t i = 0; i < index_num; i++)
+            indices[i] = compact[i];
+        }
+    }
+}
+
+/* writes a chunk's payload in pieces, followed by its padding */
+static int
+write_chunk (canary_capture_t *capture, const capture_chunk_t *chunk,
+             const void *const *pieces, const size_t *piece_sizes,
+             size_t piece_num)
+{
+  FILE *file = capture->file;
+
+  if (fwrite (chunk, sizeof (capture_chunk_t), 1, file) != 1)
+    return -1;
+
+  for (size_t i = 0; i < piece_num; i++)
+    {
+      if (piece_sizes[i] > 0
+          && fwrite (pieces[i], piece_sizes[i], 1, file) != 1)
+        return -1;
+    }
+
+  size_t padding = CAPTURE_ALIGN_UP (chunk->size) - chunk->size;
+  if (padding > 0 && fwrite (ZEROS, padding, 1, file) != 1)
+    return -1;
+
+  return 0;
+}
+
+#ifdef CANARY_HAVE_LZ4
+/* returns nonzero if compression wouldn't save anything */
+static int
+compress_frame (canary_capture_t *capture, const void *const *pieces,
+                const size_t *piece_sizes, size_t piece_num,
+                size_t raw_size)
+{
+  const mdo_allocator_t *alloc = capture->alloc;
+
+  if (raw_size > LZ4_MAX_INPUT_SIZE)
+    return -1;
+
+  capture->payload.size = 0;
+  reserve (alloc, &capture->payload, raw_size);
+
+  for (size_t i = 0; i < piece_num; i++)
+    {
+      if (piece_sizes[i] == 0)
+        continue;
+
+      memcpy (capture->payload.vals + capture->payload.size, pieces[i],
+              piece_sizes[i]);
+      capture->payload.size += piece_sizes[i];
+    }
+
+  int bound = LZ4_compressBound (raw_size);
+  reserve (alloc, &capture->compressed, bound);
+
+  int compressed_size = LZ4_compress_default (
+      (const char *)capture->payload.vals, (char *)capture->compressed.vals,
+      raw_size, bound);
+
+  if (compressed_size <= 0 || (size_t)compressed_size >= raw_size)
+    return -1;
+
+  capture->compressed.size = compressed_size;
+  return 0;
+}
+#endif
+
+int
+canary_capture_end_frame (canary_capture_t *capture)
+{
+  size_t panel_num = capture->records.size / sizeof (capture_panel_t);
+
+  /* the records were padded as they were pushed, so the data follows them
+   * at an aligned offset */
+  uint64_t data_offset = sizeof (capture_frame_t) + capture->records.size;
+
+  capture_panel_t *records = (capture_panel_t *)capture->records.vals;
+  for (size_t i = 0; i < panel_num; i++)
+    {
+      records[i].vertex_offset += data_offset;
+      records[i].index_offset += data_offset;
+    }
+
+  capture_frame_t frame;
+  memset (&frame, 0, sizeof (frame));
+  frame.panel_num = panel_num;
+
+  const void *pieces[3] = { &frame, capture->records.vals,
+                            capture->data.vals };
+  size_t piece_sizes[3]
+      = { sizeof (frame), capture->records.size, capture->data.size };
+
+  capture_chunk_t chunk;
+  memset (&chunk, 0, sizeof (chunk));
+  chunk.type = CAPTURE_CHUNK_FRAME;
+  chunk.raw_size = data_offset + capture->data.size;
+  chunk.size = chunk.raw_size;
+
+  int result;
+
+#ifdef CANARY_HAVE_LZ4
+  if ((capture->flags & CANARY_CAPTURE_COMPRESS)
+      && !compress_frame (capture, pieces, piece_sizes, 3, chunk.raw_size))
+    {
+      const void *compressed = capture->compressed.vals;
+      size_t compressed_size = capture->compressed.size;
+
+      chunk.flags = CAPTURE_CHUNK_LZ4;
+      chunk.size = compressed_size;
+      result = write_chunk (capture, &chunk, &compressed, &compressed_size,
+                            1);
+    }
+  else
+#endif
+    {
+      result = write_chunk (capture, &chunk, pieces, piece_sizes, 3);
+    }
+
+  if (result)
+    LOG_ERR ("failed to write capture frame");
+
+  return result;
+}
@@ -0,0 +1,70 @@
+/** @file capture_format.h
+ * The layout of a draw list capture file, shared by the writer and the
+ * replay library. Everything is stored in host byte order.
+ */
+
+#pragma once
+
+#include <stdint.h> /* for uint32_t, uint64_t */
+
+#define CAPTURE_MAGIC "CNRYCAP"
+#define CAPTURE_VERSION 1
+
+/* chunks start, and offsets within a frame are, aligned to this, so that
+ * uncompressed frames can be used in place from a mapping */
+#define CAPTURE_ALIGN 16
+
+#define CAPTURE_ALIGN_UP(size)                                               \
+  (((uint64_t)(size) + CAPTURE_ALIGN - 1) & ~(uint64_t)(CAPTURE_ALIGN - 1))
+
+typedef struct capture_header_s
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+} capture_header_t;
+
+/* chunks of unknown types are skipped, so that new ones can be added */
+typedef enum capture_chunk_type_e
+{
+  CAPTURE_CHUNK_FRAME = 1,
+} capture_chunk_type_t;
+
+#define CAPTURE_CHUNK_LZ4 (1 << 0)
+
+/* followed by the chunk's payload, padded to CAPTURE_ALIGN */
+typedef struct capture_chunk_s
+{
+  uint32_t type;
+  uint32_t flags;
+
+  /* the payload's size in the file, and once decompressed */
+  uint64_t size;
+  uint64_t raw_size;
+
+  uint64_t reserved;
+} capture_chunk_t;
+
+/* a frame's payload begins with this and its panel records, followed by
+ * the buffers the records point into */
+typedef struct capture_frame_s
+{
+  uint32_t panel_num;
+  uint32_t reserved[3];
+} capture_frame_t;
+
+typedef struct capture_panel_s
+{
+  uint32_t id;
+  uint32_t reserved;
+
+  float color[4];
+  float size[2];
+
+  /* relative to the start of the payload; vertices are always
+   * #canary_draw_vertex_t and indices #canary_draw_index_t */
+  uint64_t vertex_offset;
+  uint64_t vertex_num;
+  uint64_t index_offset;
+  uint64_t index_num;
+} capture_panel_t;
@@ -0,0 +1,134 @@
+/** @file draw_format.c
+ */
+
+#include "draw_format.h"
+
+#include <string.h> /* for memcpy */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#else
+#include <math.h> /* for lrintf */
+#endif
+
+#define POSITION_SCALE 32767.0f
+#define COLOR_SCALE 255.0f
+
+#if defined(__SSE2__)
+
+void
+canary_draw_pack_vertices (canary_draw_compact_vertex_t *dst,
+                           const canary_draw_vertex_t *src, size_t vertex_num)
+{
+  const __m128 position_min = _mm_set1_ps (-1.0f);
+  const __m128 one = _mm_set1_ps (1.0f);
+  const __m128 zero = _mm_setzero_ps ();
+  const __m128 position_scale = _mm_set1_ps (POSITION_SCALE);
+  const __m128 color_scale = _mm_set1_ps (COLOR_SCALE);
+
+  for (size_t i = 0; i < vertex_num; i++)
+    {
+      __m128 position = _mm_castpd_ps (
+          _mm_load_sd ((const double *)(const void *)src[i].position));
+      __m128 color = _mm_loadu_ps (src[i].color);
+
+      position = _mm_min_ps (_mm_max_ps (position, position_min), one);
+      color = _mm_min_ps (_mm_max_ps (color, zero), one);
+
+      /* round to nearest, like lrintf */
+      __m128i position_i
+          = _mm_cvtps_epi32 (_mm_mul_ps (position, position_scale));
+      __m128i color_i = _mm_cvtps_epi32 (_mm_mul_ps (color, color_scale));
+
+      __m128i position_16 = _mm_packs_epi32 (position_i, position_i);
+      __m128i color_16 = _mm_packs_epi32 (color_i, color_i);
+      __m128i color_8 = _mm_packus_epi16 (color_16, color_16);
+
+      uint32_t packed[2];
+      packed[0] = _mm_cvtsi128_si32 (position_16);
+      packed[1] = _mm_cvtsi128_si32 (color_8);
+      memcpy (&dst[i], packed, sizeof (packed));
+    }
+}
+
+void
+canary_draw_unpack_vertices (canary_draw_vertex_t *dst,
+                             const canary_draw_compact_vertex_t *src,
+                             size_t vertex_num)
+{
+  const __m128 position_min = _mm_set1_ps (-1.0f);
+  const __m128 position_scale = _mm_set1_ps (1.0f / POSITION_SCALE);
+  const __m128 color_scale = _mm_set1_ps (1.0f / COLOR_SCALE);
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (size_t i = 0; i < vertex_num; i++)
+    {
+      __m128i packed
+          = _mm_loadl_epi64 ((const __m128i *)(const void *)&src[i]);
+
+      /* sign-extend the positions, zero-extend the colors */
+      __m128i position_i
+          = _mm_srai_epi32 (_mm_unpacklo_epi16 (packed, packed), 16);
+      __m128i color_i = _mm_unpacklo_epi16 (
+          _mm_unpacklo_epi8 (_mm_srli_si128 (packed, 4), zero), zero);
+
+      __m128 position = _mm_mul_ps (_mm_cvtepi32_ps (position_i),
+                                    position_scale);
+      position = _mm_max_ps (position, position_min);
+      __m128 color = _mm_mul_ps (_mm_cvtepi32_ps (color_i), color_scale);
+
+      _mm_store_sd ((double *)(void *)dst[i].position,
+                    _mm_castps_pd (position));
+      _mm_storeu_ps (dst[i].color, color);
+    }
+}
+
+#else
+
+/* same operand order as maxps and minps, so NaN clamps to min */
+static float
+clamp (float value, float min, float max)
+{
+  value = value > min ? value : min;
+  return value < max ? value : max;
+}
+
+void
+canary_draw_pack_vertices (canary_draw_compact_vertex_t *dst,
+                           const canary_draw_vertex_t *src, size_t vertex_num)
+{
+  for (size_t i = 0; i < vertex_num; i++)
+    {
+      for (int j = 0; j < 2; j++)
+        {
+          float position = clamp (src[i].position[j], -1.0f, 1.0f);
+          dst[i].position[j] = lrintf (position * POSITION_SCALE);
+        }
+
+      for (int j = 0; j < 4; j++)
+        {
+          float color = clamp (src[i].color[j], 0.0f, 1.0f);
+          dst[i].color[j] = lrintf (color * COLOR_SCALE);
+        }
+    }
+}
+
+void
+canary_draw_unpack_vertices (canary_draw_vertex_t *dst,
+                             const canary_draw_compact_vertex_t *src,
+                             size_t vertex_num)
+{
+  for (size_t i = 0; i < vertex_num; i++)
+    {
+      for (int j = 0; j < 2; j++)
+        {
+          float position = src[i].position[j] * (1.0f / POSITION_SCALE);
+          dst[i].position[j] = position < -1.0f ? -1.0f : position;
+        }
+
+      for (int j = 0; j < 4; j++)
+        dst[i].color[j] = src[i].color[j] * (1.0f / COLOR_SCALE);
+    }
+}
+
+#endif
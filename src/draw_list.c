@@ -5,35 +5,73 @@
 
 #include <string.h> /* for memcpy */
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* compact lists switch to 32-bit indices at this many vertices */
+#define COMPACT_INDEX_LIMIT 65536
+
 struct canary_draw_list_s
 {
   const mdo_allocator_t *alloc;
 
+  /* if set, the buffers belong to the arena */
+  canary_frame_arena_t *arena;
+
+  canary_draw_format_t format;
+
+  /* in bytes; compact lists widen their indices when they outgrow 16 bits,
+   * and narrow them again when cleared */
+  size_t vertex_size;
+  size_t index_size;
+
   /* TODO(marceline-cramer): mdo-utils vector */
   struct
   {
-    canary_draw_vertex_t *vals;
+    uint8_t *vals;
     size_t size;
     size_t capacity;
   } vertices;
 
   struct
   {
-    canary_draw_index_t *vals;
+    uint8_t *vals;
     size_t size;
     size_t capacity;
   } indices;
+
+  /* kept between welds so that steady state doesn't allocate */
+  struct
+  {
+    uint32_t *vals;
+    size_t capacity;
+  } weld_scratch;
 };
 
 mdo_result_t
-canary_draw_list_create (canary_draw_list_t **draw_list,
-                         const mdo_allocator_t *alloc)
+canary_draw_list_create_with_format (canary_draw_list_t **draw_list,
+                                     const mdo_allocator_t *alloc,
+                                     canary_draw_format_t format)
 {
   canary_draw_list_t *new_draw_list
       = mdo_allocator_malloc (alloc, sizeof (canary_draw_list_t));
   *draw_list = new_draw_list;
 
   new_draw_list->alloc = alloc;
+  new_draw_list->arena = NULL;
+  new_draw_list->format = format;
+
+  if (format == CANARY_DRAW_FORMAT_COMPACT)
+    {
+      new_draw_list->vertex_size = sizeof (canary_draw_compact_vertex_t);
+      new_draw_list->index_size = sizeof (canary_draw_compact_index_t);
+    }
+  else
+    {
+      new_draw_list->vertex_size = sizeof (canary_draw_vertex_t);
+      new_draw_list->index_size = sizeof (canary_draw_index_t);
+    }
 
   new_draw_list->vertices.vals = NULL;
   new_draw_list->vertices.size = 0;
@@ -43,19 +81,51 @@ canary_draw_list_create (canary_draw_list_t **draw_list,
   new_draw_list->indices.size = 0;
   new_draw_list->indices.capacity = 0;
 
+  new_draw_list->weld_scratch.vals = NULL;
+  new_draw_list->weld_scratch.capacity = 0;
+
   return MDO_SUCCESS;
 }
 
+mdo_result_t
+canary_draw_list_create (canary_draw_list_t **draw_list,
+                         const mdo_allocator_t *alloc)
+{
+  return canary_draw_list_create_with_format (draw_list, alloc,
+                                              CANARY_DRAW_FORMAT_FLOAT);
+}
+
+mdo_result_t
+canary_draw_list_create_in_arena (canary_draw_list_t **draw_list,
+                                  const mdo_allocator_t *alloc,
+                                  canary_frame_arena_t *arena,
+                                  canary_draw_format_t format)
+{
+  mdo_result_t result
+      = canary_draw_list_create_with_format (draw_list, alloc, format);
+
+  if (mdo_result_success (result))
+    (*draw_list)->arena = arena;
+
+  return result;
+}
+
 void
 canary_draw_list_delete (canary_draw_list_t *draw_list)
 {
   const mdo_allocator_t *alloc = draw_list->alloc;
 
-  if (draw_list->vertices.vals)
-    mdo_allocator_free (alloc, draw_list->vertices.vals);
+  if (!draw_list->arena)
+    {
+      if (draw_list->vertices.vals)
+        mdo_allocator_free (alloc, draw_list->vertices.vals);
 
-  if (draw_list->indices.vals)
-    mdo_allocator_free (alloc, draw_list->indices.vals);
+      if (draw_list->indices.vals)
+        mdo_allocator_free (alloc, draw_list->indices.vals);
+    }
+
+  if (draw_list->weld_scratch.vals)
+    mdo_allocator_free (alloc, draw_list->weld_scratch.vals);
 
   mdo_allocator_free (alloc, draw_list);
 }
@@ -65,32 +135,162 @@ canary_draw_list_clear (canary_draw_list_t *draw_list)
 {
   draw_list->vertices.size = 0;
   draw_list->indices.size = 0;
+
+  /* the same bytes hold twice as many narrow indices */
+  if (draw_list->format == CANARY_DRAW_FORMAT_COMPACT
+      && draw_list->index_size != sizeof (canary_draw_compact_index_t))
+    {
+      draw_list->index_size = sizeof (canary_draw_compact_index_t);
+      draw_list->indices.capacity = draw_list->indices.capacity << 1;
+    }
 }
 
-canary_draw_index_t
-canary_draw_vertex (canary_draw_list_t *draw_list,
-                    const canary_draw_vertex_t *vertex)
+static uint8_t *
+grow_buffer (canary_draw_list_t *draw_list, uint8_t *vals, size_t used,
+             size_t size)
 {
   const mdo_allocator_t *alloc = draw_list->alloc;
 
-  canary_draw_index_t index = draw_list->vertices.size++;
-
-  if (draw_list->vertices.capacity == 0)
-    {
-      draw_list->vertices.capacity = 1024;
-      draw_list->vertices.vals = mdo_allocator_calloc (
-          alloc, draw_list->vertices.capacity, sizeof (canary_draw_vertex_t));
-    }
-  else if (index >= draw_list->vertices.capacity)
+  if (draw_list->arena)
     {
-      draw_list->vertices.capacity = draw_list->vertices.capacity << 1;
-      draw_list->vertices.vals = mdo_allocator_realloc (
-          alloc, draw_list->vertices.vals,
-          sizeof (canary_draw_vertex_t) * draw_list->vertices.capacity);
+      uint8_t *new_vals = canary_frame_arena_alloc (draw_list->arena, size);
+
+      if (vals)
+        memcpy (new_vals, vals, used);
+
+      return new_vals;
     }
 
-  canary_draw_vertex_t *dst = &draw_list->vertices.vals[index];
-  memcpy (dst, vertex, sizeof (canary_draw_vertex_t));
+  if (vals)
+    return mdo_allocator_realloc (alloc, vals, size);
+
+  return mdo_allocator_calloc (alloc, size, 1);
+}
+
+static void
+reserve_vertices (canary_draw_list_t *draw_list, size_t size)
+{
+  if (size <= draw_list->vertices.capacity)
+    return;
+
+  size_t capacity = draw_list->vertices.capacity;
+  if (capacity == 0)
+    capacity = 1024;
+
+  while (capacity < size)
+    capacity = capacity << 1;
+
+  draw_list->vertices.vals = grow_buffer (
+      draw_list, draw_list->vertices.vals,
+      draw_list->vertex_size * draw_list->vertices.size,
+      draw_list->vertex_size * capacity);
+
+  draw_list->vertices.capacity = capacity;
+}
+
+static void
+reserve_indices (canary_draw_list_t *draw_list, size_t size)
+{
+  if (size <= draw_list->indices.capacity)
+    return;
+
+  size_t capacity = draw_list->indices.capacity;
+  if (capacity == 0)
+    capacity = 1536;
+
+  while (capacity < size)
+    capacity = capacity << 1;
+
+  draw_list->indices.vals = grow_buffer (
+      draw_list, draw_list->indices.vals,
+      draw_list->index_size * draw_list->indices.size,
+      draw_list->index_size * capacity);
+
+  draw_list->indices.capacity = capacity;
+}
+
+/* switches a compact list to 32-bit indices if it will need them */
+static void
+reserve_index_range (canary_draw_list_t *draw_list, size_t vertex_num)
+{
+  if (vertex_num < COMPACT_INDEX_LIMIT
+      || draw_list->index_size == sizeof (canary_draw_index_t))
+    return;
+
+  const mdo_allocator_t *alloc = draw_list->alloc;
+
+  size_t index_num = draw_list->indices.size;
+  size_t capacity = draw_list->indices.capacity;
+  const canary_draw_compact_index_t *src
+      = (const canary_draw_compact_index_t *)draw_list->indices.vals;
+
+  canary_draw_index_t *dst;
+  if (draw_list->arena)
+    dst = canary_frame_arena_alloc (draw_list->arena,
+                                    sizeof (canary_draw_index_t) * capacity);
+  else
+    dst = mdo_allocator_calloc (alloc, capacity, sizeof (canary_draw_index_t));
+
+  for (size_t i = 0; i < index_num; i++)
+    dst[i] = src[i];
+
+  if (!draw_list->arena && draw_list->indices.vals)
+    mdo_allocator_free (alloc, draw_list->indices.vals);
+
+  draw_list->indices.vals = (uint8_t *)dst;
+  draw_list->index_size = sizeof (canary_draw_index_t);
+}
+
+void
+canary_draw_list_reset (canary_draw_list_t *draw_list)
+{
+  canary_draw_list_clear (draw_list);
+
+  if (!draw_list->arena)
+    return;
+
+  /* the old buffers went with the arena; take back the same capacity */
+  if (draw_list->vertices.capacity > 0)
+    draw_list->vertices.vals = canary_frame_arena_alloc (
+        draw_list->arena,
+        draw_list->vertex_size * draw_list->vertices.capacity);
+
+  if (draw_list->indices.capacity > 0)
+    draw_list->indices.vals = canary_frame_arena_alloc (
+        draw_list->arena, draw_list->index_size * draw_list->indices.capacity);
+}
+
+static void
+copy_vertices (canary_draw_list_t *draw_list, size_t offset,
+               canary_draw_format_t src_format, const void *src,
+               size_t vertex_num)
+{
+  /* appending an empty list, whose buffers may not exist yet */
+  if (vertex_num == 0)
+    return;
+
+  uint8_t *dst = draw_list->vertices.vals + draw_list->vertex_size * offset;
+
+  if (src_format == draw_list->format)
+    memcpy (dst, src, draw_list->vertex_size * vertex_num);
+  else if (draw_list->format == CANARY_DRAW_FORMAT_COMPACT)
+    canary_draw_pack_vertices ((canary_draw_compact_vertex_t *)dst, src,
+                               vertex_num);
+  else
+    canary_draw_unpack_vertices ((canary_draw_vertex_t *)dst, src,
+                                 vertex_num);
+}
+
+canary_draw_index_t
+canary_draw_vertex (canary_draw_list_t *draw_list,
+                    const canary_draw_vertex_t *vertex)
+{
+  canary_draw_index_t index = draw_list->vertices.size;
+  reserve_index_range (draw_list, index + 1);
+  reserve_vertices (draw_list, index + 1);
+  draw_list->vertices.size++;
+
+  copy_vertices (draw_list, index, CANARY_DRAW_FORMAT_FLOAT, vertex, 1);
 
   return index;
 }
@@ -104,7 +304,10 @@ canary_draw_list_vertex_count (canary_draw_list_t *draw_list)
 canary_draw_vertex_t *
 canary_draw_list_vertex_buffer (canary_draw_list_t *draw_list)
 {
-  return draw_list->vertices.vals;
+  if (draw_list->format != CANARY_DRAW_FORMAT_FLOAT)
+    return NULL;
+
+  return (canary_draw_vertex_t *)draw_list->vertices.vals;
 }
 
 size_t
@@ -116,7 +319,34 @@ canary_draw_list_index_count (canary_draw_list_t *draw_list)
 canary_draw_index_t *
 canary_draw_list_index_buffer (canary_draw_list_t *draw_list)
 {
-  return draw_list->indices.vals;
+  if (draw_list->index_size != sizeof (canary_draw_index_t))
+    return NULL;
+
+  return (canary_draw_index_t *)draw_list->indices.vals;
+}
+
+canary_draw_format_t
+canary_draw_list_get_format (canary_draw_list_t *draw_list)
+{
+  return draw_list->format;
+}
+
+canary_draw_compact_vertex_t *
+canary_draw_list_compact_vertex_buffer (canary_draw_list_t *draw_list)
+{
+  if (draw_list->format != CANARY_DRAW_FORMAT_COMPACT)
+    return NULL;
+
+  return (canary_draw_compact_vertex_t *)draw_list->vertices.vals;
+}
+
+canary_draw_compact_index_t *
+canary_draw_list_compact_index_buffer (canary_draw_list_t *draw_list)
+{
+  if (draw_list->index_size != sizeof (canary_draw_compact_index_t))
+    return NULL;
+
+  return (canary_draw_compact_index_t *)draw_list->indices.vals;
 }
 
 void
@@ -124,28 +354,581 @@ canary_draw_triangle (canary_draw_list_t *draw_list,
                       canary_draw_index_t vertex1, canary_draw_index_t vertex2,
                       canary_draw_index_t vertex3)
 {
-  const mdo_allocator_t *alloc = draw_list->alloc;
-
   size_t index_offset = draw_list->indices.size;
+  reserve_indices (draw_list, index_offset + 3);
   draw_list->indices.size += 3;
 
-  if (draw_list->indices.capacity == 0)
+  if (draw_list->index_size == sizeof (canary_draw_compact_index_t))
+    {
+      canary_draw_compact_index_t *indices
+          = (canary_draw_compact_index_t *)draw_list->indices.vals
+            + index_offset;
+
+      indices[0] = vertex1;
+      indices[1] = vertex2;
+      indices[2] = vertex3;
+    }
+  else
+    {
+      canary_draw_index_t *indices
+          = (canary_draw_index_t *)draw_list->indices.vals + index_offset;
+
+      indices[0] = vertex1;
+      indices[1] = vertex2;
+      indices[2] = vertex3;
+    }
+}
+
+/* branchless so that the compiler can vectorize the rebase; indices below
+ * first_index wrap around and fail the range check too */
+#define REBASE_INDICES(dst_type, src_type)                                   \
+  do                                                                          \
+    {                                                                         \
+      const src_type *src = indices;                                          \
+      dst_type *dst = (dst_type *)draw_list->indices.vals + index_offset;    \
+                                                                              \
+      for (size_t i = 0; i < index_num; i++)                                  \
+        {                                                                     \
+          canary_draw_index_t index = src[i] - first_index;                  \
+          out_of_range |= index >= limit;                                     \
+          dst[i] = index + base;                                              \
+        }                                                                     \
+    }                                                                         \
+  while (0)
+
+/* appends vertices, and indices that refer to them as
+ * [first_index, first_index + vertex_num) */
+static int
+append_buffers (canary_draw_list_t *draw_list,
+                canary_draw_format_t vertex_format, const void *vertices,
+                size_t vertex_num, size_t index_size, const void *indices,
+                size_t index_num, canary_draw_index_t first_index)
+{
+  size_t vertex_offset = draw_list->vertices.size;
+  size_t index_offset = draw_list->indices.size;
+
+  reserve_index_range (draw_list, vertex_offset + vertex_num);
+  reserve_vertices (draw_list, vertex_offset + vertex_num);
+  reserve_indices (draw_list, index_offset + index_num);
+
+  copy_vertices (draw_list, vertex_offset, vertex_format, vertices,
+                 vertex_num);
+
+  canary_draw_index_t base = vertex_offset;
+  canary_draw_index_t limit = vertex_num;
+  int out_of_range = 0;
+
+  int src_compact = index_size == sizeof (canary_draw_compact_index_t);
+  int dst_compact
+      = draw_list->index_size == sizeof (canary_draw_compact_index_t);
+
+  if (dst_compact && src_compact)
+    REBASE_INDICES (canary_draw_compact_index_t, canary_draw_compact_index_t);
+  else if (dst_compact)
+    REBASE_INDICES (canary_draw_compact_index_t, canary_draw_index_t);
+  else if (src_compact)
+    REBASE_INDICES (canary_draw_index_t, canary_draw_compact_index_t);
+  else
+    REBASE_INDICES (canary_draw_index_t, canary_draw_index_t);
+
+  /* don't leave half-validated geometry in the list */
+  if (out_of_range)
+    return -1;
+
+  draw_list->vertices.size += vertex_num;
+  draw_list->indices.size += index_num;
+
+  return 0;
+}
+
+int
+canary_draw_buffers (canary_draw_list_t *draw_list,
+                     const canary_draw_vertex_t *vertices, size_t vertex_num,
+                     const canary_draw_index_t *indices, size_t index_num)
+{
+  return append_buffers (draw_list, CANARY_DRAW_FORMAT_FLOAT, vertices,
+                         vertex_num, sizeof (canary_draw_index_t), indices,
+                         index_num, 0);
+}
+
+int
+canary_draw_list_append_range (canary_draw_list_t *draw_list,
+                               canary_draw_list_t *src, size_t vertex_start,
+                               size_t index_start)
+{
+  if (vertex_start > src->vertices.size || index_start > src->indices.size)
+    return -1;
+
+  return append_buffers (
+      draw_list, src->format,
+      src->vertices.vals + src->vertex_size * vertex_start,
+      src->vertices.size - vertex_start,
+      src->index_size, src->indices.vals + src->index_size * index_start,
+      src->indices.size - index_start, vertex_start);
+}
+
+/* like REBASE_INDICES, but for indices that are already known to be in
+ * range; the same-width cases are the common ones, so they get SIMD */
+static void
+rebase_indices (canary_draw_list_t *draw_list, size_t index_offset,
+                size_t src_index_size, const uint8_t *indices,
+                size_t index_num, canary_draw_index_t base)
+{
+  int src_compact = src_index_size == sizeof (canary_draw_compact_index_t);
+  int dst_compact
+      = draw_list->index_size == sizeof (canary_draw_compact_index_t);
+
+  size_t i = 0;
+
+  if (dst_compact && src_compact)
+    {
+      const canary_draw_compact_index_t *src
+          = (const canary_draw_compact_index_t *)indices;
+      canary_draw_compact_index_t *dst
+          = (canary_draw_compact_index_t *)draw_list->indices.vals
+            + index_offset;
+
+#if defined(__SSE2__)
+      const __m128i offset = _mm_set1_epi16 ((int16_t)base);
+      for (; i + 8 <= index_num; i += 8)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *)&src[i]);
+          _mm_storeu_si128 ((__m128i *)&dst[i], _mm_add_epi16 (v, offset));
+        }
+#endif
+
+      for (; i < index_num; i++)
+        dst[i] = src[i] + base;
+    }
+  else if (!dst_compact && !src_compact)
+    {
+      const canary_draw_index_t *src = (const canary_draw_index_t *)indices;
+      canary_draw_index_t *dst
+          = (canary_draw_index_t *)draw_list->indices.vals + index_offset;
+
+#if defined(__SSE2__)
+      const __m128i offset = _mm_set1_epi32 ((int32_t)base);
+      for (; i + 4 <= index_num; i += 4)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *)&src[i]);
+          _mm_storeu_si128 ((__m128i *)&dst[i], _mm_add_epi32 (v, offset));
+        }
+#endif
+
+      for (; i < index_num; i++)
+        dst[i] = src[i] + base;
+    }
+  else if (dst_compact)
+    {
+      /* a float list merged into a compact one that still fits 16 bits */
+      const canary_draw_index_t *src = (const canary_draw_index_t *)indices;
+      canary_draw_compact_index_t *dst
+          = (canary_draw_compact_index_t *)draw_list->indices.vals
+            + index_offset;
+
+      for (; i < index_num; i++)
+        dst[i] = src[i] + base;
+    }
+  else
     {
-      draw_list->indices.capacity = 1536;
-      draw_list->indices.vals = mdo_allocator_calloc (
-          alloc, draw_list->indices.capacity, sizeof (canary_draw_index_t));
+      const canary_draw_compact_index_t *src
+          = (const canary_draw_compact_index_t *)indices;
+      canary_draw_index_t *dst
+          = (canary_draw_index_t *)draw_list->indices.vals + index_offset;
+
+      for (; i < index_num; i++)
+        dst[i] = src[i] + base;
     }
-  else if (draw_list->indices.size > draw_list->indices.capacity)
+}
+
+void
+canary_draw_list_concat_many (canary_draw_list_t *draw_list,
+                              const canary_draw_list_t *const *srcs,
+                              size_t src_num, size_t *vertex_offsets,
+                              size_t *index_offsets)
+{
+  size_t vertex_num = draw_list->vertices.size;
+  size_t index_num = draw_list->indices.size;
+
+  for (size_t i = 0; i < src_num; i++)
     {
+      vertex_num += srcs[i]->vertices.size;
+      index_num += srcs[i]->indices.size;
+    }
+
+  /* one reservation for everything, so nothing grows halfway through */
+  reserve_index_range (draw_list, vertex_num);
+  reserve_vertices (draw_list, vertex_num);
+  reserve_indices (draw_list, index_num);
+
+  for (size_t i = 0; i < src_num; i++)
+    {
+      const canary_draw_list_t *src = srcs[i];
+      size_t vertex_offset = draw_list->vertices.size;
+      size_t index_offset = draw_list->indices.size;
+
+      if (vertex_offsets)
+        vertex_offsets[i] = vertex_offset;
+
+      if (index_offsets)
+        index_offsets[i] = index_offset;
+
+      /* indices without vertices couldn't refer to anything */
+      if (src->vertices.size == 0)
+        continue;
+
+      copy_vertices (draw_list, vertex_offset, src->format, src->vertices.vals,
+                     src->vertices.size);
+      rebase_indices (draw_list, index_offset, src->index_size,
+                      src->indices.vals, src->indices.size, vertex_offset);
+
+      draw_list->vertices.size += src->vertices.size;
+      draw_list->indices.size += src->indices.size;
+    }
+}
+
+void
+canary_draw_list_concat (canary_draw_list_t *draw_list,
+                         const canary_draw_list_t *src)
+{
+  canary_draw_list_concat_many (draw_list, &src, 1, NULL, NULL);
+}
+
+/* the post-transform cache size that reordering optimizes for */
+#define WELD_CACHE_SIZE 16
+
+#define WELD_EMPTY UINT32_MAX
+
+static uint32_t *
+reserve_weld_scratch (canary_draw_list_t *draw_list, size_t size)
+{
+  const mdo_allocator_t *alloc = draw_list->alloc;
+
+  if (size <= draw_list->weld_scratch.capacity)
+    return draw_list->weld_scratch.vals;
+
+  if (draw_list->weld_scratch.vals)
+    mdo_allocator_free (alloc, draw_list->weld_scratch.vals);
+
+  draw_list->weld_scratch.vals
+      = mdo_allocator_calloc (alloc, size, sizeof (uint32_t));
+  draw_list->weld_scratch.capacity = size;
+
+  return draw_list->weld_scratch.vals;
+}
+
+static uint32_t
+hash_vertex (const uint8_t *vertex, size_t size)
+{
+  /* murmur3, over whole words since both layouts are made of them */
+  uint32_t hash = 0;
+
+  for (size_t i = 0; i < size; i += 4)
+    {
+      uint32_t word;
+      memcpy (&word, vertex + i, sizeof (word));
+
+      word *= 0xcc9e2d51;
+      word = (word << 15) | (word >> 17);
+      word *= 0x1b873593;
+
+      hash ^= word;
+      hash = (hash << 13) | (hash >> 19);
+      hash = hash * 5 + 0xe6546b64;
+    }
+
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+
+  return hash;
+}
+
+static uint32_t
+get_index (canary_draw_list_t *draw_list, size_t i)
+{
+  if (draw_list->index_size == sizeof (canary_draw_compact_index_t))
+    return ((canary_draw_compact_index_t *)draw_list->indices.vals)[i];
+
+  return ((canary_draw_index_t *)draw_list->indices.vals)[i];
+}
+
+/* merges identical vertices in place, writing each old vertex's new index
+ * to remap, and returns the new vertex count */
+static size_t
+weld_vertices (canary_draw_list_t *draw_list, uint32_t *remap,
+               uint32_t *table, size_t table_size)
+{
+  size_t vertex_num = draw_list->vertices.size;
+  size_t vertex_size = draw_list->vertex_size;
+  uint8_t *vertices = draw_list->vertices.vals;
+  uint32_t mask = table_size - 1;
+  uint32_t welded_num = 0;
+
+  for (size_t i = 0; i < table_size; i++)
+    table[i] = WELD_EMPTY;
+
+  for (size_t i = 0; i < vertex_num; i++)
+    {
+      const uint8_t *vertex = vertices + vertex_size * i;
+      uint32_t slot = hash_vertex (vertex, vertex_size) & mask;
+
+      for (;;)
+        {
+          uint32_t entry = table[slot];
+
+          if (entry == WELD_EMPTY)
+            {
+              /* welded vertices never pass unwelded ones, so this only
+               * overwrites vertices that were already visited */
+              if (welded_num != i)
+                memcpy (vertices + vertex_size * welded_num, vertex,
+                        vertex_size);
+
+              table[slot] = welded_num;
+              remap[i] = welded_num++;
+              break;
+            }
+
+          if (!memcmp (vertices + vertex_size * entry, vertex, vertex_size))
+            {
+              remap[i] = entry;
+              break;
+            }
+
+          slot = (slot + 1) & mask;
+        }
+    }
+
+  return welded_num;
+}
+
+typedef struct weld_reorder_s
+{
+  const uint32_t *indices;
+  size_t vertex_num;
+
+  uint32_t *offsets;
+  uint32_t *adjacency;
+  uint32_t *live;
+  uint32_t *cache_time;
+  uint32_t *dead_ends;
+  size_t dead_end_num;
+  uint32_t *candidates;
+  size_t candidate_num;
+
+  uint32_t time;
+  size_t cursor;
+} weld_reorder_t;
+
+static int64_t
+next_fanning_vertex (weld_reorder_t *reorder)
+{
+  int64_t best = -1;
+  int64_t best_priority = -1;
+
+  /* prefer candidates that will still be in the cache once all of their
+   * remaining triangles are emitted, and the oldest of those */
+  for (size_t i = 0; i < reorder->candidate_num; i++)
+    {
+      uint32_t vertex = reorder->candidates[i];
+      uint32_t live = reorder->live[vertex];
+
+      if (live == 0)
+        continue;
+
+      int64_t age = reorder->time - reorder->cache_time[vertex];
+      int64_t priority = 0;
+
+      if (age + 2 * live <= WELD_CACHE_SIZE)
+        priority = age;
+
+      if (priority > best_priority)
+        {
+          best = vertex;
+          best_priority = priority;
+        }
+    }
+
+  if (best >= 0)
+    return best;
+
+  /* dead end; backtrack through recently used vertices */
+  while (reorder->dead_end_num > 0)
+    {
+      uint32_t vertex = reorder->dead_ends[--reorder->dead_end_num];
+      if (reorder->live[vertex] > 0)
+        return vertex;
+    }
+
+  while (reorder->cursor < reorder->vertex_num)
+    {
+      uint32_t vertex = reorder->cursor++;
+      if (reorder->live[vertex] > 0)
+        return vertex;
+    }
+
+  return -1;
+}
+
+/* Tipsify, from Sander et al., "Fast Triangle Reordering for Vertex
+ * Locality and Reduced Overdraw" */
+static void
+reorder_triangles (const uint32_t *indices, size_t index_num,
+                   size_t vertex_num, uint32_t *scratch, uint32_t *out)
+{
+  size_t triangle_num = index_num / 3;
+
+  weld_reorder_t reorder;
+  reorder.indices = indices;
+  reorder.vertex_num = vertex_num;
+  reorder.offsets = scratch;
+  reorder.adjacency = reorder.offsets + vertex_num + 1;
+  reorder.live = reorder.adjacency + index_num;
+  reorder.cache_time = reorder.live + vertex_num;
+  reorder.dead_ends = reorder.cache_time + vertex_num;
+  reorder.dead_end_num = 0;
+  reorder.candidates = reorder.dead_ends + index_num;
+  reorder.candidate_num = 0;
+  reorder.time = WELD_CACHE_SIZE + 1;
+  reorder.cursor = 0;
+
+  uint32_t *emitted = reorder.candidates + index_num;
+
+  memset (reorder.live, 0, sizeof (uint32_t) * vertex_num);
+  for (size_t i = 0; i < index_num; i++)
+    reorder.live[indices[i]]++;
+
+  reorder.offsets[0] = 0;
+  for (size_t i = 0; i < vertex_num; i++)
+    {
+      reorder.offsets[i + 1] = reorder.offsets[i] + reorder.live[i];
+      reorder.cache_time[i] = reorder.offsets[i];
+    }
+
+  /* cache_time doubles as the fill cursor until the adjacency is built */
+  for (size_t i = 0; i < index_num; i++)
+    reorder.adjacency[reorder.cache_time[indices[i]]++] = i / 3;
+
+  memset (reorder.cache_time, 0, sizeof (uint32_t) * vertex_num);
+  memset (emitted, 0, sizeof (uint32_t) * triangle_num);
+
+  size_t out_num = 0;
+  int64_t fanning = next_fanning_vertex (&reorder);
+
+  while (fanning >= 0)
+    {
+      reorder.candidate_num = 0;
+
+      for (uint32_t a = reorder.offsets[fanning];
+           a < reorder.offsets[fanning + 1]; a++)
+        {
+          uint32_t triangle = reorder.adjacency[a];
+
+          if (emitted[triangle])
+            continue;
+
+          emitted[triangle] = 1;
+
+          for (int j = 0; j < 3; j++)
+            {
+              uint32_t vertex = indices[triangle * 3 + j];
+              out[out_num++] = vertex;
+
+              reorder.dead_ends[reorder.dead_end_num++] = vertex;
+              reorder.candidates[reorder.candidate_num++] = vertex;
+              reorder.live[vertex]--;
+
+              if (reorder.time - reorder.cache_time[vertex]
+                  > WELD_CACHE_SIZE)
+                reorder.cache_time[vertex] = reorder.time++;
+            }
+        }
+
+      fanning = next_fanning_vertex (&reorder);
+    }
+}
+
+int
+canary_draw_list_weld (canary_draw_list_t *draw_list, bool reorder,
+                       canary_draw_weld_stats_t *stats)
+{
+  size_t vertex_num = draw_list->vertices.size;
+  size_t index_num = draw_list->indices.size;
+
+  if (stats)
+    {
+      stats->vertices_before = vertex_num;
+      stats->vertices_after = vertex_num;
+    }
+
+  if (index_num % 3 != 0)
+    return -1;
+
+  /* an empty list, such as an empty segment, has no buffers to rewrite */
+  if (index_num == 0)
+    return 0;
+
+  for (size_t i = 0; i < index_num; i++)
+    if (get_index (draw_list, i) >= vertex_num)
+      return -1;
+
+  size_t table_size = 16;
+  while (table_size < vertex_num * 2)
+    table_size = table_size << 1;
+
+  size_t weld_size = vertex_num + index_num
+                     + (table_size > index_num ? table_size : index_num);
+  size_t reorder_size = vertex_num * 3 + 1 + index_num * 3 + index_num / 3;
+
+  uint32_t *scratch = reserve_weld_scratch (
+      draw_list, weld_size + (reorder ? reorder_size : 0));
+
+  uint32_t *remap = scratch;
+  uint32_t *indices = remap + vertex_num;
+  uint32_t *table = indices + index_num;
+
+  size_t welded_num = weld_vertices (draw_list, remap, table, table_size);
+
+  for (size_t i = 0; i < index_num; i++)
+    indices[i] = remap[get_index (draw_list, i)];
+
+  /* the table isn't needed anymore, so its space holds the output */
+  if (reorder)
+    {
+      reorder_triangles (indices, index_num, welded_num,
+                         scratch + weld_size, table);
+      indices = table;
+    }
+
+  draw_list->vertices.size = welded_num;
+
+  /* welding may bring a compact list back under the 16-bit limit */
+  if (draw_list->format == CANARY_DRAW_FORMAT_COMPACT
+      && draw_list->index_size != sizeof (canary_draw_compact_index_t)
+      && welded_num < COMPACT_INDEX_LIMIT)
+    {
+      draw_list->index_size = sizeof (canary_draw_compact_index_t);
       draw_list->indices.capacity = draw_list->indices.capacity << 1;
-      draw_list->indices.vals = mdo_allocator_realloc (
-          alloc, draw_list->indices.vals,
-          sizeof (canary_draw_index_t) * draw_list->indices.capacity);
     }
 
-  canary_draw_index_t *indices = &draw_list->indices.vals[index_offset];
+  if (draw_list->index_size == sizeof (canary_draw_compact_index_t))
+    {
+      canary_draw_compact_index_t *dst
+          = (canary_draw_compact_index_t *)draw_list->indices.vals;
+      for (size_t i = 0; i < index_num; i++)
+        dst[i] = indices[i];
+    }
+  else
+    {
+      memcpy (draw_list->indices.vals, indices,
+              sizeof (canary_draw_index_t) * index_num);
+    }
+
+  if (stats)
+    stats->vertices_after = welded_num;
 
-  indices[0] = vertex1;
-  indices[1] = vertex2;
-  indices[2] = vertex3;
+  return 0;
 }
@@ -0,0 +1,108 @@
+/** @file draw_list_set.c
+ */
+
+#include "draw_list_set.h"
+
+typedef struct draw_buffer_s
+{
+  canary_frame_arena_t *arena;
+  canary_draw_list_t *draw_list;
+} draw_buffer_t;
+
+struct canary_draw_list_set_s
+{
+  const mdo_allocator_t *alloc;
+
+  canary_panel_t *panel;
+
+  uint32_t buffer_num;
+  uint32_t back;
+  draw_buffer_t *buffers;
+};
+
+mdo_result_t
+canary_draw_list_set_create (canary_draw_list_set_t **set,
+                             const mdo_allocator_t *alloc,
+                             canary_panel_t *panel, uint32_t buffer_num,
+                             canary_draw_format_t format)
+{
+  canary_draw_list_set_t *new_set
+      = mdo_allocator_malloc (alloc, sizeof (canary_draw_list_set_t));
+  *set = new_set;
+
+  if (buffer_num < 2)
+    buffer_num = 2;
+
+  new_set->alloc = alloc;
+  new_set->panel = panel;
+  new_set->buffer_num = buffer_num;
+  new_set->back = 0;
+  new_set->buffers
+      = mdo_allocator_calloc (alloc, buffer_num, sizeof (draw_buffer_t));
+
+  for (uint32_t i = 0; i < buffer_num; i++)
+    {
+      draw_buffer_t *buffer = &new_set->buffers[i];
+
+      mdo_result_t result
+          = canary_frame_arena_create (&buffer->arena, alloc, 0);
+      if (!mdo_result_success (result))
+        return result;
+
+      result = canary_draw_list_create_in_arena (&buffer->draw_list, alloc,
+                                                 buffer->arena, format);
+      if (!mdo_result_success (result))
+        return result;
+    }
+
+  if (panel)
+    canary_panel_set_draw_list (panel, new_set->buffers[0].draw_list);
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_draw_list_set_delete (canary_draw_list_set_t *set)
+{
+  const mdo_allocator_t *alloc = set->alloc;
+
+  for (uint32_t i = 0; i < set->buffer_num; i++)
+    {
+      draw_buffer_t *buffer = &set->buffers[i];
+
+      if (buffer->draw_list)
+        canary_draw_list_delete (buffer->draw_list);
+
+      if (buffer->arena)
+        canary_frame_arena_delete (buffer->arena);
+    }
+
+  mdo_allocator_free (alloc, set->buffers);
+  mdo_allocator_free (alloc, set);
+}
+
+canary_draw_list_t *
+canary_draw_list_set_get_back (canary_draw_list_set_t *set)
+{
+  return set->buffers[set->back].draw_list;
+}
+
+canary_draw_list_t *
+canary_draw_list_set_get_front (canary_draw_list_set_t *set)
+{
+  uint32_t front = (set->back + set->buffer_num - 1) % set->buffer_num;
+  return set->buffers[front].draw_list;
+}
+
+void
+canary_draw_list_set_swap (canary_draw_list_set_t *set)
+{
+  set->back = (set->back + 1) % set->buffer_num;
+
+  draw_buffer_t *buffer = &set->buffers[set->back];
+  canary_frame_arena_reset (buffer->arena);
+  canary_draw_list_reset (buffer->draw_list);
+
+  if (set->panel)
+    canary_panel_set_draw_list (set->panel, buffer->draw_list);
+}
@@ -0,0 +1,47 @@
+/** @file file_map.c
+ */
+
+#include "file_map.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int
+file_map_open (file_map_t *map, const char *filename)
+{
+  map->data = NULL;
+  map->size = 0;
+
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  struct stat st;
+  if (fstat (fd, &st) || st.st_size <= 0)
+    {
+      close (fd);
+      return -1;
+    }
+
+  void *data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+
+  if (data == MAP_FAILED)
+    return -1;
+
+  map->data = data;
+  map->size = st.st_size;
+  return 0;
+}
+
+void
+file_map_close (file_map_t *map)
+{
+  if (map->data)
+    munmap ((void *)map->data, map->size);
+
+  map->data = NULL;
+  map->size = 0;
+}
@@ -0,0 +1,30 @@
+/** @file file_map.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint8_t */
+
+/** @typedef file_map_t
+ * A whole file mapped read-only, so that loading it doesn't copy it to the
+ * heap first and its pages can be dropped and reread by the kernel.
+ */
+typedef struct file_map_s
+{
+  const uint8_t *data;
+  size_t size;
+} file_map_t;
+
+/** @function file_map_open
+ * @param map
+ * @param filename
+ * @return Zero on success, or nonzero if the file can't be opened or is
+ * empty.
+ */
+int file_map_open (file_map_t *, const char *);
+
+/** @function file_map_close
+ * @param map
+ */
+void file_map_close (file_map_t *);
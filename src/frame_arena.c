@@ -0,0 +1,150 @@
+/** @file frame_arena.c
+ */
+
+#include "frame_arena.h"
+
+#include <stdint.h> /* for uint8_t */
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_MIN_CHUNK_SIZE 4096
+
+#define ALIGN_UP(size) \
+  (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/* overflow memory for a frame that outgrew the block */
+typedef struct arena_chunk_s
+{
+  struct arena_chunk_s *next;
+  size_t capacity;
+  size_t used;
+} arena_chunk_t;
+
+#define CHUNK_HEADER_SIZE ALIGN_UP (sizeof (arena_chunk_t))
+
+struct canary_frame_arena_s
+{
+  const mdo_allocator_t *alloc;
+
+  uint8_t *block;
+  size_t capacity;
+  size_t used;
+
+  arena_chunk_t *overflow;
+  size_t overflow_used;
+};
+
+mdo_result_t
+canary_frame_arena_create (canary_frame_arena_t **arena,
+                           const mdo_allocator_t *alloc, size_t capacity)
+{
+  canary_frame_arena_t *new_arena
+      = mdo_allocator_malloc (alloc, sizeof (canary_frame_arena_t));
+  *arena = new_arena;
+
+  new_arena->alloc = alloc;
+  new_arena->capacity = ALIGN_UP (capacity);
+  new_arena->used = 0;
+  new_arena->overflow = NULL;
+  new_arena->overflow_used = 0;
+
+  if (new_arena->capacity > 0)
+    new_arena->block = mdo_allocator_malloc (alloc, new_arena->capacity);
+  else
+    new_arena->block = NULL;
+
+  return MDO_SUCCESS;
+}
+
+static void
+free_overflow (canary_frame_arena_t *arena)
+{
+  const mdo_allocator_t *alloc = arena->alloc;
+
+  arena_chunk_t *chunk = arena->overflow;
+  while (chunk)
+    {
+      arena_chunk_t *next = chunk->next;
+      mdo_allocator_free (alloc, chunk);
+      chunk = next;
+    }
+
+  arena->overflow = NULL;
+  arena->overflow_used = 0;
+}
+
+void
+canary_frame_arena_delete (canary_frame_arena_t *arena)
+{
+  const mdo_allocator_t *alloc = arena->alloc;
+
+  free_overflow (arena);
+
+  if (arena->block)
+    mdo_allocator_free (alloc, arena->block);
+
+  mdo_allocator_free (alloc, arena);
+}
+
+void *
+canary_frame_arena_alloc (canary_frame_arena_t *arena, size_t size)
+{
+  size = ALIGN_UP (size);
+
+  if (arena->used + size <= arena->capacity)
+    {
+      void *ptr = arena->block + arena->used;
+      arena->used += size;
+      return ptr;
+    }
+
+  arena->overflow_used += size;
+
+  arena_chunk_t *chunk = arena->overflow;
+  if (!chunk || chunk->used + size > chunk->capacity)
+    {
+      size_t capacity = arena->capacity;
+      if (capacity < ARENA_MIN_CHUNK_SIZE)
+        capacity = ARENA_MIN_CHUNK_SIZE;
+      if (capacity < size)
+        capacity = size;
+
+      chunk = mdo_allocator_malloc (arena->alloc,
+                                    CHUNK_HEADER_SIZE + capacity);
+      chunk->next = arena->overflow;
+      chunk->capacity = capacity;
+      chunk->used = 0;
+      arena->overflow = chunk;
+    }
+
+  void *ptr = (uint8_t *)chunk + CHUNK_HEADER_SIZE + chunk->used;
+  chunk->used += size;
+  return ptr;
+}
+
+void
+canary_frame_arena_reset (canary_frame_arena_t *arena)
+{
+  const mdo_allocator_t *alloc = arena->alloc;
+
+  /* grow to fit everything the last frame needed in one block */
+  if (arena->overflow)
+    {
+      size_t capacity = arena->used + arena->overflow_used;
+
+      free_overflow (arena);
+
+      if (arena->block)
+        mdo_allocator_free (alloc, arena->block);
+
+      arena->block = mdo_allocator_malloc (alloc, capacity);
+      arena->capacity = capacity;
+    }
+
+  arena->used = 0;
+}
+
+size_t
+canary_frame_arena_get_capacity (canary_frame_arena_t *arena)
+{
+  return arena->capacity;
+}
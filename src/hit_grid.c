@@ -0,0 +1,373 @@
+/** @file hit_grid.c
+ */
+
+#include "hit_grid.h"
+
+#include <math.h>   /* for floorf, isfinite */
+#include <string.h> /* for memcpy, memset */
+
+/* cells along each axis of the grid, which spans the regions' bounds */
+#define GRID_DIM 16
+#define CELL_NUM (GRID_DIM * GRID_DIM)
+
+typedef enum
+{
+  SHAPE_RECT,
+  SHAPE_CIRCLE,
+} hit_shape_t;
+
+typedef struct hit_region_s
+{
+  uint32_t id;
+  hit_shape_t shape;
+
+  /* the bounds, which are also the exact shape of a rect */
+  float min[2];
+  float max[2];
+
+  /* only used by circles */
+  float center[2];
+  float radius;
+} hit_region_t;
+
+struct canary_hit_grid_s
+{
+  const mdo_allocator_t *alloc;
+
+  /* TODO(marceline-cramer): use mdo-utils vector */
+  struct
+  {
+    hit_region_t *vals;
+    size_t size;
+    size_t capacity;
+  } regions;
+
+  /* set whenever regions change, so that a script re-adding its regions
+   * every frame only rebuilds the cells once */
+  bool dirty;
+
+  float min[2];
+  float max[2];
+  float cell_scale[2];
+
+  /* the regions overlapping cell i are cell_regions[cell_start[i]] up to
+   * cell_regions[cell_start[i + 1]], in the order they were added */
+  uint32_t cell_start[CELL_NUM + 1];
+
+  /* TODO(marceline-cramer): use mdo-utils vector */
+  struct
+  {
+    uint32_t *vals;
+    size_t size;
+    size_t capacity;
+  } cell_regions;
+};
+
+mdo_result_t
+canary_hit_grid_create (canary_hit_grid_t **grid, const mdo_allocator_t *alloc)
+{
+  canary_hit_grid_t *new_grid
+      = mdo_allocator_malloc (alloc, sizeof (canary_hit_grid_t));
+  *grid = new_grid;
+
+  new_grid->alloc = alloc;
+  new_grid->dirty = false;
+
+  new_grid->regions.vals = NULL;
+  new_grid->regions.size = 0;
+  new_grid->regions.capacity = 0;
+
+  new_grid->cell_regions.vals = NULL;
+  new_grid->cell_regions.size = 0;
+  new_grid->cell_regions.capacity = 0;
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_hit_grid_delete (canary_hit_grid_t *grid)
+{
+  const mdo_allocator_t *alloc = grid->alloc;
+
+  if (grid->regions.vals)
+    mdo_allocator_free (alloc, grid->regions.vals);
+
+  if (grid->cell_regions.vals)
+    mdo_allocator_free (alloc, grid->cell_regions.vals);
+
+  mdo_allocator_free (alloc, grid);
+}
+
+static hit_region_t *
+push_region (canary_hit_grid_t *grid)
+{
+  const mdo_allocator_t *alloc = grid->alloc;
+
+  if (grid->regions.size >= grid->regions.capacity)
+    {
+      size_t capacity = grid->regions.capacity << 1;
+
+      if (capacity == 0)
+        {
+          capacity = 16;
+          grid->regions.vals
+              = mdo_allocator_calloc (alloc, capacity, sizeof (hit_region_t));
+        }
+      else
+        {
+          grid->regions.vals
+              = mdo_allocator_realloc (alloc, grid->regions.vals,
+                                       sizeof (hit_region_t) * capacity);
+        }
+
+      grid->regions.capacity = capacity;
+    }
+
+  grid->dirty = true;
+  return &grid->regions.vals[grid->regions.size++];
+}
+
+/* empty, inverted, and non-finite bounds would never be hit, and would
+ * break the grid's cell math */
+static bool
+bounds_valid (const float min[2], const float max[2])
+{
+  for (int axis = 0; axis < 2; axis++)
+    {
+      if (!isfinite (min[axis]) || !isfinite (max[axis]))
+        return false;
+
+      if (!(max[axis] >= min[axis]))
+        return false;
+    }
+
+  return true;
+}
+
+void
+canary_hit_grid_add_rect (canary_hit_grid_t *grid, uint32_t id,
+                          const float position[2], const float size[2])
+{
+  float min[2] = { position[0], position[1] };
+  float max[2] = { position[0] + size[0], position[1] + size[1] };
+
+  if (!bounds_valid (min, max))
+    return;
+
+  hit_region_t *region = push_region (grid);
+  region->id = id;
+  region->shape = SHAPE_RECT;
+
+  for (int axis = 0; axis < 2; axis++)
+    {
+      region->min[axis] = min[axis];
+      region->max[axis] = max[axis];
+    }
+}
+
+void
+canary_hit_grid_add_circle (canary_hit_grid_t *grid, uint32_t id,
+                            const float center[2], float radius)
+{
+  float min[2] = { center[0] - radius, center[1] - radius };
+  float max[2] = { center[0] + radius, center[1] + radius };
+
+  if (!bounds_valid (min, max))
+    return;
+
+  hit_region_t *region = push_region (grid);
+  region->id = id;
+  region->shape = SHAPE_CIRCLE;
+  region->radius = radius;
+
+  for (int axis = 0; axis < 2; axis++)
+    {
+      region->min[axis] = min[axis];
+      region->max[axis] = max[axis];
+      region->center[axis] = center[axis];
+    }
+}
+
+void
+canary_hit_grid_remove (canary_hit_grid_t *grid, uint32_t id)
+{
+  /* keep the order, which decides which overlapping region wins */
+  size_t kept = 0;
+  for (size_t i = 0; i < grid->regions.size; i++)
+    {
+      if (grid->regions.vals[i].id != id)
+        grid->regions.vals[kept++] = grid->regions.vals[i];
+    }
+
+  if (kept != grid->regions.size)
+    {
+      grid->regions.size = kept;
+      grid->dirty = true;
+    }
+}
+
+void
+canary_hit_grid_clear (canary_hit_grid_t *grid)
+{
+  grid->regions.size = 0;
+  grid->dirty = true;
+}
+
+size_t
+canary_hit_grid_get_region_num (canary_hit_grid_t *grid)
+{
+  return grid->regions.size;
+}
+
+static int
+get_cell (canary_hit_grid_t *grid, int axis, float coord)
+{
+  float cell = floorf ((coord - grid->min[axis]) * grid->cell_scale[axis]);
+
+  if (cell < 0.0f)
+    return 0;
+  else if (cell > GRID_DIM - 1)
+    return GRID_DIM - 1;
+  else
+    return (int)cell;
+}
+
+static void
+rebuild (canary_hit_grid_t *grid)
+{
+  const mdo_allocator_t *alloc = grid->alloc;
+
+  grid->dirty = false;
+
+  if (grid->regions.size == 0)
+    return;
+
+  for (int axis = 0; axis < 2; axis++)
+    {
+      grid->min[axis] = grid->regions.vals[0].min[axis];
+      grid->max[axis] = grid->regions.vals[0].max[axis];
+
+      for (size_t i = 1; i < grid->regions.size; i++)
+        {
+          const hit_region_t *region = &grid->regions.vals[i];
+
+          if (region->min[axis] < grid->min[axis])
+            grid->min[axis] = region->min[axis];
+
+          if (region->max[axis] > grid->max[axis])
+            grid->max[axis] = region->max[axis];
+        }
+
+      float extent = grid->max[axis] - grid->min[axis];
+      grid->cell_scale[axis] = extent > 0.0f ? GRID_DIM / extent : 0.0f;
+    }
+
+  /* count the regions in each cell, one past the cell's own start */
+  memset (grid->cell_start, 0, sizeof (grid->cell_start));
+
+  for (size_t i = 0; i < grid->regions.size; i++)
+    {
+      const hit_region_t *region = &grid->regions.vals[i];
+
+      int x0 = get_cell (grid, 0, region->min[0]);
+      int x1 = get_cell (grid, 0, region->max[0]);
+      int y0 = get_cell (grid, 1, region->min[1]);
+      int y1 = get_cell (grid, 1, region->max[1]);
+
+      for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+          grid->cell_start[y * GRID_DIM + x + 1]++;
+    }
+
+  for (int cell = 0; cell < CELL_NUM; cell++)
+    grid->cell_start[cell + 1] += grid->cell_start[cell];
+
+  size_t total = grid->cell_start[CELL_NUM];
+  if (total > grid->cell_regions.capacity)
+    {
+      size_t capacity = grid->cell_regions.capacity;
+      if (capacity == 0)
+        capacity = 64;
+
+      while (capacity < total)
+        capacity = capacity << 1;
+
+      if (grid->cell_regions.vals)
+        mdo_allocator_free (alloc, grid->cell_regions.vals);
+
+      grid->cell_regions.vals
+          = mdo_allocator_calloc (alloc, capacity, sizeof (uint32_t));
+      grid->cell_regions.capacity = capacity;
+    }
+
+  grid->cell_regions.size = total;
+
+  uint32_t cursor[CELL_NUM];
+  memcpy (cursor, grid->cell_start, sizeof (cursor));
+
+  for (size_t i = 0; i < grid->regions.size; i++)
+    {
+      const hit_region_t *region = &grid->regions.vals[i];
+
+      int x0 = get_cell (grid, 0, region->min[0]);
+      int x1 = get_cell (grid, 0, region->max[0]);
+      int y0 = get_cell (grid, 1, region->min[1]);
+      int y1 = get_cell (grid, 1, region->max[1]);
+
+      for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+          grid->cell_regions.vals[cursor[y * GRID_DIM + x]++] = i;
+    }
+}
+
+static bool
+region_contains (const hit_region_t *region, const float point[2])
+{
+  if (point[0] < region->min[0] || point[0] > region->max[0]
+      || point[1] < region->min[1] || point[1] > region->max[1])
+    return false;
+
+  if (region->shape == SHAPE_CIRCLE)
+    {
+      float dx = point[0] - region->center[0];
+      float dy = point[1] - region->center[1];
+      return dx * dx + dy * dy <= region->radius * region->radius;
+    }
+
+  return true;
+}
+
+bool
+canary_hit_grid_test (canary_hit_grid_t *grid, const float point[2],
+                      uint32_t *id)
+{
+  if (grid->regions.size == 0)
+    return false;
+
+  if (grid->dirty)
+    rebuild (grid);
+
+  /* written so that NaN coordinates miss too */
+  if (!(point[0] >= grid->min[0] && point[0] <= grid->max[0]
+        && point[1] >= grid->min[1] && point[1] <= grid->max[1]))
+    return false;
+
+  int cell = get_cell (grid, 1, point[1]) * GRID_DIM
+             + get_cell (grid, 0, point[0]);
+
+  /* walk backwards, so that the region added last wins */
+  for (uint32_t i = grid->cell_start[cell + 1]; i > grid->cell_start[cell];
+       i--)
+    {
+      const hit_region_t *region
+          = &grid->regions.vals[grid->cell_regions.vals[i - 1]];
+
+      if (region_contains (region, point))
+        {
+          *id = region->id;
+          return true;
+        }
+    }
+
+  return false;
+}
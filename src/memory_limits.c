@@ -0,0 +1,195 @@
+/** @file memory_limits.c
+ */
+
+#include "memory_limits.h"
+
+#include <stdbool.h>
+#include <string.h> /* for memcmp */
+
+#define SECTION_IMPORT 2
+#define SECTION_MEMORY 5
+
+#define IMPORT_FUNC 0
+#define IMPORT_TABLE 1
+#define IMPORT_MEMORY 2
+#define IMPORT_GLOBAL 3
+
+/* bit 0 of a limits' flags is set if it has a maximum, and bit 1 if the
+ * memory is shared; anything higher, like 64-bit memories, is rejected */
+#define LIMITS_HAS_MAX 0x01
+#define LIMITS_KNOWN 0x03
+
+typedef struct reader_s
+{
+  const uint8_t *data;
+  const uint8_t *end;
+} reader_t;
+
+static int
+read_byte (reader_t *reader, uint8_t *byte)
+{
+  if (reader->data >= reader->end)
+    return -1;
+
+  *byte = *reader->data++;
+  return 0;
+}
+
+/* an unsigned LEB128 of at most 32 bits */
+static int
+read_u32 (reader_t *reader, uint32_t *value)
+{
+  *value = 0;
+
+  for (int shift = 0; shift < 35; shift += 7)
+    {
+      uint8_t byte;
+      if (read_byte (reader, &byte))
+        return -1;
+
+      *value |= (uint32_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return 0;
+    }
+
+  return -1;
+}
+
+static int
+skip (reader_t *reader, uint32_t size)
+{
+  if ((size_t)(reader->end - reader->data) < size)
+    return -1;
+
+  reader->data += size;
+  return 0;
+}
+
+/* table and memory limits alike */
+static int
+read_limits (reader_t *reader, bool *has_max, uint32_t *max)
+{
+  uint8_t flags;
+  uint32_t min;
+  if (read_byte (reader, &flags) || (flags & ~LIMITS_KNOWN)
+      || read_u32 (reader, &min))
+    return -1;
+
+  *has_max = flags & LIMITS_HAS_MAX;
+  if (*has_max)
+    return read_u32 (reader, max);
+
+  return 0;
+}
+
+static int
+check_limits (reader_t *reader, uint32_t max_pages)
+{
+  bool has_max;
+  uint32_t max;
+  if (read_limits (reader, &has_max, &max))
+    return -1;
+
+  return has_max && max <= max_pages ? 0 : -1;
+}
+
+static int
+check_imports (reader_t *reader, uint32_t max_pages)
+{
+  uint32_t import_num;
+  if (read_u32 (reader, &import_num))
+    return -1;
+
+  for (uint32_t i = 0; i < import_num; i++)
+    {
+      /* module and field names */
+      for (int j = 0; j < 2; j++)
+        {
+          uint32_t name_size;
+          if (read_u32 (reader, &name_size) || skip (reader, name_size))
+            return -1;
+        }
+
+      uint8_t kind;
+      if (read_byte (reader, &kind))
+        return -1;
+
+      uint32_t index;
+      uint8_t byte;
+      bool has_max;
+      uint32_t max;
+
+      switch (kind)
+        {
+        case IMPORT_FUNC:
+          if (read_u32 (reader, &index))
+            return -1;
+          break;
+        case IMPORT_TABLE:
+          if (read_byte (reader, &byte)
+              || read_limits (reader, &has_max, &max))
+            return -1;
+          break;
+        case IMPORT_MEMORY:
+          if (check_limits (reader, max_pages))
+            return -1;
+          break;
+        case IMPORT_GLOBAL:
+          if (read_byte (reader, &byte) || read_byte (reader, &byte))
+            return -1;
+          break;
+        default:
+          return -1;
+        }
+    }
+
+  return 0;
+}
+
+static int
+check_memories (reader_t *reader, uint32_t max_pages)
+{
+  uint32_t memory_num;
+  if (read_u32 (reader, &memory_num))
+    return -1;
+
+  for (uint32_t i = 0; i < memory_num; i++)
+    if (check_limits (reader, max_pages))
+      return -1;
+
+  return 0;
+}
+
+int
+memory_limits_check (const uint8_t *wasm, size_t wasm_size,
+                     uint32_t max_pages)
+{
+  static const uint8_t HEADER[8] = { 0x00, 'a', 's', 'm', 1, 0, 0, 0 };
+
+  if (wasm_size < sizeof (HEADER) || memcmp (wasm, HEADER, sizeof (HEADER)))
+    return -1;
+
+  reader_t reader = { wasm + sizeof (HEADER), wasm + wasm_size };
+
+  while (reader.data < reader.end)
+    {
+      uint8_t id;
+      uint32_t section_size;
+      if (read_byte (&reader, &id) || read_u32 (&reader, &section_size))
+        return -1;
+
+      const uint8_t *start = reader.data;
+      if (skip (&reader, section_size))
+        return -1;
+
+      reader_t section = { start, reader.data };
+
+      if (id == SECTION_IMPORT && check_imports (&section, max_pages))
+        return -1;
+
+      if (id == SECTION_MEMORY && check_memories (&section, max_pages))
+        return -1;
+    }
+
+  return 0;
+}
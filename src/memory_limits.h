@@ -0,0 +1,19 @@
+/** @file memory_limits.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint8_t, uint32_t */
+
+/** @function memory_limits_check
+ * Reads the limits every memory in a Wasm binary declares, whether defined
+ * by the module or imported, straight from the binary, since wasmtime can't
+ * list memories that are neither imported nor exported.
+ * @param wasm
+ * @param wasm_size
+ * @param max_pages
+ * @return Zero if every memory declares a maximum of at most max_pages, or
+ * nonzero if one doesn't or the binary is malformed.
+ */
+int memory_limits_check (const uint8_t *, size_t, uint32_t);
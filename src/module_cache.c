@@ -0,0 +1,289 @@
+/** @file module_cache.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "module_cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h> /* for qsort */
+#include <string.h> /* for strlen, memcpy */
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "file_map.h"
+#include "sha256.h"
+
+#define CACHE_EXTENSION ".cwasm"
+#define CACHE_KEY_SIZE (SHA256_DIGEST_SIZE * 2 + 1)
+#define CACHE_PATH_SIZE 4096
+
+struct canary_module_cache_s
+{
+  const mdo_allocator_t *alloc;
+
+  char *directory;
+  size_t max_size;
+};
+
+typedef struct cache_file_s
+{
+  char name[CACHE_KEY_SIZE + sizeof (CACHE_EXTENSION)];
+  time_t mtime;
+  size_t size;
+} cache_file_t;
+
+mdo_result_t
+canary_module_cache_create (canary_module_cache_t **cache,
+                            const mdo_allocator_t *alloc,
+                            const char *directory, size_t max_size)
+{
+  canary_module_cache_t *new_cache
+      = mdo_allocator_malloc (alloc, sizeof (canary_module_cache_t));
+  *cache = new_cache;
+
+  new_cache->alloc = alloc;
+  new_cache->max_size = max_size;
+
+  size_t directory_len = strlen (directory);
+  new_cache->directory = mdo_allocator_malloc (alloc, directory_len + 1);
+  memcpy (new_cache->directory, directory, directory_len + 1);
+
+  if (mkdir (directory, 0755) && errno != EEXIST)
+    LOG_ERR ("failed to create module cache directory %s", directory);
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_module_cache_delete (canary_module_cache_t *cache)
+{
+  const mdo_allocator_t *alloc = cache->alloc;
+
+  mdo_allocator_free (alloc, cache->directory);
+  mdo_allocator_free (alloc, cache);
+}
+
+static void
+make_key (const char *engine_key, const uint8_t *wasm, size_t wasm_size,
+          char key[CACHE_KEY_SIZE])
+{
+  static const char HEX[] = "0123456789abcdef";
+
+  sha256_t hash;
+  sha256_init (&hash);
+
+  /* include the terminator so the key and module can't run together */
+  sha256_update (&hash, engine_key, strlen (engine_key) + 1);
+  sha256_update (&hash, wasm, wasm_size);
+
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  sha256_final (&hash, digest);
+
+  for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+    {
+      key[i * 2] = HEX[digest[i] >> 4];
+      key[i * 2 + 1] = HEX[digest[i] & 0xf];
+    }
+
+  key[SHA256_DIGEST_SIZE * 2] = '\0';
+}
+
+static int
+load_cached (canary_module_cache_t *cache, wasm_engine_t *engine,
+             const char *path, wasmtime_module_t **module)
+{
+  file_map_t map;
+  if (file_map_open (&map, path))
+    return -1;
+
+  wasmtime_error_t *error
+      = wasmtime_module_deserialize (engine, map.data, map.size, module);
+  file_map_close (&map);
+
+  /* most likely written by an incompatible wasmtime; recompile over it */
+  if (error)
+    {
+      wasmtime_error_delete (error);
+      return -1;
+    }
+
+  /* mark as recently used for eviction */
+  utime (path, NULL);
+
+  return 0;
+}
+
+static int
+compare_files (const void *a, const void *b)
+{
+  const cache_file_t *fa = a;
+  const cache_file_t *fb = b;
+  return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+static void
+evict (canary_module_cache_t *cache, const char *keep_name)
+{
+  const mdo_allocator_t *alloc = cache->alloc;
+
+  DIR *dir = opendir (cache->directory);
+  if (!dir)
+    return;
+
+  size_t extension_len = strlen (CACHE_EXTENSION);
+  size_t total_size = 0;
+
+  /* TODO(marceline-cramer): use mdo-utils vector */
+  struct
+  {
+    cache_file_t *vals;
+    size_t size;
+    size_t capacity;
+  } files = { NULL, 0, 0 };
+
+  struct dirent *entry;
+  while ((entry = readdir (dir)))
+    {
+      size_t name_len = strlen (entry->d_name);
+
+      if (name_len != CACHE_KEY_SIZE - 1 + extension_len
+          || strcmp (&entry->d_name[CACHE_KEY_SIZE - 1], CACHE_EXTENSION))
+        continue;
+
+      char path[CACHE_PATH_SIZE];
+      snprintf (path, sizeof (path), "%s/%s", cache->directory,
+                entry->d_name);
+
+      struct stat st;
+      if (stat (path, &st))
+        continue;
+
+      if (files.capacity == 0)
+        {
+          files.capacity = 64;
+          files.vals = mdo_allocator_calloc (alloc, files.capacity,
+                                             sizeof (cache_file_t));
+        }
+      else if (files.size >= files.capacity)
+        {
+          files.capacity = files.capacity << 1;
+          files.vals = mdo_allocator_realloc (
+              alloc, files.vals, sizeof (cache_file_t) * files.capacity);
+        }
+
+      cache_file_t *file = &files.vals[files.size++];
+      memcpy (file->name, entry->d_name, name_len + 1);
+      file->mtime = st.st_mtime;
+      file->size = st.st_size;
+      total_size += st.st_size;
+    }
+
+  closedir (dir);
+
+  if (total_size > cache->max_size)
+    {
+      qsort (files.vals, files.size, sizeof (cache_file_t), compare_files);
+
+      for (size_t i = 0; i < files.size && total_size > cache->max_size; i++)
+        {
+          const cache_file_t *file = &files.vals[i];
+
+          if (!strcmp (file->name, keep_name))
+            continue;
+
+          char path[CACHE_PATH_SIZE];
+          snprintf (path, sizeof (path), "%s/%s", cache->directory,
+                    file->name);
+
+          if (!unlink (path))
+            total_size -= file->size;
+        }
+    }
+
+  if (files.vals)
+    mdo_allocator_free (alloc, files.vals);
+}
+
+static void
+store_cached (canary_module_cache_t *cache, const char *path,
+              const char *name, wasmtime_module_t *module)
+{
+  wasm_byte_vec_t serialized;
+  wasmtime_error_t *error = wasmtime_module_serialize (module, &serialized);
+
+  if (error)
+    {
+      wasmtime_error_delete (error);
+      LOG_ERR ("failed to serialize module for cache");
+      return;
+    }
+
+  /* write somewhere private, then rename so readers never see partials */
+  char tmp_path[CACHE_PATH_SIZE + sizeof (".XXXXXX")];
+  snprintf (tmp_path, sizeof (tmp_path), "%s.XXXXXX", path);
+
+  int fd = mkstemp (tmp_path);
+  FILE *f = fd < 0 ? NULL : fdopen (fd, "wb");
+  if (!f)
+    {
+      LOG_ERR ("failed to write module cache file %s", tmp_path);
+
+      if (fd >= 0)
+        {
+          close (fd);
+          unlink (tmp_path);
+        }
+
+      wasm_byte_vec_delete (&serialized);
+      return;
+    }
+
+  size_t written = fwrite (serialized.data, 1, serialized.size, f);
+  int close_error = fclose (f);
+
+  if (written != serialized.size || close_error || rename (tmp_path, path))
+    {
+      LOG_ERR ("failed to write module cache file %s", path);
+      unlink (tmp_path);
+    }
+
+  wasm_byte_vec_delete (&serialized);
+
+  evict (cache, name);
+}
+
+wasmtime_error_t *
+canary_module_cache_compile (canary_module_cache_t *cache,
+                             wasm_engine_t *engine, const char *engine_key,
+                             const uint8_t *wasm, size_t wasm_size,
+                             wasmtime_module_t **module)
+{
+  char key[CACHE_KEY_SIZE];
+  make_key (engine_key, wasm, wasm_size, key);
+
+  char name[CACHE_KEY_SIZE + sizeof (CACHE_EXTENSION)];
+  snprintf (name, sizeof (name), "%s%s", key, CACHE_EXTENSION);
+
+  char path[CACHE_PATH_SIZE];
+  int path_len
+      = snprintf (path, sizeof (path), "%s/%s", cache->directory, name);
+
+  /* the cache can't be used, but compiling still works */
+  if (path_len < 0 || (size_t)path_len >= sizeof (path))
+    return wasmtime_module_new (engine, wasm, wasm_size, module);
+
+  if (!load_cached (cache, engine, path, module))
+    return NULL;
+
+  wasmtime_error_t *error
+      = wasmtime_module_new (engine, wasm, wasm_size, module);
+
+  if (!error)
+    store_cached (cache, path, name, *module);
+
+  return error;
+}
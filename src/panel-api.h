@@ -22,3 +22,55 @@ SCRIPT_CALLBACK (canary_panel_set_color_cb);
 /** @function canary_panel_draw_triangle_cb
  */
 SCRIPT_CALLBACK (canary_panel_draw_triangle_cb);
+
+/** @function canary_panel_draw_buffers_cb
+ */
+SCRIPT_CALLBACK (canary_panel_draw_buffers_cb);
+
+/** @function canary_panel_begin_segment_cb
+ */
+SCRIPT_CALLBACK (canary_panel_begin_segment_cb);
+
+/** @function canary_panel_end_segment_cb
+ */
+SCRIPT_CALLBACK (canary_panel_end_segment_cb);
+
+/** @function canary_panel_draw_segment_cb
+ */
+SCRIPT_CALLBACK (canary_panel_draw_segment_cb);
+
+/** @function canary_panel_invalidate_segment_cb
+ */
+SCRIPT_CALLBACK (canary_panel_invalidate_segment_cb);
+
+/** @function canary_panel_draw_rect_cb
+ */
+SCRIPT_CALLBACK (canary_panel_draw_rect_cb);
+
+/** @function canary_panel_draw_rounded_rect_cb
+ */
+SCRIPT_CALLBACK (canary_panel_draw_rounded_rect_cb);
+
+/** @function canary_panel_draw_circle_cb
+ */
+SCRIPT_CALLBACK (canary_panel_draw_circle_cb);
+
+/** @function canary_panel_draw_polyline_cb
+ */
+SCRIPT_CALLBACK (canary_panel_draw_polyline_cb);
+
+/** @function canary_panel_add_hit_rect_cb
+ */
+SCRIPT_CALLBACK (canary_panel_add_hit_rect_cb);
+
+/** @function canary_panel_add_hit_circle_cb
+ */
+SCRIPT_CALLBACK (canary_panel_add_hit_circle_cb);
+
+/** @function canary_panel_remove_hit_region_cb
+ */
+SCRIPT_CALLBACK (canary_panel_remove_hit_region_cb);
+
+/** @function canary_panel_clear_hit_regions_cb
+ */
+SCRIPT_CALLBACK (canary_panel_clear_hit_regions_cb);
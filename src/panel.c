@@ -3,9 +3,24 @@
 
 #include "panel.h"
 
+#include <stdbool.h>
 #include <string.h> /* for memcpy */
 
 #include "api.h"
+#include "hit_grid.h"
+#include "tessellate.h"
+
+/* a panel unit covering 256 pixels, until the host says otherwise */
+#define DEFAULT_PIXEL_SCALE 256.0f
+
+typedef struct panel_segment_s
+{
+  uint32_t id;
+  bool valid;
+
+  /* indices are relative to the segment's own vertices */
+  canary_draw_list_t *draw_list;
+} panel_segment_t;
 
 struct canary_panel_s
 {
@@ -13,8 +28,27 @@ struct canary_panel_s
 
   float color[4];
   float size[2];
+  float pixel_scale;
 
   canary_draw_list_t *draw_list;
+  canary_hit_grid_t *hit_grid;
+
+  /* TODO(marceline-cramer): use mdo-utils vector */
+  struct
+  {
+    panel_segment_t *vals;
+    size_t size;
+    size_t capacity;
+  } segments;
+
+  /* the segment being recorded, as a range of the current draw list */
+  struct
+  {
+    bool open;
+    uint32_t id;
+    size_t vertex_start;
+    size_t index_start;
+  } recording;
 };
 
 mdo_result_t
@@ -25,8 +59,19 @@ canary_panel_create (canary_panel_t **panel, const mdo_allocator_t *alloc)
   *panel = new_panel;
 
   new_panel->alloc = alloc;
+  new_panel->pixel_scale = DEFAULT_PIXEL_SCALE;
   new_panel->draw_list = NULL;
 
+  new_panel->segments.vals = NULL;
+  new_panel->segments.size = 0;
+  new_panel->segments.capacity = 0;
+
+  new_panel->recording.open = false;
+
+  mdo_result_t result = canary_hit_grid_create (&new_panel->hit_grid, alloc);
+  if (!mdo_result_success (result))
+    return result;
+
   return MDO_SUCCESS;
 }
 
@@ -35,6 +80,13 @@ canary_panel_delete (canary_panel_t *panel)
 {
   const mdo_allocator_t *alloc = panel->alloc;
 
+  for (size_t i = 0; i < panel->segments.size; i++)
+    canary_draw_list_delete (panel->segments.vals[i].draw_list);
+
+  if (panel->segments.vals)
+    mdo_allocator_free (alloc, panel->segments.vals);
+
+  canary_hit_grid_delete (panel->hit_grid);
   mdo_allocator_free (alloc, panel);
 }
 
@@ -62,10 +114,26 @@ canary_panel_get_size (canary_panel_t *panel, float size[2])
   memcpy (size, panel->size, sizeof (float) * 2);
 }
 
+void
+canary_panel_set_pixel_scale (canary_panel_t *panel, float pixel_scale)
+{
+  panel->pixel_scale = pixel_scale;
+}
+
+float
+canary_panel_get_pixel_scale (canary_panel_t *panel)
+{
+  return panel->pixel_scale;
+}
+
 void
 canary_panel_set_draw_list (canary_panel_t *panel,
                             canary_draw_list_t *draw_list)
 {
+  /* the recording is a range of the old draw list */
+  if (draw_list != panel->draw_list)
+    panel->recording.open = false;
+
   panel->draw_list = draw_list;
 }
 
@@ -75,6 +143,128 @@ canary_panel_get_draw_list (canary_panel_t *panel)
   return panel->draw_list;
 }
 
+canary_hit_grid_t *
+canary_panel_get_hit_grid (canary_panel_t *panel)
+{
+  return panel->hit_grid;
+}
+
+static panel_segment_t *
+find_segment (canary_panel_t *panel, uint32_t id)
+{
+  for (size_t i = 0; i < panel->segments.size; i++)
+    if (panel->segments.vals[i].id == id)
+      return &panel->segments.vals[i];
+
+  return NULL;
+}
+
+static panel_segment_t *
+add_segment (canary_panel_t *panel, uint32_t id, canary_draw_format_t format)
+{
+  const mdo_allocator_t *alloc = panel->alloc;
+
+  if (panel->segments.capacity == 0)
+    {
+      panel->segments.capacity = 16;
+      panel->segments.vals = mdo_allocator_calloc (
+          alloc, panel->segments.capacity, sizeof (panel_segment_t));
+    }
+  else if (panel->segments.size >= panel->segments.capacity)
+    {
+      panel->segments.capacity = panel->segments.capacity << 1;
+      panel->segments.vals = mdo_allocator_realloc (
+          alloc, panel->segments.vals,
+          sizeof (panel_segment_t) * panel->segments.capacity);
+    }
+
+  panel_segment_t *segment = &panel->segments.vals[panel->segments.size++];
+  segment->id = id;
+  segment->valid = false;
+  canary_draw_list_create_with_format (&segment->draw_list, alloc, format);
+
+  return segment;
+}
+
+int
+canary_panel_begin_segment (canary_panel_t *panel, uint32_t id)
+{
+  if (panel->recording.open || !panel->draw_list)
+    return -1;
+
+  panel->recording.open = true;
+  panel->recording.id = id;
+  panel->recording.vertex_start
+      = canary_draw_list_vertex_count (panel->draw_list);
+  panel->recording.index_start
+      = canary_draw_list_index_count (panel->draw_list);
+
+  return 0;
+}
+
+int
+canary_panel_end_segment (canary_panel_t *panel)
+{
+  if (!panel->recording.open)
+    return -1;
+
+  panel->recording.open = false;
+
+  panel_segment_t *segment = find_segment (panel, panel->recording.id);
+  if (!segment)
+    segment = add_segment (panel, panel->recording.id,
+                           canary_draw_list_get_format (panel->draw_list));
+
+  /* re-recording reuses the segment's buffers */
+  canary_draw_list_clear (segment->draw_list);
+  segment->valid = !canary_draw_list_append_range (
+      segment->draw_list, panel->draw_list, panel->recording.vertex_start,
+      panel->recording.index_start);
+
+  /* segments are replayed many times, so they're worth welding once, but
+   * not reordering, since scripts draw translucent UI in painter's order */
+  if (segment->valid)
+    canary_draw_list_weld (segment->draw_list, false, NULL);
+
+  return segment->valid ? 0 : -1;
+}
+
+void
+canary_panel_abandon_segment (canary_panel_t *panel)
+{
+  panel->recording.open = false;
+}
+
+int
+canary_panel_draw_segment (canary_panel_t *panel, uint32_t id)
+{
+  panel_segment_t *segment = find_segment (panel, id);
+
+  if (!segment || !segment->valid || !panel->draw_list)
+    return -1;
+
+  return canary_draw_list_append_range (panel->draw_list, segment->draw_list,
+                                        0, 0);
+}
+
+void
+canary_panel_invalidate_segment (canary_panel_t *panel, uint32_t id)
+{
+  panel_segment_t *segment = find_segment (panel, id);
+
+  if (segment)
+    segment->valid = false;
+}
+
+void
+canary_panel_invalidate_segments (canary_panel_t *panel)
+{
+  for (size_t i = 0; i < panel->segments.size; i++)
+    panel->segments.vals[i].valid = false;
+
+  panel->recording.open = false;
+}
+
 static wasm_trap_t *
 get_panel (canary_script_t *script, const wasmtime_val_t *self,
            canary_panel_t **panel)
@@ -96,8 +286,9 @@ get_panel (canary_script_t *script, const wasmtime_val_t *self,
 
 SCRIPT_CALLBACK (canary_panel_get_width_cb)
 {
+  canary_script_t *script = canary_script_from_caller (caller);
   canary_panel_t *panel;
-  wasm_trap_t *trap = get_panel (env, args, &panel);
+  wasm_trap_t *trap = get_panel (script, args, &panel);
 
   if (!trap)
     {
@@ -111,8 +302,9 @@ SCRIPT_CALLBACK (canary_panel_get_width_cb)
 
 SCRIPT_CALLBACK (canary_panel_get_height_cb)
 {
+  canary_script_t *script = canary_script_from_caller (caller);
   canary_panel_t *panel;
-  wasm_trap_t *trap = get_panel (env, args, &panel);
+  wasm_trap_t *trap = get_panel (script, args, &panel);
 
   if (!trap)
     {
@@ -126,8 +318,9 @@ SCRIPT_CALLBACK (canary_panel_get_height_cb)
 
 SCRIPT_CALLBACK (canary_panel_set_size_cb)
 {
+  canary_script_t *script = canary_script_from_caller (caller);
   canary_panel_t *panel;
-  wasm_trap_t *trap = get_panel (env, args, &panel);
+  wasm_trap_t *trap = get_panel (script, args, &panel);
 
   if (!trap)
     {
@@ -144,8 +337,9 @@ SCRIPT_CALLBACK (canary_panel_set_size_cb)
 
 SCRIPT_CALLBACK (canary_panel_set_color_cb)
 {
+  canary_script_t *script = canary_script_from_caller (caller);
   canary_panel_t *panel;
-  wasm_trap_t *trap = get_panel (env, args, &panel);
+  wasm_trap_t *trap = get_panel (script, args, &panel);
 
   if (!trap)
     {
@@ -182,6 +376,13 @@ get_draw_list (canary_script_t *script, const wasmtime_val_t *self,
   return NULL;
 }
 
+static void
+get_color (const wasmtime_val_t *color_args, float color[4])
+{
+  for (int i = 0; i < 4; i++)
+    color[i] = color_args[i].of.f32;
+}
+
 static canary_draw_vertex_t
 make_vertex (const wasmtime_val_t *coord_args, float color[4])
 {
@@ -194,8 +395,9 @@ make_vertex (const wasmtime_val_t *coord_args, float color[4])
 
 SCRIPT_CALLBACK (canary_panel_draw_triangle_cb)
 {
+  canary_script_t *script = canary_script_from_caller (caller);
   canary_draw_list_t *draw_list;
-  wasm_trap_t *trap = get_draw_list (env, args, &draw_list);
+  wasm_trap_t *trap = get_draw_list (script, args, &draw_list);
 
   if (trap)
     return trap;
@@ -218,3 +420,332 @@ SCRIPT_CALLBACK (canary_panel_draw_triangle_cb)
 
   return NULL;
 }
+
+static wasm_trap_t *
+get_memory (canary_script_t *script, wasmtime_caller_t *caller,
+            const uint8_t **data, size_t *size)
+{
+  wasmtime_extern_t memory;
+
+  if (!wasmtime_caller_export_get (caller, "memory", 6, &memory)
+      || memory.kind != WASMTIME_EXTERN_MEMORY)
+    {
+      return canary_script_new_trap (script, "script has no exported memory");
+    }
+
+  wasmtime_context_t *context = wasmtime_caller_context (caller);
+  *data = wasmtime_memory_data (context, &memory.of.memory);
+  *size = wasmtime_memory_data_size (context, &memory.of.memory);
+
+  return NULL;
+}
+
+static wasm_trap_t *
+get_buffer (canary_script_t *script, const uint8_t *memory,
+            size_t memory_size, const wasmtime_val_t *buffer_args,
+            size_t stride, const uint8_t **buffer, size_t *num)
+{
+  uint32_t ptr = (uint32_t)buffer_args[0].of.i32;
+  uint32_t count = (uint32_t)buffer_args[1].of.i32;
+
+  /* both vertex and index buffers are made of 32-bit values */
+  if (ptr % 4 != 0)
+    {
+      return canary_script_new_trap (script, "buffer is misaligned");
+    }
+
+  uint64_t end = (uint64_t)ptr + (uint64_t)count * stride;
+  if (end > memory_size)
+    {
+      return canary_script_new_trap (script, "buffer is out of bounds");
+    }
+
+  *buffer = memory + ptr;
+  *num = count;
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_draw_buffers_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_draw_list_t *draw_list;
+  wasm_trap_t *trap = get_draw_list (script, args, &draw_list);
+
+  if (trap)
+    return trap;
+
+  const uint8_t *memory;
+  size_t memory_size;
+  trap = get_memory (script, caller, &memory, &memory_size);
+
+  if (trap)
+    return trap;
+
+  const uint8_t *vertices;
+  size_t vertex_num;
+  trap = get_buffer (script, memory, memory_size, &args[1],
+                     sizeof (canary_draw_vertex_t), &vertices, &vertex_num);
+
+  if (trap)
+    return trap;
+
+  const uint8_t *indices;
+  size_t index_num;
+  trap = get_buffer (script, memory, memory_size, &args[3],
+                     sizeof (canary_draw_index_t), &indices, &index_num);
+
+  if (trap)
+    return trap;
+
+  if (index_num % 3 != 0)
+    {
+      return canary_script_new_trap (script, "index count is not a "
+                                             "multiple of 3");
+    }
+
+  if (canary_draw_buffers (draw_list, (const canary_draw_vertex_t *)vertices,
+                           vertex_num, (const canary_draw_index_t *)indices,
+                           index_num))
+    {
+      return canary_script_new_trap (script, "index is out of range");
+    }
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_begin_segment_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (trap)
+    return trap;
+
+  if (canary_panel_begin_segment (panel, (uint32_t)args[1].of.i32))
+    {
+      return canary_script_new_trap (script, "failed to begin segment");
+    }
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_end_segment_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (trap)
+    return trap;
+
+  if (canary_panel_end_segment (panel))
+    {
+      return canary_script_new_trap (script, "failed to end segment");
+    }
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_draw_segment_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (trap)
+    return trap;
+
+  /* a missing segment isn't an error; the script just records it again */
+  int drawn = !canary_panel_draw_segment (panel, (uint32_t)args[1].of.i32);
+  results[0].kind = WASMTIME_I32;
+  results[0].of.i32 = drawn;
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_invalidate_segment_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (!trap)
+    canary_panel_invalidate_segment (panel, (uint32_t)args[1].of.i32);
+
+  return trap;
+}
+
+SCRIPT_CALLBACK (canary_panel_draw_rect_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_draw_list_t *draw_list;
+  wasm_trap_t *trap = get_draw_list (script, args, &draw_list);
+
+  if (trap)
+    return trap;
+
+  float position[2] = { args[1].of.f32, args[2].of.f32 };
+  float size[2] = { args[3].of.f32, args[4].of.f32 };
+
+  float color[4];
+  get_color (&args[5], color);
+
+  canary_draw_rect (draw_list, position, size, color);
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_draw_rounded_rect_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (trap)
+    return trap;
+
+  canary_draw_list_t *draw_list;
+  trap = get_draw_list (script, args, &draw_list);
+
+  if (trap)
+    return trap;
+
+  float position[2] = { args[1].of.f32, args[2].of.f32 };
+  float size[2] = { args[3].of.f32, args[4].of.f32 };
+  float radius = args[5].of.f32;
+
+  float color[4];
+  get_color (&args[6], color);
+
+  uint32_t segments = canary_tessellate_segments (radius, panel->pixel_scale);
+  canary_draw_rounded_rect (draw_list, position, size, radius, color,
+                            segments);
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_draw_circle_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (trap)
+    return trap;
+
+  canary_draw_list_t *draw_list;
+  trap = get_draw_list (script, args, &draw_list);
+
+  if (trap)
+    return trap;
+
+  float center[2] = { args[1].of.f32, args[2].of.f32 };
+  float radius = args[3].of.f32;
+
+  float color[4];
+  get_color (&args[4], color);
+
+  uint32_t segments = canary_tessellate_segments (radius, panel->pixel_scale);
+  canary_draw_circle (draw_list, center, radius, color, segments);
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_draw_polyline_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_draw_list_t *draw_list;
+  wasm_trap_t *trap = get_draw_list (script, args, &draw_list);
+
+  if (trap)
+    return trap;
+
+  const uint8_t *memory;
+  size_t memory_size;
+  trap = get_memory (script, caller, &memory, &memory_size);
+
+  if (trap)
+    return trap;
+
+  /* each point is an x and a y */
+  const uint8_t *points;
+  size_t point_num;
+  trap = get_buffer (script, memory, memory_size, &args[1],
+                     sizeof (float) * 2, &points, &point_num);
+
+  if (trap)
+    return trap;
+
+  float width = args[3].of.f32;
+  bool closed = args[4].of.i32 != 0;
+
+  float color[4];
+  get_color (&args[5], color);
+
+  canary_draw_polyline (draw_list, (const float *)points, point_num, width,
+                        closed, color);
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_add_hit_rect_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (trap)
+    return trap;
+
+  float position[2] = { args[2].of.f32, args[3].of.f32 };
+  float size[2] = { args[4].of.f32, args[5].of.f32 };
+
+  canary_hit_grid_add_rect (panel->hit_grid, (uint32_t)args[1].of.i32,
+                            position, size);
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_add_hit_circle_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (trap)
+    return trap;
+
+  float center[2] = { args[2].of.f32, args[3].of.f32 };
+  float radius = args[4].of.f32;
+
+  canary_hit_grid_add_circle (panel->hit_grid, (uint32_t)args[1].of.i32,
+                              center, radius);
+
+  return NULL;
+}
+
+SCRIPT_CALLBACK (canary_panel_remove_hit_region_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (!trap)
+    canary_hit_grid_remove (panel->hit_grid, (uint32_t)args[1].of.i32);
+
+  return trap;
+}
+
+SCRIPT_CALLBACK (canary_panel_clear_hit_regions_cb)
+{
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_panel_t *panel;
+  wasm_trap_t *trap = get_panel (script, args, &panel);
+
+  if (!trap)
+    canary_hit_grid_clear (panel->hit_grid);
+
+  return trap;
+}
@@ -0,0 +1,49 @@
+/** @file profile.c
+ */
+
+#include "profile.h"
+
+#include <time.h> /* for clock_gettime */
+
+uint64_t
+canary_profile_now (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void
+canary_profile_record (canary_profile_stats_t *stats, uint64_t duration_ns)
+{
+  stats->call_num++;
+  stats->total_ns += duration_ns;
+
+  if (duration_ns > stats->max_ns)
+    stats->max_ns = duration_ns;
+
+  uint64_t duration_us = duration_ns / 1000;
+  size_t bucket = 0;
+
+  while (duration_us > 0 && bucket < CANARY_PROFILE_BUCKET_NUM - 1)
+    {
+      duration_us >>= 1;
+      bucket++;
+    }
+
+  stats->histogram[bucket]++;
+}
+
+void
+canary_profile_record_draw (canary_profile_draw_stats_t *stats,
+                            size_t vertex_num, size_t index_num)
+{
+  stats->vertex_num = vertex_num;
+  stats->index_num = index_num;
+
+  if (vertex_num > stats->peak_vertex_num)
+    stats->peak_vertex_num = vertex_num;
+
+  if (index_num > stats->peak_index_num)
+    stats->peak_index_num = index_num;
+}
@@ -0,0 +1,206 @@
+/** @file recording.c
+ */
+
+#include "recording.h"
+
+#include <stdio.h>
+#include <string.h> /* for memcmp, memcpy, memset */
+
+#include "recording_format.h"
+
+struct canary_recorder_s
+{
+  const mdo_allocator_t *alloc;
+  FILE *file;
+};
+
+struct canary_recording_s
+{
+  const mdo_allocator_t *alloc;
+
+  recording_event_t *events;
+  size_t event_num;
+};
+
+static mdo_result_t
+recording_error (const char *message)
+{
+  mdo_result_t result
+      = mdo_result_create (MDO_LOG_ERROR, "recording error: %s", 1, false);
+  return LOG_RESULT (result, message);
+}
+
+mdo_result_t
+canary_recorder_create (canary_recorder_t **recorder,
+                        const mdo_allocator_t *alloc, const char *filename)
+{
+  canary_recorder_t *new_recorder
+      = mdo_allocator_calloc (alloc, 1, sizeof (canary_recorder_t));
+  *recorder = new_recorder;
+
+  new_recorder->alloc = alloc;
+
+  new_recorder->file = fopen (filename, "wb");
+  if (!new_recorder->file)
+    return recording_error ("failed to open recording");
+
+  recording_header_t header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, RECORDING_MAGIC, sizeof (RECORDING_MAGIC));
+  header.version = RECORDING_VERSION;
+
+  if (fwrite (&header, sizeof (header), 1, new_recorder->file) != 1)
+    return recording_error ("failed to write recording");
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_recorder_delete (canary_recorder_t *recorder)
+{
+  if (recorder->file)
+    fclose (recorder->file);
+
+  mdo_allocator_free (recorder->alloc, recorder);
+}
+
+int
+canary_recorder_write (canary_recorder_t *recorder,
+                       const canary_recording_event_t *event)
+{
+  recording_event_t record;
+  memset (&record, 0, sizeof (record));
+  record.type = event->type;
+  record.panel_key = event->panel_key;
+
+  switch (event->type)
+    {
+    case CANARY_RECORDING_BIND_PANEL:
+      memcpy (&record.values[0], event->color, sizeof (float) * 4);
+      memcpy (&record.values[4], event->size, sizeof (float) * 2);
+      record.values[6] = event->pixel_scale;
+      break;
+    case CANARY_RECORDING_INPUT:
+      record.value = event->input_event;
+      memcpy (record.values, event->coords, sizeof (float) * 2);
+      break;
+    case CANARY_RECORDING_SET_INPUT_MODE:
+      record.value = event->input_mode;
+      break;
+    case CANARY_RECORDING_UPDATE:
+      record.values[0] = event->dt;
+      break;
+    default:
+      break;
+    }
+
+  if (fwrite (&record, sizeof (record), 1, recorder->file) != 1)
+    {
+      LOG_ERR ("failed to write recording event");
+      return -1;
+    }
+
+  return 0;
+}
+
+mdo_result_t
+canary_recording_create (canary_recording_t **recording,
+                         const mdo_allocator_t *alloc, const char *filename)
+{
+  canary_recording_t *new_recording
+      = mdo_allocator_calloc (alloc, 1, sizeof (canary_recording_t));
+  *recording = new_recording;
+
+  new_recording->alloc = alloc;
+
+  FILE *file = fopen (filename, "rb");
+  if (!file)
+    return recording_error ("failed to open recording");
+
+  recording_header_t header;
+  if (fread (&header, sizeof (header), 1, file) != 1
+      || memcmp (header.magic, RECORDING_MAGIC, sizeof (RECORDING_MAGIC))
+      || header.version != RECORDING_VERSION)
+    {
+      fclose (file);
+      return recording_error ("not a recording");
+    }
+
+  fseek (file, 0, SEEK_END);
+  long size = ftell (file);
+  fseek (file, sizeof (header), SEEK_SET);
+
+  size_t event_num = 0;
+  if (size > (long)sizeof (header))
+    event_num = (size - sizeof (header)) / sizeof (recording_event_t);
+
+  if (event_num > 0)
+    {
+      new_recording->events = mdo_allocator_calloc (
+          alloc, event_num, sizeof (recording_event_t));
+      event_num = fread (new_recording->events, sizeof (recording_event_t),
+                         event_num, file);
+    }
+
+  new_recording->event_num = event_num;
+
+  fclose (file);
+  return MDO_SUCCESS;
+}
+
+void
+canary_recording_delete (canary_recording_t *recording)
+{
+  const mdo_allocator_t *alloc = recording->alloc;
+
+  if (recording->events)
+    mdo_allocator_free (alloc, recording->events);
+
+  mdo_allocator_free (alloc, recording);
+}
+
+size_t
+canary_recording_get_event_num (canary_recording_t *recording)
+{
+  return recording->event_num;
+}
+
+int
+canary_recording_get_event (canary_recording_t *recording, size_t index,
+                            canary_recording_event_t *event)
+{
+  if (index >= recording->event_num)
+    return -1;
+
+  const recording_event_t *record = &recording->events[index];
+
+  memset (event, 0, sizeof (canary_recording_event_t));
+  event->type = record->type;
+  event->panel_key = record->panel_key;
+
+  switch (record->type)
+    {
+    case CANARY_RECORDING_BIND_PANEL:
+      memcpy (event->color, &record->values[0], sizeof (float) * 4);
+      memcpy (event->size, &record->values[4], sizeof (float) * 2);
+      event->pixel_scale = record->values[6];
+      break;
+    case CANARY_RECORDING_INPUT:
+      event->input_event = record->value;
+      memcpy (event->coords, record->values, sizeof (float) * 2);
+      break;
+    case CANARY_RECORDING_SET_INPUT_MODE:
+      event->input_mode = record->value;
+      break;
+    case CANARY_RECORDING_UPDATE:
+      event->dt = record->values[0];
+      break;
+    case CANARY_RECORDING_UNBIND_PANEL:
+    case CANARY_RECORDING_FLUSH_INPUT:
+      break;
+    default:
+      return -1;
+    }
+
+  return 0;
+}
@@ -0,0 +1,33 @@
+/** @file recording_format.h
+ * The layout of a file written by a #canary_recorder_t. Everything is
+ * stored in host byte order.
+ */
+
+#pragma once
+
+#include <stdint.h> /* for uint32_t */
+
+#define RECORDING_MAGIC "CNRYREC"
+#define RECORDING_VERSION 1
+
+typedef struct recording_header_s
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+} recording_header_t;
+
+/* every event is the same size, so the file is just an array of them */
+typedef struct recording_event_s
+{
+  uint32_t type;
+  uint32_t panel_key;
+
+  /* the input event or mode */
+  uint32_t value;
+  uint32_t reserved;
+
+  /* dt; the input coordinates; or the bound panel's color, size, and pixel
+   * scale */
+  float values[8];
+} recording_event_t;
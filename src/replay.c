@@ -0,0 +1,280 @@
+/** @file replay.c
+ */
+
+#include "replay.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h> /* for memcmp */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef CANARY_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include "capture_format.h"
+
+struct canary_replay_s
+{
+  const mdo_allocator_t *alloc;
+
+  const uint8_t *mapping;
+  size_t mapping_size;
+
+  /* TODO(marceline-cramer): use mdo-utils vector */
+  struct
+  {
+    size_t *vals;
+    size_t size;
+    size_t capacity;
+  } frames;
+
+  /* where compressed frames are decompressed to, one at a time */
+  uint8_t *decompressed;
+  size_t decompressed_capacity;
+};
+
+static mdo_result_t
+replay_error (const char *message)
+{
+  mdo_result_t result
+      = mdo_result_create (MDO_LOG_ERROR, "replay error: %s", 1, false);
+  return LOG_RESULT (result, message);
+}
+
+static void
+push_frame (canary_replay_t *replay, size_t offset)
+{
+  const mdo_allocator_t *alloc = replay->alloc;
+
+  if (replay->frames.size >= replay->frames.capacity)
+    {
+      size_t capacity = replay->frames.capacity << 1;
+
+      if (capacity == 0)
+        {
+          capacity = 256;
+          replay->frames.vals
+              = mdo_allocator_calloc (alloc, capacity, sizeof (size_t));
+        }
+      else
+        {
+          replay->frames.vals = mdo_allocator_realloc (
+              alloc, replay->frames.vals, sizeof (size_t) * capacity);
+        }
+
+      replay->frames.capacity = capacity;
+    }
+
+  replay->frames.vals[replay->frames.size++] = offset;
+}
+
+mdo_result_t
+canary_replay_create (canary_replay_t **replay, const mdo_allocator_t *alloc,
+                      const char *filename)
+{
+  canary_replay_t *new_replay
+      = mdo_allocator_calloc (alloc, 1, sizeof (canary_replay_t));
+  *replay = new_replay;
+
+  new_replay->alloc = alloc;
+
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return replay_error ("failed to open capture");
+
+  struct stat st;
+  if (fstat (fd, &st) || (size_t)st.st_size < sizeof (capture_header_t))
+    {
+      close (fd);
+      return replay_error ("not a capture");
+    }
+
+  new_replay->mapping_size = st.st_size;
+
+  void *mapping = mmap (NULL, new_replay->mapping_size, PROT_READ,
+                        MAP_PRIVATE, fd, 0);
+  close (fd);
+
+  if (mapping == MAP_FAILED)
+    return replay_error ("failed to map capture");
+
+  new_replay->mapping = mapping;
+
+  /* replays stream through the file from front to back */
+  madvise (mapping, new_replay->mapping_size, MADV_SEQUENTIAL);
+
+  const capture_header_t *header = mapping;
+  if (memcmp (header->magic, CAPTURE_MAGIC, sizeof (CAPTURE_MAGIC))
+      || header->version != CAPTURE_VERSION)
+    return replay_error ("not a capture");
+
+  /* a chunk cut short ends the capture */
+  size_t offset = sizeof (capture_header_t);
+  while (new_replay->mapping_size - offset >= sizeof (capture_chunk_t))
+    {
+      const capture_chunk_t *chunk
+          = (const capture_chunk_t *)(new_replay->mapping + offset);
+
+      size_t payload = offset + sizeof (capture_chunk_t);
+      if (chunk->size > new_replay->mapping_size - payload)
+        break;
+
+      if (chunk->type == CAPTURE_CHUNK_FRAME)
+        push_frame (new_replay, offset);
+
+      offset = payload + CAPTURE_ALIGN_UP (chunk->size);
+      if (offset > new_replay->mapping_size)
+        break;
+    }
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_replay_delete (canary_replay_t *replay)
+{
+  const mdo_allocator_t *alloc = replay->alloc;
+
+  if (replay->mapping)
+    munmap ((void *)replay->mapping, replay->mapping_size);
+
+  if (replay->frames.vals)
+    mdo_allocator_free (alloc, replay->frames.vals);
+
+  if (replay->decompressed)
+    mdo_allocator_free (alloc, replay->decompressed);
+
+  mdo_allocator_free (alloc, replay);
+}
+
+size_t
+canary_replay_get_frame_num (canary_replay_t *replay)
+{
+  return replay->frames.size;
+}
+
+#ifdef CANARY_HAVE_LZ4
+static const uint8_t *
+decompress (canary_replay_t *replay, const capture_chunk_t *chunk)
+{
+  const mdo_allocator_t *alloc = replay->alloc;
+
+  if (chunk->size > LZ4_MAX_INPUT_SIZE || chunk->raw_size > INT32_MAX)
+    return NULL;
+
+  if (chunk->raw_size > replay->decompressed_capacity)
+    {
+      if (replay->decompressed)
+        mdo_allocator_free (alloc, replay->decompressed);
+
+      replay->decompressed = mdo_allocator_malloc (alloc, chunk->raw_size);
+      replay->decompressed_capacity = chunk->raw_size;
+    }
+
+  int size = LZ4_decompress_safe ((const char *)(chunk + 1),
+                                  (char *)replay->decompressed, chunk->size,
+                                  chunk->raw_size);
+
+  if (size < 0 || (uint64_t)size != chunk->raw_size)
+    return NULL;
+
+  return replay->decompressed;
+}
+#endif
+
+int
+canary_replay_get_frame (canary_replay_t *replay, size_t index,
+                         canary_replay_frame_t *frame)
+{
+  if (index >= replay->frames.size)
+    return -1;
+
+  const capture_chunk_t *chunk
+      = (const capture_chunk_t *)(replay->mapping
+                                  + replay->frames.vals[index]);
+
+  const uint8_t *payload = (const uint8_t *)(chunk + 1);
+  size_t size = chunk->size;
+
+  if (chunk->flags & CAPTURE_CHUNK_LZ4)
+    {
+#ifdef CANARY_HAVE_LZ4
+      payload = decompress (replay, chunk);
+      size = chunk->raw_size;
+
+      if (!payload)
+        {
+          LOG_ERR ("failed to decompress frame %zu", index);
+          return -1;
+        }
+#else
+      LOG_ERR ("capture is compressed, but canary was built without LZ4");
+      return -1;
+#endif
+    }
+
+  if (size < sizeof (capture_frame_t))
+    return -1;
+
+  const capture_frame_t *header = (const capture_frame_t *)payload;
+  if (header->panel_num
+      > (size - sizeof (capture_frame_t)) / sizeof (capture_panel_t))
+    return -1;
+
+  frame->panel_num = header->panel_num;
+  frame->payload = payload;
+  frame->size = size;
+
+  return 0;
+}
+
+/* whether a buffer of the given elements lies within the frame */
+static bool
+buffer_valid (const canary_replay_frame_t *frame, uint64_t offset,
+              uint64_t num, uint64_t size)
+{
+  if (offset > frame->size || offset % CAPTURE_ALIGN)
+    return false;
+
+  return num <= (frame->size - offset) / size;
+}
+
+int
+canary_replay_get_panel (canary_replay_t *replay,
+                         const canary_replay_frame_t *frame, size_t index,
+                         canary_replay_panel_t *panel)
+{
+  if (index >= frame->panel_num)
+    return -1;
+
+  const capture_panel_t *record
+      = (const capture_panel_t *)(frame->payload + sizeof (capture_frame_t))
+        + index;
+
+  if (!buffer_valid (frame, record->vertex_offset, record->vertex_num,
+                     sizeof (canary_draw_vertex_t))
+      || !buffer_valid (frame, record->index_offset, record->index_num,
+                        sizeof (canary_draw_index_t)))
+    return -1;
+
+  panel->id = record->id;
+
+  for (int i = 0; i < 4; i++)
+    panel->color[i] = record->color[i];
+
+  for (int i = 0; i < 2; i++)
+    panel->size[i] = record->size[i];
+
+  panel->vertices = (const canary_draw_vertex_t *)(frame->payload
+                                                    + record->vertex_offset);
+  panel->vertex_num = record->vertex_num;
+
+  panel->indices = (const canary_draw_index_t *)(frame->payload
+                                                  + record->index_offset);
+  panel->index_num = record->index_num;
+
+  return 0;
+}
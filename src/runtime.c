@@ -0,0 +1,799 @@
+/** @file runtime.c
+ */
+
+#include "runtime.h"
+
+#include <pthread.h>
+#include <stdio.h>  /* for snprintf */
+#include <string.h> /* for strlen, memcmp */
+
+#include "memory_limits.h"
+#include "panel-api.h"
+#include "sha256.h"
+
+#ifndef CANARY_WASMTIME_VERSION
+#define CANARY_WASMTIME_VERSION "unknown"
+#endif
+
+#define WASM_PAGE_SIZE 65536
+
+/* enough for every host function in the API */
+#define IMPORT_MAX 32
+
+typedef struct import_entry_s
+{
+  canary_runtime_t *runtime;
+  const char *symbol;
+  size_t index;
+  wasmtime_func_callback_t cb;
+} import_entry_t;
+
+typedef struct module_entry_s
+{
+  uint8_t hash[SHA256_DIGEST_SIZE];
+  wasmtime_module_t *module;
+  size_t ref_count;
+} module_entry_t;
+
+struct canary_runtime_s
+{
+  const mdo_allocator_t *alloc;
+  mdo_result_t wasm_error;
+  mdo_result_t wasmtime_error;
+
+  wasm_engine_t *engine;
+  wasmtime_linker_t *linker;
+
+  /* identifies the engine configuration that compiled modules depend on */
+  char engine_key[96];
+
+  size_t max_scripts;
+  uint32_t max_memory_pages;
+
+  /* scripts may be created from any thread, so only touched atomically */
+  size_t script_num;
+
+  /* referenced by the linker's functions, so never reallocated */
+  import_entry_t imports[IMPORT_MAX];
+  size_t import_num;
+
+  canary_module_cache_t *module_cache;
+
+  /* enforces script CPU budgets */
+  canary_watchdog_t *watchdog;
+
+  /* atomic, since scripts on other threads read it on every host call */
+  canary_trace_t *trace;
+
+  /* guards modules, since scripts may load from any thread */
+  pthread_mutex_t modules_lock;
+
+  /* TODO(marceline-cramer): use mdo-utils vector */
+  struct
+  {
+    module_entry_t *vals;
+    size_t size;
+    size_t capacity;
+  } modules;
+};
+
+static int
+log_wasmtime_error (canary_runtime_t *runtime, wasmtime_error_t *error)
+{
+  wasm_byte_vec_t error_message;
+  wasmtime_error_message (error, &error_message);
+  wasmtime_error_delete (error);
+  LOG_ERR ("%.*s", error_message.size, error_message.data);
+  wasm_byte_vec_delete (&error_message);
+  return -1;
+}
+
+static wasm_trap_t *
+env_abort_cb (void *env, wasmtime_caller_t *caller, const wasmtime_val_t *args,
+              size_t arg_num, wasmtime_val_t *results, size_t result_num)
+{
+  return NULL;
+}
+
+static void
+finalizer_cb (void *env)
+{
+}
+
+/* every import goes through here, so that scripts can profile them */
+static wasm_trap_t *
+import_cb (void *env, wasmtime_caller_t *caller, const wasmtime_val_t *args,
+           size_t arg_num, wasmtime_val_t *results, size_t result_num)
+{
+  const import_entry_t *import = env;
+  canary_script_t *script = canary_script_from_caller (caller);
+  canary_profile_stats_t *stats
+      = canary_script_get_import_profile (script, import->index);
+  canary_trace_t *trace
+      = __atomic_load_n (&import->runtime->trace, __ATOMIC_ACQUIRE);
+
+  if (!stats && !trace)
+    return import->cb (NULL, caller, args, arg_num, results, result_num);
+
+  if (trace)
+    canary_trace_begin (trace, import->symbol);
+
+  uint64_t start = canary_profile_now ();
+  wasm_trap_t *trap
+      = import->cb (NULL, caller, args, arg_num, results, result_num);
+
+  if (stats)
+    canary_profile_record (stats, canary_profile_now () - start);
+
+  if (trace)
+    canary_trace_end (trace, import->symbol);
+
+  return trap;
+}
+
+static void
+link_function (canary_runtime_t *runtime, const char *module,
+               const char *symbol, wasm_functype_t *functype,
+               wasmtime_func_callback_t cb)
+{
+  if (runtime->import_num >= IMPORT_MAX)
+    {
+      LOG_ERR ("too many imports to link %s", symbol);
+      return;
+    }
+
+  import_entry_t *import = &runtime->imports[runtime->import_num];
+  import->runtime = runtime;
+  import->symbol = symbol;
+  import->index = runtime->import_num;
+  import->cb = cb;
+
+  /* callbacks find their script through the caller's store data */
+  wasmtime_error_t *error = wasmtime_linker_define_func (
+      runtime->linker, module, strlen (module), symbol, strlen (symbol),
+      functype, import_cb, import, finalizer_cb);
+  if (error)
+    {
+      log_wasmtime_error (runtime, error);
+      return;
+    }
+
+  runtime->import_num++;
+}
+
+/* a panel, followed by a number of f32 arguments */
+static wasm_functype_t *
+new_panel_functype (size_t float_num)
+{
+  wasm_valtype_vec_t params;
+  wasm_valtype_vec_new_uninitialized (&params, float_num + 1);
+
+  params.data[0] = wasm_valtype_new_i32 ();
+
+  for (size_t i = 1; i < params.size; i++)
+    params.data[i] = wasm_valtype_new_f32 ();
+
+  wasm_valtype_vec_t results;
+  wasm_valtype_vec_new_empty (&results);
+
+  return wasm_functype_new (&params, &results);
+}
+
+static void
+link_functions (canary_runtime_t *runtime)
+{
+  {
+    wasm_valtype_vec_t params;
+    wasm_valtype_vec_new_uninitialized (&params, 4);
+
+    for (size_t i = 0; i < params.size; i++)
+      params.data[i] = wasm_valtype_new_i32 ();
+
+    wasm_valtype_vec_t results;
+    wasm_valtype_vec_new_empty (&results);
+
+    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+    link_function (runtime, "env", "abort", functype, env_abort_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_functype_t *functype = wasm_functype_new_1_1 (
+        wasm_valtype_new_i32 (), wasm_valtype_new_f32 ());
+    link_function (runtime, "", "UiPanel_getWidth", functype,
+                   canary_panel_get_width_cb);
+    link_function (runtime, "", "UiPanel_getHeight", functype,
+                   canary_panel_get_height_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_functype_t *functype = wasm_functype_new_3_0 (
+        wasm_valtype_new_i32 (), wasm_valtype_new_f32 (),
+        wasm_valtype_new_f32 ());
+    link_function (runtime, "", "UiPanel_setSize", functype,
+                   canary_panel_set_size_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_valtype_vec_t params;
+    wasm_valtype_vec_new_uninitialized (&params, 5);
+
+    params.data[0] = wasm_valtype_new_i32 ();
+
+    for (size_t i = 1; i < params.size; i++)
+      params.data[i] = wasm_valtype_new_f32 ();
+
+    wasm_valtype_vec_t results;
+    wasm_valtype_vec_new_empty (&results);
+
+    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+    link_function (runtime, "", "UiPanel_setColor", functype,
+                   canary_panel_set_color_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_valtype_vec_t params;
+    wasm_valtype_vec_new_uninitialized (&params, 11);
+
+    params.data[0] = wasm_valtype_new_i32 ();
+
+    for (size_t i = 1; i < params.size; i++)
+      params.data[i] = wasm_valtype_new_f32 ();
+
+    wasm_valtype_vec_t results;
+    wasm_valtype_vec_new_empty (&results);
+
+    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+    link_function (runtime, "", "UiPanel_drawTriangle", functype,
+                   canary_panel_draw_triangle_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_valtype_vec_t params;
+    wasm_valtype_vec_new_uninitialized (&params, 5);
+
+    for (size_t i = 0; i < params.size; i++)
+      params.data[i] = wasm_valtype_new_i32 ();
+
+    wasm_valtype_vec_t results;
+    wasm_valtype_vec_new_empty (&results);
+
+    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+    link_function (runtime, "", "UiPanel_drawBuffers", functype,
+                   canary_panel_draw_buffers_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_functype_t *functype = wasm_functype_new_2_0 (
+        wasm_valtype_new_i32 (), wasm_valtype_new_i32 ());
+    link_function (runtime, "", "UiPanel_beginSegment", functype,
+                   canary_panel_begin_segment_cb);
+    link_function (runtime, "", "UiPanel_invalidateSegment", functype,
+                   canary_panel_invalidate_segment_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_functype_t *functype
+        = wasm_functype_new_1_0 (wasm_valtype_new_i32 ());
+    link_function (runtime, "", "UiPanel_endSegment", functype,
+                   canary_panel_end_segment_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_functype_t *functype = wasm_functype_new_2_1 (
+        wasm_valtype_new_i32 (), wasm_valtype_new_i32 (),
+        wasm_valtype_new_i32 ());
+    link_function (runtime, "", "UiPanel_drawSegment", functype,
+                   canary_panel_draw_segment_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    /* x, y, width, height, and a color */
+    wasm_functype_t *functype = new_panel_functype (8);
+    link_function (runtime, "", "UiPanel_drawRect", functype,
+                   canary_panel_draw_rect_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    /* x, y, width, height, radius, and a color */
+    wasm_functype_t *functype = new_panel_functype (9);
+    link_function (runtime, "", "UiPanel_drawRoundedRect", functype,
+                   canary_panel_draw_rounded_rect_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    /* x, y, radius, and a color */
+    wasm_functype_t *functype = new_panel_functype (7);
+    link_function (runtime, "", "UiPanel_drawCircle", functype,
+                   canary_panel_draw_circle_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    /* self, points, point count, width, closed, and a color */
+    wasm_valtype_vec_t params;
+    wasm_valtype_vec_new_uninitialized (&params, 9);
+
+    params.data[0] = wasm_valtype_new_i32 ();
+    params.data[1] = wasm_valtype_new_i32 ();
+    params.data[2] = wasm_valtype_new_i32 ();
+    params.data[3] = wasm_valtype_new_f32 ();
+    params.data[4] = wasm_valtype_new_i32 ();
+
+    for (size_t i = 5; i < params.size; i++)
+      params.data[i] = wasm_valtype_new_f32 ();
+
+    wasm_valtype_vec_t results;
+    wasm_valtype_vec_new_empty (&results);
+
+    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+    link_function (runtime, "", "UiPanel_drawPolyline", functype,
+                   canary_panel_draw_polyline_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    /* self, id, x, y, width, and height */
+    wasm_valtype_vec_t params;
+    wasm_valtype_vec_new_uninitialized (&params, 6);
+
+    params.data[0] = wasm_valtype_new_i32 ();
+    params.data[1] = wasm_valtype_new_i32 ();
+
+    for (size_t i = 2; i < params.size; i++)
+      params.data[i] = wasm_valtype_new_f32 ();
+
+    wasm_valtype_vec_t results;
+    wasm_valtype_vec_new_empty (&results);
+
+    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+    link_function (runtime, "", "UiPanel_addHitRect", functype,
+                   canary_panel_add_hit_rect_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    /* self, id, x, y, and radius */
+    wasm_valtype_vec_t params;
+    wasm_valtype_vec_new_uninitialized (&params, 5);
+
+    params.data[0] = wasm_valtype_new_i32 ();
+    params.data[1] = wasm_valtype_new_i32 ();
+
+    for (size_t i = 2; i < params.size; i++)
+      params.data[i] = wasm_valtype_new_f32 ();
+
+    wasm_valtype_vec_t results;
+    wasm_valtype_vec_new_empty (&results);
+
+    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+    link_function (runtime, "", "UiPanel_addHitCircle", functype,
+                   canary_panel_add_hit_circle_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_functype_t *functype = wasm_functype_new_2_0 (
+        wasm_valtype_new_i32 (), wasm_valtype_new_i32 ());
+    link_function (runtime, "", "UiPanel_removeHitRegion", functype,
+                   canary_panel_remove_hit_region_cb);
+    wasm_functype_delete (functype);
+  }
+
+  {
+    wasm_functype_t *functype
+        = wasm_functype_new_1_0 (wasm_valtype_new_i32 ());
+    link_function (runtime, "", "UiPanel_clearHitRegions", functype,
+                   canary_panel_clear_hit_regions_cb);
+    wasm_functype_delete (functype);
+  }
+}
+
+mdo_result_t
+canary_runtime_create (canary_runtime_t **runtime,
+                       const mdo_allocator_t *alloc)
+{
+  const canary_runtime_config_t config = { 0 };
+  return canary_runtime_create_with_config (runtime, alloc, &config);
+}
+
+mdo_result_t
+canary_runtime_create_with_config (canary_runtime_t **runtime,
+                                   const mdo_allocator_t *alloc,
+                                   const canary_runtime_config_t *config)
+{
+  canary_runtime_t *new_runtime
+      = mdo_allocator_malloc (alloc, sizeof (canary_runtime_t));
+  *runtime = new_runtime;
+
+  new_runtime->alloc = alloc;
+  new_runtime->engine = NULL;
+  new_runtime->linker = NULL;
+  new_runtime->import_num = 0;
+  new_runtime->module_cache = NULL;
+  new_runtime->watchdog = NULL;
+  new_runtime->trace = NULL;
+
+  new_runtime->max_scripts = config->max_scripts;
+  new_runtime->max_memory_pages = config->max_memory_pages;
+  new_runtime->script_num = 0;
+
+  pthread_mutex_init (&new_runtime->modules_lock, NULL);
+  new_runtime->modules.vals = NULL;
+  new_runtime->modules.size = 0;
+  new_runtime->modules.capacity = 0;
+
+  mdo_result_t wasm_error
+      = mdo_result_create (MDO_LOG_ERROR, "wasm error: %s", 1, false);
+  new_runtime->wasm_error = wasm_error;
+
+  mdo_result_t wasmtime_error
+      = mdo_result_create (MDO_LOG_ERROR, "wasmtime error: %s", 1, false);
+  new_runtime->wasmtime_error = wasmtime_error;
+
+  /* with budgets, compiled code checks for interrupts at loop headers and
+   * calls, so that the watchdog can stop scripts that overrun them */
+  wasm_config_t *wasm_config = wasm_config_new ();
+  wasmtime_config_interruptable_set (wasm_config, config->enable_budgets);
+
+  char *engine_key = new_runtime->engine_key;
+  size_t key_size = sizeof (new_runtime->engine_key);
+  int key_len = snprintf (engine_key, key_size, "wasmtime %s%s",
+                          CANARY_WASMTIME_VERSION,
+                          config->enable_budgets ? " interruptable" : "");
+
+  /* by default every memory reserves 6 GiB of address space, which is
+   * mapped and unmapped with each instance; bounding memories makes that
+   * reservation, and instantiation, as small as the limit allows */
+  if (config->max_memory_pages)
+    {
+      uint64_t bound = (uint64_t)config->max_memory_pages * WASM_PAGE_SIZE;
+      wasmtime_config_static_memory_maximum_size_set (wasm_config, bound);
+      wasmtime_config_static_memory_guard_size_set (wasm_config,
+                                                    WASM_PAGE_SIZE);
+      wasmtime_config_dynamic_memory_guard_size_set (wasm_config,
+                                                     WASM_PAGE_SIZE);
+
+      snprintf (engine_key + key_len, key_size - key_len,
+                " static %u pages", config->max_memory_pages);
+    }
+
+  new_runtime->engine = wasm_engine_new_with_config (wasm_config);
+  if (!new_runtime->engine)
+    return LOG_RESULT (wasm_error, "failed to create engine");
+
+  if (config->enable_budgets)
+    {
+      mdo_result_t result
+          = canary_watchdog_create (&new_runtime->watchdog, alloc);
+      if (!mdo_result_success (result))
+        return result;
+    }
+
+  new_runtime->linker = wasmtime_linker_new (new_runtime->engine);
+  if (!new_runtime->linker)
+    return LOG_RESULT (wasmtime_error, "failed to create linker");
+
+  link_functions (new_runtime);
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_runtime_delete (canary_runtime_t *runtime)
+{
+  const mdo_allocator_t *alloc = runtime->alloc;
+
+  for (size_t i = 0; i < runtime->modules.size; i++)
+    wasmtime_module_delete (runtime->modules.vals[i].module);
+
+  if (runtime->modules.vals)
+    mdo_allocator_free (alloc, runtime->modules.vals);
+
+  pthread_mutex_destroy (&runtime->modules_lock);
+
+  if (runtime->watchdog)
+    canary_watchdog_delete (runtime->watchdog);
+
+  if (runtime->linker)
+    wasmtime_linker_delete (runtime->linker);
+
+  if (runtime->engine)
+    wasm_engine_delete (runtime->engine);
+
+  mdo_allocator_free (alloc, runtime);
+}
+
+void
+canary_runtime_set_module_cache (canary_runtime_t *runtime,
+                                 canary_module_cache_t *cache)
+{
+  runtime->module_cache = cache;
+}
+
+const mdo_allocator_t *
+canary_runtime_get_allocator (canary_runtime_t *runtime)
+{
+  return runtime->alloc;
+}
+
+wasm_engine_t *
+canary_runtime_get_engine (canary_runtime_t *runtime)
+{
+  return runtime->engine;
+}
+
+const wasmtime_linker_t *
+canary_runtime_get_linker (canary_runtime_t *runtime)
+{
+  return runtime->linker;
+}
+
+canary_watchdog_t *
+canary_runtime_get_watchdog (canary_runtime_t *runtime)
+{
+  return runtime->watchdog;
+}
+
+void
+canary_runtime_set_trace (canary_runtime_t *runtime, canary_trace_t *trace)
+{
+  __atomic_store_n (&runtime->trace, trace, __ATOMIC_RELEASE);
+}
+
+canary_trace_t *
+canary_runtime_get_trace (canary_runtime_t *runtime)
+{
+  return __atomic_load_n (&runtime->trace, __ATOMIC_ACQUIRE);
+}
+
+int
+canary_runtime_add_script (canary_runtime_t *runtime)
+{
+  size_t script_num
+      = __atomic_load_n (&runtime->script_num, __ATOMIC_RELAXED);
+
+  do
+    {
+      if (runtime->max_scripts && script_num >= runtime->max_scripts)
+        return -1;
+    }
+  while (!__atomic_compare_exchange_n (&runtime->script_num, &script_num,
+                                       script_num + 1, true, __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED));
+
+  return 0;
+}
+
+void
+canary_runtime_remove_script (canary_runtime_t *runtime)
+{
+  __atomic_fetch_sub (&runtime->script_num, 1, __ATOMIC_RELAXED);
+}
+
+size_t
+canary_runtime_get_import_num (canary_runtime_t *runtime)
+{
+  return runtime->import_num;
+}
+
+const char *
+canary_runtime_get_import_name (canary_runtime_t *runtime, size_t index)
+{
+  if (index >= runtime->import_num)
+    return NULL;
+
+  return runtime->imports[index].symbol;
+}
+
+static module_entry_t *
+find_module (canary_runtime_t *runtime, const uint8_t *hash)
+{
+  for (size_t i = 0; i < runtime->modules.size; i++)
+    {
+      module_entry_t *entry = &runtime->modules.vals[i];
+      if (!memcmp (entry->hash, hash, SHA256_DIGEST_SIZE))
+        return entry;
+    }
+
+  return NULL;
+}
+
+static void
+add_module (canary_runtime_t *runtime, const uint8_t *hash,
+            wasmtime_module_t *module)
+{
+  const mdo_allocator_t *alloc = runtime->alloc;
+
+  if (runtime->modules.capacity == 0)
+    {
+      runtime->modules.capacity = 16;
+      runtime->modules.vals = mdo_allocator_calloc (
+          alloc, runtime->modules.capacity, sizeof (module_entry_t));
+    }
+  else if (runtime->modules.size >= runtime->modules.capacity)
+    {
+      runtime->modules.capacity = runtime->modules.capacity << 1;
+      runtime->modules.vals = mdo_allocator_realloc (
+          alloc, runtime->modules.vals,
+          sizeof (module_entry_t) * runtime->modules.capacity);
+    }
+
+  module_entry_t *entry = &runtime->modules.vals[runtime->modules.size++];
+  memcpy (entry->hash, hash, SHA256_DIGEST_SIZE);
+  entry->module = module;
+  entry->ref_count = 1;
+}
+
+static bool
+memory_fits (canary_runtime_t *runtime, const wasm_externtype_t *type)
+{
+  if (wasm_externtype_kind (type) != WASM_EXTERN_MEMORY)
+    return true;
+
+  const wasm_limits_t *limits
+      = wasm_memorytype_limits (wasm_externtype_as_memorytype_const (type));
+
+  /* wasm_limits_max_default marks a memory without a maximum */
+  return limits->max != wasm_limits_max_default
+         && limits->max <= runtime->max_memory_pages;
+}
+
+/* precompiled modules have no binary to read their limits from, so only
+ * the memories they import or export can be checked */
+static int
+check_precompiled_limits (canary_runtime_t *runtime,
+                          const wasmtime_module_t *module)
+{
+  int result = 0;
+
+  wasm_importtype_vec_t imports;
+  wasmtime_module_imports (module, &imports);
+
+  for (size_t i = 0; i < imports.size; i++)
+    if (!memory_fits (runtime, wasm_importtype_type (imports.data[i])))
+      result = -1;
+
+  wasm_importtype_vec_delete (&imports);
+
+  wasm_exporttype_vec_t exports;
+  wasmtime_module_exports (module, &exports);
+
+  for (size_t i = 0; i < exports.size; i++)
+    if (!memory_fits (runtime, wasm_exporttype_type (exports.data[i])))
+      result = -1;
+
+  wasm_exporttype_vec_delete (&exports);
+
+  return result;
+}
+
+/* shares a module made from the same bytes, precompiled or not, with any
+ * that was made before */
+static wasmtime_error_t *
+share_module (canary_runtime_t *runtime, const uint8_t *data, size_t size,
+              bool precompiled, wasmtime_module_t **module)
+{
+  uint8_t hash[SHA256_DIGEST_SIZE];
+  sha256_t sha256;
+  sha256_init (&sha256);
+  sha256_update (&sha256, data, size);
+  sha256_final (&sha256, hash);
+
+  pthread_mutex_lock (&runtime->modules_lock);
+
+  module_entry_t *entry = find_module (runtime, hash);
+  if (entry)
+    {
+      entry->ref_count++;
+      *module = entry->module;
+      pthread_mutex_unlock (&runtime->modules_lock);
+      return NULL;
+    }
+
+  pthread_mutex_unlock (&runtime->modules_lock);
+
+  /* wasmtime only gives a memory the static bound if its declared maximum
+   * fits in it; any other memory is allocated dynamically, and could grow
+   * past the limit */
+  if (runtime->max_memory_pages && !precompiled
+      && memory_limits_check (data, size, runtime->max_memory_pages))
+    {
+      LOG_ERR ("module's memories must declare a maximum of at most %u "
+               "pages",
+               runtime->max_memory_pages);
+      *module = NULL;
+      return NULL;
+    }
+
+  /* compile unlocked; a racing compile of the same bytes is harmless */
+  wasmtime_error_t *error;
+  if (precompiled)
+    error = wasmtime_module_deserialize (runtime->engine, data, size, module);
+  else if (runtime->module_cache)
+    error = canary_module_cache_compile (runtime->module_cache,
+                                         runtime->engine, runtime->engine_key,
+                                         data, size, module);
+  else
+    error = wasmtime_module_new (runtime->engine, data, size, module);
+
+  if (error)
+    return error;
+
+  if (runtime->max_memory_pages && precompiled
+      && check_precompiled_limits (runtime, *module))
+    {
+      LOG_ERR ("precompiled module's memories must declare a maximum of at "
+               "most %u pages",
+               runtime->max_memory_pages);
+      wasmtime_module_delete (*module);
+      *module = NULL;
+      return NULL;
+    }
+
+  pthread_mutex_lock (&runtime->modules_lock);
+
+  entry = find_module (runtime, hash);
+  if (entry)
+    {
+      wasmtime_module_delete (*module);
+      entry->ref_count++;
+      *module = entry->module;
+    }
+  else
+    {
+      add_module (runtime, hash, *module);
+    }
+
+  pthread_mutex_unlock (&runtime->modules_lock);
+
+  return NULL;
+}
+
+wasmtime_error_t *
+canary_runtime_compile (canary_runtime_t *runtime, const uint8_t *wasm,
+                        size_t wasm_size, wasmtime_module_t **module)
+{
+  return share_module (runtime, wasm, wasm_size, false, module);
+}
+
+wasmtime_error_t *
+canary_runtime_deserialize (canary_runtime_t *runtime, const uint8_t *data,
+                            size_t size, wasmtime_module_t **module)
+{
+  return share_module (runtime, data, size, true, module);
+}
+
+void
+canary_runtime_release_module (canary_runtime_t *runtime,
+                               wasmtime_module_t *module)
+{
+  pthread_mutex_lock (&runtime->modules_lock);
+
+  for (size_t i = 0; i < runtime->modules.size; i++)
+    {
+      module_entry_t *entry = &runtime->modules.vals[i];
+      if (entry->module != module)
+        continue;
+
+      if (--entry->ref_count == 0)
+        {
+          wasmtime_module_delete (entry->module);
+          *entry = runtime->modules.vals[--runtime->modules.size];
+        }
+
+      break;
+    }
+
+  pthread_mutex_unlock (&runtime->modules_lock);
+}
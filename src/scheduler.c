@@ -0,0 +1,252 @@
+/** @file scheduler.c
+ */
+
+#include "scheduler.h"
+
+#include <pthread.h>
+
+/* a range of script indices; the owner takes from the head, and idle
+ * workers steal from the tail */
+typedef struct work_queue_s
+{
+  pthread_mutex_t lock;
+  size_t head;
+  size_t tail;
+} work_queue_t;
+
+typedef struct worker_s
+{
+  canary_scheduler_t *scheduler;
+  uint32_t index;
+  pthread_t thread;
+} worker_t;
+
+struct canary_scheduler_s
+{
+  const mdo_allocator_t *alloc;
+
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+  uint32_t generation;
+  uint32_t busy_workers;
+  int shutdown;
+
+  /* queue 0 belongs to the calling thread */
+  uint32_t thread_num;
+  work_queue_t *queues;
+  worker_t *workers;
+
+  canary_script_t *const *scripts;
+  float dt;
+
+  /* each job writes only its own index, so this needs no locking */
+  canary_script_status_t *statuses;
+};
+
+static int
+pop_work (work_queue_t *queue, size_t *job)
+{
+  int found = 0;
+
+  pthread_mutex_lock (&queue->lock);
+  if (queue->head < queue->tail)
+    {
+      *job = queue->head++;
+      found = 1;
+    }
+  pthread_mutex_unlock (&queue->lock);
+
+  return found;
+}
+
+static int
+steal_work (work_queue_t *queue, size_t *job)
+{
+  int found = 0;
+
+  pthread_mutex_lock (&queue->lock);
+  if (queue->head < queue->tail)
+    {
+      *job = --queue->tail;
+      found = 1;
+    }
+  pthread_mutex_unlock (&queue->lock);
+
+  return found;
+}
+
+static void
+run_queue (canary_scheduler_t *scheduler, uint32_t index)
+{
+  work_queue_t *own = &scheduler->queues[index];
+
+  for (;;)
+    {
+      size_t job;
+      int found = pop_work (own, &job);
+
+      for (uint32_t i = 1; !found && i < scheduler->thread_num; i++)
+        {
+          uint32_t victim = (index + i) % scheduler->thread_num;
+          found = steal_work (&scheduler->queues[victim], &job);
+        }
+
+      /* no work is added mid-frame, so empty queues stay empty */
+      if (!found)
+        break;
+
+      canary_script_status_t status
+          = canary_script_update (scheduler->scripts[job], scheduler->dt);
+
+      if (scheduler->statuses)
+        scheduler->statuses[job] = status;
+    }
+}
+
+static void *
+worker_main (void *arg)
+{
+  worker_t *worker = arg;
+  canary_scheduler_t *scheduler = worker->scheduler;
+  uint32_t generation = 0;
+
+  for (;;)
+    {
+      pthread_mutex_lock (&scheduler->lock);
+
+      while (!scheduler->shutdown && scheduler->generation == generation)
+        pthread_cond_wait (&scheduler->work_cond, &scheduler->lock);
+
+      generation = scheduler->generation;
+      int shutdown = scheduler->shutdown;
+      pthread_mutex_unlock (&scheduler->lock);
+
+      if (shutdown)
+        break;
+
+      run_queue (scheduler, worker->index);
+
+      pthread_mutex_lock (&scheduler->lock);
+      if (--scheduler->busy_workers == 0)
+        pthread_cond_signal (&scheduler->done_cond);
+      pthread_mutex_unlock (&scheduler->lock);
+    }
+
+  return NULL;
+}
+
+mdo_result_t
+canary_scheduler_create (canary_scheduler_t **scheduler,
+                         const mdo_allocator_t *alloc, uint32_t thread_num)
+{
+  canary_scheduler_t *new_scheduler
+      = mdo_allocator_malloc (alloc, sizeof (canary_scheduler_t));
+  *scheduler = new_scheduler;
+
+  new_scheduler->alloc = alloc;
+
+  pthread_mutex_init (&new_scheduler->lock, NULL);
+  pthread_cond_init (&new_scheduler->work_cond, NULL);
+  pthread_cond_init (&new_scheduler->done_cond, NULL);
+  new_scheduler->generation = 0;
+  new_scheduler->busy_workers = 0;
+  new_scheduler->shutdown = 0;
+
+  new_scheduler->scripts = NULL;
+  new_scheduler->dt = 0.0;
+  new_scheduler->statuses = NULL;
+
+  if (thread_num < 1)
+    thread_num = 1;
+
+  new_scheduler->thread_num = thread_num;
+  new_scheduler->queues
+      = mdo_allocator_calloc (alloc, thread_num, sizeof (work_queue_t));
+
+  for (uint32_t i = 0; i < thread_num; i++)
+    pthread_mutex_init (&new_scheduler->queues[i].lock, NULL);
+
+  new_scheduler->workers
+      = mdo_allocator_calloc (alloc, thread_num, sizeof (worker_t));
+
+  for (uint32_t i = 1; i < thread_num; i++)
+    {
+      worker_t *worker = &new_scheduler->workers[i];
+      worker->scheduler = new_scheduler;
+      worker->index = i;
+
+      if (pthread_create (&worker->thread, NULL, worker_main, worker))
+        {
+          LOG_ERR ("failed to create scheduler thread");
+          new_scheduler->thread_num = i;
+          break;
+        }
+    }
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_scheduler_delete (canary_scheduler_t *scheduler)
+{
+  const mdo_allocator_t *alloc = scheduler->alloc;
+
+  pthread_mutex_lock (&scheduler->lock);
+  scheduler->shutdown = 1;
+  pthread_cond_broadcast (&scheduler->work_cond);
+  pthread_mutex_unlock (&scheduler->lock);
+
+  for (uint32_t i = 1; i < scheduler->thread_num; i++)
+    pthread_join (scheduler->workers[i].thread, NULL);
+
+  for (uint32_t i = 0; i < scheduler->thread_num; i++)
+    pthread_mutex_destroy (&scheduler->queues[i].lock);
+
+  pthread_cond_destroy (&scheduler->done_cond);
+  pthread_cond_destroy (&scheduler->work_cond);
+  pthread_mutex_destroy (&scheduler->lock);
+
+  mdo_allocator_free (alloc, scheduler->workers);
+  mdo_allocator_free (alloc, scheduler->queues);
+  mdo_allocator_free (alloc, scheduler);
+}
+
+void
+canary_scheduler_update (canary_scheduler_t *scheduler,
+                         canary_script_t *const *scripts, size_t script_num,
+                         float dt, canary_script_status_t *statuses)
+{
+  uint32_t thread_num = scheduler->thread_num;
+
+  scheduler->scripts = scripts;
+  scheduler->dt = dt;
+  scheduler->statuses = statuses;
+
+  /* the queues are idle, so they can be refilled without locking */
+  for (uint32_t i = 0; i < thread_num; i++)
+    {
+      work_queue_t *queue = &scheduler->queues[i];
+      queue->head = script_num * i / thread_num;
+      queue->tail = script_num * (i + 1) / thread_num;
+    }
+
+  if (thread_num > 1)
+    {
+      pthread_mutex_lock (&scheduler->lock);
+      scheduler->busy_workers = thread_num - 1;
+      scheduler->generation++;
+      pthread_cond_broadcast (&scheduler->work_cond);
+      pthread_mutex_unlock (&scheduler->lock);
+    }
+
+  run_queue (scheduler, 0);
+
+  if (thread_num > 1)
+    {
+      pthread_mutex_lock (&scheduler->lock);
+      while (scheduler->busy_workers > 0)
+        pthread_cond_wait (&scheduler->done_cond, &scheduler->lock);
+      pthread_mutex_unlock (&scheduler->lock);
+    }
+}
@@ -1,18 +1,96 @@
 #include "script.h"
 
+#include <pthread.h>
 #include <stdio.h>
-#include <string.h> /* for strlen, strncmp */
+#include <string.h> /* for memcmp, memcpy, memset, strcmp, strlen, strncmp */
 #include <wasm.h>
 #include <wasmtime.h>
 
-#include "panel-api.h"
+#include "api.h"
+#include "file_map.h"
+
+typedef enum
+{
+  CALLBACK_UPDATE,
+  CALLBACK_BIND_PANEL,
+  CALLBACK_ON_HOVER,
+  CALLBACK_ON_SELECT,
+  CALLBACK_ON_DRAG,
+  CALLBACK_ON_DESELECT,
+  CALLBACK_ON_ENTER,
+  CALLBACK_ON_LEAVE,
+  CALLBACK_ON_REGION_HOVER,
+  CALLBACK_NUM,
+} script_callback_t;
+
+static const char *CALLBACK_NAMES[CALLBACK_NUM] = {
+  [CALLBACK_UPDATE] = "update",
+  [CALLBACK_BIND_PANEL] = "bind_panel",
+  [CALLBACK_ON_HOVER] = "on_hover",
+  [CALLBACK_ON_SELECT] = "on_select",
+  [CALLBACK_ON_DRAG] = "on_drag",
+  [CALLBACK_ON_DESELECT] = "on_deselect",
+  [CALLBACK_ON_ENTER] = "on_enter",
+  [CALLBACK_ON_LEAVE] = "on_leave",
+  [CALLBACK_ON_REGION_HOVER] = "on_region_hover",
+};
+
+typedef struct callback_entry_s
+{
+  bool exported;
+  wasmtime_func_t func;
+} callback_entry_t;
+
+/* panel keys are a slot index in the low bits and the slot's generation in
+ * the high bits, so that a key goes stale once its panel is unbound */
+#define PANEL_KEY_INDEX_BITS 16
+#define PANEL_KEY_INDEX_MASK ((1u << PANEL_KEY_INDEX_BITS) - 1)
+#define PANEL_SLOT_MAX (1u << PANEL_KEY_INDEX_BITS)
+#define PANEL_GENERATION_MASK ((1u << (32 - PANEL_KEY_INDEX_BITS)) - 1)
+
+#define PANEL_FREE_NONE UINT32_MAX
 
 typedef struct panel_entry_s
 {
+  /* NULL while the slot is free */
   canary_panel_t *panel;
   uint32_t userdata;
+
+  /* never zero, so that zero is never a valid key */
+  uint32_t generation;
+
+  /* the next free slot, while this one is free */
+  uint32_t next_free;
+
+  /* the hit region last entered, if the pointer hasn't left it since */
+  bool hovering;
+  uint32_t hover_region;
+
+  /* only recorded while profiling */
+  canary_profile_draw_stats_t draw_stats;
 } panel_entry_t;
 
+/* a module being compiled off-thread by canary_script_reload */
+typedef struct reload_job_s
+{
+  canary_runtime_t *runtime;
+  const mdo_allocator_t *alloc;
+  char *filename;
+  pthread_t thread;
+
+  /* written by the compile thread before it sets done */
+  wasmtime_module_t *module;
+  wasmtime_error_t *error;
+  bool done;
+} reload_job_t;
+
+typedef struct input_entry_s
+{
+  canary_panel_key_t panel_key;
+  canary_input_event_t event;
+  float coords[2];
+} input_entry_t;
+
 struct canary_script_s
 {
   const mdo_allocator_t *alloc;
@@ -20,22 +98,71 @@ struct canary_script_s
   mdo_result_t wasmtime_error;
   mdo_result_t wasm_trap_error;
 
-  wasm_engine_t *engine;
+  canary_runtime_t *runtime;
   wasmtime_store_t *store;
   wasmtime_context_t *context;
 
-  wasmtime_linker_t *linker;
+  /* false if the runtime had no room for the script */
+  bool counted;
 
   wasmtime_module_t *module;
   wasmtime_instance_t instance;
 
+  /* resolved once on load so that dispatch doesn't look up exports */
+  callback_entry_t callbacks[CALLBACK_NUM];
+
   /* TODO(marceline-cramer): use mdo-utils vector */
   struct
   {
     panel_entry_t *vals;
     size_t size;
     size_t capacity;
+    uint32_t free_head;
   } panels;
+
+  canary_input_mode_t input_mode;
+  size_t coalesced_input;
+
+  /* TODO(marceline-cramer): use mdo-utils vector */
+  struct
+  {
+    input_entry_t *vals;
+    size_t size;
+    size_t capacity;
+  } input_queue;
+
+  /* per-call CPU budget, enforced by the runtime's watchdog; the timer is
+   * NULL if the engine can't interrupt the store */
+  canary_watchdog_timer_t *timer;
+  float budget;
+
+  /* state of the call from the host that is currently running */
+  bool in_call;
+  bool call_armed;
+  canary_script_status_t call_status;
+
+  /* a trap in this call was the budget's interrupt; if the budget fired
+   * without one, the interrupt is still waiting in the store */
+  bool interrupt_consumed;
+
+  /* the timer fired after the script had already returned, so the store
+   * will trap as soon as it is entered again */
+  bool interrupt_pending;
+
+  size_t overruns;
+  size_t consecutive_overruns;
+
+  /* NULL unless profiling is enabled; imports are indexed like the
+   * runtime's */
+  canary_profile_stats_t *callback_stats;
+  canary_profile_stats_t *import_stats;
+  size_t import_stat_num;
+
+  /* NULL unless the host's calls are being recorded */
+  canary_recorder_t *recorder;
+
+  /* NULL unless a reload is compiling, or waiting for the next update */
+  reload_job_t *reload;
 };
 
 static int
@@ -60,11 +187,23 @@ log_wasm_trap (canary_script_t *script, wasm_trap_t *trap)
   return -1;
 }
 
-static wasm_trap_t *
-env_abort_cb (void *env, wasmtime_caller_t *caller, const wasmtime_val_t *args,
-              size_t arg_num, wasmtime_val_t *results, size_t result_num)
+/* wasmtime reports the interrupt like any other trap code, as the start
+ * of the trap's message */
+static bool
+trap_is_interrupt (wasm_trap_t *trap)
 {
-  return NULL;
+  static const char INTERRUPT[] = "wasm trap: interrupt";
+  const size_t interrupt_size = sizeof (INTERRUPT) - 1;
+
+  wasm_byte_vec_t trap_message;
+  wasm_trap_message (trap, &trap_message);
+
+  bool is_interrupt
+      = trap_message.size >= interrupt_size
+        && !memcmp (trap_message.data, INTERRUPT, interrupt_size);
+
+  wasm_byte_vec_delete (&trap_message);
+  return is_interrupt;
 }
 
 static void
@@ -72,37 +211,75 @@ finalizer_cb (void *env)
 {
 }
 
-static void
-link_function (canary_script_t *script, const char *module, const char *symbol,
-               wasm_functype_t *functype, wasmtime_func_callback_t cb)
+/* the timer is left NULL if the store can't be interrupted */
+static wasmtime_store_t *
+create_store (canary_script_t *script, canary_watchdog_timer_t **timer)
 {
-  /* TODO(marceline-cramer): collect created funcs with vector and delete */
-  wasmtime_extern_t func_extern;
-  func_extern.kind = WASMTIME_EXTERN_FUNC;
-  wasmtime_func_new (script->context, functype, cb, script, finalizer_cb,
-                     &func_extern.of.func);
+  /* host callbacks look the script up from the store's data */
+  wasmtime_store_t *store = wasmtime_store_new (
+      canary_runtime_get_engine (script->runtime), script, finalizer_cb);
+  if (!store)
+    return NULL;
 
-  wasmtime_error_t *error
-      = wasmtime_linker_define (script->linker, module, strlen (module),
-                                symbol, strlen (symbol), &func_extern);
-  if (error)
-    log_wasmtime_error (script, error);
+  *timer = NULL;
+
+  canary_watchdog_t *watchdog = canary_runtime_get_watchdog (script->runtime);
+  if (!watchdog)
+    return store;
+
+  wasmtime_interrupt_handle_t *interrupt_handle
+      = wasmtime_interrupt_handle_new (wasmtime_store_context (store));
+  if (interrupt_handle)
+    canary_watchdog_timer_create (timer, watchdog, interrupt_handle);
+
+  return store;
 }
 
 mdo_result_t
-canary_script_create (canary_script_t **script, const mdo_allocator_t *alloc)
+canary_script_create (canary_script_t **script, canary_runtime_t *runtime)
 {
+  const mdo_allocator_t *alloc = canary_runtime_get_allocator (runtime);
+
   canary_script_t *new_script
       = mdo_allocator_malloc (alloc, sizeof (canary_script_t));
   *script = new_script;
 
   new_script->alloc = alloc;
+  new_script->runtime = runtime;
   new_script->module = NULL;
 
+  for (int i = 0; i < CALLBACK_NUM; i++)
+    new_script->callbacks[i].exported = false;
+
   new_script->panels.capacity = 16;
   new_script->panels.vals = mdo_allocator_calloc (
       alloc, new_script->panels.capacity, sizeof (panel_entry_t));
   new_script->panels.size = 0;
+  new_script->panels.free_head = PANEL_FREE_NONE;
+
+  new_script->input_mode = CANARY_INPUT_IMMEDIATE;
+  new_script->coalesced_input = 0;
+
+  new_script->input_queue.vals = NULL;
+  new_script->input_queue.size = 0;
+  new_script->input_queue.capacity = 0;
+
+  new_script->timer = NULL;
+  new_script->budget = 0.0;
+  new_script->in_call = false;
+  new_script->call_armed = false;
+  new_script->call_status = CANARY_SCRIPT_OK;
+  new_script->interrupt_consumed = false;
+  new_script->interrupt_pending = false;
+  new_script->overruns = 0;
+  new_script->consecutive_overruns = 0;
+
+  new_script->callback_stats = NULL;
+  new_script->import_stats = NULL;
+  new_script->import_stat_num = 0;
+
+  new_script->recorder = NULL;
+  new_script->reload = NULL;
 
   mdo_result_t wasm_error
       = mdo_result_create (MDO_LOG_ERROR, "wasm error: %s", 1, false);
@@ -116,161 +293,276 @@ canary_script_create (canary_script_t **script, const mdo_allocator_t *alloc)
       = mdo_result_create (MDO_LOG_ERROR, "wasm trap thrown: %s", 1, false);
   new_script->wasm_trap_error = wasm_trap_error;
 
-  new_script->engine = wasm_engine_new ();
-  if (!new_script->engine)
-    return LOG_RESULT (wasm_error, "failed to create engine");
+  new_script->store = NULL;
+  new_script->counted = !canary_runtime_add_script (runtime);
+  if (!new_script->counted)
+    return LOG_RESULT (wasm_error, "too many scripts for the runtime");
 
-  new_script->store
-      = wasmtime_store_new (new_script->engine, NULL, finalizer_cb);
+  new_script->store = create_store (new_script, &new_script->timer);
   if (!new_script->store)
     return LOG_RESULT (wasm_error, "failed to create store");
 
   new_script->context = wasmtime_store_context (new_script->store);
 
-  new_script->linker = wasmtime_linker_new (new_script->engine);
-  if (!new_script->linker)
-    return LOG_RESULT (wasmtime_error, "failed to create linker");
+  return MDO_SUCCESS;
+}
 
-  {
-    wasm_valtype_vec_t params;
-    wasm_valtype_vec_new_uninitialized (&params, 4);
+canary_script_t *
+canary_script_from_caller (wasmtime_caller_t *caller)
+{
+  return wasmtime_context_get_data (wasmtime_caller_context (caller));
+}
 
-    for (size_t i = 0; i < params.size; i++)
-      params.data[i] = wasm_valtype_new_i32 ();
+static void
+resolve_callbacks (canary_script_t *script)
+{
+  for (int i = 0; i < CALLBACK_NUM; i++)
+    {
+      const char *symbol = CALLBACK_NAMES[i];
+      callback_entry_t *callback = &script->callbacks[i];
+      callback->exported = false;
 
-    wasm_valtype_vec_t results;
-    wasm_valtype_vec_new_empty (&results);
+      wasmtime_extern_t exported;
 
-    /* TODO(marceline-cramer): collect with vector and delete */
-    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+      if (!wasmtime_instance_export_get (script->context, &script->instance,
+                                         symbol, strlen (symbol), &exported))
+        continue;
 
-    link_function (new_script, "env", "abort", functype, env_abort_cb);
-  }
+      if (exported.kind != WASMTIME_EXTERN_FUNC)
+        {
+          LOG_ERR ("export '%s' is not a function", symbol);
+          continue;
+        }
 
-  {
-    /* TODO(marceline-cramer): collect with vector and delete */
-    wasm_functype_t *functype = wasm_functype_new_1_1 (
-        wasm_valtype_new_i32 (), wasm_valtype_new_f32 ());
-    link_function (new_script, "", "UiPanel_getWidth", functype,
-                   canary_panel_get_width_cb);
-    link_function (new_script, "", "UiPanel_getHeight", functype,
-                   canary_panel_get_height_cb);
-  }
+      callback->exported = true;
+      callback->func = exported.of.func;
+    }
+}
 
-  {
-    /* TODO(marceline-cramer): collect with vector and delete */
-    wasm_functype_t *functype = wasm_functype_new_3_0 (
-        wasm_valtype_new_i32 (), wasm_valtype_new_f32 (),
-        wasm_valtype_new_f32 ());
-    link_function (new_script, "", "UiPanel_setSize", functype,
-                   canary_panel_set_size_cb);
-  }
+static mdo_result_t
+load_bytes (canary_script_t *script, const uint8_t *data, size_t size,
+            bool precompiled)
+{
+  mdo_result_t wasm_error = script->wasm_error;
 
-  {
-    wasm_valtype_vec_t params;
-    wasm_valtype_vec_new_uninitialized (&params, 5);
+  if (script->module)
+    {
+      canary_runtime_release_module (script->runtime, script->module);
+      script->module = NULL;
+    }
 
-    params.data[0] = wasm_valtype_new_i32 ();
+  wasmtime_error_t *wasmtime_error;
+  if (precompiled)
+    wasmtime_error = canary_runtime_deserialize (script->runtime, data, size,
+                                                 &script->module);
+  else
+    wasmtime_error = canary_runtime_compile (script->runtime, data, size,
+                                             &script->module);
 
-    for (size_t i = 1; i < params.size; i++)
-      params.data[i] = wasm_valtype_new_f32 ();
+  if (wasmtime_error)
+    return log_wasmtime_error (script, wasmtime_error);
 
-    wasm_valtype_vec_t results;
-    wasm_valtype_vec_new_empty (&results);
+  if (!script->module)
+    return LOG_RESULT (wasm_error, "failed to compile UI script");
 
-    /* TODO(marceline-cramer): collect with vector and delete */
-    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+  const wasmtime_linker_t *linker
+      = canary_runtime_get_linker (script->runtime);
 
-    link_function (new_script, "", "UiPanel_setColor", functype,
-                   canary_panel_set_color_cb);
-  }
+  wasm_trap_t *trap = NULL;
+  wasmtime_error = wasmtime_linker_instantiate (
+      linker, script->context, script->module, &script->instance, &trap);
 
-  {
-    wasm_valtype_vec_t params;
-    wasm_valtype_vec_new_uninitialized (&params, 11);
+  if (wasmtime_error)
+    return log_wasmtime_error (script, wasmtime_error);
 
-    params.data[0] = wasm_valtype_new_i32 ();
+  if (trap)
+    return log_wasm_trap (script, trap);
 
-    for (size_t i = 1; i < params.size; i++)
-      params.data[i] = wasm_valtype_new_f32 ();
+  resolve_callbacks (script);
 
-    wasm_valtype_vec_t results;
-    wasm_valtype_vec_new_empty (&results);
+  return MDO_SUCCESS;
+}
 
-    /* TODO(marceline-cramer): collect with vector and delete */
-    wasm_functype_t *functype = wasm_functype_new (&params, &results);
+/* maps the file instead of reading it, so that it isn't copied before
+ * wasmtime makes its own copy */
+static mdo_result_t
+load_file (canary_script_t *script, const char *filename, bool precompiled)
+{
+  file_map_t map;
+  if (file_map_open (&map, filename))
+    return LOG_RESULT (script->wasm_error, "failed to open UI script file");
 
-    link_function (new_script, "", "UiPanel_drawTriangle", functype,
-                   canary_panel_draw_triangle_cb);
-  }
+  mdo_result_t result = load_bytes (script, map.data, map.size, precompiled);
 
-  return MDO_SUCCESS;
+  file_map_close (&map);
+  return result;
+}
+
+static void *
+reload_main (void *data)
+{
+  reload_job_t *job = data;
+
+  file_map_t map;
+  if (!file_map_open (&map, job->filename))
+    {
+      job->error = canary_runtime_compile (job->runtime, map.data, map.size,
+                                           &job->module);
+      file_map_close (&map);
+    }
+
+  __atomic_store_n (&job->done, true, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+/* waits for the compile thread and takes the job from the script */
+static reload_job_t *
+join_reload (canary_script_t *script)
+{
+  reload_job_t *job = script->reload;
+  script->reload = NULL;
+
+  pthread_join (job->thread, NULL);
+  return job;
+}
+
+static void
+delete_reload (canary_script_t *script, reload_job_t *job)
+{
+  const mdo_allocator_t *alloc = script->alloc;
+
+  if (job->module)
+    canary_runtime_release_module (script->runtime, job->module);
+
+  if (job->error)
+    wasmtime_error_delete (job->error);
+
+  mdo_allocator_free (alloc, job->filename);
+  mdo_allocator_free (alloc, job);
+}
+
+/* a pending reload would otherwise replace a load */
+static void
+cancel_reload (canary_script_t *script)
+{
+  if (script->reload)
+    delete_reload (script, join_reload (script));
 }
 
 mdo_result_t
 canary_script_load (canary_script_t *script, const char *filename)
 {
-  const mdo_allocator_t *alloc = script->alloc;
-  mdo_result_t wasm_error = script->wasm_error;
+  canary_trace_t *trace = canary_runtime_get_trace (script->runtime);
 
-  FILE *f = fopen (filename, "rb");
-  if (!f)
-    return LOG_RESULT (wasm_error, "failed to open UI script file");
+  cancel_reload (script);
 
-  wasm_byte_vec_t file_contents;
+  if (trace)
+    canary_trace_begin (trace, "canary_script_load");
 
-  fseek (f, 0, SEEK_END);
-  file_contents.size = ftell (f);
-  fseek (f, 0, SEEK_SET);
-  file_contents.data = mdo_allocator_malloc (alloc, file_contents.size);
-  fread (file_contents.data, 1, file_contents.size, f);
-  fclose (f);
+  mdo_result_t result = load_file (script, filename, false);
 
-  wasmtime_error_t *wasmtime_error = wasmtime_module_new (
-      script->engine, (const uint8_t *)file_contents.data, file_contents.size,
-      &script->module);
-  mdo_allocator_free (alloc, file_contents.data);
+  if (trace)
+    canary_trace_end (trace, "canary_script_load");
 
-  if (wasmtime_error)
-    return log_wasmtime_error (script, wasmtime_error);
+  return result;
+}
 
-  if (!script->module)
-    return LOG_RESULT (wasm_error, "failed to compile UI script");
+mdo_result_t
+canary_script_load_precompiled (canary_script_t *script, const char *filename)
+{
+  canary_trace_t *trace = canary_runtime_get_trace (script->runtime);
 
-  wasm_trap_t *trap = NULL;
-  wasmtime_error
-      = wasmtime_linker_instantiate (script->linker, script->context,
-                                     script->module, &script->instance, &trap);
+  cancel_reload (script);
 
-  if (wasmtime_error)
-    return log_wasmtime_error (script, wasmtime_error);
+  if (trace)
+    canary_trace_begin (trace, "canary_script_load_precompiled");
 
-  if (trap)
-    return log_wasm_trap (script, trap);
+  mdo_result_t result = load_file (script, filename, true);
+
+  if (trace)
+    canary_trace_end (trace, "canary_script_load_precompiled");
+
+  return result;
+}
+
+mdo_result_t
+canary_script_load_buffer (canary_script_t *script, const uint8_t *wasm,
+                           size_t wasm_size)
+{
+  canary_trace_t *trace = canary_runtime_get_trace (script->runtime);
+
+  cancel_reload (script);
+
+  if (trace)
+    canary_trace_begin (trace, "canary_script_load_buffer");
+
+  mdo_result_t result = load_bytes (script, wasm, wasm_size, false);
+
+  if (trace)
+    canary_trace_end (trace, "canary_script_load_buffer");
 
+  return result;
+}
+
+mdo_result_t
+canary_script_reload (canary_script_t *script, const char *filename)
+{
+  const mdo_allocator_t *alloc = script->alloc;
+  mdo_result_t wasm_error = script->wasm_error;
+
+  if (script->reload)
+    return LOG_RESULT (wasm_error, "a reload is already in progress");
+
+  reload_job_t *job = mdo_allocator_calloc (alloc, 1, sizeof (reload_job_t));
+  job->runtime = script->runtime;
+  job->alloc = alloc;
+
+  size_t filename_size = strlen (filename) + 1;
+  job->filename = mdo_allocator_malloc (alloc, filename_size);
+  memcpy (job->filename, filename, filename_size);
+
+  if (pthread_create (&job->thread, NULL, reload_main, job))
+    {
+      delete_reload (script, job);
+      return LOG_RESULT (wasm_error, "failed to start reload thread");
+    }
+
+  script->reload = job;
   return MDO_SUCCESS;
 }
 
+bool
+canary_script_reload_pending (canary_script_t *script)
+{
+  return script->reload != NULL;
+}
+
 void
 canary_script_delete (canary_script_t *script)
 {
-
   const mdo_allocator_t *alloc = script->alloc;
 
+  cancel_reload (script);
+
   if (script->panels.vals)
     mdo_allocator_free (alloc, script->panels.vals);
 
-  if (script->module)
-    wasmtime_module_delete (script->module);
+  if (script->input_queue.vals)
+    mdo_allocator_free (alloc, script->input_queue.vals);
 
-  if (script->linker)
-    wasmtime_linker_delete (script->linker);
+  if (script->timer)
+    canary_watchdog_timer_delete (script->timer);
+
+  canary_script_set_profiling (script, false);
 
   if (script->store)
     wasmtime_store_delete (script->store);
 
-  if (script->engine)
-    wasm_engine_delete (script->engine);
+  if (script->module)
+    canary_runtime_release_module (script->runtime, script->module);
+
+  if (script->counted)
+    canary_runtime_remove_script (script->runtime);
 
   mdo_allocator_free (alloc, script);
 }
@@ -281,75 +573,487 @@ canary_script_new_trap (canary_script_t *script, const char *message)
   return wasmtime_trap_new (message, strlen (message));
 }
 
-static int
-run_callback (canary_script_t *script, const char *symbol,
-              const wasmtime_val_t *args, size_t arg_num,
-              wasmtime_val_t *results, size_t result_num)
+/* arms the budget for a call from the host; callbacks run by that call
+ * share its budget */
+static bool
+begin_call (canary_script_t *script)
+{
+  if (script->in_call)
+    return false;
+
+  script->in_call = true;
+  script->call_status = CANARY_SCRIPT_OK;
+  script->interrupt_consumed = false;
+  script->call_armed = script->timer && script->budget > 0.0;
+
+  if (script->call_armed)
+    canary_watchdog_timer_arm (script->timer, script->budget);
+
+  return true;
+}
+
+/* a script stopped partway through a call may have left segments open,
+ * which would keep it from beginning them again */
+static void
+abandon_segments (canary_script_t *script)
+{
+  for (size_t i = 0; i < script->panels.size; i++)
+    {
+      panel_entry_t *entry = &script->panels.vals[i];
+
+      if (entry->panel)
+        canary_panel_abandon_segment (entry->panel);
+    }
+}
+
+static canary_script_status_t
+end_call (canary_script_t *script, bool outermost)
 {
-  size_t symbol_len = strlen (symbol);
+  if (!outermost)
+    return script->call_status;
 
-  wasmtime_extern_t exported;
+  script->in_call = false;
 
-  if (!wasmtime_instance_export_get (script->context, &script->instance,
-                                     symbol, symbol_len, &exported))
+  if (script->call_armed)
     {
+      bool fired = canary_watchdog_timer_disarm (script->timer);
 
-      LOG_ERR ("could not find callback '%s'", symbol);
-      return -1;
+      /* only a trap consumes the interrupt; the budget may also have run
+       * out while the script was returning, or in the host between
+       * callbacks */
+      if (fired && !script->interrupt_consumed)
+        script->interrupt_pending = true;
+
+      script->call_armed = false;
     }
 
-  if (exported.kind != WASMTIME_EXTERN_FUNC)
+  if (script->call_status != CANARY_SCRIPT_OK)
+    abandon_segments (script);
+
+  if (script->call_status == CANARY_SCRIPT_PREEMPTED)
     {
-      LOG_ERR ("export '%s' is not a function", symbol);
-      return -1;
+      script->overruns++;
+      script->consecutive_overruns++;
+    }
+  else
+    {
+      script->consecutive_overruns = 0;
     }
 
+  return script->call_status;
+}
+
+static bool
+budget_fired (canary_script_t *script)
+{
+  return script->call_armed && canary_watchdog_timer_fired (script->timer);
+}
+
+static canary_script_status_t
+run_callback (canary_script_t *script, script_callback_t callback,
+              const wasmtime_val_t *args, size_t arg_num,
+              wasmtime_val_t *results, size_t result_num)
+{
+  const callback_entry_t *entry = &script->callbacks[callback];
+
+  /* optional callbacks that aren't exported are skipped */
+  if (!entry->exported)
+    return CANARY_SCRIPT_OK;
+
+  /* the budget ran out on an earlier callback in this call */
+  if (budget_fired (script))
+    {
+      script->call_status = CANARY_SCRIPT_PREEMPTED;
+      return CANARY_SCRIPT_PREEMPTED;
+    }
+
+  bool interrupt_pending = script->interrupt_pending;
+  script->interrupt_pending = false;
+
+  uint64_t start = script->callback_stats ? canary_profile_now () : 0;
+
   wasm_trap_t *trap = NULL;
   wasmtime_error_t *error
-      = wasmtime_func_call (script->context, &exported.of.func, args, arg_num,
+      = wasmtime_func_call (script->context, &entry->func, args, arg_num,
                             results, result_num, &trap);
 
+  /* a leftover interrupt traps on entry, before any of the script has run,
+   * so it is safe to call again */
+  if (trap && interrupt_pending && !budget_fired (script)
+      && trap_is_interrupt (trap))
+    {
+      wasm_trap_delete (trap);
+      trap = NULL;
+      error = wasmtime_func_call (script->context, &entry->func, args,
+                                  arg_num, results, result_num, &trap);
+    }
+
+  if (script->callback_stats)
+    canary_profile_record (&script->callback_stats[callback],
+                           canary_profile_now () - start);
+
+  canary_script_status_t status = CANARY_SCRIPT_OK;
+
   if (error)
-    return log_wasmtime_error (script, error);
+    {
+      log_wasmtime_error (script, error);
+      status = CANARY_SCRIPT_TRAPPED;
+    }
+  else if (trap && budget_fired (script) && trap_is_interrupt (trap))
+    {
+      wasm_trap_delete (trap);
+      script->interrupt_consumed = true;
+      status = CANARY_SCRIPT_PREEMPTED;
+    }
+  else if (trap)
+    {
+      log_wasm_trap (script, trap);
+      status = CANARY_SCRIPT_TRAPPED;
+    }
 
-  if (trap)
-    return log_wasm_trap (script, trap);
+  if (status > script->call_status)
+    script->call_status = status;
 
-  return 0;
+  return status;
 }
 
-void
+/* the panels' draw lists hold whatever this frame drew */
+static void
+record_draw_stats (canary_script_t *script)
+{
+  for (size_t i = 0; i < script->panels.size; i++)
+    {
+      panel_entry_t *entry = &script->panels.vals[i];
+
+      if (!entry->panel)
+        continue;
+
+      canary_draw_list_t *draw_list
+          = canary_panel_get_draw_list (entry->panel);
+
+      if (draw_list)
+        canary_profile_record_draw (
+            &entry->draw_stats, canary_draw_list_vertex_count (draw_list),
+            canary_draw_list_index_count (draw_list));
+    }
+}
+
+/* gives every bound panel to the new instance, as if it was just bound */
+static void
+rebind_panels (canary_script_t *script)
+{
+  if (!script->callbacks[CALLBACK_BIND_PANEL].exported)
+    {
+      LOG_ERR ("could not find callback 'bind_panel'");
+      return;
+    }
+
+  bool outermost = begin_call (script);
+
+  for (size_t i = 0; i < script->panels.size; i++)
+    {
+      panel_entry_t *entry = &script->panels.vals[i];
+      if (!entry->panel)
+        continue;
+
+      /* hit regions and segments belong to the old instance */
+      entry->hovering = false;
+      canary_hit_grid_clear (canary_panel_get_hit_grid (entry->panel));
+      canary_panel_invalidate_segments (entry->panel);
+
+      canary_panel_key_t panel_key
+          = (entry->generation << PANEL_KEY_INDEX_BITS) | i;
+
+      wasmtime_val_t args[]
+          = { { .kind = WASM_I32, .of = { .i32 = panel_key } } };
+
+      wasmtime_val_t results[1];
+
+      if (run_callback (script, CALLBACK_BIND_PANEL, args, 1, results, 1)
+          != CANARY_SCRIPT_OK)
+        {
+          LOG_ERR ("couldn't run bind_panel callback after reload");
+          break;
+        }
+
+      entry->userdata = results[0].of.i32;
+    }
+
+  end_call (script, outermost);
+}
+
+/* swaps in a reloaded module once it has compiled; called between frames,
+ * so that the old instance serves every frame until then */
+static void
+finish_reload (canary_script_t *script)
+{
+  if (!__atomic_load_n (&script->reload->done, __ATOMIC_ACQUIRE))
+    return;
+
+  reload_job_t *job = join_reload (script);
+
+  if (job->error)
+    {
+      log_wasmtime_error (script, job->error);
+      job->error = NULL;
+      delete_reload (script, job);
+      return;
+    }
+
+  if (!job->module)
+    {
+      LOG_ERR ("failed to load reloaded UI script %s", job->filename);
+      delete_reload (script, job);
+      return;
+    }
+
+  /* a fresh store, since the old instance's memory can't be freed from the
+   * old one */
+  canary_watchdog_timer_t *timer;
+  wasmtime_store_t *store = create_store (script, &timer);
+  if (!store)
+    {
+      LOG_ERR ("failed to create store for reloaded UI script");
+      delete_reload (script, job);
+      return;
+    }
+
+  wasmtime_instance_t instance;
+  wasm_trap_t *trap = NULL;
+  wasmtime_error_t *error = wasmtime_linker_instantiate (
+      canary_runtime_get_linker (script->runtime),
+      wasmtime_store_context (store), job->module, &instance, &trap);
+
+  if (error || trap)
+    {
+      if (error)
+        log_wasmtime_error (script, error);
+      else
+        log_wasm_trap (script, trap);
+
+      if (timer)
+        canary_watchdog_timer_delete (timer);
+
+      wasmtime_store_delete (store);
+      delete_reload (script, job);
+      return;
+    }
+
+  if (script->timer)
+    canary_watchdog_timer_delete (script->timer);
+
+  wasmtime_store_delete (script->store);
+
+  if (script->module)
+    canary_runtime_release_module (script->runtime, script->module);
+
+  script->store = store;
+  script->context = wasmtime_store_context (store);
+  script->timer = timer;
+  script->interrupt_pending = false;
+
+  script->module = job->module;
+  script->instance = instance;
+  job->module = NULL;
+
+  resolve_callbacks (script);
+  rebind_panels (script);
+
+  delete_reload (script, job);
+}
+
+/* records a call from the host that takes no more than a panel key */
+static void
+record_call (canary_script_t *script, canary_recording_event_type_t type,
+             canary_panel_key_t panel_key)
+{
+  canary_recording_event_t event;
+  memset (&event, 0, sizeof (event));
+  event.type = type;
+  event.panel_key = panel_key;
+
+  canary_recorder_write (script->recorder, &event);
+}
+
+canary_script_status_t
 canary_script_update (canary_script_t *script, float dt)
 {
+  canary_trace_t *trace = canary_runtime_get_trace (script->runtime);
+
+  if (script->recorder)
+    {
+      canary_recording_event_t event;
+      memset (&event, 0, sizeof (event));
+      event.type = CANARY_RECORDING_UPDATE;
+      event.dt = dt;
+
+      canary_recorder_write (script->recorder, &event);
+    }
+
+  if (trace)
+    canary_trace_begin (trace, "canary_script_update");
+
+  if (script->reload)
+    finish_reload (script);
+
+  bool outermost = begin_call (script);
+
+  canary_script_flush_input (script);
+
   wasmtime_val_t dt_arg;
   dt_arg.kind = WASM_F32;
   dt_arg.of.f32 = dt;
 
-  run_callback (script, "update", &dt_arg, 1, NULL, 0);
+  run_callback (script, CALLBACK_UPDATE, &dt_arg, 1, NULL, 0);
+
+  if (script->callback_stats)
+    record_draw_stats (script);
+
+  canary_script_status_t status = end_call (script, outermost);
+
+  if (trace)
+    canary_trace_end (trace, "canary_script_update");
+
+  return status;
+}
+
+void
+canary_script_set_budget (canary_script_t *script, float seconds)
+{
+  if (seconds > 0.0 && !script->timer)
+    LOG_ERR ("the runtime doesn't enable budgets; budget is ignored");
+
+  script->budget = seconds;
+}
+
+size_t
+canary_script_get_overruns (canary_script_t *script)
+{
+  return script->overruns;
+}
+
+size_t
+canary_script_get_consecutive_overruns (canary_script_t *script)
+{
+  return script->consecutive_overruns;
+}
+
+static panel_entry_t *
+get_panel_entry (canary_script_t *script, canary_panel_key_t panel_key)
+{
+  uint32_t index = panel_key & PANEL_KEY_INDEX_MASK;
+  uint32_t generation = panel_key >> PANEL_KEY_INDEX_BITS;
+
+  if (index >= script->panels.size)
+    return NULL;
+
+  panel_entry_t *entry = &script->panels.vals[index];
+
+  if (!entry->panel || entry->generation != generation)
+    return NULL;
+
+  return entry;
+}
+
+/* takes a slot from the free list, or grows the table if there are none */
+static int
+alloc_panel_slot (canary_script_t *script, uint32_t *index)
+{
+  const mdo_allocator_t *alloc = script->alloc;
+
+  if (script->panels.free_head != PANEL_FREE_NONE)
+    {
+      *index = script->panels.free_head;
+      script->panels.free_head = script->panels.vals[*index].next_free;
+      return 0;
+    }
+
+  if (script->panels.size >= PANEL_SLOT_MAX)
+    return -1;
+
+  if (script->panels.size >= script->panels.capacity)
+    {
+      size_t capacity = script->panels.capacity << 1;
+      script->panels.vals = mdo_allocator_realloc (
+          alloc, script->panels.vals, sizeof (panel_entry_t) * capacity);
+      script->panels.capacity = capacity;
+    }
+
+  *index = script->panels.size++;
+  script->panels.vals[*index].generation = 1;
+  return 0;
+}
+
+static void
+free_panel_slot (canary_script_t *script, uint32_t index)
+{
+  panel_entry_t *entry = &script->panels.vals[index];
+
+  entry->panel = NULL;
+  entry->generation = (entry->generation + 1) & PANEL_GENERATION_MASK;
+  if (entry->generation == 0)
+    entry->generation = 1;
+
+  entry->next_free = script->panels.free_head;
+  script->panels.free_head = index;
 }
 
 int
 canary_script_bind_panel (canary_script_t *script, canary_panel_t *panel,
                           canary_panel_key_t *panel_key)
 {
-  /* TODO(marceline-cramer): bounds checking, reallocation */
-  *panel_key = script->panels.size++;
-  panel_entry_t *entry = &script->panels.vals[*panel_key];
+  uint32_t index;
+  if (alloc_panel_slot (script, &index))
+    {
+      LOG_ERR ("too many panels bound");
+      return -1;
+    }
 
+  panel_entry_t *entry = &script->panels.vals[index];
   entry->panel = panel;
+  entry->hovering = false;
+  memset (&entry->draw_stats, 0, sizeof (entry->draw_stats));
+  *panel_key = (entry->generation << PANEL_KEY_INDEX_BITS) | index;
 
   wasmtime_val_t args[]
       = { { .kind = WASM_I32, .of = { .i32 = *panel_key } } };
 
   wasmtime_val_t results[1];
 
-  if (run_callback (script, "bind_panel", args, 1, results, 1))
+  if (!script->callbacks[CALLBACK_BIND_PANEL].exported)
+    {
+      LOG_ERR ("could not find callback 'bind_panel'");
+      free_panel_slot (script, index);
+      return -1;
+    }
+
+  /* the panel as it was before the script saw it */
+  canary_recording_event_t event;
+  if (script->recorder)
+    {
+      memset (&event, 0, sizeof (event));
+      event.type = CANARY_RECORDING_BIND_PANEL;
+      event.panel_key = *panel_key;
+      canary_panel_get_color (panel, event.color);
+      canary_panel_get_size (panel, event.size);
+      event.pixel_scale = canary_panel_get_pixel_scale (panel);
+    }
+
+  bool outermost = begin_call (script);
+  run_callback (script, CALLBACK_BIND_PANEL, args, 1, results, 1);
+
+  if (end_call (script, outermost) != CANARY_SCRIPT_OK)
     {
       LOG_ERR ("couldn't run bind_panel callback");
+      free_panel_slot (script, index);
       return -1;
     }
 
   entry->userdata = results[0].of.i32;
+
+  if (script->recorder)
+    canary_recorder_write (script->recorder, &event);
+
   return 0;
 }
 
@@ -357,47 +1061,151 @@ void
 canary_script_unbind_panel (canary_script_t *script,
                             canary_panel_key_t panel_key)
 {
-  /* TODO(marceline-cramer): bounds checking, reallocation */
-  script->panels.vals[panel_key].panel = NULL;
+  if (!get_panel_entry (script, panel_key))
+    {
+      LOG_ERR ("unbinding a stale panel key");
+      return;
+    }
+
+  if (script->recorder)
+    record_call (script, CANARY_RECORDING_UNBIND_PANEL, panel_key);
+
+  free_panel_slot (script, panel_key & PANEL_KEY_INDEX_MASK);
 }
 
 canary_panel_t *
 canary_script_lookup_panel (canary_script_t *script,
                             canary_panel_key_t panel_key)
 {
-  /* TODO(marceline-cramer): bounds checking */
-  return script->panels.vals[panel_key].panel;
+  panel_entry_t *entry = get_panel_entry (script, panel_key);
+  return entry ? entry->panel : NULL;
 }
 
-void
-canary_script_on_input (canary_script_t *script, canary_panel_key_t panel_key,
-                        canary_input_event_t event, const float coords[2])
+static void
+run_region_callback (canary_script_t *script, script_callback_t callback,
+                     const panel_entry_t *entry, uint32_t region,
+                     const float coords[2])
 {
-  const char *callback_name;
+  wasmtime_val_t args[4];
+
+  args[0].kind = WASM_I32;
+  args[0].of.i32 = entry->userdata;
+
+  args[1].kind = WASM_I32;
+  args[1].of.i32 = region;
+
+  size_t arg_num = 2;
+  if (coords)
+    {
+      args[2].kind = WASM_F32;
+      args[2].of.f32 = coords[0];
+
+      args[3].kind = WASM_F32;
+      args[3].of.f32 = coords[1];
+
+      arg_num = 4;
+    }
+
+  run_callback (script, callback, args, arg_num, NULL, 0);
+}
+
+/* a panel with hit regions only hears about the pointer when it enters,
+ * leaves, or moves within a region; returns false if the panel has no
+ * regions and the event should go to on_hover as usual */
+static bool
+dispatch_hover (canary_script_t *script, panel_entry_t *entry,
+                const float coords[2])
+{
+  canary_hit_grid_t *grid = canary_panel_get_hit_grid (entry->panel);
+  bool has_regions = canary_hit_grid_get_region_num (grid) > 0;
+
+  /* still owe the script a leave if its regions were just removed */
+  if (!has_regions && !entry->hovering)
+    return false;
+
+  uint32_t region;
+  bool hit = canary_hit_grid_test (grid, coords, &region);
+
+  if (entry->hovering && (!hit || region != entry->hover_region))
+    {
+      entry->hovering = false;
+      run_region_callback (script, CALLBACK_ON_LEAVE, entry,
+                           entry->hover_region, NULL);
+    }
+
+  if (hit)
+    {
+      if (!entry->hovering)
+        {
+          entry->hovering = true;
+          entry->hover_region = region;
+          run_region_callback (script, CALLBACK_ON_ENTER, entry, region,
+                               NULL);
+        }
+
+      run_region_callback (script, CALLBACK_ON_REGION_HOVER, entry, region,
+                           coords);
+    }
+
+  return has_regions;
+}
+
+/* whether a hover event would reach the script at all, so that the common
+ * case of the pointer over empty panel area skips the call entirely */
+static bool
+hover_is_idle (canary_script_t *script, canary_panel_key_t panel_key,
+               const float coords[2])
+{
+  panel_entry_t *entry = get_panel_entry (script, panel_key);
+  if (!entry || entry->hovering)
+    return false;
+
+  canary_hit_grid_t *grid = canary_panel_get_hit_grid (entry->panel);
+  if (canary_hit_grid_get_region_num (grid) == 0)
+    return false;
+
+  uint32_t region;
+  return !canary_hit_grid_test (grid, coords, &region);
+}
+
+static void
+dispatch_input (canary_script_t *script, canary_panel_key_t panel_key,
+                canary_input_event_t event, const float coords[2])
+{
+  panel_entry_t *entry = get_panel_entry (script, panel_key);
+  if (!entry)
+    return;
+
+  script_callback_t callback;
   switch (event)
     {
     case CANARY_HOVER:
-      callback_name = "on_hover";
+      if (dispatch_hover (script, entry, coords))
+        return;
+
+      callback = CALLBACK_ON_HOVER;
       break;
     case CANARY_SELECT:
-      callback_name = "on_select";
+      callback = CALLBACK_ON_SELECT;
       break;
     case CANARY_DRAG:
-      callback_name = "on_drag";
+      callback = CALLBACK_ON_DRAG;
       break;
     case CANARY_DESELECT:
-      callback_name = "on_deselect";
+      callback = CALLBACK_ON_DESELECT;
       break;
     default:
-        LOG_ERR ("unrecognized input event type");
-        return;
+      LOG_ERR ("unrecognized input event type");
+      return;
     }
 
+  if (!script->callbacks[callback].exported)
+    return;
+
   wasmtime_val_t args[3];
 
-  /* TODO(marceline-cramer): bounds checking */
   args[0].kind = WASM_I32;
-  args[0].of.i32 = script->panels.vals[panel_key].userdata;
+  args[0].of.i32 = entry->userdata;
 
   args[1].kind = WASM_F32;
   args[1].of.f32 = coords[0];
@@ -405,5 +1213,258 @@ canary_script_on_input (canary_script_t *script, canary_panel_key_t panel_key,
   args[2].kind = WASM_F32;
   args[2].of.f32 = coords[1];
 
-  run_callback (script, callback_name, args, 3, NULL, 0);
+  run_callback (script, callback, args, 3, NULL, 0);
+}
+
+static void
+queue_input (canary_script_t *script, canary_panel_key_t panel_key,
+             canary_input_event_t event, const float coords[2])
+{
+  const mdo_allocator_t *alloc = script->alloc;
+
+  if (script->input_queue.size > 0)
+    {
+      input_entry_t *last
+          = &script->input_queue.vals[script->input_queue.size - 1];
+
+      /* only the latest position of a continuous motion matters */
+      if ((event == CANARY_HOVER || event == CANARY_DRAG)
+          && last->event == event && last->panel_key == panel_key)
+        {
+          memcpy (last->coords, coords, sizeof (float) * 2);
+          script->coalesced_input++;
+          return;
+        }
+    }
+
+  if (script->input_queue.size >= script->input_queue.capacity)
+    {
+      size_t capacity = script->input_queue.capacity << 1;
+
+      if (capacity == 0)
+        {
+          capacity = 32;
+          script->input_queue.vals
+              = mdo_allocator_calloc (alloc, capacity, sizeof (input_entry_t));
+        }
+      else
+        {
+          script->input_queue.vals
+              = mdo_allocator_realloc (alloc, script->input_queue.vals,
+                                       sizeof (input_entry_t) * capacity);
+        }
+
+      script->input_queue.capacity = capacity;
+    }
+
+  input_entry_t *entry = &script->input_queue.vals[script->input_queue.size++];
+  entry->panel_key = panel_key;
+  entry->event = event;
+  memcpy (entry->coords, coords, sizeof (float) * 2);
+}
+
+canary_script_status_t
+canary_script_on_input (canary_script_t *script, canary_panel_key_t panel_key,
+                        canary_input_event_t event, const float coords[2])
+{
+  if (script->recorder)
+    {
+      canary_recording_event_t recorded;
+      memset (&recorded, 0, sizeof (recorded));
+      recorded.type = CANARY_RECORDING_INPUT;
+      recorded.panel_key = panel_key;
+      recorded.input_event = event;
+      memcpy (recorded.coords, coords, sizeof (float) * 2);
+
+      canary_recorder_write (script->recorder, &recorded);
+    }
+
+  if (script->input_mode == CANARY_INPUT_QUEUED)
+    {
+      queue_input (script, panel_key, event, coords);
+      return CANARY_SCRIPT_OK;
+    }
+
+  if (event == CANARY_HOVER && hover_is_idle (script, panel_key, coords))
+    return CANARY_SCRIPT_OK;
+
+  canary_trace_t *trace = canary_runtime_get_trace (script->runtime);
+
+  if (trace)
+    canary_trace_begin (trace, "canary_script_on_input");
+
+  bool outermost = begin_call (script);
+  dispatch_input (script, panel_key, event, coords);
+  canary_script_status_t status = end_call (script, outermost);
+
+  if (trace)
+    canary_trace_end (trace, "canary_script_on_input");
+
+  return status;
+}
+
+void
+canary_script_set_input_mode (canary_script_t *script,
+                              canary_input_mode_t mode)
+{
+  if (script->recorder)
+    {
+      canary_recording_event_t event;
+      memset (&event, 0, sizeof (event));
+      event.type = CANARY_RECORDING_SET_INPUT_MODE;
+      event.input_mode = mode;
+
+      canary_recorder_write (script->recorder, &event);
+    }
+
+  if (mode != CANARY_INPUT_QUEUED)
+    canary_script_flush_input (script);
+
+  script->input_mode = mode;
+}
+
+canary_script_status_t
+canary_script_flush_input (canary_script_t *script)
+{
+  /* flushes from within update are replayed by the update itself */
+  if (script->recorder && !script->in_call)
+    record_call (script, CANARY_RECORDING_FLUSH_INPUT, 0);
+
+  if (script->input_queue.size == 0)
+    return CANARY_SCRIPT_OK;
+
+  canary_trace_t *trace = canary_runtime_get_trace (script->runtime);
+
+  if (trace)
+    canary_trace_begin (trace, "canary_script_flush_input");
+
+  bool outermost = begin_call (script);
+
+  for (size_t i = 0; i < script->input_queue.size; i++)
+    {
+      const input_entry_t *entry = &script->input_queue.vals[i];
+
+      /* the panel may have been unbound since the event was queued */
+      if (!canary_script_lookup_panel (script, entry->panel_key))
+        continue;
+
+      dispatch_input (script, entry->panel_key, entry->event, entry->coords);
+    }
+
+  script->input_queue.size = 0;
+
+  canary_script_status_t status = end_call (script, outermost);
+
+  if (trace)
+    canary_trace_end (trace, "canary_script_flush_input");
+
+  return status;
+}
+
+size_t
+canary_script_get_coalesced_input (canary_script_t *script)
+{
+  return script->coalesced_input;
+}
+
+void
+canary_script_set_profiling (canary_script_t *script, bool enabled)
+{
+  const mdo_allocator_t *alloc = script->alloc;
+
+  if (enabled == (script->callback_stats != NULL))
+    return;
+
+  if (!enabled)
+    {
+      mdo_allocator_free (alloc, script->callback_stats);
+      script->callback_stats = NULL;
+
+      if (script->import_stats)
+        mdo_allocator_free (alloc, script->import_stats);
+
+      script->import_stats = NULL;
+      script->import_stat_num = 0;
+      return;
+    }
+
+  script->callback_stats = mdo_allocator_calloc (
+      alloc, CALLBACK_NUM, sizeof (canary_profile_stats_t));
+
+  script->import_stat_num = canary_runtime_get_import_num (script->runtime);
+  if (script->import_stat_num > 0)
+    script->import_stats = mdo_allocator_calloc (
+        alloc, script->import_stat_num, sizeof (canary_profile_stats_t));
+
+  for (size_t i = 0; i < script->panels.size; i++)
+    memset (&script->panels.vals[i].draw_stats, 0,
+            sizeof (canary_profile_draw_stats_t));
+}
+
+canary_profile_stats_t *
+canary_script_get_import_profile (canary_script_t *script, size_t index)
+{
+  if (index >= script->import_stat_num)
+    return NULL;
+
+  return &script->import_stats[index];
+}
+
+bool
+canary_script_get_callback_stats (canary_script_t *script, const char *name,
+                                  canary_profile_stats_t *stats)
+{
+  if (!script->callback_stats)
+    return false;
+
+  for (int i = 0; i < CALLBACK_NUM; i++)
+    {
+      if (strcmp (CALLBACK_NAMES[i], name))
+        continue;
+
+      *stats = script->callback_stats[i];
+      return true;
+    }
+
+  return false;
+}
+
+bool
+canary_script_get_import_stats (canary_script_t *script, const char *name,
+                                canary_profile_stats_t *stats)
+{
+  for (size_t i = 0; i < script->import_stat_num; i++)
+    {
+      const char *import_name
+          = canary_runtime_get_import_name (script->runtime, i);
+
+      if (strcmp (import_name, name))
+        continue;
+
+      *stats = script->import_stats[i];
+      return true;
+    }
+
+  return false;
+}
+
+bool
+canary_script_get_draw_stats (canary_script_t *script,
+                              canary_panel_key_t panel_key,
+                              canary_profile_draw_stats_t *stats)
+{
+  panel_entry_t *entry = get_panel_entry (script, panel_key);
+
+  if (!script->callback_stats || !entry)
+    return false;
+
+  *stats = entry->draw_stats;
+  return true;
+}
+
+void
+canary_script_set_recorder (canary_script_t *script,
+                            canary_recorder_t *recorder)
+{
+  script->recorder = recorder;
 }
@@ -0,0 +1,138 @@
+/** @file sha256.c
+ */
+
+#include "sha256.h"
+
+#include <string.h> /* for memcpy, memset */
+
+static const uint32_t K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t
+rotr (uint32_t x, int n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+static void
+process_block (sha256_t *hash, const uint8_t *block)
+{
+  uint32_t w[64];
+
+  for (int i = 0; i < 16; i++)
+    w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16
+           | (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+
+  for (int i = 16; i < 64; i++)
+    {
+      uint32_t s0 = rotr (w[i - 15], 7) ^ rotr (w[i - 15], 18)
+                    ^ (w[i - 15] >> 3);
+      uint32_t s1 = rotr (w[i - 2], 17) ^ rotr (w[i - 2], 19)
+                    ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+  uint32_t s[8];
+  memcpy (s, hash->state, sizeof (s));
+
+  for (int i = 0; i < 64; i++)
+    {
+      uint32_t s1 = rotr (s[4], 6) ^ rotr (s[4], 11) ^ rotr (s[4], 25);
+      uint32_t ch = (s[4] & s[5]) ^ (~s[4] & s[6]);
+      uint32_t t1 = s[7] + s1 + ch + K[i] + w[i];
+      uint32_t s0 = rotr (s[0], 2) ^ rotr (s[0], 13) ^ rotr (s[0], 22);
+      uint32_t maj = (s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]);
+      uint32_t t2 = s0 + maj;
+
+      s[7] = s[6];
+      s[6] = s[5];
+      s[5] = s[4];
+      s[4] = s[3] + t1;
+      s[3] = s[2];
+      s[2] = s[1];
+      s[1] = s[0];
+      s[0] = t1 + t2;
+    }
+
+  for (int i = 0; i < 8; i++)
+    hash->state[i] += s[i];
+}
+
+void
+sha256_init (sha256_t *hash)
+{
+  static const uint32_t initial[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  };
+
+  memcpy (hash->state, initial, sizeof (initial));
+  hash->length = 0;
+  hash->block_size = 0;
+}
+
+void
+sha256_update (sha256_t *hash, const void *data, size_t size)
+{
+  const uint8_t *bytes = data;
+  hash->length += size;
+
+  while (size > 0)
+    {
+      size_t chunk = 64 - hash->block_size;
+      if (chunk > size)
+        chunk = size;
+
+      memcpy (&hash->block[hash->block_size], bytes, chunk);
+      hash->block_size += chunk;
+      bytes += chunk;
+      size -= chunk;
+
+      if (hash->block_size == 64)
+        {
+          process_block (hash, hash->block);
+          hash->block_size = 0;
+        }
+    }
+}
+
+void
+sha256_final (sha256_t *hash, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+  uint64_t bit_length = hash->length * 8;
+
+  hash->block[hash->block_size++] = 0x80;
+
+  if (hash->block_size > 56)
+    {
+      memset (&hash->block[hash->block_size], 0, 64 - hash->block_size);
+      process_block (hash, hash->block);
+      hash->block_size = 0;
+    }
+
+  memset (&hash->block[hash->block_size], 0, 56 - hash->block_size);
+
+  for (int i = 0; i < 8; i++)
+    hash->block[56 + i] = bit_length >> (56 - i * 8);
+
+  process_block (hash, hash->block);
+
+  for (int i = 0; i < 8; i++)
+    {
+      digest[i * 4] = hash->state[i] >> 24;
+      digest[i * 4 + 1] = hash->state[i] >> 16;
+      digest[i * 4 + 2] = hash->state[i] >> 8;
+      digest[i * 4 + 3] = hash->state[i];
+    }
+}
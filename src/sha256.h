@@ -0,0 +1,37 @@
+/** @file sha256.h
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint8_t, uint32_t, uint64_t */
+
+#define SHA256_DIGEST_SIZE 32
+
+/** @typedef sha256_t
+ */
+typedef struct sha256_s
+{
+  uint32_t state[8];
+  uint64_t length;
+  uint8_t block[64];
+  size_t block_size;
+} sha256_t;
+
+/** @function sha256_init
+ * @param hash
+ */
+void sha256_init (sha256_t *);
+
+/** @function sha256_update
+ * @param hash
+ * @param data
+ * @param size
+ */
+void sha256_update (sha256_t *, const void *, size_t);
+
+/** @function sha256_final
+ * @param hash
+ * @param digest
+ */
+void sha256_final (sha256_t *, uint8_t[SHA256_DIGEST_SIZE]);
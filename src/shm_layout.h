@@ -0,0 +1,69 @@
+/** @file shm_layout.h
+ * The layout of a shared memory draw list transport, shared by the writer
+ * and the reader. Both processes must be built with the same version.
+ */
+
+#pragma once
+
+#include <stdint.h> /* for uint32_t, uint64_t */
+
+#define SHM_MAGIC 0x59524e43 /* "CNRY" */
+#define SHM_VERSION 1
+
+/* every offset in the mapping is aligned to this, which covers any vertex
+ * or index type */
+#define SHM_ALIGN 16
+
+typedef struct shm_header_s
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_num;
+  uint32_t reserved;
+  uint64_t slot_size;
+
+  /* the generation of the latest finished frame, or zero before the first,
+   * stored with release semantics once its slot is complete */
+  uint64_t latest;
+} shm_header_t;
+
+/* a frame's slot begins with this and the buffers that its panel records
+ * point into, while the records themselves are stacked downwards from the
+ * end of the slot, so that neither needs a fixed limit */
+typedef struct shm_slot_s
+{
+  /* a seqlock: twice the generation of the frame in the slot once it is
+   * finished, and odd while the writer is filling the slot */
+  uint64_t sequence;
+
+  uint32_t panel_num;
+  uint32_t reserved;
+} shm_slot_t;
+
+typedef struct shm_panel_s
+{
+  uint32_t id;
+
+  /* a #canary_draw_format_t */
+  uint32_t format;
+
+  /* 2 or 4 bytes */
+  uint32_t index_size;
+  uint32_t reserved;
+
+  float color[4];
+  float size[2];
+
+  /* relative to the start of the slot */
+  uint64_t vertex_offset;
+  uint64_t vertex_num;
+  uint64_t index_offset;
+  uint64_t index_num;
+} shm_panel_t;
+
+#define SHM_ALIGN_UP(size)                                                   \
+  (((uint64_t)(size) + SHM_ALIGN - 1) & ~(uint64_t)(SHM_ALIGN - 1))
+
+/* slots follow the header back to back */
+#define SHM_SLOT_OFFSET(slot_size, slot)                                     \
+  (SHM_ALIGN_UP (sizeof (shm_header_t)) + (uint64_t)(slot) * (slot_size))
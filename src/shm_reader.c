@@ -0,0 +1,211 @@
+/** @file shm_reader.c
+ */
+
+#include "shm_reader.h"
+
+#include <string.h> /* for memcpy */
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shm_layout.h"
+
+struct canary_shm_reader_s
+{
+  const mdo_allocator_t *alloc;
+
+  const uint8_t *mapping;
+  size_t mapping_size;
+
+  uint64_t slot_size;
+  uint32_t slot_num;
+};
+
+static mdo_result_t
+shm_error (canary_shm_reader_t *reader, const char *message)
+{
+  if (reader->mapping)
+    munmap ((void *)reader->mapping, reader->mapping_size);
+
+  reader->mapping = NULL;
+
+  mdo_result_t result
+      = mdo_result_create (MDO_LOG_ERROR, "shm reader error: %s", 1, false);
+  return LOG_RESULT (result, message);
+}
+
+mdo_result_t
+canary_shm_reader_create (canary_shm_reader_t **reader,
+                          const mdo_allocator_t *alloc, int fd)
+{
+  canary_shm_reader_t *new_reader
+      = mdo_allocator_malloc (alloc, sizeof (canary_shm_reader_t));
+  *reader = new_reader;
+
+  new_reader->alloc = alloc;
+  new_reader->mapping = NULL;
+
+  struct stat st;
+  if (fstat (fd, &st))
+    return shm_error (new_reader, "failed to stat memfd");
+
+  if ((size_t)st.st_size < sizeof (shm_header_t))
+    return shm_error (new_reader, "memfd is too small");
+
+  new_reader->mapping_size = st.st_size;
+
+  void *mapping
+      = mmap (NULL, new_reader->mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED)
+    return shm_error (new_reader, "failed to map memfd");
+
+  new_reader->mapping = mapping;
+
+  const shm_header_t *header = mapping;
+  if (header->magic != SHM_MAGIC || header->version != SHM_VERSION)
+    return shm_error (new_reader, "not a draw list transport");
+
+  new_reader->slot_size = header->slot_size;
+  new_reader->slot_num = header->slot_num;
+
+  /* every slot must fit in the mapping, without overflowing on the way */
+  uint64_t slots_size = new_reader->mapping_size
+                        - SHM_ALIGN_UP (sizeof (shm_header_t));
+  if (new_reader->slot_num == 0
+      || new_reader->slot_size < SHM_ALIGN_UP (sizeof (shm_slot_t))
+      || new_reader->slot_size % SHM_ALIGN
+      || new_reader->slot_size > slots_size / new_reader->slot_num)
+    return shm_error (new_reader, "invalid slot layout");
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_shm_reader_delete (canary_shm_reader_t *reader)
+{
+  if (reader->mapping)
+    munmap ((void *)reader->mapping, reader->mapping_size);
+
+  mdo_allocator_free (reader->alloc, reader);
+}
+
+static const shm_slot_t *
+get_slot (canary_shm_reader_t *reader, uint32_t slot)
+{
+  return (const shm_slot_t *)(reader->mapping
+                              + SHM_SLOT_OFFSET (reader->slot_size, slot));
+}
+
+int
+canary_shm_reader_acquire (canary_shm_reader_t *reader,
+                           canary_shm_frame_t *frame)
+{
+  const shm_header_t *header = (const shm_header_t *)reader->mapping;
+
+  uint64_t generation = __atomic_load_n (&header->latest, __ATOMIC_ACQUIRE);
+  if (generation == 0)
+    return -1;
+
+  uint32_t slot_index = generation % reader->slot_num;
+  const shm_slot_t *slot = get_slot (reader, slot_index);
+
+  uint64_t sequence = __atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE);
+  if (sequence != generation * 2)
+    return -1;
+
+  frame->generation = generation;
+  frame->panel_num = slot->panel_num;
+  frame->slot = slot_index;
+  frame->sequence = sequence;
+
+  /* torn, if the records would run into the slot's header */
+  uint64_t record_space
+      = reader->slot_size - SHM_ALIGN_UP (sizeof (shm_slot_t));
+  if (frame->panel_num > record_space / sizeof (shm_panel_t))
+    return -1;
+
+  return 0;
+}
+
+/* whether a buffer of the given elements lies within the slot */
+static bool
+buffer_valid (canary_shm_reader_t *reader, uint64_t offset, uint64_t num,
+              uint64_t size)
+{
+  if (offset > reader->slot_size || offset % SHM_ALIGN)
+    return false;
+
+  return num <= (reader->slot_size - offset) / size;
+}
+
+int
+canary_shm_reader_get_panel (canary_shm_reader_t *reader,
+                             const canary_shm_frame_t *frame, size_t index,
+                             canary_shm_panel_t *panel)
+{
+  if (index >= frame->panel_num)
+    return -1;
+
+  const uint8_t *slot = (const uint8_t *)get_slot (reader, frame->slot);
+
+  /* the writer may overwrite the record at any time, so validate a copy,
+   * and keep the compiler from reading the mapping again in its place */
+  shm_panel_t record;
+  memcpy (&record,
+          slot + reader->slot_size - (index + 1) * sizeof (shm_panel_t),
+          sizeof (shm_panel_t));
+  __atomic_signal_fence (__ATOMIC_SEQ_CST);
+
+  size_t vertex_size;
+  switch (record.format)
+    {
+    case CANARY_DRAW_FORMAT_FLOAT:
+      vertex_size = sizeof (canary_draw_vertex_t);
+      break;
+    case CANARY_DRAW_FORMAT_COMPACT:
+      vertex_size = sizeof (canary_draw_compact_vertex_t);
+      break;
+    default:
+      return -1;
+    }
+
+  if (record.index_size != sizeof (canary_draw_index_t)
+      && record.index_size != sizeof (canary_draw_compact_index_t))
+    return -1;
+
+  if (!buffer_valid (reader, record.vertex_offset, record.vertex_num,
+                     vertex_size)
+      || !buffer_valid (reader, record.index_offset, record.index_num,
+                        record.index_size))
+    return -1;
+
+  panel->id = record.id;
+
+  for (int i = 0; i < 4; i++)
+    panel->color[i] = record.color[i];
+
+  for (int i = 0; i < 2; i++)
+    panel->size[i] = record.size[i];
+
+  panel->format = record.format;
+  panel->vertices = slot + record.vertex_offset;
+  panel->vertex_num = record.vertex_num;
+
+  panel->index_size = record.index_size;
+  panel->indices = slot + record.index_offset;
+  panel->index_num = record.index_num;
+
+  return 0;
+}
+
+bool
+canary_shm_reader_release (canary_shm_reader_t *reader,
+                           const canary_shm_frame_t *frame)
+{
+  const shm_slot_t *slot = get_slot (reader, frame->slot);
+
+  /* everything read from the frame must come before the recheck */
+  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+
+  return __atomic_load_n (&slot->sequence, __ATOMIC_RELAXED)
+         == frame->sequence;
+}
@@ -0,0 +1,230 @@
+/** @file shm_writer.c
+ */
+
+#define _GNU_SOURCE /* for memfd_create and file seals */
+
+#include "shm_writer.h"
+
+#include <fcntl.h>
+#include <string.h> /* for memcpy */
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "shm_layout.h"
+
+struct canary_shm_writer_s
+{
+  const mdo_allocator_t *alloc;
+
+  int fd;
+  uint8_t *mapping;
+  size_t mapping_size;
+
+  uint64_t slot_size;
+  uint32_t slot_num;
+
+  uint64_t generation;
+
+  /* the frame being written */
+  shm_slot_t *slot;
+  uint64_t used;
+  uint32_t panel_num;
+};
+
+static mdo_result_t
+shm_error (canary_shm_writer_t *writer, const char *message)
+{
+  if (writer->mapping)
+    munmap (writer->mapping, writer->mapping_size);
+
+  if (writer->fd >= 0)
+    close (writer->fd);
+
+  writer->mapping = NULL;
+  writer->fd = -1;
+
+  mdo_result_t result
+      = mdo_result_create (MDO_LOG_ERROR, "shm writer error: %s", 1, false);
+  return LOG_RESULT (result, message);
+}
+
+mdo_result_t
+canary_shm_writer_create (canary_shm_writer_t **writer,
+                          const mdo_allocator_t *alloc, size_t slot_size,
+                          uint32_t slot_num)
+{
+  canary_shm_writer_t *new_writer
+      = mdo_allocator_malloc (alloc, sizeof (canary_shm_writer_t));
+  *writer = new_writer;
+
+  new_writer->alloc = alloc;
+  new_writer->fd = -1;
+  new_writer->mapping = NULL;
+  new_writer->generation = 0;
+  new_writer->slot = NULL;
+
+  /* a reader can only finish a frame while the next one is written if
+   * there are at least two */
+  if (slot_num < 2)
+    slot_num = 2;
+
+  new_writer->slot_size = SHM_ALIGN_UP (slot_size);
+  new_writer->slot_num = slot_num;
+  new_writer->mapping_size = SHM_SLOT_OFFSET (new_writer->slot_size, slot_num);
+
+  new_writer->fd
+      = memfd_create ("canary-draw-lists", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (new_writer->fd < 0)
+    return shm_error (new_writer, "failed to create memfd");
+
+  if (ftruncate (new_writer->fd, new_writer->mapping_size))
+    return shm_error (new_writer, "failed to size memfd");
+
+  /* readers map the whole file, so it must never shrink under them */
+  if (fcntl (new_writer->fd, F_ADD_SEALS,
+             F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL))
+    return shm_error (new_writer, "failed to seal memfd");
+
+  new_writer->mapping
+      = mmap (NULL, new_writer->mapping_size, PROT_READ | PROT_WRITE,
+              MAP_SHARED, new_writer->fd, 0);
+  if (new_writer->mapping == MAP_FAILED)
+    {
+      new_writer->mapping = NULL;
+      return shm_error (new_writer, "failed to map memfd");
+    }
+
+  /* the file starts zeroed, so every slot's sequence is already zero */
+  shm_header_t *header = (shm_header_t *)new_writer->mapping;
+  header->magic = SHM_MAGIC;
+  header->version = SHM_VERSION;
+  header->slot_num = slot_num;
+  header->slot_size = new_writer->slot_size;
+  header->latest = 0;
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_shm_writer_delete (canary_shm_writer_t *writer)
+{
+  if (writer->mapping)
+    munmap (writer->mapping, writer->mapping_size);
+
+  if (writer->fd >= 0)
+    close (writer->fd);
+
+  mdo_allocator_free (writer->alloc, writer);
+}
+
+int
+canary_shm_writer_get_fd (canary_shm_writer_t *writer)
+{
+  return writer->fd;
+}
+
+void
+canary_shm_writer_begin_frame (canary_shm_writer_t *writer)
+{
+  uint64_t generation = ++writer->generation;
+  uint32_t slot = generation % writer->slot_num;
+
+  writer->slot = (shm_slot_t *)(writer->mapping
+                                + SHM_SLOT_OFFSET (writer->slot_size, slot));
+  writer->used = SHM_ALIGN_UP (sizeof (shm_slot_t));
+  writer->panel_num = 0;
+
+  __atomic_store_n (&writer->slot->sequence, generation * 2 - 1,
+                    __ATOMIC_RELAXED);
+
+  /* readers must not see the slot change before it is marked odd */
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+int
+canary_shm_writer_write_panel (canary_shm_writer_t *writer, uint32_t id,
+                               canary_panel_t *panel)
+{
+  canary_draw_list_t *draw_list = canary_panel_get_draw_list (panel);
+
+  canary_draw_format_t format = CANARY_DRAW_FORMAT_FLOAT;
+  const void *vertices = NULL;
+  size_t vertex_size = sizeof (canary_draw_vertex_t);
+  size_t vertex_num = 0;
+  const void *indices = NULL;
+  size_t index_size = sizeof (canary_draw_index_t);
+  size_t index_num = 0;
+
+  if (draw_list)
+    {
+      format = canary_draw_list_get_format (draw_list);
+      vertex_num = canary_draw_list_vertex_count (draw_list);
+      index_num = canary_draw_list_index_count (draw_list);
+
+      if (format == CANARY_DRAW_FORMAT_COMPACT)
+        {
+          vertices = canary_draw_list_compact_vertex_buffer (draw_list);
+          vertex_size = sizeof (canary_draw_compact_vertex_t);
+        }
+      else
+        {
+          vertices = canary_draw_list_vertex_buffer (draw_list);
+        }
+
+      indices = canary_draw_list_index_buffer (draw_list);
+      if (!indices)
+        {
+          indices = canary_draw_list_compact_index_buffer (draw_list);
+          index_size = sizeof (canary_draw_compact_index_t);
+        }
+    }
+
+  uint64_t vertex_bytes = SHM_ALIGN_UP (vertex_num * vertex_size);
+  uint64_t index_bytes = SHM_ALIGN_UP (index_num * index_size);
+
+  /* records are stacked downwards from the end of the slot */
+  uint64_t record_bytes = (writer->panel_num + 1) * sizeof (shm_panel_t);
+  if (record_bytes > writer->slot_size)
+    return -1;
+
+  uint64_t record_offset = writer->slot_size - record_bytes;
+  if (writer->used + vertex_bytes + index_bytes > record_offset)
+    return -1;
+
+  uint8_t *slot = (uint8_t *)writer->slot;
+  shm_panel_t *record = (shm_panel_t *)(slot + record_offset);
+
+  record->id = id;
+  record->format = format;
+  record->index_size = index_size;
+  record->reserved = 0;
+  canary_panel_get_color (panel, record->color);
+  canary_panel_get_size (panel, record->size);
+
+  record->vertex_offset = writer->used;
+  record->vertex_num = vertex_num;
+  if (vertex_num > 0)
+    memcpy (slot + writer->used, vertices, vertex_num * vertex_size);
+  writer->used += vertex_bytes;
+
+  record->index_offset = writer->used;
+  record->index_num = index_num;
+  if (index_num > 0)
+    memcpy (slot + writer->used, indices, index_num * index_size);
+  writer->used += index_bytes;
+
+  writer->panel_num++;
+  return 0;
+}
+
+void
+canary_shm_writer_end_frame (canary_shm_writer_t *writer)
+{
+  shm_header_t *header = (shm_header_t *)writer->mapping;
+
+  writer->slot->panel_num = writer->panel_num;
+
+  __atomic_store_n (&writer->slot->sequence, writer->generation * 2,
+                    __ATOMIC_RELEASE);
+  __atomic_store_n (&header->latest, writer->generation, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,319 @@
+/** @file tessellate.c
+ */
+
+#include "tessellate.h"
+
+#include <math.h>
+#include <string.h> /* for memcpy */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* how far a chord may stray from the true arc, in pixels */
+#define ARC_TOLERANCE 0.25f
+
+#define MIN_SEGMENTS 8
+
+/* joins sharper than this fall back to a clamped miter */
+#define MITER_LIMIT 4.0f
+
+/* enough room for a circle or four corners, rounded up for the SIMD tail */
+#define MAX_ARC_POINTS (CANARY_TESSELLATE_MAX_SEGMENTS + 8)
+
+uint32_t
+canary_tessellate_segments (float radius, float pixel_scale)
+{
+  float pixels = radius * pixel_scale;
+
+  if (!(pixels > ARC_TOLERANCE))
+    return MIN_SEGMENTS;
+
+  /* the chord of a step of theta strays r * (1 - cos (theta / 2)) */
+  float theta = 2.0f * acosf (1.0f - ARC_TOLERANCE / pixels);
+  float segments = ceilf (2.0f * M_PI / theta);
+
+  if (!(segments < CANARY_TESSELLATE_MAX_SEGMENTS))
+    return CANARY_TESSELLATE_MAX_SEGMENTS;
+
+  /* a multiple of 4 so that rounded corners split evenly */
+  uint32_t rounded = ((uint32_t)segments + 3) & ~3u;
+  return rounded < MIN_SEGMENTS ? MIN_SEGMENTS : rounded;
+}
+
+static uint32_t
+clamp_segments (uint32_t segments)
+{
+  if (segments < MIN_SEGMENTS)
+    return MIN_SEGMENTS;
+
+  if (segments > CANARY_TESSELLATE_MAX_SEGMENTS)
+    return CANARY_TESSELLATE_MAX_SEGMENTS;
+
+  return segments;
+}
+
+/* writes count points along an arc; xs and ys must have room for count
+ * rounded up to a multiple of 4 */
+static void
+generate_arc (float *xs, float *ys, const float center[2], float radius,
+              float start, float step, uint32_t count)
+{
+#if defined(__SSE2__)
+  /* rotate four points at a time by four steps */
+  float cos_init[4];
+  float sin_init[4];
+  for (int i = 0; i < 4; i++)
+    {
+      cos_init[i] = cosf (start + step * i);
+      sin_init[i] = sinf (start + step * i);
+    }
+
+  __m128 c = _mm_loadu_ps (cos_init);
+  __m128 s = _mm_loadu_ps (sin_init);
+  const __m128 rotate_cos = _mm_set1_ps (cosf (step * 4));
+  const __m128 rotate_sin = _mm_set1_ps (sinf (step * 4));
+  const __m128 center_x = _mm_set1_ps (center[0]);
+  const __m128 center_y = _mm_set1_ps (center[1]);
+  const __m128 r = _mm_set1_ps (radius);
+
+  for (uint32_t i = 0; i < count; i += 4)
+    {
+      _mm_storeu_ps (&xs[i], _mm_add_ps (center_x, _mm_mul_ps (r, c)));
+      _mm_storeu_ps (&ys[i], _mm_add_ps (center_y, _mm_mul_ps (r, s)));
+
+      __m128 next_c = _mm_sub_ps (_mm_mul_ps (c, rotate_cos),
+                                  _mm_mul_ps (s, rotate_sin));
+      s = _mm_add_ps (_mm_mul_ps (s, rotate_cos), _mm_mul_ps (c, rotate_sin));
+      c = next_c;
+    }
+#else
+  for (uint32_t i = 0; i < count; i++)
+    {
+      xs[i] = center[0] + radius * cosf (start + step * i);
+      ys[i] = center[1] + radius * sinf (start + step * i);
+    }
+#endif
+}
+
+/* appends a triangle fan around the first vertex */
+static void
+draw_fan (canary_draw_list_t *draw_list, const float center[2],
+          const float *xs, const float *ys, uint32_t rim_num,
+          const float color[4])
+{
+  canary_draw_vertex_t vertices[MAX_ARC_POINTS + 1];
+  canary_draw_index_t indices[MAX_ARC_POINTS * 3];
+
+  memcpy (vertices[0].position, center, sizeof (float) * 2);
+  memcpy (vertices[0].color, color, sizeof (float) * 4);
+
+  for (uint32_t i = 0; i < rim_num; i++)
+    {
+      vertices[i + 1].position[0] = xs[i];
+      vertices[i + 1].position[1] = ys[i];
+      memcpy (vertices[i + 1].color, color, sizeof (float) * 4);
+
+      indices[i * 3] = 0;
+      indices[i * 3 + 1] = i + 1;
+      indices[i * 3 + 2] = (i + 1) % rim_num + 1;
+    }
+
+  canary_draw_buffers (draw_list, vertices, rim_num + 1, indices,
+                       rim_num * 3);
+}
+
+void
+canary_draw_rect (canary_draw_list_t *draw_list, const float position[2],
+                  const float size[2], const float color[4])
+{
+  canary_draw_vertex_t vertices[4];
+
+  for (int i = 0; i < 4; i++)
+    {
+      vertices[i].position[0] = position[0] + (i & 1 ? size[0] : 0.0f);
+      vertices[i].position[1] = position[1] + (i & 2 ? size[1] : 0.0f);
+      memcpy (vertices[i].color, color, sizeof (float) * 4);
+    }
+
+  static const canary_draw_index_t INDICES[6] = { 0, 1, 2, 2, 1, 3 };
+  canary_draw_buffers (draw_list, vertices, 4, INDICES, 6);
+}
+
+void
+canary_draw_rounded_rect (canary_draw_list_t *draw_list,
+                          const float position[2], const float size[2],
+                          float radius, const float color[4],
+                          uint32_t segments)
+{
+  float max_radius = fminf (size[0], size[1]) * 0.5f;
+  if (radius > max_radius)
+    radius = max_radius;
+
+  if (!(radius > 0.0f))
+    {
+      canary_draw_rect (draw_list, position, size, color);
+      return;
+    }
+
+  uint32_t corner_segments = clamp_segments (segments) / 4;
+  uint32_t corner_points = corner_segments + 1;
+  float step = (M_PI * 0.5) / corner_segments;
+
+  float min_x = position[0] + radius;
+  float min_y = position[1] + radius;
+  float max_x = position[0] + size[0] - radius;
+  float max_y = position[1] + size[1] - radius;
+
+  /* counter-clockwise, starting from the bottom of the right edge */
+  const float corners[4][2] = {
+    { max_x, min_y },
+    { max_x, max_y },
+    { min_x, max_y },
+    { min_x, min_y },
+  };
+
+  float xs[MAX_ARC_POINTS];
+  float ys[MAX_ARC_POINTS];
+  uint32_t rim_num = 0;
+
+  for (int i = 0; i < 4; i++)
+    {
+      /* later corners overwrite the previous corner's SIMD tail */
+      generate_arc (&xs[rim_num], &ys[rim_num], corners[i], radius,
+                    M_PI * 0.5 * (i - 1), step, corner_points);
+      rim_num += corner_points;
+    }
+
+  const float center[2] = {
+    position[0] + size[0] * 0.5f,
+    position[1] + size[1] * 0.5f,
+  };
+
+  draw_fan (draw_list, center, xs, ys, rim_num, color);
+}
+
+void
+canary_draw_circle (canary_draw_list_t *draw_list, const float center[2],
+                    float radius, const float color[4], uint32_t segments)
+{
+  segments = clamp_segments (segments);
+
+  float xs[MAX_ARC_POINTS];
+  float ys[MAX_ARC_POINTS];
+  generate_arc (xs, ys, center, radius, 0.0f, 2.0 * M_PI / segments,
+                segments);
+
+  draw_fan (draw_list, center, xs, ys, segments, color);
+}
+
+/* returns the unit direction from a to b, or false if they coincide */
+static bool
+get_direction (const float *a, const float *b, float direction[2])
+{
+  float dx = b[0] - a[0];
+  float dy = b[1] - a[1];
+  float length = sqrtf (dx * dx + dy * dy);
+
+  if (!(length > 1e-6f))
+    return false;
+
+  direction[0] = dx / length;
+  direction[1] = dy / length;
+  return true;
+}
+
+static void
+get_join_offset (const float *points, size_t point_num, size_t i,
+                 bool closed, float half_width, float offset[2])
+{
+  size_t prev = i > 0 ? i - 1 : point_num - 1;
+  size_t next = i + 1 < point_num ? i + 1 : 0;
+
+  float in[2];
+  float out[2];
+  bool has_in = (i > 0 || closed)
+                && get_direction (&points[prev * 2], &points[i * 2], in);
+  bool has_out = (i + 1 < point_num || closed)
+                 && get_direction (&points[i * 2], &points[next * 2], out);
+
+  if (!has_in && !has_out)
+    {
+      in[0] = 1.0f;
+      in[1] = 0.0f;
+      has_in = true;
+    }
+
+  if (!has_in)
+    memcpy (in, out, sizeof (in));
+  else if (!has_out)
+    memcpy (out, in, sizeof (out));
+
+  /* normals are the directions turned a quarter counter-clockwise */
+  float miter[2] = { -in[1] - out[1], in[0] + out[0] };
+  float length = sqrtf (miter[0] * miter[0] + miter[1] * miter[1]);
+
+  /* the line doubles back on itself */
+  if (!(length > 1e-6f))
+    {
+      offset[0] = -in[1] * half_width;
+      offset[1] = in[0] * half_width;
+      return;
+    }
+
+  miter[0] /= length;
+  miter[1] /= length;
+
+  float scale = 1.0f / (miter[0] * -in[1] + miter[1] * in[0]);
+  if (scale > MITER_LIMIT)
+    scale = MITER_LIMIT;
+
+  offset[0] = miter[0] * half_width * scale;
+  offset[1] = miter[1] * half_width * scale;
+}
+
+void
+canary_draw_polyline (canary_draw_list_t *draw_list, const float *points,
+                      size_t point_num, float width, bool closed,
+                      const float color[4])
+{
+  if (point_num < 2)
+    return;
+
+  canary_draw_vertex_t vertex;
+  memcpy (vertex.color, color, sizeof (float) * 4);
+
+  canary_draw_index_t first = 0;
+
+  for (size_t i = 0; i < point_num; i++)
+    {
+      float offset[2];
+      get_join_offset (points, point_num, i, closed, width * 0.5f, offset);
+
+      vertex.position[0] = points[i * 2] + offset[0];
+      vertex.position[1] = points[i * 2 + 1] + offset[1];
+      canary_draw_index_t left = canary_draw_vertex (draw_list, &vertex);
+
+      vertex.position[0] = points[i * 2] - offset[0];
+      vertex.position[1] = points[i * 2 + 1] - offset[1];
+      canary_draw_vertex (draw_list, &vertex);
+
+      if (i == 0)
+        first = left;
+    }
+
+  size_t segment_num = closed ? point_num : point_num - 1;
+
+  for (size_t i = 0; i < segment_num; i++)
+    {
+      canary_draw_index_t a = first + i * 2;
+      canary_draw_index_t b = first + ((i + 1) % point_num) * 2;
+
+      canary_draw_triangle (draw_list, a, a + 1, b);
+      canary_draw_triangle (draw_list, b, a + 1, b + 1);
+    }
+}
@@ -0,0 +1,254 @@
+/** @file trace.c
+ */
+
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdint.h> /* for uint64_t */
+#include <stdio.h>
+
+#include "profile.h"
+
+#define PHASE_BEGIN 'B'
+#define PHASE_END 'E'
+
+/* fields are accessed atomically so that the writer can read a ring while
+ * its thread keeps recording */
+typedef struct trace_event_s
+{
+  const char *name;
+  uint64_t time;
+  char phase;
+} trace_event_t;
+
+/* a ring that only its own thread records into */
+typedef struct trace_thread_s
+{
+  uint32_t id;
+  trace_event_t *events;
+
+  /* the total number of events recorded, published after each event */
+  uint64_t head;
+
+  struct trace_thread_s *next;
+} trace_thread_t;
+
+struct canary_trace_s
+{
+  const mdo_allocator_t *alloc;
+  size_t capacity;
+  uint64_t start;
+
+  pthread_key_t key;
+
+  /* guards the list of threads, which only changes when a thread records
+   * for the first time */
+  pthread_mutex_t threads_lock;
+  trace_thread_t *threads;
+  uint32_t thread_num;
+};
+
+mdo_result_t
+canary_trace_create (canary_trace_t **trace, const mdo_allocator_t *alloc,
+                     size_t event_num)
+{
+  canary_trace_t *new_trace
+      = mdo_allocator_malloc (alloc, sizeof (canary_trace_t));
+  *trace = new_trace;
+
+  new_trace->alloc = alloc;
+  new_trace->start = canary_profile_now ();
+
+  /* a power of two, so that ring positions are a mask away */
+  size_t capacity = 16;
+  while (capacity < event_num)
+    capacity = capacity << 1;
+
+  new_trace->capacity = capacity;
+
+  pthread_key_create (&new_trace->key, NULL);
+  pthread_mutex_init (&new_trace->threads_lock, NULL);
+  new_trace->threads = NULL;
+  new_trace->thread_num = 0;
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_trace_delete (canary_trace_t *trace)
+{
+  const mdo_allocator_t *alloc = trace->alloc;
+
+  trace_thread_t *thread = trace->threads;
+  while (thread)
+    {
+      trace_thread_t *next = thread->next;
+      mdo_allocator_free (alloc, thread->events);
+      mdo_allocator_free (alloc, thread);
+      thread = next;
+    }
+
+  pthread_mutex_destroy (&trace->threads_lock);
+  pthread_key_delete (trace->key);
+
+  mdo_allocator_free (alloc, trace);
+}
+
+static trace_thread_t *
+get_thread (canary_trace_t *trace)
+{
+  trace_thread_t *thread = pthread_getspecific (trace->key);
+  if (thread)
+    return thread;
+
+  const mdo_allocator_t *alloc = trace->alloc;
+
+  thread = mdo_allocator_malloc (alloc, sizeof (trace_thread_t));
+  thread->events
+      = mdo_allocator_calloc (alloc, trace->capacity, sizeof (trace_event_t));
+  thread->head = 0;
+
+  pthread_mutex_lock (&trace->threads_lock);
+  thread->id = ++trace->thread_num;
+  thread->next = trace->threads;
+  trace->threads = thread;
+  pthread_mutex_unlock (&trace->threads_lock);
+
+  pthread_setspecific (trace->key, thread);
+
+  return thread;
+}
+
+static void
+record (canary_trace_t *trace, const char *name, char phase)
+{
+  trace_thread_t *thread = get_thread (trace);
+
+  uint64_t head = thread->head;
+  trace_event_t *event = &thread->events[head & (trace->capacity - 1)];
+
+  /* readers must not see this overwrite before the previous head */
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+
+  __atomic_store_n (&event->name, name, __ATOMIC_RELAXED);
+  __atomic_store_n (&event->time, canary_profile_now (), __ATOMIC_RELAXED);
+  __atomic_store_n (&event->phase, phase, __ATOMIC_RELAXED);
+
+  __atomic_store_n (&thread->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void
+canary_trace_begin (canary_trace_t *trace, const char *name)
+{
+  record (trace, name, PHASE_BEGIN);
+}
+
+void
+canary_trace_end (canary_trace_t *trace, const char *name)
+{
+  record (trace, name, PHASE_END);
+}
+
+/* the oldest event that a ring with this head can't have overwritten yet,
+ * including the one its thread may be writing right now */
+static uint64_t
+get_oldest (canary_trace_t *trace, uint64_t head)
+{
+  return head + 1 > trace->capacity ? head + 1 - trace->capacity : 0;
+}
+
+static void
+write_name (FILE *f, const char *name)
+{
+  fputc ('"', f);
+
+  for (const char *c = name; *c; c++)
+    {
+      if (*c == '"' || *c == '\\')
+        fputc ('\\', f);
+
+      if ((unsigned char)*c >= 0x20)
+        fputc (*c, f);
+    }
+
+  fputc ('"', f);
+}
+
+static size_t
+write_thread (canary_trace_t *trace, FILE *f, trace_thread_t *thread,
+              trace_event_t *copy, size_t written)
+{
+  uint64_t head = __atomic_load_n (&thread->head, __ATOMIC_ACQUIRE);
+  uint64_t first = get_oldest (trace, head);
+  size_t mask = trace->capacity - 1;
+
+  for (uint64_t i = first; i < head; i++)
+    {
+      const trace_event_t *event = &thread->events[i & mask];
+      trace_event_t *dst = &copy[i - first];
+
+      dst->name = __atomic_load_n (&event->name, __ATOMIC_RELAXED);
+      dst->time = __atomic_load_n (&event->time, __ATOMIC_RELAXED);
+      dst->phase = __atomic_load_n (&event->phase, __ATOMIC_RELAXED);
+    }
+
+  /* anything the thread wrapped around onto while copying is torn */
+  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+  uint64_t new_head = __atomic_load_n (&thread->head, __ATOMIC_RELAXED);
+  uint64_t valid = get_oldest (trace, new_head);
+
+  for (uint64_t i = valid > first ? valid : first; i < head; i++)
+    {
+      const trace_event_t *event = &copy[i - first];
+
+      /* chrome wants microseconds */
+      double ts = (event->time - trace->start) / 1000.0;
+
+      fputs (written++ ? ",\n" : "\n", f);
+      fputs ("{\"name\":", f);
+      write_name (f, event->name);
+      fprintf (f, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+               event->phase, ts, thread->id);
+    }
+
+  return written;
+}
+
+int
+canary_trace_write_json (canary_trace_t *trace, const char *filename)
+{
+  const mdo_allocator_t *alloc = trace->alloc;
+
+  FILE *f = fopen (filename, "w");
+  if (!f)
+    {
+      LOG_ERR ("failed to open %s", filename);
+      return -1;
+    }
+
+  trace_event_t *copy
+      = mdo_allocator_calloc (alloc, trace->capacity, sizeof (trace_event_t));
+
+  pthread_mutex_lock (&trace->threads_lock);
+  trace_thread_t *threads = trace->threads;
+  pthread_mutex_unlock (&trace->threads_lock);
+
+  fputs ("{\"traceEvents\":[", f);
+
+  /* threads are only ever pushed to the front, so this list is stable */
+  size_t written = 0;
+  for (trace_thread_t *thread = threads; thread; thread = thread->next)
+    written = write_thread (trace, f, thread, copy, written);
+
+  fputs ("\n]}\n", f);
+
+  mdo_allocator_free (alloc, copy);
+
+  if (fclose (f))
+    {
+      LOG_ERR ("failed to write %s", filename);
+      return -1;
+    }
+
+  return 0;
+}
@@ -0,0 +1,283 @@
+/** @file watchdog.c
+ */
+
+#include "watchdog.h"
+
+#include <pthread.h>
+#include <stdint.h> /* for uint64_t */
+#include <time.h>   /* for clock_gettime */
+
+#define NANOSECONDS 1000000000ull
+
+#define NO_DEADLINE UINT64_MAX
+
+struct canary_watchdog_timer_s
+{
+  canary_watchdog_t *watchdog;
+  wasmtime_interrupt_handle_t *handle;
+
+  /* set by the watchdog thread with release semantics once it has
+   * interrupted the store, so that the store's thread can check it without
+   * taking the lock; only cleared under the lock */
+  bool fired;
+
+  /* the rest is guarded by the watchdog's lock */
+  uint64_t deadline;
+  bool armed;
+
+  /* this timer's index in the watchdog's armed list */
+  size_t armed_index;
+};
+
+struct canary_watchdog_s
+{
+  const mdo_allocator_t *alloc;
+
+  pthread_t thread;
+  bool has_thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int shutdown;
+
+  /* when the thread will next wake up on its own, so that arming a later
+   * deadline doesn't need to wake it */
+  uint64_t next_wake;
+
+  /* TODO(marceline-cramer): use mdo-utils vector */
+  struct
+  {
+    canary_watchdog_timer_t **vals;
+    size_t size;
+    size_t capacity;
+  } armed;
+};
+
+static uint64_t
+get_time (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * NANOSECONDS + now.tv_nsec;
+}
+
+static void *
+watchdog_main (void *arg)
+{
+  canary_watchdog_t *watchdog = arg;
+
+  pthread_mutex_lock (&watchdog->lock);
+
+  while (!watchdog->shutdown)
+    {
+      uint64_t now = get_time ();
+      uint64_t next_wake = NO_DEADLINE;
+
+      for (size_t i = 0; i < watchdog->armed.size; i++)
+        {
+          canary_watchdog_timer_t *timer = watchdog->armed.vals[i];
+
+          if (__atomic_load_n (&timer->fired, __ATOMIC_RELAXED))
+            continue;
+
+          if (timer->deadline <= now)
+            {
+              wasmtime_interrupt_handle_interrupt (timer->handle);
+              __atomic_store_n (&timer->fired, true, __ATOMIC_RELEASE);
+            }
+          else if (timer->deadline < next_wake)
+            {
+              next_wake = timer->deadline;
+            }
+        }
+
+      watchdog->next_wake = next_wake;
+
+      if (next_wake == NO_DEADLINE)
+        {
+          pthread_cond_wait (&watchdog->cond, &watchdog->lock);
+        }
+      else
+        {
+          struct timespec until;
+          until.tv_sec = next_wake / NANOSECONDS;
+          until.tv_nsec = next_wake % NANOSECONDS;
+          pthread_cond_timedwait (&watchdog->cond, &watchdog->lock, &until);
+        }
+    }
+
+  pthread_mutex_unlock (&watchdog->lock);
+
+  return NULL;
+}
+
+mdo_result_t
+canary_watchdog_create (canary_watchdog_t **watchdog,
+                        const mdo_allocator_t *alloc)
+{
+  canary_watchdog_t *new_watchdog
+      = mdo_allocator_malloc (alloc, sizeof (canary_watchdog_t));
+  *watchdog = new_watchdog;
+
+  new_watchdog->alloc = alloc;
+  new_watchdog->has_thread = false;
+  new_watchdog->shutdown = 0;
+  new_watchdog->next_wake = NO_DEADLINE;
+
+  new_watchdog->armed.vals = NULL;
+  new_watchdog->armed.size = 0;
+  new_watchdog->armed.capacity = 0;
+
+  pthread_mutex_init (&new_watchdog->lock, NULL);
+
+  /* deadlines are monotonic, so waits must be too */
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init (&cond_attr);
+  pthread_condattr_setclock (&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init (&new_watchdog->cond, &cond_attr);
+  pthread_condattr_destroy (&cond_attr);
+
+  if (pthread_create (&new_watchdog->thread, NULL, watchdog_main,
+                      new_watchdog))
+    {
+      mdo_result_t thread_error
+          = mdo_result_create (MDO_LOG_ERROR, "watchdog error: %s", 1, false);
+      return LOG_RESULT (thread_error, "failed to create thread");
+    }
+
+  new_watchdog->has_thread = true;
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_watchdog_delete (canary_watchdog_t *watchdog)
+{
+  const mdo_allocator_t *alloc = watchdog->alloc;
+
+  pthread_mutex_lock (&watchdog->lock);
+  watchdog->shutdown = 1;
+  pthread_cond_signal (&watchdog->cond);
+  pthread_mutex_unlock (&watchdog->lock);
+
+  if (watchdog->has_thread)
+    pthread_join (watchdog->thread, NULL);
+
+  pthread_cond_destroy (&watchdog->cond);
+  pthread_mutex_destroy (&watchdog->lock);
+
+  if (watchdog->armed.vals)
+    mdo_allocator_free (alloc, watchdog->armed.vals);
+
+  mdo_allocator_free (alloc, watchdog);
+}
+
+mdo_result_t
+canary_watchdog_timer_create (canary_watchdog_timer_t **timer,
+                              canary_watchdog_t *watchdog,
+                              wasmtime_interrupt_handle_t *handle)
+{
+  canary_watchdog_timer_t *new_timer = mdo_allocator_malloc (
+      watchdog->alloc, sizeof (canary_watchdog_timer_t));
+  *timer = new_timer;
+
+  new_timer->watchdog = watchdog;
+  new_timer->handle = handle;
+  new_timer->deadline = NO_DEADLINE;
+  new_timer->armed = false;
+  new_timer->fired = false;
+  new_timer->armed_index = 0;
+
+  return MDO_SUCCESS;
+}
+
+void
+canary_watchdog_timer_delete (canary_watchdog_timer_t *timer)
+{
+  canary_watchdog_timer_disarm (timer);
+  wasmtime_interrupt_handle_delete (timer->handle);
+  mdo_allocator_free (timer->watchdog->alloc, timer);
+}
+
+void
+canary_watchdog_timer_arm (canary_watchdog_timer_t *timer, float seconds)
+{
+  canary_watchdog_t *watchdog = timer->watchdog;
+  const mdo_allocator_t *alloc = watchdog->alloc;
+
+  uint64_t deadline = get_time () + (uint64_t)(seconds * NANOSECONDS);
+
+  pthread_mutex_lock (&watchdog->lock);
+
+  if (!timer->armed)
+    {
+      if (watchdog->armed.size >= watchdog->armed.capacity)
+        {
+          size_t capacity = watchdog->armed.capacity << 1;
+
+          if (capacity == 0)
+            {
+              capacity = 16;
+              watchdog->armed.vals = mdo_allocator_calloc (
+                  alloc, capacity, sizeof (canary_watchdog_timer_t *));
+            }
+          else
+            {
+              watchdog->armed.vals = mdo_allocator_realloc (
+                  alloc, watchdog->armed.vals,
+                  sizeof (canary_watchdog_timer_t *) * capacity);
+            }
+
+          watchdog->armed.capacity = capacity;
+        }
+
+      timer->armed_index = watchdog->armed.size++;
+      watchdog->armed.vals[timer->armed_index] = timer;
+      timer->armed = true;
+    }
+
+  timer->deadline = deadline;
+  __atomic_store_n (&timer->fired, false, __ATOMIC_RELAXED);
+
+  /* only wake the thread if it would otherwise sleep past the deadline */
+  if (deadline < watchdog->next_wake)
+    {
+      watchdog->next_wake = deadline;
+      pthread_cond_signal (&watchdog->cond);
+    }
+
+  pthread_mutex_unlock (&watchdog->lock);
+}
+
+bool
+canary_watchdog_timer_disarm (canary_watchdog_timer_t *timer)
+{
+  canary_watchdog_t *watchdog = timer->watchdog;
+
+  pthread_mutex_lock (&watchdog->lock);
+
+  bool fired = __atomic_load_n (&timer->fired, __ATOMIC_RELAXED);
+
+  if (timer->armed)
+    {
+      /* swap the last armed timer into this one's place */
+      canary_watchdog_timer_t *last
+          = watchdog->armed.vals[--watchdog->armed.size];
+      watchdog->armed.vals[timer->armed_index] = last;
+      last->armed_index = timer->armed_index;
+
+      timer->armed = false;
+    }
+
+  __atomic_store_n (&timer->fired, false, __ATOMIC_RELAXED);
+
+  pthread_mutex_unlock (&watchdog->lock);
+
+  return fired;
+}
+
+bool
+canary_watchdog_timer_fired (canary_watchdog_timer_t *timer)
+{
+  /* disarming clears the flag, so it is only ever set while armed */
+  return __atomic_load_n (&timer->fired, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,521 @@
+/** @file canary_bench.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mdo-utils/result.h>
+#include <wasmtime.h>
+
+#include "draw_list.h"
+#include "panel.h"
+#include "runtime.h"
+#include "script.h"
+
+#define SAMPLE_NUM 64
+#define SAMPLE_TARGET_NS 2000000.0
+
+static size_t allocation_num = 0;
+
+#ifdef CANARY_BENCH_WRAP_ALLOCATIONS
+/* allocation counting, hooked in with the linker's --wrap option */
+
+void *__real_malloc (size_t);
+void *__real_calloc (size_t, size_t);
+void *__real_realloc (void *, size_t);
+int __real_posix_memalign (void **, size_t, size_t);
+
+void *
+__wrap_malloc (size_t size)
+{
+  allocation_num++;
+  return __real_malloc (size);
+}
+
+void *
+__wrap_calloc (size_t num, size_t size)
+{
+  allocation_num++;
+  return __real_calloc (num, size);
+}
+
+void *
+__wrap_realloc (void *ptr, size_t size)
+{
+  allocation_num++;
+  return __real_realloc (ptr, size);
+}
+
+int
+__wrap_posix_memalign (void **ptr, size_t alignment, size_t size)
+{
+  allocation_num++;
+  return __real_posix_memalign (ptr, alignment, size);
+}
+#endif
+
+typedef struct bench_context_s
+{
+  const mdo_allocator_t *alloc;
+  canary_runtime_t *runtime;
+  canary_draw_list_t *draw_list;
+  canary_panel_t *panel;
+  canary_script_t *script;
+  canary_panel_key_t panel_key;
+
+  /* the loaded script's module, for benchmarks that instantiate it again */
+  wasm_byte_vec_t wasm;
+
+  /* set by benchmarks whose operation failed, so that it isn't reported as
+   * a timing */
+  const char *error;
+} bench_context_t;
+
+typedef struct bench_s
+{
+  const char *name;
+
+  /* script to load, or NULL if the benchmark doesn't need one */
+  const char *script;
+
+  /* number of measured operations in one call to run */
+  size_t ops_per_iteration;
+
+  void (*run) (bench_context_t *, size_t);
+
+  /* runtime limits, or NULL for none */
+  const canary_runtime_config_t *config;
+} bench_t;
+
+static double
+now_ns ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+bench_draw_vertex (bench_context_t *ctx, size_t iterations)
+{
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+
+  for (size_t i = 0; i < iterations; i++)
+    {
+      if (canary_draw_list_vertex_count (ctx->draw_list) >= 4096)
+        canary_draw_list_clear (ctx->draw_list);
+
+      canary_draw_vertex (ctx->draw_list, &vertex);
+    }
+}
+
+static void
+bench_draw_triangle (bench_context_t *ctx, size_t iterations)
+{
+  for (size_t i = 0; i < iterations; i++)
+    {
+      if (canary_draw_list_index_count (ctx->draw_list) >= 4096 * 3)
+        canary_draw_list_clear (ctx->draw_list);
+
+      canary_draw_triangle (ctx->draw_list, 0, 1, 2);
+    }
+}
+
+static void
+bench_draw_list_clear (bench_context_t *ctx, size_t iterations)
+{
+  for (size_t i = 0; i < iterations; i++)
+    canary_draw_list_clear (ctx->draw_list);
+}
+
+static void
+bench_draw_list_weld (bench_context_t *ctx, size_t iterations)
+{
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+
+  for (size_t i = 0; i < iterations; i++)
+    {
+      canary_draw_list_clear (ctx->draw_list);
+
+      /* a strip of quads, drawn the way UiPanel_drawTriangle draws them */
+      for (int quad = 0; quad < 256; quad++)
+        for (int corner = 0; corner < 6; corner++)
+          {
+            static const int CORNERS[6] = { 0, 1, 2, 2, 1, 3 };
+            vertex.position[0] = quad + (CORNERS[corner] & 1);
+            vertex.position[1] = CORNERS[corner] >> 1;
+            canary_draw_vertex (ctx->draw_list, &vertex);
+
+            if (corner % 3 == 2)
+              {
+                canary_draw_index_t last = quad * 6 + corner;
+                canary_draw_triangle (ctx->draw_list, last - 2, last - 1,
+                                      last);
+              }
+          }
+
+      canary_draw_list_weld (ctx->draw_list, true, NULL);
+    }
+}
+
+static void
+bench_update (bench_context_t *ctx, size_t iterations)
+{
+  for (size_t i = 0; i < iterations; i++)
+    {
+      canary_draw_list_clear (ctx->draw_list);
+      canary_script_update (ctx->script, 0.011);
+    }
+}
+
+static void
+bench_on_input (bench_context_t *ctx, size_t iterations)
+{
+  float coords[2] = { 0.0, 0.0 };
+
+  for (size_t i = 0; i < iterations; i++)
+    canary_script_on_input (ctx->script, ctx->panel_key, CANARY_HOVER,
+                            coords);
+}
+
+static void
+bench_on_input_miss (bench_context_t *ctx, size_t iterations)
+{
+  /* a sparse panel, with the pointer moving over empty area */
+  canary_hit_grid_t *grid = canary_panel_get_hit_grid (ctx->panel);
+  if (canary_hit_grid_get_region_num (grid) == 0)
+    {
+      const float size[2] = { 0.1, 0.1 };
+      for (int i = 0; i < 16; i++)
+        {
+          const float position[2] = { i * 0.2f - 1.6f, -0.5f };
+          canary_hit_grid_add_rect (grid, i, position, size);
+        }
+    }
+
+  float coords[2] = { 0.0, 0.0 };
+
+  for (size_t i = 0; i < iterations; i++)
+    canary_script_on_input (ctx->script, ctx->panel_key, CANARY_HOVER,
+                            coords);
+}
+
+/* a script per user joining and leaving, sharing the compiled module */
+static void
+bench_instantiate (bench_context_t *ctx, size_t iterations)
+{
+  for (size_t i = 0; i < iterations; i++)
+    {
+      canary_script_t *script;
+      if (!mdo_result_success (
+              canary_script_create (&script, ctx->runtime)))
+        ctx->error = "failed to create script";
+      else if (!mdo_result_success (canary_script_load_buffer (
+                   script, (const uint8_t *)ctx->wasm.data, ctx->wasm.size)))
+        ctx->error = "failed to load script";
+
+      canary_script_delete (script);
+
+      if (ctx->error)
+        return;
+    }
+}
+
+/* 64 scripts of up to 1 MiB each */
+static const canary_runtime_config_t BOUNDED_CONFIG = { 64, 16 };
+
+static const bench_t BENCHMARKS[] = {
+  { "canary_draw_vertex", NULL, 1, bench_draw_vertex },
+  { "canary_draw_triangle", NULL, 1, bench_draw_triangle },
+  { "canary_draw_list_clear", NULL, 1, bench_draw_list_clear },
+  { "canary_draw_list_weld", NULL, 1, bench_draw_list_weld },
+  { "UiPanel_drawTriangle", "triangles.wat", 256, bench_update },
+  { "UiPanel_drawCircle", "circles.wat", 64, bench_update },
+  { "canary_script_update", "empty.wat", 1, bench_update },
+  { "canary_script_on_input", "empty.wat", 1, bench_on_input },
+  { "canary_script_on_input (hit regions)", "empty.wat", 1,
+    bench_on_input_miss },
+  { "canary_script_create", "empty.wat", 1, bench_instantiate },
+  { "canary_script_create (bounded memory)", "empty.wat", 1,
+    bench_instantiate, &BOUNDED_CONFIG },
+};
+
+static int
+read_wat (const char *name, wasm_byte_vec_t *wasm)
+{
+  char path[1024];
+  snprintf (path, sizeof (path), "%s/%s", CANARY_BENCH_SCRIPT_DIR, name);
+
+  FILE *f = fopen (path, "rb");
+  if (!f)
+    {
+      LOG_ERR ("failed to open %s", path);
+      return -1;
+    }
+
+  fseek (f, 0, SEEK_END);
+  size_t wat_size = ftell (f);
+  fseek (f, 0, SEEK_SET);
+  char *wat = malloc (wat_size);
+  size_t read_size = fread (wat, 1, wat_size, f);
+  fclose (f);
+
+  if (read_size != wat_size)
+    {
+      LOG_ERR ("failed to read %s", path);
+      free (wat);
+      return -1;
+    }
+
+  wasmtime_error_t *error = wasmtime_wat2wasm (wat, wat_size, wasm);
+  free (wat);
+
+  if (error)
+    {
+      wasm_byte_vec_t message;
+      wasmtime_error_message (error, &message);
+      LOG_ERR ("%s: %.*s", path, (int)message.size, message.data);
+      wasm_byte_vec_delete (&message);
+      wasmtime_error_delete (error);
+      return -1;
+    }
+
+  return 0;
+}
+
+static int
+setup_context (bench_context_t *ctx, const bench_t *bench)
+{
+  ctx->alloc = mdo_default_allocator ();
+  ctx->runtime = NULL;
+  ctx->script = NULL;
+  ctx->error = NULL;
+  wasm_byte_vec_new_empty (&ctx->wasm);
+
+  canary_draw_list_create (&ctx->draw_list, ctx->alloc);
+  canary_panel_create (&ctx->panel, ctx->alloc);
+  canary_panel_set_draw_list (ctx->panel, ctx->draw_list);
+
+  /* give the draw list room for benchmarks that only index */
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+  for (int i = 0; i < 3; i++)
+    canary_draw_vertex (ctx->draw_list, &vertex);
+
+  if (!bench->script)
+    return 0;
+
+  mdo_result_t result;
+  if (bench->config)
+    result = canary_runtime_create_with_config (&ctx->runtime, ctx->alloc,
+                                                bench->config);
+  else
+    result = canary_runtime_create (&ctx->runtime, ctx->alloc);
+
+  if (!mdo_result_success (result))
+    return -1;
+
+  if (!mdo_result_success (canary_script_create (&ctx->script, ctx->runtime)))
+    return -1;
+
+  if (read_wat (bench->script, &ctx->wasm))
+    return -1;
+
+  if (!mdo_result_success (canary_script_load_buffer (
+          ctx->script, (const uint8_t *)ctx->wasm.data, ctx->wasm.size)))
+    return -1;
+
+  if (canary_script_bind_panel (ctx->script, ctx->panel, &ctx->panel_key))
+    return -1;
+
+  return 0;
+}
+
+static void
+cleanup_context (bench_context_t *ctx)
+{
+  if (ctx->script)
+    canary_script_delete (ctx->script);
+
+  if (ctx->runtime)
+    canary_runtime_delete (ctx->runtime);
+
+  wasm_byte_vec_delete (&ctx->wasm);
+
+  canary_panel_delete (ctx->panel);
+  canary_draw_list_delete (ctx->draw_list);
+}
+
+static int
+compare_doubles (const void *a, const void *b)
+{
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+static double
+percentile (const double *sorted, size_t num, double p)
+{
+  size_t index = (size_t)(p * (num - 1) + 0.5);
+  return sorted[index];
+}
+
+/* reports a benchmark that couldn't be measured in place of its timings */
+static int
+write_failure (const bench_t *bench, FILE *out, int first, const char *error)
+{
+  LOG_ERR ("benchmark %s: %s", bench->name, error);
+
+  fprintf (out,
+           "%s    {\n"
+           "      \"name\": \"%s\",\n"
+           "      \"error\": \"%s\"\n"
+           "    }",
+           first ? "" : ",\n", bench->name, error);
+
+  return -1;
+}
+
+static int
+run_bench (const bench_t *bench, FILE *out, int first)
+{
+  bench_context_t ctx;
+  if (setup_context (&ctx, bench))
+    {
+      cleanup_context (&ctx);
+      return write_failure (bench, out, first, "failed to set up");
+    }
+
+  /* warm up, and find a batch size that takes about SAMPLE_TARGET_NS */
+  size_t iterations = 1;
+  for (;;)
+    {
+      double start = now_ns ();
+      bench->run (&ctx, iterations);
+      double elapsed = now_ns () - start;
+
+      if (ctx.error)
+        break;
+
+      if (elapsed > SAMPLE_TARGET_NS / 4 || iterations >= (1 << 30))
+        {
+          if (elapsed > 0)
+            iterations *= SAMPLE_TARGET_NS / elapsed;
+          if (iterations < 1)
+            iterations = 1;
+          break;
+        }
+
+      iterations *= 2;
+    }
+
+  double samples[SAMPLE_NUM];
+  double total_ns = 0.0;
+  size_t allocations = 0;
+
+  for (int i = 0; i < SAMPLE_NUM && !ctx.error; i++)
+    {
+      size_t start_allocations = allocation_num;
+      double start = now_ns ();
+      bench->run (&ctx, iterations);
+      double elapsed = now_ns () - start;
+      allocations += allocation_num - start_allocations;
+
+      total_ns += elapsed;
+      samples[i] = elapsed / (iterations * bench->ops_per_iteration);
+    }
+
+  cleanup_context (&ctx);
+
+  if (ctx.error)
+    return write_failure (bench, out, first, ctx.error);
+
+  qsort (samples, SAMPLE_NUM, sizeof (double), compare_doubles);
+
+  double ops = (double)SAMPLE_NUM * iterations * bench->ops_per_iteration;
+
+  fprintf (out,
+           "%s    {\n"
+           "      \"name\": \"%s\",\n"
+           "      \"ops\": %.0f,\n"
+           "      \"ns_per_op\": {\n"
+           "        \"mean\": %.3f,\n"
+           "        \"min\": %.3f,\n"
+           "        \"p50\": %.3f,\n"
+           "        \"p90\": %.3f,\n"
+           "        \"p99\": %.3f,\n"
+           "        \"max\": %.3f\n"
+           "      },\n"
+           "      \"allocs_per_op\": %.6f\n"
+           "    }",
+           first ? "" : ",\n", bench->name, ops, total_ns / ops, samples[0],
+           percentile (samples, SAMPLE_NUM, 0.5),
+           percentile (samples, SAMPLE_NUM, 0.9),
+           percentile (samples, SAMPLE_NUM, 0.99), samples[SAMPLE_NUM - 1],
+           allocations / ops);
+
+  return 0;
+}
+
+int
+main (int argc, const char *argv[])
+{
+  const char *filter = NULL;
+  const char *output = NULL;
+
+  for (int i = 1; i < argc; i++)
+    {
+      if (!strcmp (argv[i], "--filter") && i + 1 < argc)
+        filter = argv[++i];
+      else if (!strcmp (argv[i], "--output") && i + 1 < argc)
+        output = argv[++i];
+      else
+        {
+          fprintf (stderr, "Usage:\n  %s [--filter name] [--output file]\n",
+                   argv[0]);
+          return 1;
+        }
+    }
+
+  FILE *out = stdout;
+  if (output)
+    {
+      out = fopen (output, "w");
+      if (!out)
+        {
+          LOG_ERR ("failed to open %s", output);
+          return 1;
+        }
+    }
+
+  int error_code = 0;
+  int first = 1;
+
+  fprintf (out, "{\n  \"benchmarks\": [\n");
+
+  for (size_t i = 0; i < sizeof (BENCHMARKS) / sizeof (BENCHMARKS[0]); i++)
+    {
+      const bench_t *bench = &BENCHMARKS[i];
+
+      if (filter && !strstr (bench->name, filter))
+        continue;
+
+      /* failures are reported too, so every benchmark gets an entry */
+      if (run_bench (bench, out, first))
+        error_code = 1;
+
+      first = 0;
+    }
+
+  fprintf (out, "\n  ]\n}\n");
+
+  if (out != stdout)
+    fclose (out);
+
+  mdo_result_cleanup ();
+  return error_code;
+}
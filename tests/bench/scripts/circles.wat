@@ -0,0 +1,24 @@
+;; Draws 64 circles with UiPanel_drawCircle on every update, to measure host
+;; tessellation against drawing the same triangles from Wasm.
+(module
+  (import "" "UiPanel_drawCircle"
+    (func $draw_circle (param i32 f32 f32 f32 f32 f32 f32 f32)))
+
+  (memory (export "memory") 1 16)
+
+  (global $panel (mut i32) (i32.const 0))
+
+  (func (export "bind_panel") (param $panel i32) (result i32)
+    (global.set $panel (local.get $panel))
+    (local.get $panel))
+
+  (func (export "update") (param $dt f32)
+    (local $i i32)
+    (loop $draw
+      (call $draw_circle
+        (global.get $panel)
+        (f32.const 0.0) (f32.const 0.0) (f32.const 0.1)
+        (f32.const 1.0) (f32.const 1.0) (f32.const 1.0) (f32.const 1.0))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $draw (i32.lt_u (local.get $i) (i32.const 64)))))
+)
@@ -0,0 +1,20 @@
+;; Exports every callback canary dispatches to, each doing as little as
+;; possible, so that benchmarks measure host-side dispatch overhead.
+(module
+  (memory (export "memory") 1 16)
+
+  (func (export "bind_panel") (param $panel i32) (result i32)
+    (local.get $panel))
+
+  (func (export "update") (param $dt f32))
+
+  (func (export "on_hover") (param $self i32) (param $x f32) (param $y f32))
+  (func (export "on_select") (param $self i32) (param $x f32) (param $y f32))
+  (func (export "on_drag") (param $self i32) (param $x f32) (param $y f32))
+  (func (export "on_deselect") (param $self i32) (param $x f32) (param $y f32))
+
+  (func (export "on_enter") (param $self i32) (param $id i32))
+  (func (export "on_leave") (param $self i32) (param $id i32))
+  (func (export "on_region_hover")
+    (param $self i32) (param $id i32) (param $x f32) (param $y f32))
+)
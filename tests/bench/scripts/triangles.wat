@@ -0,0 +1,27 @@
+;; Draws 256 triangles with UiPanel_drawTriangle on every update, to measure
+;; the host call round trip.
+(module
+  (import "" "UiPanel_drawTriangle"
+    (func $draw_triangle
+      (param i32 f32 f32 f32 f32 f32 f32 f32 f32 f32 f32)))
+
+  (memory (export "memory") 1 16)
+
+  (global $panel (mut i32) (i32.const 0))
+
+  (func (export "bind_panel") (param $panel i32) (result i32)
+    (global.set $panel (local.get $panel))
+    (local.get $panel))
+
+  (func (export "update") (param $dt f32)
+    (local $i i32)
+    (loop $draw
+      (call $draw_triangle
+        (global.get $panel)
+        (f32.const -0.5) (f32.const -0.5)
+        (f32.const 0.5) (f32.const -0.5)
+        (f32.const 0.0) (f32.const 0.5)
+        (f32.const 1.0) (f32.const 1.0) (f32.const 1.0) (f32.const 1.0))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $draw (i32.lt_u (local.get $i) (i32.const 256)))))
+)
@@ -140,11 +140,55 @@ gles_renderer_render_frame (gles_renderer_t *ren)
   if (!draw_list)
     return;
 
-  size_t vertex_count = canary_draw_list_vertex_count (draw_list);
-  canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (draw_list);
+  gles_renderer_render_draw_list (ren, draw_list);
+}
 
+void
+gles_renderer_render_draw_list (gles_renderer_t *ren,
+                                canary_draw_list_t *draw_list)
+{
+  size_t vertex_count = canary_draw_list_vertex_count (draw_list);
   size_t index_count = canary_draw_list_index_count (draw_list);
-  canary_draw_index_t *indices = canary_draw_list_index_buffer (draw_list);
+
+  const void *vertices;
+  size_t vertex_size;
+  GLenum position_type;
+  GLenum color_type;
+  size_t position_offset;
+  size_t color_offset;
+
+  if (canary_draw_list_get_format (draw_list) == CANARY_DRAW_FORMAT_COMPACT)
+    {
+      vertices = canary_draw_list_compact_vertex_buffer (draw_list);
+      vertex_size = sizeof (canary_draw_compact_vertex_t);
+      position_type = GL_SHORT;
+      color_type = GL_UNSIGNED_BYTE;
+      position_offset = offsetof (canary_draw_compact_vertex_t, position);
+      color_offset = offsetof (canary_draw_compact_vertex_t, color);
+    }
+  else
+    {
+      vertices = canary_draw_list_vertex_buffer (draw_list);
+      vertex_size = sizeof (canary_draw_vertex_t);
+      position_type = GL_FLOAT;
+      color_type = GL_FLOAT;
+      position_offset = offsetof (canary_draw_vertex_t, position);
+      color_offset = offsetof (canary_draw_vertex_t, color);
+    }
+
+  const void *indices;
+  GLenum index_type;
+
+  if (canary_draw_list_compact_index_buffer (draw_list))
+    {
+      indices = canary_draw_list_compact_index_buffer (draw_list);
+      index_type = GL_UNSIGNED_SHORT;
+    }
+  else
+    {
+      indices = canary_draw_list_index_buffer (draw_list);
+      index_type = GL_UNSIGNED_INT;
+    }
 
   glEnable (GL_BLEND);
   glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -152,22 +196,21 @@ gles_renderer_render_frame (gles_renderer_t *ren)
   glUseProgram (ren->program);
 
   glBindBuffer (GL_ARRAY_BUFFER, ren->vbo);
-  glBufferData (GL_ARRAY_BUFFER, vertex_count * sizeof (canary_draw_vertex_t),
-                vertices, GL_STATIC_DRAW);
+  glBufferData (GL_ARRAY_BUFFER, vertex_count * vertex_size, vertices,
+                GL_STATIC_DRAW);
 
+  /* normalized, so compact vertices need no shader changes */
   glEnableVertexAttribArray (0);
-  glVertexAttribPointer (0, 2, GL_FLOAT, GL_FALSE,
-                         sizeof (canary_draw_vertex_t),
-                         (void *)offsetof (canary_draw_vertex_t, position));
+  glVertexAttribPointer (0, 2, position_type, GL_TRUE, vertex_size,
+                         (void *)position_offset);
 
   glEnableVertexAttribArray (1);
-  glVertexAttribPointer (1, 4, GL_FLOAT, GL_FALSE,
-                         sizeof (canary_draw_vertex_t),
-                         (void *)offsetof (canary_draw_vertex_t, color));
+  glVertexAttribPointer (1, 4, color_type, GL_TRUE, vertex_size,
+                         (void *)color_offset);
 
   if (validate_program (ren->program))
     {
-      glDrawElements (GL_TRIANGLES, index_count, GL_UNSIGNED_INT, indices);
+      glDrawElements (GL_TRIANGLES, index_count, index_type, indices);
     }
 
   glDisableVertexAttribArray (0);
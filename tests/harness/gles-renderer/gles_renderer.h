@@ -24,3 +24,9 @@ void gles_renderer_delete (gles_renderer_t *);
  * @param ren
  */
 void gles_renderer_render_frame (gles_renderer_t *);
+
+/** @function gles_renderer_render_draw_list
+ * @param ren
+ * @param ui_draw
+ */
+void gles_renderer_render_draw_list (gles_renderer_t *, canary_draw_list_t *);
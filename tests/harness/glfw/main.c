@@ -1,20 +1,26 @@
 #include <stdio.h>
+#include <stdlib.h> /* for getenv */
 
 #define GLFW_INCLUDE_ES2
 #include "GLFW/glfw3.h"
 
 #include <mdo-utils/result.h>
 
+#include "capture.h"
 #include "draw_list.h"
+#include "draw_list_set.h"
 #include "gles_renderer.h"
 #include "panel.h"
+#include "runtime.h"
 #include "script.h"
+#include "trace.h"
 
 typedef struct window_userdata_s
 {
   canary_script_t *script;
   canary_panel_t *panel;
   canary_panel_key_t panel_key;
+  const char *filename;
 } window_userdata_t;
 
 static int
@@ -73,6 +79,17 @@ mouse_button_callback (GLFWwindow *window, int button, int action, int mods)
   send_input_event (window, event);
 }
 
+/* R reloads the script without restarting the harness */
+static void
+key_callback (GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+  if (key != GLFW_KEY_R || action != GLFW_PRESS)
+    return;
+
+  window_userdata_t *userdata = glfwGetWindowUserPointer (window);
+  canary_script_reload (userdata->script, userdata->filename);
+}
+
 int
 run_harness (const char *filename)
 {
@@ -82,10 +99,25 @@ run_harness (const char *filename)
   mdo_result_t result = MDO_SUCCESS;
 
   GLFWwindow *window = NULL;
+  canary_runtime_t *runtime = NULL;
   canary_script_t *script = NULL;
   canary_panel_t *panel = NULL;
   gles_renderer_t *ren = NULL;
-  canary_draw_list_t *draw_list = NULL;
+  canary_draw_list_set_t *draw_lists = NULL;
+  canary_trace_t *trace = NULL;
+  canary_capture_t *capture = NULL;
+  canary_recorder_t *recorder = NULL;
+
+  /* set CANARY_TRACE to a filename to record a Chrome trace of the run */
+  const char *trace_filename = getenv ("CANARY_TRACE");
+
+  /* set CANARY_CAPTURE to a filename to record every frame's draw list for
+   * canary-replay, and CANARY_CAPTURE_COMPRESS to compress it */
+  const char *capture_filename = getenv ("CANARY_CAPTURE");
+
+  /* set CANARY_RECORD to a filename to record the script's dt and input for
+   * canary-trace-runner */
+  const char *record_filename = getenv ("CANARY_RECORD");
 
   window_userdata_t userdata;
 
@@ -108,7 +140,44 @@ run_harness (const char *filename)
   printf ("GL_VERSION  : %s\n", glGetString (GL_VERSION));
   printf ("GL_RENDERER : %s\n", glGetString (GL_RENDERER));
 
-  result = canary_script_create (&script, alloc);
+  result = canary_runtime_create (&runtime, alloc);
+  if (!mdo_result_success (result))
+    {
+      LOG_ERR ("failed to create UI runtime");
+      error_code = 1;
+      goto error;
+    }
+
+  if (trace_filename)
+    {
+      result = canary_trace_create (&trace, alloc, 1 << 16);
+      if (!mdo_result_success (result))
+        {
+          LOG_ERR ("failed to create trace");
+          error_code = 1;
+          goto error;
+        }
+
+      canary_runtime_set_trace (runtime, trace);
+    }
+
+  if (capture_filename)
+    {
+      uint32_t flags = 0;
+      if (getenv ("CANARY_CAPTURE_COMPRESS"))
+        flags |= CANARY_CAPTURE_COMPRESS;
+
+      result = canary_capture_create (&capture, alloc, capture_filename,
+                                      flags);
+      if (!mdo_result_success (result))
+        {
+          LOG_ERR ("failed to create capture");
+          error_code = 1;
+          goto error;
+        }
+    }
+
+  result = canary_script_create (&script, runtime);
   if (!mdo_result_success (result))
     {
       LOG_ERR ("failed to create UI script");
@@ -124,6 +193,19 @@ run_harness (const char *filename)
       goto error;
     }
 
+  if (record_filename)
+    {
+      result = canary_recorder_create (&recorder, alloc, record_filename);
+      if (!mdo_result_success (result))
+        {
+          LOG_ERR ("failed to create recorder");
+          error_code = 1;
+          goto error;
+        }
+
+      canary_script_set_recorder (script, recorder);
+    }
+
   result = canary_panel_create (&panel, alloc);
   if (!mdo_result_success (result))
     {
@@ -132,16 +214,19 @@ run_harness (const char *filename)
       goto error;
     }
 
-  result = canary_draw_list_create (&draw_list, alloc);
+  /* panel space spans the window, which is 800 pixels across */
+  canary_panel_set_pixel_scale (panel, 400.0);
+
+  /* the script fills the back list while the front one is rendered */
+  result = canary_draw_list_set_create (&draw_lists, alloc, panel, 2,
+                                        CANARY_DRAW_FORMAT_FLOAT);
   if (!mdo_result_success (result))
     {
-      LOG_ERR ("failed to create UI draw list");
+      LOG_ERR ("failed to create UI draw lists");
       error_code = 1;
       goto error;
     }
 
-  canary_panel_set_draw_list (panel, draw_list);
-
   canary_panel_key_t panel_key;
   if (canary_script_bind_panel (script, panel, &panel_key))
     {
@@ -157,13 +242,18 @@ run_harness (const char *filename)
       goto error;
     }
 
+  /* cursor events arrive much faster than frames; coalesce them */
+  canary_script_set_input_mode (script, CANARY_INPUT_QUEUED);
+
   userdata.script = script;
   userdata.panel = panel;
   userdata.panel_key = panel_key;
+  userdata.filename = filename;
 
   glfwSetWindowUserPointer (window, &userdata);
   glfwSetCursorPosCallback (window, cursor_position_callback);
   glfwSetMouseButtonCallback (window, mouse_button_callback);
+  glfwSetKeyCallback (window, key_callback);
 
   double last_tick = glfwGetTime ();
 
@@ -175,20 +265,35 @@ run_harness (const char *filename)
       float dt = this_tick - last_tick;
       last_tick = this_tick;
 
-      canary_draw_list_clear (draw_list);
       canary_script_update (script, dt);
 
+      if (capture)
+        {
+          canary_capture_begin_frame (capture);
+          canary_capture_write_panel (capture, 0, panel);
+          canary_capture_end_frame (capture);
+        }
+
+      canary_draw_list_set_swap (draw_lists);
+
+      if (trace)
+        canary_trace_begin (trace, "render");
+
       glClear (GL_COLOR_BUFFER_BIT);
-      gles_renderer_render_frame (ren);
+      gles_renderer_render_draw_list (
+          ren, canary_draw_list_set_get_front (draw_lists));
       glfwSwapBuffers (window);
+
+      if (trace)
+        canary_trace_end (trace, "render");
     }
 
 error:
   if (ren)
     gles_renderer_delete (ren);
 
-  if (draw_list)
-    canary_draw_list_delete (draw_list);
+  if (draw_lists)
+    canary_draw_list_set_delete (draw_lists);
 
   if (panel)
     {
@@ -199,6 +304,21 @@ error:
   if (script)
     canary_script_delete (script);
 
+  if (recorder)
+    canary_recorder_delete (recorder);
+
+  if (runtime)
+    canary_runtime_delete (runtime);
+
+  if (capture)
+    canary_capture_delete (capture);
+
+  if (trace)
+    {
+      canary_trace_write_json (trace, trace_filename);
+      canary_trace_delete (trace);
+    }
+
   glfwTerminate ();
   return 0;
 }
@@ -0,0 +1,634 @@
+/** @file soft_renderer.c
+ */
+
+#include "soft_renderer.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define TILE_SIZE 32
+#define TILE_PIXELS (TILE_SIZE * TILE_SIZE)
+
+typedef struct triangle_s
+{
+  /* edge function i is opposite vertex i: w = a * x + b * y + c */
+  float a[3];
+  float b[3];
+  float c[3];
+  int top_left[3];
+
+  /* relative to vertex 0 so that flat colors interpolate exactly */
+  float inv_area;
+  float color[4];
+  float color_delta[2][4];
+
+  /* inclusive pixel bounds */
+  int min_x;
+  int min_y;
+  int max_x;
+  int max_y;
+} triangle_t;
+
+/* planar so that four horizontal pixels load into one register */
+typedef struct tile_buffer_s
+{
+  float planes[4][TILE_PIXELS];
+} tile_buffer_t;
+
+typedef struct worker_s
+{
+  soft_renderer_t *ren;
+  tile_buffer_t *tile;
+  pthread_t thread;
+} worker_t;
+
+struct soft_renderer_s
+{
+  canary_panel_t *panel;
+
+  uint32_t width;
+  uint32_t height;
+  uint32_t tiles_x;
+  uint32_t tiles_y;
+  uint8_t *framebuffer;
+
+  struct
+  {
+    triangle_t *vals;
+    size_t size;
+    size_t capacity;
+  } triangles;
+
+  /* compact lists are unpacked here before setup */
+  struct
+  {
+    canary_draw_vertex_t *vals;
+    size_t capacity;
+  } unpacked;
+
+  /* triangle indices binned per tile, in submission order */
+  uint32_t *bin_offsets;
+  uint32_t *bin_cursors;
+
+  struct
+  {
+    uint32_t *vals;
+    size_t capacity;
+  } bins;
+
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+  uint32_t generation;
+  uint32_t next_tile;
+  uint32_t busy_workers;
+  int shutdown;
+
+  tile_buffer_t main_tile;
+  uint32_t worker_num;
+  worker_t *workers;
+};
+
+static void
+setup_edge (triangle_t *tri, int edge, const float from[2],
+            const float to[2])
+{
+  tri->a[edge] = from[1] - to[1];
+  tri->b[edge] = to[0] - from[0];
+  tri->c[edge] = from[0] * to[1] - from[1] * to[0];
+}
+
+static int
+setup_triangle (soft_renderer_t *ren, triangle_t *tri,
+                const canary_draw_vertex_t *vertices[3])
+{
+  float screen[3][2];
+
+  /* the GLES renderer passes positions straight through as clip space */
+  for (int i = 0; i < 3; i++)
+    {
+      screen[i][0] = (vertices[i]->position[0] * 0.5f + 0.5f) * ren->width;
+      screen[i][1] = (0.5f - vertices[i]->position[1] * 0.5f) * ren->height;
+    }
+
+  setup_edge (tri, 0, screen[1], screen[2]);
+  setup_edge (tri, 1, screen[2], screen[0]);
+  setup_edge (tri, 2, screen[0], screen[1]);
+
+  float area = tri->a[0] * screen[0][0] + tri->b[0] * screen[0][1]
+               + tri->c[0];
+
+  if (area == 0.0f || !isfinite (area))
+    return -1;
+
+  /* nothing is culled, so flip back-facing triangles around */
+  if (area < 0.0f)
+    {
+      area = -area;
+
+      for (int i = 0; i < 3; i++)
+        {
+          tri->a[i] = -tri->a[i];
+          tri->b[i] = -tri->b[i];
+          tri->c[i] = -tri->c[i];
+        }
+    }
+
+  /* y points down, so left edges face +x and top edges face +y */
+  for (int i = 0; i < 3; i++)
+    tri->top_left[i]
+        = tri->a[i] > 0.0f || (tri->a[i] == 0.0f && tri->b[i] > 0.0f);
+
+  tri->inv_area = 1.0f / area;
+
+  for (int c = 0; c < 4; c++)
+    {
+      float base = vertices[0]->color[c];
+      tri->color[c] = base;
+      tri->color_delta[0][c] = vertices[1]->color[c] - base;
+      tri->color_delta[1][c] = vertices[2]->color[c] - base;
+    }
+
+  float min_x = fminf (screen[0][0], fminf (screen[1][0], screen[2][0]));
+  float min_y = fminf (screen[0][1], fminf (screen[1][1], screen[2][1]));
+  float max_x = fmaxf (screen[0][0], fmaxf (screen[1][0], screen[2][0]));
+  float max_y = fmaxf (screen[0][1], fmaxf (screen[1][1], screen[2][1]));
+
+  /* pixel centers are at +0.5; clamp before converting to int */
+  float width = ren->width;
+  float height = ren->height;
+  tri->min_x = fminf (fmaxf (floorf (min_x - 0.5f), 0.0f), width);
+  tri->min_y = fminf (fmaxf (floorf (min_y - 0.5f), 0.0f), height);
+  tri->max_x = fmaxf (fminf (ceilf (max_x - 0.5f), width - 1.0f), -1.0f);
+  tri->max_y = fmaxf (fminf (ceilf (max_y - 0.5f), height - 1.0f), -1.0f);
+
+  if (tri->min_x > tri->max_x || tri->min_y > tri->max_y)
+    return -1;
+
+  return 0;
+}
+
+static const canary_draw_vertex_t *
+get_vertices (soft_renderer_t *ren, canary_draw_list_t *draw_list)
+{
+  if (canary_draw_list_get_format (draw_list) != CANARY_DRAW_FORMAT_COMPACT)
+    return canary_draw_list_vertex_buffer (draw_list);
+
+  size_t vertex_num = canary_draw_list_vertex_count (draw_list);
+  if (vertex_num > ren->unpacked.capacity)
+    {
+      ren->unpacked.capacity = vertex_num;
+      ren->unpacked.vals = realloc (
+          ren->unpacked.vals, sizeof (canary_draw_vertex_t) * vertex_num);
+    }
+
+  canary_draw_unpack_vertices (
+      ren->unpacked.vals, canary_draw_list_compact_vertex_buffer (draw_list),
+      vertex_num);
+
+  return ren->unpacked.vals;
+}
+
+static void
+setup_triangles (soft_renderer_t *ren, canary_draw_list_t *draw_list)
+{
+  size_t vertex_num = canary_draw_list_vertex_count (draw_list);
+  const canary_draw_vertex_t *vertices = get_vertices (ren, draw_list);
+
+  size_t index_num = canary_draw_list_index_count (draw_list);
+  const canary_draw_index_t *indices
+      = canary_draw_list_index_buffer (draw_list);
+  const canary_draw_compact_index_t *compact_indices
+      = canary_draw_list_compact_index_buffer (draw_list);
+
+  size_t triangle_num = index_num / 3;
+  if (triangle_num > ren->triangles.capacity)
+    {
+      ren->triangles.capacity = triangle_num;
+      ren->triangles.vals = realloc (ren->triangles.vals,
+                                     sizeof (triangle_t) * triangle_num);
+    }
+
+  ren->triangles.size = 0;
+
+  for (size_t i = 0; i < triangle_num; i++)
+    {
+      const canary_draw_vertex_t *corners[3];
+      int valid = 1;
+
+      for (int j = 0; j < 3; j++)
+        {
+          canary_draw_index_t index = compact_indices
+                                          ? compact_indices[i * 3 + j]
+                                          : indices[i * 3 + j];
+          valid = valid && index < vertex_num;
+          corners[j] = &vertices[valid ? index : 0];
+        }
+
+      if (!valid)
+        continue;
+
+      triangle_t *tri = &ren->triangles.vals[ren->triangles.size];
+      if (!setup_triangle (ren, tri, corners))
+        ren->triangles.size++;
+    }
+}
+
+static void
+bin_triangles (soft_renderer_t *ren)
+{
+  uint32_t tile_num = ren->tiles_x * ren->tiles_y;
+  memset (ren->bin_offsets, 0, sizeof (uint32_t) * (tile_num + 1));
+
+  for (size_t i = 0; i < ren->triangles.size; i++)
+    {
+      const triangle_t *tri = &ren->triangles.vals[i];
+
+      for (int ty = tri->min_y / TILE_SIZE; ty <= tri->max_y / TILE_SIZE;
+           ty++)
+        for (int tx = tri->min_x / TILE_SIZE; tx <= tri->max_x / TILE_SIZE;
+             tx++)
+          ren->bin_offsets[ty * ren->tiles_x + tx + 1]++;
+    }
+
+  for (uint32_t i = 0; i < tile_num; i++)
+    ren->bin_offsets[i + 1] += ren->bin_offsets[i];
+
+  size_t bin_size = ren->bin_offsets[tile_num];
+  if (bin_size > ren->bins.capacity)
+    {
+      ren->bins.capacity = bin_size;
+      ren->bins.vals
+          = realloc (ren->bins.vals, sizeof (uint32_t) * bin_size);
+    }
+
+  memcpy (ren->bin_cursors, ren->bin_offsets, sizeof (uint32_t) * tile_num);
+
+  for (size_t i = 0; i < ren->triangles.size; i++)
+    {
+      const triangle_t *tri = &ren->triangles.vals[i];
+
+      for (int ty = tri->min_y / TILE_SIZE; ty <= tri->max_y / TILE_SIZE;
+           ty++)
+        for (int tx = tri->min_x / TILE_SIZE; tx <= tri->max_x / TILE_SIZE;
+             tx++)
+          ren->bins.vals[ren->bin_cursors[ty * ren->tiles_x + tx]++] = i;
+    }
+}
+
+static inline float
+clamp_unit (float value)
+{
+  return fminf (fmaxf (value, 0.0f), 1.0f);
+}
+
+#if !defined(__SSE2__)
+static void
+raster_span_scalar (const triangle_t *tri, tile_buffer_t *tile, int row,
+                    float py, int x0, int x1, int tile_x)
+{
+  float wy[3];
+  for (int i = 0; i < 3; i++)
+    wy[i] = tri->b[i] * py + tri->c[i];
+
+  for (int x = x0; x <= x1; x++)
+    {
+      float px = (float)x + 0.5f;
+      float w[3];
+      int inside = 1;
+
+      for (int i = 0; i < 3; i++)
+        {
+          w[i] = tri->a[i] * px + wy[i];
+          inside = inside
+                   && (w[i] > 0.0f || (w[i] == 0.0f && tri->top_left[i]));
+        }
+
+      if (!inside)
+        continue;
+
+      float l1 = w[1] * tri->inv_area;
+      float l2 = w[2] * tri->inv_area;
+
+      float src[4];
+      for (int c = 0; c < 4; c++)
+        src[c] = clamp_unit (tri->color[c] + l1 * tri->color_delta[0][c]
+                             + l2 * tri->color_delta[1][c]);
+
+      /* GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA on every channel */
+      float alpha = src[3];
+      float inv_alpha = 1.0f - alpha;
+      int pixel = row * TILE_SIZE + (x - tile_x);
+
+      for (int c = 0; c < 4; c++)
+        {
+          float *dst = &tile->planes[c][pixel];
+          *dst = src[c] * alpha + *dst * inv_alpha;
+        }
+    }
+}
+
+#else
+static void
+raster_span_sse2 (const triangle_t *tri, tile_buffer_t *tile, int row,
+                  float py, int x0, int x1, int tile_x)
+{
+  const __m128 zero = _mm_setzero_ps ();
+  const __m128 one = _mm_set1_ps (1.0f);
+  const __m128 lane_offsets = _mm_setr_ps (0.5f, 1.5f, 2.5f, 3.5f);
+  const __m128 inv_area = _mm_set1_ps (tri->inv_area);
+  const __m128 span_min = _mm_set1_ps ((float)x0);
+  const __m128 span_max = _mm_set1_ps ((float)x1 + 1.0f);
+
+  __m128 a[3];
+  __m128 wy[3];
+  __m128 top_left[3];
+
+  for (int i = 0; i < 3; i++)
+    {
+      a[i] = _mm_set1_ps (tri->a[i]);
+      wy[i] = _mm_set1_ps (tri->b[i] * py + tri->c[i]);
+      top_left[i] = _mm_castsi128_ps (_mm_set1_epi32 (-tri->top_left[i]));
+    }
+
+  /* tile origins are multiples of four, so spans stay lane-aligned */
+  int start = x0 & ~3;
+
+  for (int x = start; x <= x1; x += 4)
+    {
+      __m128 px = _mm_add_ps (_mm_set1_ps ((float)x), lane_offsets);
+      __m128 mask = _mm_and_ps (_mm_cmpgt_ps (px, span_min),
+                                _mm_cmplt_ps (px, span_max));
+
+      __m128 w[3];
+      for (int i = 0; i < 3; i++)
+        {
+          w[i] = _mm_add_ps (_mm_mul_ps (a[i], px), wy[i]);
+          __m128 edge = _mm_or_ps (
+              _mm_cmpgt_ps (w[i], zero),
+              _mm_and_ps (_mm_cmpeq_ps (w[i], zero), top_left[i]));
+          mask = _mm_and_ps (mask, edge);
+        }
+
+      if (!_mm_movemask_ps (mask))
+        continue;
+
+      __m128 l1 = _mm_mul_ps (w[1], inv_area);
+      __m128 l2 = _mm_mul_ps (w[2], inv_area);
+
+      __m128 src[4];
+      for (int c = 0; c < 4; c++)
+        {
+          __m128 value = _mm_add_ps (
+              _mm_add_ps (
+                  _mm_set1_ps (tri->color[c]),
+                  _mm_mul_ps (l1, _mm_set1_ps (tri->color_delta[0][c]))),
+              _mm_mul_ps (l2, _mm_set1_ps (tri->color_delta[1][c])));
+          src[c] = _mm_min_ps (_mm_max_ps (value, zero), one);
+        }
+
+      __m128 alpha = src[3];
+      __m128 inv_alpha = _mm_sub_ps (one, alpha);
+      int pixel = row * TILE_SIZE + (x - tile_x);
+
+      for (int c = 0; c < 4; c++)
+        {
+          float *dst_ptr = &tile->planes[c][pixel];
+          __m128 dst = _mm_loadu_ps (dst_ptr);
+          __m128 blended = _mm_add_ps (_mm_mul_ps (src[c], alpha),
+                                       _mm_mul_ps (dst, inv_alpha));
+          dst = _mm_or_ps (_mm_and_ps (mask, blended),
+                           _mm_andnot_ps (mask, dst));
+          _mm_storeu_ps (dst_ptr, dst);
+        }
+    }
+}
+#endif
+
+static void
+render_tile (soft_renderer_t *ren, tile_buffer_t *tile, uint32_t tile_index)
+{
+  int tile_x = (tile_index % ren->tiles_x) * TILE_SIZE;
+  int tile_y = (tile_index / ren->tiles_x) * TILE_SIZE;
+  int tile_w = ren->width - tile_x < TILE_SIZE ? ren->width - tile_x
+                                               : TILE_SIZE;
+  int tile_h = ren->height - tile_y < TILE_SIZE ? ren->height - tile_y
+                                                : TILE_SIZE;
+
+  memset (tile, 0, sizeof (tile_buffer_t));
+
+  for (uint32_t i = ren->bin_offsets[tile_index];
+       i < ren->bin_offsets[tile_index + 1]; i++)
+    {
+      const triangle_t *tri = &ren->triangles.vals[ren->bins.vals[i]];
+
+      int x0 = tri->min_x > tile_x ? tri->min_x : tile_x;
+      int y0 = tri->min_y > tile_y ? tri->min_y : tile_y;
+      int x1 = tri->max_x < tile_x + tile_w - 1 ? tri->max_x
+                                                : tile_x + tile_w - 1;
+      int y1 = tri->max_y < tile_y + tile_h - 1 ? tri->max_y
+                                                : tile_y + tile_h - 1;
+
+      for (int y = y0; y <= y1; y++)
+        {
+          float py = (float)y + 0.5f;
+#if defined(__SSE2__)
+          raster_span_sse2 (tri, tile, y - tile_y, py, x0, x1, tile_x);
+#else
+          raster_span_scalar (tri, tile, y - tile_y, py, x0, x1, tile_x);
+#endif
+        }
+    }
+
+  for (int y = 0; y < tile_h; y++)
+    {
+      uint8_t *dst
+          = &ren->framebuffer[((tile_y + y) * ren->width + tile_x) * 4];
+
+      for (int x = 0; x < tile_w; x++)
+        for (int c = 0; c < 4; c++)
+          {
+            float value = tile->planes[c][y * TILE_SIZE + x];
+            dst[x * 4 + c] = (uint8_t)(clamp_unit (value) * 255.0f + 0.5f);
+          }
+    }
+}
+
+static void
+render_tiles (soft_renderer_t *ren, tile_buffer_t *tile)
+{
+  uint32_t tile_num = ren->tiles_x * ren->tiles_y;
+
+  for (;;)
+    {
+      pthread_mutex_lock (&ren->lock);
+      uint32_t tile_index = ren->next_tile++;
+      pthread_mutex_unlock (&ren->lock);
+
+      if (tile_index >= tile_num)
+        break;
+
+      render_tile (ren, tile, tile_index);
+    }
+}
+
+static void *
+worker_main (void *arg)
+{
+  worker_t *worker = arg;
+  soft_renderer_t *ren = worker->ren;
+  uint32_t generation = 0;
+
+  for (;;)
+    {
+      pthread_mutex_lock (&ren->lock);
+
+      while (!ren->shutdown && ren->generation == generation)
+        pthread_cond_wait (&ren->work_cond, &ren->lock);
+
+      generation = ren->generation;
+      int shutdown = ren->shutdown;
+      pthread_mutex_unlock (&ren->lock);
+
+      if (shutdown)
+        break;
+
+      render_tiles (ren, worker->tile);
+
+      pthread_mutex_lock (&ren->lock);
+      if (--ren->busy_workers == 0)
+        pthread_cond_signal (&ren->done_cond);
+      pthread_mutex_unlock (&ren->lock);
+    }
+
+  return NULL;
+}
+
+int
+soft_renderer_create (soft_renderer_t **new_ren, canary_panel_t *panel,
+                      uint32_t width, uint32_t height, uint32_t thread_num)
+{
+  soft_renderer_t *ren = malloc (sizeof (soft_renderer_t));
+  *new_ren = ren;
+
+  ren->panel = panel;
+  ren->width = width;
+  ren->height = height;
+  ren->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+  ren->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+  ren->framebuffer = calloc ((size_t)width * height, 4);
+
+  ren->triangles.vals = NULL;
+  ren->triangles.size = 0;
+  ren->triangles.capacity = 0;
+
+  ren->unpacked.vals = NULL;
+  ren->unpacked.capacity = 0;
+
+  uint32_t tile_num = ren->tiles_x * ren->tiles_y;
+  ren->bin_offsets = calloc (tile_num + 1, sizeof (uint32_t));
+  ren->bin_cursors = calloc (tile_num + 1, sizeof (uint32_t));
+  ren->bins.vals = NULL;
+  ren->bins.capacity = 0;
+
+  pthread_mutex_init (&ren->lock, NULL);
+  pthread_cond_init (&ren->work_cond, NULL);
+  pthread_cond_init (&ren->done_cond, NULL);
+  ren->generation = 0;
+  ren->next_tile = 0;
+  ren->busy_workers = 0;
+  ren->shutdown = 0;
+
+  /* the calling thread always renders too */
+  ren->worker_num = thread_num > 1 ? thread_num - 1 : 0;
+  ren->workers = calloc (ren->worker_num, sizeof (worker_t));
+
+  for (uint32_t i = 0; i < ren->worker_num; i++)
+    {
+      worker_t *worker = &ren->workers[i];
+      worker->ren = ren;
+      worker->tile = malloc (sizeof (tile_buffer_t));
+
+      if (pthread_create (&worker->thread, NULL, worker_main, worker))
+        {
+          LOG_ERR ("failed to create rasterizer thread");
+          free (worker->tile);
+          ren->worker_num = i;
+          break;
+        }
+    }
+
+  return 0;
+}
+
+void
+soft_renderer_delete (soft_renderer_t *ren)
+{
+  pthread_mutex_lock (&ren->lock);
+  ren->shutdown = 1;
+  pthread_cond_broadcast (&ren->work_cond);
+  pthread_mutex_unlock (&ren->lock);
+
+  for (uint32_t i = 0; i < ren->worker_num; i++)
+    {
+      pthread_join (ren->workers[i].thread, NULL);
+      free (ren->workers[i].tile);
+    }
+
+  pthread_cond_destroy (&ren->done_cond);
+  pthread_cond_destroy (&ren->work_cond);
+  pthread_mutex_destroy (&ren->lock);
+
+  free (ren->workers);
+  free (ren->bins.vals);
+  free (ren->bin_cursors);
+  free (ren->bin_offsets);
+  free (ren->unpacked.vals);
+  free (ren->triangles.vals);
+  free (ren->framebuffer);
+  free (ren);
+}
+
+void
+soft_renderer_render_frame (soft_renderer_t *ren)
+{
+  canary_draw_list_t *draw_list = canary_panel_get_draw_list (ren->panel);
+  if (!draw_list)
+    return;
+
+  soft_renderer_render_draw_list (ren, draw_list);
+}
+
+void
+soft_renderer_render_draw_list (soft_renderer_t *ren,
+                                canary_draw_list_t *draw_list)
+{
+  setup_triangles (ren, draw_list);
+  bin_triangles (ren);
+
+  pthread_mutex_lock (&ren->lock);
+  ren->next_tile = 0;
+  ren->busy_workers = ren->worker_num;
+  ren->generation++;
+  pthread_cond_broadcast (&ren->work_cond);
+  pthread_mutex_unlock (&ren->lock);
+
+  render_tiles (ren, &ren->main_tile);
+
+  pthread_mutex_lock (&ren->lock);
+  while (ren->busy_workers > 0)
+    pthread_cond_wait (&ren->done_cond, &ren->lock);
+  pthread_mutex_unlock (&ren->lock);
+}
+
+const uint8_t *
+soft_renderer_get_framebuffer (soft_renderer_t *ren)
+{
+  return ren->framebuffer;
+}
@@ -0,0 +1,52 @@
+/** @file soft_renderer.h
+ */
+
+#pragma once
+
+#include <stdint.h> /* for uint8_t, uint32_t */
+
+#include "draw_list.h"
+#include "panel.h"
+
+/** @typedef soft_renderer_t
+ * A headless rasterizer that draws panel draw lists into an RGBA8
+ * framebuffer on the CPU, blending the same way as the GLES renderer.
+ */
+typedef struct soft_renderer_s soft_renderer_t;
+
+/** @function soft_renderer_create
+ * @param new_ren
+ * @param panel The panel to render. May be NULL if only
+ * #soft_renderer_render_draw_list is used.
+ * @param width
+ * @param height
+ * @param thread_num The number of threads to rasterize with, including the
+ * calling thread.
+ * @return Zero on success.
+ */
+int soft_renderer_create (soft_renderer_t **, canary_panel_t *, uint32_t,
+                          uint32_t, uint32_t);
+
+/** @function soft_renderer_delete
+ * @param ren
+ */
+void soft_renderer_delete (soft_renderer_t *);
+
+/** @function soft_renderer_render_frame
+ * Clears the framebuffer and draws the panel's current draw list.
+ * @param ren
+ */
+void soft_renderer_render_frame (soft_renderer_t *);
+
+/** @function soft_renderer_render_draw_list
+ * Clears the framebuffer and draws the given draw list.
+ * @param ren
+ * @param ui_draw
+ */
+void soft_renderer_render_draw_list (soft_renderer_t *, canary_draw_list_t *);
+
+/** @function soft_renderer_get_framebuffer
+ * @param ren
+ * @return Tightly packed, top-down RGBA8 pixels.
+ */
+const uint8_t *soft_renderer_get_framebuffer (soft_renderer_t *);
@@ -0,0 +1,185 @@
+/** @file test_capture.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h> /* for fabsf */
+#include <stdlib.h> /* for mkstemp */
+#include <sys/stat.h>
+#include <unistd.h> /* for close, truncate, unlink */
+
+#include "capture.h"
+#include "replay.h"
+#include "test_common.h"
+
+#define FRAME_NUM 8
+
+static const float RED[4] = { 1.0, 0.0, 0.0, 1.0 };
+
+/* a quad whose vertices carry the frame's number */
+static void
+draw_frame (canary_draw_list_t *ui_draw, int frame)
+{
+  canary_draw_list_clear (ui_draw);
+
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 0.0, 1.0, 1.0 } };
+  vertex.position[0] = frame / 16.0;
+
+  for (int i = 0; i < 4; i++)
+    {
+      vertex.position[1] = i / 4.0;
+      canary_draw_vertex (ui_draw, &vertex);
+    }
+
+  canary_draw_triangle (ui_draw, 0, 1, 2);
+  canary_draw_triangle (ui_draw, 2, 1, 3);
+}
+
+static void
+write_capture (const char *filename, canary_draw_format_t format,
+               uint32_t flags)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_capture_t *capture;
+  assert_true (mdo_result_success (
+      canary_capture_create (&capture, alloc, filename, flags)));
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create_with_format (&ui_draw, alloc, format);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_color (panel, RED);
+  canary_panel_set_draw_list (panel, ui_draw);
+
+  canary_panel_t *empty;
+  canary_panel_create (&empty, alloc);
+
+  for (int i = 0; i < FRAME_NUM; i++)
+    {
+      draw_frame (ui_draw, i);
+
+      canary_capture_begin_frame (capture);
+      canary_capture_write_panel (capture, 3, panel);
+      canary_capture_write_panel (capture, 4, empty);
+      assert_int_equal (canary_capture_end_frame (capture), 0);
+    }
+
+  canary_capture_delete (capture);
+  canary_panel_delete (empty);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+check_capture (const char *filename, int frame_num)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_replay_t *replay;
+  assert_true (
+      mdo_result_success (canary_replay_create (&replay, alloc, filename)));
+  assert_int_equal (canary_replay_get_frame_num (replay), frame_num);
+
+  for (int i = 0; i < frame_num; i++)
+    {
+      canary_replay_frame_t frame;
+      assert_int_equal (canary_replay_get_frame (replay, i, &frame), 0);
+      assert_int_equal (frame.panel_num, 2);
+
+      canary_replay_panel_t view;
+      assert_int_equal (canary_replay_get_panel (replay, &frame, 0, &view),
+                        0);
+      assert_int_equal (view.id, 3);
+      assert_true (view.color[0] == 1.0f && view.color[1] == 0.0f);
+      assert_int_equal (view.vertex_num, 4);
+      assert_int_equal (view.index_num, 6);
+
+      /* compact lists come back within their precision */
+      for (int j = 0; j < 4; j++)
+        {
+          assert_true (fabsf (view.vertices[j].position[0] - i / 16.0f)
+                       < 1e-3);
+          assert_true (fabsf (view.vertices[j].position[1] - j / 4.0f)
+                       < 1e-3);
+          assert_true (view.vertices[j].color[2] == 1.0f);
+        }
+
+      assert_int_equal (view.indices[3], 2);
+      assert_int_equal (view.indices[5], 3);
+
+      assert_int_equal (canary_replay_get_panel (replay, &frame, 1, &view),
+                        0);
+      assert_int_equal (view.id, 4);
+      assert_int_equal (view.vertex_num, 0);
+      assert_int_equal (view.index_num, 0);
+
+      assert_int_not_equal (
+          canary_replay_get_panel (replay, &frame, 2, &view), 0);
+    }
+
+  canary_replay_frame_t frame;
+  assert_int_not_equal (canary_replay_get_frame (replay, frame_num, &frame),
+                        0);
+
+  canary_replay_delete (replay);
+}
+
+static void
+test_round_trip (void **state)
+{
+  char filename[] = "/tmp/canary-capture-XXXXXX";
+  int fd = mkstemp (filename);
+  assert_true (fd >= 0);
+  close (fd);
+
+  write_capture (filename, CANARY_DRAW_FORMAT_FLOAT, 0);
+  check_capture (filename, FRAME_NUM);
+
+  write_capture (filename, CANARY_DRAW_FORMAT_COMPACT, 0);
+  check_capture (filename, FRAME_NUM);
+
+  /* falls back to uncompressed frames if built without LZ4 */
+  write_capture (filename, CANARY_DRAW_FORMAT_FLOAT, CANARY_CAPTURE_COMPRESS);
+  check_capture (filename, FRAME_NUM);
+
+  unlink (filename);
+}
+
+static void
+test_truncated (void **state)
+{
+  char filename[] = "/tmp/canary-capture-XXXXXX";
+  int fd = mkstemp (filename);
+  assert_true (fd >= 0);
+
+  /* not a capture at all */
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+  canary_replay_t *replay;
+  assert_false (
+      mdo_result_success (canary_replay_create (&replay, alloc, filename)));
+  canary_replay_delete (replay);
+  close (fd);
+
+  write_capture (filename, CANARY_DRAW_FORMAT_FLOAT, 0);
+
+  /* a capture cut short keeps its whole frames */
+  struct stat st;
+  assert_int_equal (stat (filename, &st), 0);
+  assert_int_equal (truncate (filename, st.st_size - 20), 0);
+  check_capture (filename, FRAME_NUM - 1);
+
+  unlink (filename);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_round_trip),
+    cmocka_unit_test (test_truncated),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -1,6 +1,9 @@
 /** @file test_ui_draw_list.c
  */
 
+#include <stdlib.h> /* for malloc, qsort */
+#include <string.h> /* for memcmp, memcpy */
+
 #include "draw_list.h"
 #include "test_common.h"
 
@@ -16,11 +19,303 @@ test_create_and_delete (void **state)
   canary_draw_list_delete (ui_draw);
 }
 
+static void
+test_draw_buffers (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  mdo_result_t result = canary_draw_list_create (&ui_draw, alloc);
+  assert_true (mdo_result_success (result));
+
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+  canary_draw_vertex (ui_draw, &vertex);
+
+  canary_draw_vertex_t vertices[4];
+  for (int i = 0; i < 4; i++)
+    {
+      vertices[i] = vertex;
+      vertices[i].position[0] = i;
+    }
+
+  canary_draw_index_t indices[] = { 0, 1, 2, 2, 1, 3 };
+  assert_int_equal (canary_draw_buffers (ui_draw, vertices, 4, indices, 6),
+                    0);
+
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 5);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), 6);
+
+  canary_draw_vertex_t *vertex_buffer
+      = canary_draw_list_vertex_buffer (ui_draw);
+  assert_true (vertex_buffer[4].position[0] == 3.0);
+
+  canary_draw_index_t *index_buffer = canary_draw_list_index_buffer (ui_draw);
+  for (int i = 0; i < 6; i++)
+    assert_int_equal (index_buffer[i], indices[i] + 1);
+
+  /* out-of-range indices are rejected without appending anything */
+  canary_draw_index_t bad_indices[] = { 0, 1, 4 };
+  assert_int_not_equal (
+      canary_draw_buffers (ui_draw, vertices, 4, bad_indices, 3), 0);
+
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 5);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), 6);
+
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+test_compact (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  mdo_result_t result = canary_draw_list_create_with_format (
+      &ui_draw, alloc, CANARY_DRAW_FORMAT_COMPACT);
+  assert_true (mdo_result_success (result));
+
+  /* out-of-range values are clamped */
+  canary_draw_vertex_t vertices[] = {
+    { { -1.0, 0.25 }, { 0.0, 0.2, 1.0, 1.0 } },
+    { { 1.0, -2.0 }, { 2.0, -1.0, 0.6, 0.0 } },
+    { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } },
+  };
+
+  for (int i = 0; i < 3; i++)
+    canary_draw_vertex (ui_draw, &vertices[i]);
+
+  canary_draw_triangle (ui_draw, 0, 1, 2);
+
+  assert_null (canary_draw_list_vertex_buffer (ui_draw));
+  assert_null (canary_draw_list_index_buffer (ui_draw));
+
+  canary_draw_compact_vertex_t *compact
+      = canary_draw_list_compact_vertex_buffer (ui_draw);
+  assert_non_null (compact);
+
+  assert_int_equal (compact[0].position[0], -32767);
+  assert_int_equal (compact[0].position[1], 8192);
+  assert_int_equal (compact[0].color[1], 51);
+  assert_int_equal (compact[1].position[0], 32767);
+  assert_int_equal (compact[1].position[1], -32767);
+  assert_int_equal (compact[1].color[0], 255);
+  assert_int_equal (compact[1].color[1], 0);
+  assert_int_equal (compact[1].color[2], 153);
+
+  canary_draw_compact_index_t *indices
+      = canary_draw_list_compact_index_buffer (ui_draw);
+  assert_non_null (indices);
+  assert_int_equal (indices[2], 2);
+
+  /* unpacking gets within quantization error of the originals */
+  canary_draw_vertex_t unpacked[3];
+  canary_draw_unpack_vertices (unpacked, compact, 3);
+  assert_true (unpacked[0].position[0] == -1.0);
+  assert_true (unpacked[0].position[1] > 0.2499
+               && unpacked[0].position[1] < 0.2501);
+  assert_true (unpacked[2].color[3] == 1.0);
+
+  /* indices are widened once they can't address every vertex */
+  canary_draw_vertex_t vertex = vertices[2];
+  while (canary_draw_list_vertex_count (ui_draw) < 70000)
+    canary_draw_vertex (ui_draw, &vertex);
+
+  canary_draw_triangle (ui_draw, 69997, 69998, 69999);
+
+  assert_null (canary_draw_list_compact_index_buffer (ui_draw));
+  canary_draw_index_t *wide = canary_draw_list_index_buffer (ui_draw);
+  assert_non_null (wide);
+  assert_int_equal (wide[1], 1);
+  assert_int_equal (wide[5], 69999);
+
+  canary_draw_list_clear (ui_draw);
+  assert_non_null (canary_draw_list_compact_index_buffer (ui_draw));
+
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+test_concat (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *lists[3];
+  canary_draw_format_t formats[3] = {
+    CANARY_DRAW_FORMAT_FLOAT,
+    CANARY_DRAW_FORMAT_COMPACT,
+    CANARY_DRAW_FORMAT_FLOAT,
+  };
+
+  /* enough quads in each that the SIMD loops have full blocks and a tail */
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+  for (int i = 0; i < 3; i++)
+    {
+      mdo_result_t result
+          = canary_draw_list_create_with_format (&lists[i], alloc, formats[i]);
+      assert_true (mdo_result_success (result));
+
+      for (int quad = 0; quad < 3 + i; quad++)
+        {
+          canary_draw_index_t base = canary_draw_list_vertex_count (lists[i]);
+          for (int corner = 0; corner < 4; corner++)
+            {
+              vertex.position[0] = i * 0.25;
+              canary_draw_vertex (lists[i], &vertex);
+            }
+
+          canary_draw_triangle (lists[i], base, base + 1, base + 2);
+          canary_draw_triangle (lists[i], base + 2, base + 1, base + 3);
+        }
+    }
+
+  canary_draw_list_t *ui_draw;
+  mdo_result_t result = canary_draw_list_create (&ui_draw, alloc);
+  assert_true (mdo_result_success (result));
+
+  canary_draw_list_concat (ui_draw, lists[0]);
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 12);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), 18);
+
+  const canary_draw_list_t *srcs[] = { lists[1], lists[2] };
+  size_t vertex_offsets[2];
+  size_t index_offsets[2];
+  canary_draw_list_concat_many (ui_draw, srcs, 2, vertex_offsets,
+                                index_offsets);
+
+  assert_int_equal (vertex_offsets[0], 12);
+  assert_int_equal (vertex_offsets[1], 28);
+  assert_int_equal (index_offsets[0], 18);
+  assert_int_equal (index_offsets[1], 42);
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 48);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), 72);
+
+  /* every quad still refers to its own four vertices */
+  canary_draw_index_t *indices = canary_draw_list_index_buffer (ui_draw);
+  for (int quad = 0; quad < 12; quad++)
+    {
+      assert_int_equal (indices[quad * 6], quad * 4);
+      assert_int_equal (indices[quad * 6 + 5], quad * 4 + 3);
+    }
+
+  /* compact vertices are unpacked on the way in */
+  canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (ui_draw);
+  assert_true (vertices[12].position[0] > 0.2499
+               && vertices[12].position[0] < 0.2501);
+  assert_true (vertices[47].position[0] == 0.5);
+
+  /* and packed when the destination is compact */
+  canary_draw_list_t *compact;
+  result = canary_draw_list_create_with_format (&compact, alloc,
+                                                CANARY_DRAW_FORMAT_COMPACT);
+  assert_true (mdo_result_success (result));
+
+  canary_draw_list_concat (compact, lists[1]);
+  canary_draw_list_concat (compact, ui_draw);
+  assert_int_equal (canary_draw_list_vertex_count (compact), 64);
+
+  canary_draw_compact_index_t *compact_indices
+      = canary_draw_list_compact_index_buffer (compact);
+  assert_non_null (compact_indices);
+  assert_int_equal (compact_indices[95], 63);
+
+  canary_draw_list_delete (compact);
+  canary_draw_list_delete (ui_draw);
+
+  for (int i = 0; i < 3; i++)
+    canary_draw_list_delete (lists[i]);
+}
+
+static int
+compare_triangles (const void *a, const void *b)
+{
+  return memcmp (a, b, sizeof (float) * 6);
+}
+
+/* the positions of every triangle, in a canonical order */
+static void
+get_triangles (canary_draw_list_t *ui_draw, float (*triangles)[6])
+{
+  canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (ui_draw);
+  canary_draw_index_t *indices = canary_draw_list_index_buffer (ui_draw);
+  size_t triangle_num = canary_draw_list_index_count (ui_draw) / 3;
+
+  for (size_t i = 0; i < triangle_num; i++)
+    for (int j = 0; j < 3; j++)
+      memcpy (&triangles[i][j * 2], vertices[indices[i * 3 + j]].position,
+              sizeof (float) * 2);
+
+  qsort (triangles, triangle_num, sizeof (float) * 6, compare_triangles);
+}
+
+static void
+test_weld (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  mdo_result_t result = canary_draw_list_create (&ui_draw, alloc);
+  assert_true (mdo_result_success (result));
+
+  /* a grid of quads drawn one triangle at a time, like drawTriangle */
+  const int GRID_SIZE = 8;
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+
+  for (int y = 0; y < GRID_SIZE; y++)
+    for (int x = 0; x < GRID_SIZE; x++)
+      {
+        const int corners[6][2] = {
+          { 0, 0 }, { 1, 0 }, { 0, 1 }, { 0, 1 }, { 1, 0 }, { 1, 1 },
+        };
+
+        canary_draw_index_t indices[6];
+        for (int i = 0; i < 6; i++)
+          {
+            vertex.position[0] = x + corners[i][0];
+            vertex.position[1] = y + corners[i][1];
+            indices[i] = canary_draw_vertex (ui_draw, &vertex);
+          }
+
+        canary_draw_triangle (ui_draw, indices[0], indices[1], indices[2]);
+        canary_draw_triangle (ui_draw, indices[3], indices[4], indices[5]);
+      }
+
+  size_t index_num = canary_draw_list_index_count (ui_draw);
+  float(*before)[6] = malloc (sizeof (float) * 2 * index_num);
+  float(*after)[6] = malloc (sizeof (float) * 2 * index_num);
+  get_triangles (ui_draw, before);
+
+  canary_draw_weld_stats_t stats;
+  assert_int_equal (canary_draw_list_weld (ui_draw, true, &stats), 0);
+
+  size_t grid_vertices = (GRID_SIZE + 1) * (GRID_SIZE + 1);
+  assert_int_equal (stats.vertices_before, GRID_SIZE * GRID_SIZE * 6);
+  assert_int_equal (stats.vertices_after, grid_vertices);
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), grid_vertices);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), index_num);
+
+  /* the same triangles are drawn, if maybe in another order */
+  get_triangles (ui_draw, after);
+  assert_memory_equal (before, after, sizeof (float) * 2 * index_num);
+
+  /* lists with bad indices are left alone */
+  canary_draw_triangle (ui_draw, 0, 1, grid_vertices);
+  assert_int_not_equal (canary_draw_list_weld (ui_draw, false, NULL), 0);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), index_num + 3);
+
+  free (before);
+  free (after);
+  canary_draw_list_delete (ui_draw);
+}
+
 int
 main ()
 {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test (test_create_and_delete),
+    cmocka_unit_test (test_draw_buffers),
+    cmocka_unit_test (test_compact),
+    cmocka_unit_test (test_concat),
+    cmocka_unit_test (test_weld),
   };
 
   return cmocka_run_group_tests (tests, NULL, NULL);
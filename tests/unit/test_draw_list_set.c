@@ -0,0 +1,117 @@
+/** @file test_draw_list_set.c
+ */
+
+#include "draw_list_set.h"
+#include "test_common.h"
+
+static void
+draw_frame (canary_draw_list_t *ui_draw, size_t vertex_num)
+{
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+
+  for (size_t i = 0; i < vertex_num; i++)
+    {
+      vertex.position[0] = i;
+      canary_draw_vertex (ui_draw, &vertex);
+    }
+
+  for (size_t i = 0; i + 2 < vertex_num; i += 3)
+    canary_draw_triangle (ui_draw, i, i + 1, i + 2);
+}
+
+static void
+test_swap (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+
+  canary_draw_list_set_t *set;
+  mdo_result_t result = canary_draw_list_set_create (
+      &set, alloc, panel, 2, CANARY_DRAW_FORMAT_FLOAT);
+  assert_true (mdo_result_success (result));
+
+  canary_draw_list_t *back = canary_draw_list_set_get_back (set);
+  assert_ptr_equal (canary_panel_get_draw_list (panel), back);
+  assert_ptr_not_equal (canary_draw_list_set_get_front (set), back);
+
+  draw_frame (back, 3);
+  canary_draw_list_set_swap (set);
+
+  /* the finished list is published, and the panel moves to a fresh one */
+  canary_draw_list_t *front = canary_draw_list_set_get_front (set);
+  assert_ptr_equal (front, back);
+  assert_int_equal (canary_draw_list_vertex_count (front), 3);
+
+  back = canary_draw_list_set_get_back (set);
+  assert_ptr_not_equal (back, front);
+  assert_ptr_equal (canary_panel_get_draw_list (panel), back);
+  assert_int_equal (canary_draw_list_vertex_count (back), 0);
+
+  canary_draw_list_set_delete (set);
+  canary_panel_delete (panel);
+}
+
+static void
+test_steady_state (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_set_t *set;
+  mdo_result_t result = canary_draw_list_set_create (
+      &set, alloc, NULL, 3, CANARY_DRAW_FORMAT_FLOAT);
+  assert_true (mdo_result_success (result));
+
+  /* enough to outgrow the initial capacities several times */
+  const size_t VERTEX_NUM = 10000;
+
+  for (int i = 0; i < 6; i++)
+    {
+      draw_frame (canary_draw_list_set_get_back (set), VERTEX_NUM);
+      canary_draw_list_set_swap (set);
+    }
+
+  /* once warm, every frame reuses the same buffers */
+  canary_draw_vertex_t *vertex_buffers[3];
+  canary_draw_index_t *index_buffers[3];
+
+  for (int i = 0; i < 3; i++)
+    {
+      canary_draw_list_t *back = canary_draw_list_set_get_back (set);
+      draw_frame (back, VERTEX_NUM);
+      vertex_buffers[i] = canary_draw_list_vertex_buffer (back);
+      index_buffers[i] = canary_draw_list_index_buffer (back);
+      canary_draw_list_set_swap (set);
+    }
+
+  for (int i = 0; i < 9; i++)
+    {
+      canary_draw_list_t *back = canary_draw_list_set_get_back (set);
+      draw_frame (back, VERTEX_NUM);
+      assert_ptr_equal (canary_draw_list_vertex_buffer (back),
+                        vertex_buffers[i % 3]);
+      assert_ptr_equal (canary_draw_list_index_buffer (back),
+                        index_buffers[i % 3]);
+      canary_draw_list_set_swap (set);
+
+      canary_draw_list_t *front = canary_draw_list_set_get_front (set);
+      assert_int_equal (canary_draw_list_vertex_count (front), VERTEX_NUM);
+
+      canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (front);
+      assert_true (vertices[VERTEX_NUM - 1].position[0] == VERTEX_NUM - 1);
+    }
+
+  canary_draw_list_set_delete (set);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_swap),
+    cmocka_unit_test (test_steady_state),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,177 @@
+/** @file test_hit_grid.c
+ */
+
+#include <stdlib.h> /* for rand */
+
+#include "hit_grid.h"
+#include "test_common.h"
+
+static void
+test_shapes (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_hit_grid_t *grid;
+  canary_hit_grid_create (&grid, alloc);
+
+  uint32_t id = 0;
+  const float origin[2] = { 0.0, 0.0 };
+  assert_false (canary_hit_grid_test (grid, origin, &id));
+
+  const float position[2] = { -1.0, -1.0 };
+  const float size[2] = { 0.5, 0.5 };
+  canary_hit_grid_add_rect (grid, 1, position, size);
+
+  const float center[2] = { 0.5, 0.5 };
+  canary_hit_grid_add_circle (grid, 2, center, 0.25);
+
+  assert_int_equal (canary_hit_grid_get_region_num (grid), 2);
+
+  const float in_rect[2] = { -0.75, -0.6 };
+  assert_true (canary_hit_grid_test (grid, in_rect, &id));
+  assert_int_equal (id, 1);
+
+  const float in_circle[2] = { 0.6, 0.4 };
+  assert_true (canary_hit_grid_test (grid, in_circle, &id));
+  assert_int_equal (id, 2);
+
+  /* inside the circle's bounds, but not the circle */
+  const float corner[2] = { 0.74, 0.74 };
+  assert_false (canary_hit_grid_test (grid, corner, &id));
+
+  /* between the regions, and outside of them all */
+  assert_false (canary_hit_grid_test (grid, origin, &id));
+
+  const float outside[2] = { 2.0, 0.0 };
+  assert_false (canary_hit_grid_test (grid, outside, &id));
+
+  /* empty regions are dropped */
+  const float inverted[2] = { -0.5, 0.5 };
+  canary_hit_grid_add_rect (grid, 3, origin, inverted);
+  canary_hit_grid_add_circle (grid, 4, origin, -1.0);
+  assert_int_equal (canary_hit_grid_get_region_num (grid), 2);
+
+  canary_hit_grid_delete (grid);
+}
+
+static void
+test_overlap (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_hit_grid_t *grid;
+  canary_hit_grid_create (&grid, alloc);
+
+  const float position[2] = { 0.0, 0.0 };
+  const float big[2] = { 1.0, 1.0 };
+  const float small[2] = { 0.5, 0.5 };
+
+  canary_hit_grid_add_rect (grid, 1, position, big);
+  canary_hit_grid_add_rect (grid, 2, position, small);
+
+  /* the region added last is on top */
+  uint32_t id = 0;
+  const float point[2] = { 0.25, 0.25 };
+  assert_true (canary_hit_grid_test (grid, point, &id));
+  assert_int_equal (id, 2);
+
+  canary_hit_grid_remove (grid, 2);
+  assert_true (canary_hit_grid_test (grid, point, &id));
+  assert_int_equal (id, 1);
+
+  /* several regions can share an id, and are removed together */
+  const float far[2] = { 4.0, 4.0 };
+  const float far_point[2] = { 4.5, 4.5 };
+  canary_hit_grid_add_rect (grid, 1, far, big);
+  assert_true (canary_hit_grid_test (grid, far_point, &id));
+  assert_int_equal (id, 1);
+
+  canary_hit_grid_remove (grid, 1);
+  assert_int_equal (canary_hit_grid_get_region_num (grid), 0);
+  assert_false (canary_hit_grid_test (grid, point, &id));
+
+  canary_hit_grid_add_rect (grid, 3, position, big);
+  canary_hit_grid_clear (grid);
+  assert_false (canary_hit_grid_test (grid, point, &id));
+
+  canary_hit_grid_delete (grid);
+}
+
+static float
+random_float (float min, float max)
+{
+  return min + (max - min) * (rand () / (float)RAND_MAX);
+}
+
+static void
+test_random (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_hit_grid_t *grid;
+  canary_hit_grid_create (&grid, alloc);
+
+  typedef struct
+  {
+    float position[2];
+    float size[2];
+  } rect_t;
+
+  rect_t rects[200];
+
+  srand (1);
+
+  for (uint32_t i = 0; i < 200; i++)
+    {
+      rect_t *rect = &rects[i];
+      rect->position[0] = random_float (-1.0, 1.0);
+      rect->position[1] = random_float (-1.0, 1.0);
+      rect->size[0] = random_float (0.0, 0.3);
+      rect->size[1] = random_float (0.0, 0.3);
+      canary_hit_grid_add_rect (grid, i, rect->position, rect->size);
+    }
+
+  /* the grid must agree with testing every region in reverse */
+  for (int i = 0; i < 10000; i++)
+    {
+      float point[2] = { random_float (-1.2, 1.4), random_float (-1.2, 1.4) };
+
+      bool expected_hit = false;
+      uint32_t expected_id = 0;
+      for (uint32_t j = 200; j > 0; j--)
+        {
+          const rect_t *rect = &rects[j - 1];
+
+          if (point[0] >= rect->position[0]
+              && point[0] <= rect->position[0] + rect->size[0]
+              && point[1] >= rect->position[1]
+              && point[1] <= rect->position[1] + rect->size[1])
+            {
+              expected_hit = true;
+              expected_id = j - 1;
+              break;
+            }
+        }
+
+      uint32_t id = UINT32_MAX;
+      assert_int_equal (canary_hit_grid_test (grid, point, &id),
+                        expected_hit);
+
+      if (expected_hit)
+        assert_int_equal (id, expected_id);
+    }
+
+  canary_hit_grid_delete (grid);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_shapes),
+    cmocka_unit_test (test_overlap),
+    cmocka_unit_test (test_random),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,107 @@
+/** @file test_module_cache.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "module_cache.h"
+#include "test_common.h"
+
+static const char *MODULE_A = "(module (func (export \"update\") (param f32)))";
+static const char *MODULE_B = "(module (func (export \"on_hover\")))";
+
+static size_t
+count_files (const char *directory)
+{
+  DIR *dir = opendir (directory);
+  assert_non_null (dir);
+
+  size_t count = 0;
+  struct dirent *entry;
+  while ((entry = readdir (dir)))
+    if (entry->d_name[0] != '.')
+      count++;
+
+  closedir (dir);
+  return count;
+}
+
+static void
+remove_directory (const char *directory)
+{
+  DIR *dir = opendir (directory);
+  assert_non_null (dir);
+
+  struct dirent *entry;
+  while ((entry = readdir (dir)))
+    {
+      if (entry->d_name[0] == '.')
+        continue;
+
+      char path[1024];
+      snprintf (path, sizeof (path), "%s/%s", directory, entry->d_name);
+      unlink (path);
+    }
+
+  closedir (dir);
+  rmdir (directory);
+}
+
+static void
+compile (canary_module_cache_t *cache, wasm_engine_t *engine,
+         const char *wat)
+{
+  wasm_byte_vec_t wasm;
+  assert_null (wasmtime_wat2wasm (wat, strlen (wat), &wasm));
+
+  wasmtime_module_t *module = NULL;
+  assert_null (canary_module_cache_compile (cache, engine, "test",
+                                            (const uint8_t *)wasm.data,
+                                            wasm.size, &module));
+  assert_non_null (module);
+
+  wasmtime_module_delete (module);
+  wasm_byte_vec_delete (&wasm);
+}
+
+static void
+test_hit_and_evict (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  char directory[] = "/tmp/canary-module-cache-XXXXXX";
+  assert_non_null (mkdtemp (directory));
+
+  wasm_engine_t *engine = wasm_engine_new ();
+
+  canary_module_cache_t *cache;
+  mdo_result_t result
+      = canary_module_cache_create (&cache, alloc, directory, 1);
+  assert_true (mdo_result_success (result));
+
+  /* the second compile is a hit, so nothing new is written */
+  compile (cache, engine, MODULE_A);
+  compile (cache, engine, MODULE_A);
+  assert_int_equal (count_files (directory), 1);
+
+  /* the cap is smaller than any module, so only the newest survives */
+  compile (cache, engine, MODULE_B);
+  assert_int_equal (count_files (directory), 1);
+
+  canary_module_cache_delete (cache);
+  wasm_engine_delete (engine);
+  remove_directory (directory);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_hit_and_evict),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,160 @@
+/** @file test_panel.c
+ */
+
+#include "panel.h"
+#include "test_common.h"
+
+static void
+draw_quad (canary_draw_list_t *ui_draw, float x)
+{
+  canary_draw_vertex_t vertex = { { x, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+
+  canary_draw_index_t first = canary_draw_vertex (ui_draw, &vertex);
+  for (int i = 1; i < 4; i++)
+    {
+      vertex.position[1] = i;
+      canary_draw_vertex (ui_draw, &vertex);
+    }
+
+  canary_draw_triangle (ui_draw, first, first + 1, first + 2);
+  canary_draw_triangle (ui_draw, first + 2, first + 1, first + 3);
+}
+
+static void
+test_segments (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create (&ui_draw, alloc);
+  canary_panel_set_draw_list (panel, ui_draw);
+
+  /* nothing is recorded yet */
+  assert_int_not_equal (canary_panel_draw_segment (panel, 7), 0);
+  assert_int_not_equal (canary_panel_end_segment (panel), 0);
+
+  /* record a segment after some unrelated geometry */
+  draw_quad (ui_draw, 0.0);
+  assert_int_equal (canary_panel_begin_segment (panel, 7), 0);
+  assert_int_not_equal (canary_panel_begin_segment (panel, 8), 0);
+  draw_quad (ui_draw, 1.0);
+  assert_int_equal (canary_panel_end_segment (panel), 0);
+
+  /* replay it into a fresh frame after other geometry */
+  canary_draw_list_clear (ui_draw);
+  draw_quad (ui_draw, 2.0);
+  draw_quad (ui_draw, 3.0);
+  assert_int_equal (canary_panel_draw_segment (panel, 7), 0);
+
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 12);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), 18);
+
+  canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (ui_draw);
+  canary_draw_index_t *indices = canary_draw_list_index_buffer (ui_draw);
+
+  for (int i = 8; i < 12; i++)
+    assert_true (vertices[i].position[0] == 1.0);
+
+  canary_draw_index_t expected[] = { 8, 9, 10, 10, 9, 11 };
+  for (int i = 0; i < 6; i++)
+    assert_int_equal (indices[12 + i], expected[i]);
+
+  /* invalidated segments are not drawn until recorded again */
+  canary_panel_invalidate_segment (panel, 7);
+  assert_int_not_equal (canary_panel_draw_segment (panel, 7), 0);
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 12);
+
+  canary_panel_delete (panel);
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+test_segment_order (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create (&ui_draw, alloc);
+  canary_panel_set_draw_list (panel, ui_draw);
+
+  /* two quads drawn a triangle at a time, alternating between them */
+  assert_int_equal (canary_panel_begin_segment (panel, 7), 0);
+  draw_quad (ui_draw, 0.0);
+  draw_quad (ui_draw, 1.0);
+
+  canary_draw_index_t *indices = canary_draw_list_index_buffer (ui_draw);
+  canary_draw_index_t interleaved[] = { 0, 1, 2, 4, 5, 6, 2, 1, 3, 6, 5, 7 };
+  for (int i = 0; i < 12; i++)
+    indices[i] = interleaved[i];
+
+  assert_int_equal (canary_panel_end_segment (panel), 0);
+
+  /* blending depends on the order, so replays keep it */
+  canary_draw_list_clear (ui_draw);
+  assert_int_equal (canary_panel_draw_segment (panel, 7), 0);
+
+  canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (ui_draw);
+  indices = canary_draw_list_index_buffer (ui_draw);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), 12);
+
+  for (int i = 0; i < 12; i++)
+    assert_true (vertices[indices[i]].position[0] == (i / 3) % 2);
+
+  canary_panel_delete (panel);
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+test_abandoned_segments (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+
+  canary_draw_list_t *ui_draws[2];
+  for (int i = 0; i < 2; i++)
+    canary_draw_list_create (&ui_draws[i], alloc);
+
+  /* swapping the draw list abandons the recording */
+  canary_panel_set_draw_list (panel, ui_draws[0]);
+  assert_int_equal (canary_panel_begin_segment (panel, 7), 0);
+  draw_quad (ui_draws[0], 0.0);
+  canary_panel_set_draw_list (panel, ui_draws[1]);
+  assert_int_not_equal (canary_panel_end_segment (panel), 0);
+  assert_int_not_equal (canary_panel_draw_segment (panel, 7), 0);
+
+  /* but setting the same one doesn't */
+  assert_int_equal (canary_panel_begin_segment (panel, 7), 0);
+  canary_panel_set_draw_list (panel, ui_draws[1]);
+  assert_int_equal (canary_panel_end_segment (panel), 0);
+
+  /* abandoned recordings can be started over */
+  assert_int_equal (canary_panel_begin_segment (panel, 8), 0);
+  canary_panel_abandon_segment (panel);
+  assert_int_not_equal (canary_panel_end_segment (panel), 0);
+  assert_int_equal (canary_panel_begin_segment (panel, 8), 0);
+  assert_int_equal (canary_panel_end_segment (panel), 0);
+
+  canary_panel_delete (panel);
+  for (int i = 0; i < 2; i++)
+    canary_draw_list_delete (ui_draws[i]);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_segments),
+    cmocka_unit_test (test_segment_order),
+    cmocka_unit_test (test_abandoned_segments),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
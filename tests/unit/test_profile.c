@@ -0,0 +1,67 @@
+/** @file test_profile.c
+ */
+
+#include <string.h> /* for memset */
+
+#include "profile.h"
+#include "test_common.h"
+
+static void
+test_record (void **state)
+{
+  canary_profile_stats_t stats;
+  memset (&stats, 0, sizeof (stats));
+
+  canary_profile_record (&stats, 500);
+  canary_profile_record (&stats, 1500);
+  canary_profile_record (&stats, 3000);
+  canary_profile_record (&stats, 3000);
+
+  assert_int_equal (stats.call_num, 4);
+  assert_int_equal (stats.total_ns, 8000);
+  assert_int_equal (stats.max_ns, 3000);
+
+  /* under 1 us, under 2 us, and under 4 us */
+  assert_int_equal (stats.histogram[0], 1);
+  assert_int_equal (stats.histogram[1], 1);
+  assert_int_equal (stats.histogram[2], 2);
+
+  /* anything too slow for the histogram lands in the last bucket */
+  canary_profile_record (&stats, UINT64_MAX / 2);
+  assert_int_equal (stats.histogram[CANARY_PROFILE_BUCKET_NUM - 1], 1);
+}
+
+static void
+test_record_draw (void **state)
+{
+  canary_profile_draw_stats_t stats;
+  memset (&stats, 0, sizeof (stats));
+
+  canary_profile_record_draw (&stats, 300, 450);
+  canary_profile_record_draw (&stats, 100, 150);
+
+  assert_int_equal (stats.vertex_num, 100);
+  assert_int_equal (stats.index_num, 150);
+  assert_int_equal (stats.peak_vertex_num, 300);
+  assert_int_equal (stats.peak_index_num, 450);
+}
+
+static void
+test_now (void **state)
+{
+  uint64_t before = canary_profile_now ();
+  uint64_t after = canary_profile_now ();
+  assert_true (after >= before);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_record),
+    cmocka_unit_test (test_record_draw),
+    cmocka_unit_test (test_now),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
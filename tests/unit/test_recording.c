@@ -0,0 +1,110 @@
+/** @file test_recording.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h> /* for mkstemp */
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h> /* for close, truncate, unlink */
+
+#include "recording.h"
+#include "script.h"
+#include "test_common.h"
+
+static void
+test_round_trip (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  char filename[] = "/tmp/canary-recording-XXXXXX";
+  int fd = mkstemp (filename);
+  assert_true (fd >= 0);
+  close (fd);
+
+  canary_recorder_t *recorder;
+  assert_true (mdo_result_success (
+      canary_recorder_create (&recorder, alloc, filename)));
+
+  canary_recording_event_t bind = { 0 };
+  bind.type = CANARY_RECORDING_BIND_PANEL;
+  bind.panel_key = 0x10000;
+  bind.color[3] = 1.0;
+  bind.size[0] = 2.0;
+  bind.size[1] = 0.5;
+  bind.pixel_scale = 400.0;
+
+  canary_recording_event_t input = { 0 };
+  input.type = CANARY_RECORDING_INPUT;
+  input.panel_key = 0x10000;
+  input.input_event = CANARY_DRAG;
+  input.coords[0] = -0.25;
+  input.coords[1] = 0.75;
+
+  canary_recording_event_t mode = { 0 };
+  mode.type = CANARY_RECORDING_SET_INPUT_MODE;
+  mode.input_mode = CANARY_INPUT_QUEUED;
+
+  canary_recording_event_t update = { 0 };
+  update.type = CANARY_RECORDING_UPDATE;
+  update.dt = 1.0 / 60.0;
+
+  canary_recording_event_t unbind = { 0 };
+  unbind.type = CANARY_RECORDING_UNBIND_PANEL;
+  unbind.panel_key = 0x10000;
+
+  const canary_recording_event_t *events[]
+      = { &bind, &mode, &input, &update, &unbind };
+
+  for (int i = 0; i < 5; i++)
+    assert_int_equal (canary_recorder_write (recorder, events[i]), 0);
+
+  canary_recorder_delete (recorder);
+
+  canary_recording_t *recording;
+  assert_true (mdo_result_success (
+      canary_recording_create (&recording, alloc, filename)));
+  assert_int_equal (canary_recording_get_event_num (recording), 5);
+
+  for (int i = 0; i < 5; i++)
+    {
+      canary_recording_event_t event;
+      assert_int_equal (canary_recording_get_event (recording, i, &event),
+                        0);
+      assert_memory_equal (&event, events[i], sizeof (event));
+    }
+
+  canary_recording_event_t event;
+  assert_int_not_equal (canary_recording_get_event (recording, 5, &event),
+                        0);
+
+  canary_recording_delete (recording);
+
+  /* a recording cut short keeps its whole events */
+  struct stat st;
+  assert_int_equal (stat (filename, &st), 0);
+  assert_int_equal (truncate (filename, st.st_size - 4), 0);
+
+  assert_true (mdo_result_success (
+      canary_recording_create (&recording, alloc, filename)));
+  assert_int_equal (canary_recording_get_event_num (recording), 4);
+  canary_recording_delete (recording);
+
+  /* but anything else is rejected */
+  assert_int_equal (truncate (filename, 4), 0);
+  assert_false (mdo_result_success (
+      canary_recording_create (&recording, alloc, filename)));
+  canary_recording_delete (recording);
+
+  unlink (filename);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_round_trip),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
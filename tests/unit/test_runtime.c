@@ -0,0 +1,127 @@
+/** @file test_runtime.c
+ */
+
+#include <string.h> /* for strlen */
+
+#include "panel.h"
+#include "runtime.h"
+#include "script.h"
+#include "test_common.h"
+
+/* with a limit of 4 pages */
+static const char *BOUNDED_MODULE
+    = "(module (memory (export \"memory\") 1 4))";
+
+static const char *UNBOUNDED_MODULES[] = {
+  "(module (memory (export \"memory\") 1))",
+  "(module (memory (export \"memory\") 1 8))",
+  "(module (memory 1))",
+  "(module (memory 1 8))",
+  "(module (import \"env\" \"memory\" (memory 1)))",
+  "(module (import \"env\" \"memory\" (memory 1 8)))",
+};
+
+/* sets the panel's size to the results of growing memory to the limit,
+ * then one page past it */
+static const char *GROW_MODULE
+    = "(module"
+      "  (import \"\" \"UiPanel_setSize\""
+      "    (func $setSize (param i32 f32 f32)))"
+      "  (memory (export \"memory\") 1 4)"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (call $setSize (local.get $panel)"
+      "      (f32.convert_i32_s (memory.grow (i32.const 3)))"
+      "      (f32.convert_i32_s (memory.grow (i32.const 1))))"
+      "    (local.get $panel)))";
+
+static mdo_result_t
+load_wat (canary_script_t *script, const char *wat)
+{
+  wasm_byte_vec_t wasm;
+  assert_null (wasmtime_wat2wasm (wat, strlen (wat), &wasm));
+
+  mdo_result_t result = canary_script_load_buffer (
+      script, (const uint8_t *)wasm.data, wasm.size);
+
+  wasm_byte_vec_delete (&wasm);
+  return result;
+}
+
+static void
+test_max_scripts (void **state)
+{
+  const canary_runtime_config_t config = { 2, 0 };
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create_with_config (
+      &runtime, mdo_default_allocator (), &config)));
+
+  canary_script_t *scripts[3];
+  for (int i = 0; i < 3; i++)
+    assert_int_equal (
+        mdo_result_success (canary_script_create (&scripts[i], runtime)),
+        i < 2);
+
+  canary_script_delete (scripts[2]);
+
+  /* deleting a script makes room for another */
+  canary_script_delete (scripts[0]);
+  assert_true (
+      mdo_result_success (canary_script_create (&scripts[0], runtime)));
+
+  canary_script_delete (scripts[0]);
+  canary_script_delete (scripts[1]);
+  canary_runtime_delete (runtime);
+}
+
+static void
+test_max_memory_pages (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+  const canary_runtime_config_t config = { 0, 4 };
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (
+      canary_runtime_create_with_config (&runtime, alloc, &config)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+
+  assert_true (mdo_result_success (load_wat (script, BOUNDED_MODULE)));
+
+  /* memories without a maximum, or one over the limit, could grow past it */
+  size_t module_num
+      = sizeof (UNBOUNDED_MODULES) / sizeof (UNBOUNDED_MODULES[0]);
+  for (size_t i = 0; i < module_num; i++)
+    assert_false (
+        mdo_result_success (load_wat (script, UNBOUNDED_MODULES[i])));
+
+  assert_true (mdo_result_success (load_wat (script, GROW_MODULE)));
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+
+  canary_panel_key_t panel_key;
+  assert_int_equal (canary_script_bind_panel (script, panel, &panel_key), 0);
+
+  /* growing to the limit returns the old size, and past it fails */
+  float size[2];
+  canary_panel_get_size (panel, size);
+  assert_true (size[0] == 1.0);
+  assert_true (size[1] == -1.0);
+
+  canary_script_delete (script);
+  canary_panel_delete (panel);
+  canary_runtime_delete (runtime);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_max_scripts),
+    cmocka_unit_test (test_max_memory_pages),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
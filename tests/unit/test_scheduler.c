@@ -0,0 +1,157 @@
+/** @file test_scheduler.c
+ */
+
+#include <string.h> /* for strlen */
+
+#include "draw_list.h"
+#include "panel.h"
+#include "runtime.h"
+#include "scheduler.h"
+#include "script.h"
+#include "test_common.h"
+
+#define THREAD_NUM 4
+#define SCRIPT_NUM 16
+#define FRAME_NUM 8
+#define RECT_NUM 64
+
+/* the last script traps every update */
+#define TRAPPED_SCRIPT (SCRIPT_NUM - 1)
+
+/* counts its updates in the panel's width, and draws RECT_NUM rects each */
+static const char *DRAW_MODULE
+    = "(module"
+      "  (import \"\" \"UiPanel_setSize\""
+      "    (func $setSize (param i32 f32 f32)))"
+      "  (import \"\" \"UiPanel_drawRect\""
+      "    (func $rect (param i32 f32 f32 f32 f32 f32 f32 f32 f32)))"
+      "  (memory (export \"memory\") 1)"
+      "  (global $panel (mut i32) (i32.const 0))"
+      "  (global $frame (mut i32) (i32.const 0))"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (global.set $panel (local.get $panel))"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32)"
+      "    (local $i i32)"
+      "    (global.set $frame (i32.add (global.get $frame) (i32.const 1)))"
+      "    (call $setSize (global.get $panel)"
+      "      (f32.convert_i32_u (global.get $frame)) (f32.const 0))"
+      "    (loop $draw"
+      "      (call $rect (global.get $panel)"
+      "        (f32.convert_i32_u (local.get $i)) (f32.const 0)"
+      "        (f32.const 1) (f32.const 1)"
+      "        (f32.const 1) (f32.const 1) (f32.const 1) (f32.const 1))"
+      "      (br_if $draw (i32.lt_u"
+      "        (local.tee $i (i32.add (local.get $i) (i32.const 1)))"
+      "        (i32.const 64)))))";
+
+static const char *TRAP_MODULE
+    = "(module"
+      "  (memory (export \"memory\") 1)"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32) unreachable))";
+
+static mdo_result_t
+load_wat (canary_script_t *script, const char *wat)
+{
+  wasm_byte_vec_t wasm;
+  assert_null (wasmtime_wat2wasm (wat, strlen (wat), &wasm));
+
+  mdo_result_t result = canary_script_load_buffer (
+      script, (const uint8_t *)wasm.data, wasm.size);
+
+  wasm_byte_vec_delete (&wasm);
+  return result;
+}
+
+static void
+test_update (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create (&runtime, alloc)));
+
+  canary_scheduler_t *scheduler;
+  assert_true (mdo_result_success (
+      canary_scheduler_create (&scheduler, alloc, THREAD_NUM)));
+
+  canary_script_t *scripts[SCRIPT_NUM];
+  canary_panel_t *panels[SCRIPT_NUM];
+  canary_draw_list_t *draw_lists[SCRIPT_NUM];
+
+  for (int i = 0; i < SCRIPT_NUM; i++)
+    {
+      const char *wat = i == TRAPPED_SCRIPT ? TRAP_MODULE : DRAW_MODULE;
+
+      assert_true (
+          mdo_result_success (canary_script_create (&scripts[i], runtime)));
+      assert_true (mdo_result_success (load_wat (scripts[i], wat)));
+
+      canary_draw_list_create (&draw_lists[i], alloc);
+      canary_panel_create (&panels[i], alloc);
+      canary_panel_set_draw_list (panels[i], draw_lists[i]);
+
+      canary_panel_key_t panel_key;
+      assert_int_equal (
+          canary_script_bind_panel (scripts[i], panels[i], &panel_key), 0);
+    }
+
+  for (int frame = 1; frame <= FRAME_NUM; frame++)
+    {
+      canary_script_status_t statuses[SCRIPT_NUM];
+      for (int i = 0; i < SCRIPT_NUM; i++)
+        {
+          canary_draw_list_clear (draw_lists[i]);
+          statuses[i] = CANARY_SCRIPT_OK;
+        }
+
+      canary_scheduler_update (scheduler, scripts, SCRIPT_NUM, 0.0,
+                               statuses);
+
+      for (int i = 0; i < SCRIPT_NUM; i++)
+        {
+          if (i == TRAPPED_SCRIPT)
+            {
+              assert_int_equal (statuses[i], CANARY_SCRIPT_TRAPPED);
+              continue;
+            }
+
+          assert_int_equal (statuses[i], CANARY_SCRIPT_OK);
+
+          /* an update run twice, or not at all, miscounts the frames */
+          float size[2];
+          canary_panel_get_size (panels[i], size);
+          assert_true (size[0] == (float)frame);
+
+          assert_int_equal (canary_draw_list_vertex_count (draw_lists[i]),
+                            RECT_NUM * 4);
+          assert_int_equal (canary_draw_list_index_count (draw_lists[i]),
+                            RECT_NUM * 6);
+        }
+    }
+
+  /* statuses may be left out */
+  canary_scheduler_update (scheduler, scripts, SCRIPT_NUM, 0.0, NULL);
+
+  for (int i = 0; i < SCRIPT_NUM; i++)
+    {
+      canary_script_delete (scripts[i]);
+      canary_panel_delete (panels[i]);
+      canary_draw_list_delete (draw_lists[i]);
+    }
+
+  canary_scheduler_delete (scheduler);
+  canary_runtime_delete (runtime);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_update),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,787 @@
+/** @file test_script.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>  /* for snprintf */
+#include <stdlib.h> /* for mkstemp */
+#include <string.h> /* for strlen */
+#include <time.h>   /* for nanosleep */
+#include <unistd.h> /* for write, close, unlink */
+
+#include "draw_list.h"
+#include "hit_grid.h"
+#include "panel.h"
+#include "runtime.h"
+#include "script.h"
+#include "test_common.h"
+
+/* enough polylines that on_select outlasts the budget in the host, where
+ * the interrupt can't trap it, and returns normally */
+#define POLYLINE_NUM 64
+
+static const char *SLOW_MODULE_HEAD
+    = "(module"
+      "  (import \"\" \"UiPanel_drawPolyline\""
+      "    (func $polyline (param i32 i32 i32 f32 i32 f32 f32 f32 f32)))"
+      "  (memory (export \"memory\") 1)"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (local $i i32)"
+      "    (loop $fill"
+      "      (f32.store (i32.shl (local.get $i) (i32.const 3))"
+      "        (f32.convert_i32_u (local.get $i)))"
+      "      (f32.store offset=4 (i32.shl (local.get $i) (i32.const 3))"
+      "        (f32.convert_i32_u (i32.and (local.get $i) (i32.const 1))))"
+      "      (br_if $fill (i32.lt_u"
+      "        (local.tee $i (i32.add (local.get $i) (i32.const 1)))"
+      "        (i32.const 4096))))"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32))"
+      "  (func (export \"on_select\")"
+      "    (param $self i32) (param $x f32) (param $y f32)";
+
+static const char *SLOW_MODULE_CALL
+    = "    (call $polyline (local.get $self) (i32.const 0) (i32.const 4096)"
+      "      (f32.const 0.1) (i32.const 0) (f32.const 1) (f32.const 1)"
+      "      (f32.const 1) (f32.const 1))";
+
+/* begins a segment every update, but traps before ending the first */
+static const char *SEGMENT_MODULE
+    = "(module"
+      "  (import \"\" \"UiPanel_beginSegment\""
+      "    (func $begin (param i32 i32)))"
+      "  (import \"\" \"UiPanel_endSegment\" (func $end (param i32)))"
+      "  (memory (export \"memory\") 1)"
+      "  (global $panel (mut i32) (i32.const 0))"
+      "  (global $frame (mut i32) (i32.const 0))"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (global.set $panel (local.get $panel))"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32)"
+      "    (call $begin (global.get $panel) (i32.const 1))"
+      "    (global.set $frame (i32.add (global.get $frame) (i32.const 1)))"
+      "    (if (i32.eq (global.get $frame) (i32.const 1)) (then unreachable))"
+      "    (call $end (global.get $panel))))";
+
+/* records segment 1 every update */
+static const char *RECORD_MODULE
+    = "(module"
+      "  (import \"\" \"UiPanel_beginSegment\""
+      "    (func $begin (param i32 i32)))"
+      "  (import \"\" \"UiPanel_endSegment\" (func $end (param i32)))"
+      "  (memory (export \"memory\") 1)"
+      "  (global $panel (mut i32) (i32.const 0))"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (global.set $panel (local.get $panel))"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32)"
+      "    (call $begin (global.get $panel) (i32.const 1))"
+      "    (call $end (global.get $panel))))";
+
+/* sets the panel's size to the update's dt */
+static const char *SIZE_MODULE
+    = "(module"
+      "  (import \"\" \"UiPanel_setSize\""
+      "    (func $setSize (param i32 f32 f32)))"
+      "  (memory (export \"memory\") 1)"
+      "  (global $panel (mut i32) (i32.const 0))"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (global.set $panel (local.get $panel))"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32)"
+      "    (call $setSize (global.get $panel) (local.get $dt)"
+      "      (local.get $dt))))";
+
+/* logs each input callback as a rect at its coordinates, colored by which
+ * callback ran and for which panel */
+static const char *INPUT_MODULE
+    = "(module"
+      "  (import \"\" \"UiPanel_drawRect\""
+      "    (func $rect (param i32 f32 f32 f32 f32 f32 f32 f32 f32)))"
+      "  (memory (export \"memory\") 1)"
+      "  (func $log (param $code f32) (param $self i32)"
+      "    (param $x f32) (param $y f32)"
+      "    (call $rect (local.get $self) (local.get $x) (local.get $y)"
+      "      (f32.const 1) (f32.const 1) (local.get $code)"
+      "      (f32.convert_i32_u (local.get $self)) (f32.const 0)"
+      "      (f32.const 1)))"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32))"
+      "  (func (export \"on_hover\")"
+      "    (param $self i32) (param $x f32) (param $y f32)"
+      "    (call $log (f32.const 1) (local.get $self) (local.get $x)"
+      "      (local.get $y)))"
+      "  (func (export \"on_select\")"
+      "    (param $self i32) (param $x f32) (param $y f32)"
+      "    (call $log (f32.const 2) (local.get $self) (local.get $x)"
+      "      (local.get $y)))"
+      "  (func (export \"on_drag\")"
+      "    (param $self i32) (param $x f32) (param $y f32)"
+      "    (call $log (f32.const 3) (local.get $self) (local.get $x)"
+      "      (local.get $y))))";
+
+/* logs hit region callbacks like INPUT_MODULE, with the region's id in the
+ * blue channel, and clears the panel's hit regions on select */
+static const char *HOVER_MODULE
+    = "(module"
+      "  (import \"\" \"UiPanel_drawRect\""
+      "    (func $rect (param i32 f32 f32 f32 f32 f32 f32 f32 f32)))"
+      "  (import \"\" \"UiPanel_clearHitRegions\""
+      "    (func $clear (param i32)))"
+      "  (memory (export \"memory\") 1)"
+      "  (func $log (param $code f32) (param $self i32) (param $id i32)"
+      "    (param $x f32) (param $y f32)"
+      "    (call $rect (local.get $self) (local.get $x) (local.get $y)"
+      "      (f32.const 1) (f32.const 1) (local.get $code)"
+      "      (f32.convert_i32_u (local.get $self))"
+      "      (f32.convert_i32_u (local.get $id)) (f32.const 1)))"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32))"
+      "  (func (export \"on_hover\")"
+      "    (param $self i32) (param $x f32) (param $y f32)"
+      "    (call $log (f32.const 1) (local.get $self) (i32.const 0)"
+      "      (local.get $x) (local.get $y)))"
+      "  (func (export \"on_select\")"
+      "    (param $self i32) (param $x f32) (param $y f32)"
+      "    (call $clear (local.get $self))"
+      "    (call $log (f32.const 2) (local.get $self) (i32.const 0)"
+      "      (local.get $x) (local.get $y)))"
+      "  (func (export \"on_enter\") (param $self i32) (param $id i32)"
+      "    (call $log (f32.const 4) (local.get $self) (local.get $id)"
+      "      (f32.const 0) (f32.const 0)))"
+      "  (func (export \"on_leave\") (param $self i32) (param $id i32)"
+      "    (call $log (f32.const 5) (local.get $self) (local.get $id)"
+      "      (f32.const 0) (f32.const 0)))"
+      "  (func (export \"on_region_hover\")"
+      "    (param $self i32) (param $id i32) (param $x f32) (param $y f32)"
+      "    (call $log (f32.const 6) (local.get $self) (local.get $id)"
+      "      (local.get $x) (local.get $y))))";
+
+#define LOG_HOVER 1
+#define LOG_SELECT 2
+#define LOG_DRAG 3
+#define LOG_ENTER 4
+#define LOG_LEAVE 5
+#define LOG_REGION_HOVER 6
+
+static const char *EMPTY_MODULE
+    = "(module"
+      "  (memory (export \"memory\") 1)"
+      "  (func (export \"bind_panel\") (param $panel i32) (result i32)"
+      "    (local.get $panel))"
+      "  (func (export \"update\") (param $dt f32)))";
+
+static mdo_result_t
+load_wat (canary_script_t *script, const char *wat)
+{
+  wasm_byte_vec_t wasm;
+  assert_null (wasmtime_wat2wasm (wat, strlen (wat), &wasm));
+
+  mdo_result_t result = canary_script_load_buffer (
+      script, (const uint8_t *)wasm.data, wasm.size);
+
+  wasm_byte_vec_delete (&wasm);
+  return result;
+}
+
+/* on_select ends with the given instructions */
+static const char *
+build_slow_module (const char *tail)
+{
+  static char wat[16384];
+  size_t wat_size = snprintf (wat, sizeof (wat), "%s", SLOW_MODULE_HEAD);
+  for (int i = 0; i < POLYLINE_NUM; i++)
+    wat_size += snprintf (wat + wat_size, sizeof (wat) - wat_size, "%s",
+                          SLOW_MODULE_CALL);
+  wat_size
+      += snprintf (wat + wat_size, sizeof (wat) - wat_size, "%s))", tail);
+  assert_true (wat_size < sizeof (wat));
+
+  return wat;
+}
+
+/* fills in the template's XXXXXX */
+static void
+write_temp_file (char *filename, const void *data, size_t size)
+{
+  int fd = mkstemp (filename);
+  assert_true (fd >= 0);
+  assert_int_equal (write (fd, data, size), size);
+  close (fd);
+}
+
+/* checks the nth callback logged by a module like INPUT_MODULE */
+static void
+assert_logged (canary_draw_list_t *draw_list, size_t index, int code,
+               canary_panel_key_t panel_key, float x, float y)
+{
+  assert_true (canary_draw_list_vertex_count (draw_list) > index * 4);
+
+  const canary_draw_vertex_t *vertex
+      = &canary_draw_list_vertex_buffer (draw_list)[index * 4];
+  assert_true (vertex->color[0] == code);
+  assert_true (vertex->color[1] == panel_key);
+  assert_true (vertex->position[0] == x);
+  assert_true (vertex->position[1] == y);
+}
+
+/* the region id logged by a module like HOVER_MODULE */
+static uint32_t
+logged_region (canary_draw_list_t *draw_list, size_t index)
+{
+  return canary_draw_list_vertex_buffer (draw_list)[index * 4].color[2];
+}
+
+static void
+test_budget_between_callbacks (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+  const char *wat = build_slow_module ("");
+
+  const canary_runtime_config_t config = { 0, 0, true };
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (
+      canary_runtime_create_with_config (&runtime, alloc, &config)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+  assert_true (mdo_result_success (load_wat (script, wat)));
+
+  canary_draw_list_t *draw_list;
+  canary_draw_list_create (&draw_list, alloc);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_draw_list (panel, draw_list);
+
+  canary_panel_key_t panel_key;
+  assert_int_equal (canary_script_bind_panel (script, panel, &panel_key), 0);
+
+  /* the update runs on_select, which returns after the budget is spent,
+   * and is preempted before update itself */
+  const float coords[2] = { 0.0, 0.0 };
+  canary_script_set_input_mode (script, CANARY_INPUT_QUEUED);
+  canary_script_on_input (script, panel_key, CANARY_SELECT, coords);
+
+  canary_script_set_budget (script, 0.0005);
+  assert_int_equal (canary_script_update (script, 0.0),
+                    CANARY_SCRIPT_PREEMPTED);
+  assert_int_equal (canary_script_get_overruns (script), 1);
+
+  /* no trap consumed the interrupt, but the next call isn't hit by it */
+  canary_script_set_budget (script, 0.0);
+  assert_int_equal (canary_script_update (script, 0.0), CANARY_SCRIPT_OK);
+  assert_int_equal (canary_script_get_consecutive_overruns (script), 0);
+
+  canary_script_delete (script);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (draw_list);
+  canary_runtime_delete (runtime);
+}
+
+static void
+test_trap_after_budget (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+  const char *wat = build_slow_module ("unreachable");
+
+  const canary_runtime_config_t config = { 0, 0, true };
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (
+      canary_runtime_create_with_config (&runtime, alloc, &config)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+  assert_true (mdo_result_success (load_wat (script, wat)));
+
+  canary_draw_list_t *draw_list;
+  canary_draw_list_create (&draw_list, alloc);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_draw_list (panel, draw_list);
+
+  canary_panel_key_t panel_key;
+  assert_int_equal (canary_script_bind_panel (script, panel, &panel_key), 0);
+
+  /* the budget runs out in the host, and the unreachable after it is a
+   * real trap rather than the interrupt */
+  const float coords[2] = { 0.0, 0.0 };
+  canary_script_set_budget (script, 0.0005);
+  assert_int_equal (
+      canary_script_on_input (script, panel_key, CANARY_SELECT, coords),
+      CANARY_SCRIPT_TRAPPED);
+  assert_int_equal (canary_script_get_overruns (script), 0);
+
+  /* the interrupt it didn't consume doesn't hit the next call */
+  canary_script_set_budget (script, 0.0);
+  assert_int_equal (canary_script_update (script, 0.0), CANARY_SCRIPT_OK);
+
+  canary_script_delete (script);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (draw_list);
+  canary_runtime_delete (runtime);
+}
+
+static void
+test_trap_abandons_segment (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create (&runtime, alloc)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+  assert_true (mdo_result_success (load_wat (script, SEGMENT_MODULE)));
+
+  canary_draw_list_t *draw_list;
+  canary_draw_list_create (&draw_list, alloc);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_draw_list (panel, draw_list);
+
+  canary_panel_key_t panel_key;
+  assert_int_equal (canary_script_bind_panel (script, panel, &panel_key), 0);
+
+  assert_int_equal (canary_script_update (script, 0.0),
+                    CANARY_SCRIPT_TRAPPED);
+
+  /* the segment left open by the trap doesn't stop it from beginning
+   * again */
+  assert_int_equal (canary_script_update (script, 0.0), CANARY_SCRIPT_OK);
+  assert_int_equal (canary_panel_draw_segment (panel, 1), 0);
+
+  canary_script_delete (script);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (draw_list);
+  canary_runtime_delete (runtime);
+}
+
+static void
+test_reload_invalidates_segments (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  wasm_byte_vec_t wasm;
+  assert_null (
+      wasmtime_wat2wasm (EMPTY_MODULE, strlen (EMPTY_MODULE), &wasm));
+
+  char filename[] = "/tmp/canary-reload-XXXXXX";
+  write_temp_file (filename, wasm.data, wasm.size);
+  wasm_byte_vec_delete (&wasm);
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create (&runtime, alloc)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+  assert_true (mdo_result_success (load_wat (script, RECORD_MODULE)));
+
+  canary_draw_list_t *draw_list;
+  canary_draw_list_create (&draw_list, alloc);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_draw_list (panel, draw_list);
+
+  canary_panel_key_t panel_key;
+  assert_int_equal (canary_script_bind_panel (script, panel, &panel_key), 0);
+
+  assert_int_equal (canary_script_update (script, 0.0), CANARY_SCRIPT_OK);
+  assert_int_equal (canary_panel_draw_segment (panel, 1), 0);
+
+  /* the new instance doesn't get the old one's segments */
+  assert_true (mdo_result_success (canary_script_reload (script, filename)));
+  const struct timespec frame = { 0, 1000000 };
+  while (canary_script_reload_pending (script))
+    {
+      nanosleep (&frame, NULL);
+      assert_int_equal (canary_script_update (script, 0.0),
+                        CANARY_SCRIPT_OK);
+    }
+
+  assert_int_not_equal (canary_panel_draw_segment (panel, 1), 0);
+
+  canary_script_delete (script);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (draw_list);
+  canary_runtime_delete (runtime);
+  unlink (filename);
+}
+
+/* keys hold a 16-bit generation above a 16-bit slot index */
+#define KEY_GENERATION(panel_key) ((panel_key) >> 16)
+#define KEY_INDEX(panel_key) ((panel_key) & 0xffff)
+
+static void
+test_panel_keys (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create (&runtime, alloc)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+  assert_true (mdo_result_success (load_wat (script, EMPTY_MODULE)));
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+
+  canary_panel_key_t first_key;
+  assert_int_equal (canary_script_bind_panel (script, panel, &first_key), 0);
+  assert_ptr_equal (canary_script_lookup_panel (script, first_key), panel);
+
+  /* keys to slots that were never bound are rejected */
+  assert_null (canary_script_lookup_panel (script, first_key + 1));
+
+  canary_script_unbind_panel (script, first_key);
+  assert_null (canary_script_lookup_panel (script, first_key));
+
+  /* the slot is reused under a new generation, so the old key stays
+   * unbound */
+  canary_panel_key_t panel_key;
+  assert_int_equal (canary_script_bind_panel (script, panel, &panel_key), 0);
+  assert_int_equal (KEY_INDEX (panel_key), KEY_INDEX (first_key));
+  assert_int_not_equal (panel_key, first_key);
+  assert_null (canary_script_lookup_panel (script, first_key));
+  assert_ptr_equal (canary_script_lookup_panel (script, panel_key), panel);
+
+  /* the generation wraps around to the first key's, skipping zero */
+  for (uint32_t i = 2; i <= 0xffff; i++)
+    {
+      assert_int_not_equal (KEY_GENERATION (panel_key), 0);
+      canary_script_unbind_panel (script, panel_key);
+      assert_int_equal (canary_script_bind_panel (script, panel, &panel_key),
+                        0);
+    }
+
+  assert_int_equal (panel_key, first_key);
+  assert_ptr_equal (canary_script_lookup_panel (script, panel_key), panel);
+
+  canary_script_delete (script);
+  canary_panel_delete (panel);
+  canary_runtime_delete (runtime);
+}
+
+static void
+test_panel_slot_max (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create (&runtime, alloc)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+  assert_true (mdo_result_success (load_wat (script, EMPTY_MODULE)));
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+
+  /* every slot index fits in a key */
+  canary_panel_key_t panel_key;
+  for (uint32_t i = 0; i <= 0xffff; i++)
+    {
+      assert_int_equal (canary_script_bind_panel (script, panel, &panel_key),
+                        0);
+      assert_int_equal (KEY_INDEX (panel_key), i);
+    }
+
+  canary_panel_key_t last_key = panel_key;
+  assert_int_not_equal (canary_script_bind_panel (script, panel, &panel_key),
+                        0);
+
+  /* until one is freed */
+  canary_script_unbind_panel (script, last_key);
+  assert_int_equal (canary_script_bind_panel (script, panel, &panel_key), 0);
+  assert_int_equal (KEY_INDEX (panel_key), KEY_INDEX (last_key));
+
+  canary_script_delete (script);
+  canary_panel_delete (panel);
+  canary_runtime_delete (runtime);
+}
+
+static void
+test_load_files (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create (&runtime, alloc)));
+
+  wasm_byte_vec_t wasm;
+  assert_null (wasmtime_wat2wasm (SIZE_MODULE, strlen (SIZE_MODULE), &wasm));
+
+  /* precompiled with the runtime's own engine, so that it matches */
+  wasmtime_module_t *module;
+  assert_null (wasmtime_module_new (canary_runtime_get_engine (runtime),
+                                    (const uint8_t *)wasm.data, wasm.size,
+                                    &module));
+
+  wasm_byte_vec_t serialized;
+  assert_null (wasmtime_module_serialize (module, &serialized));
+  wasmtime_module_delete (module);
+
+  char wasm_filename[] = "/tmp/canary-wasm-XXXXXX";
+  write_temp_file (wasm_filename, wasm.data, wasm.size);
+  wasm_byte_vec_delete (&wasm);
+
+  char precompiled_filename[] = "/tmp/canary-precompiled-XXXXXX";
+  write_temp_file (precompiled_filename, serialized.data, serialized.size);
+  wasm_byte_vec_delete (&serialized);
+
+  char empty_filename[] = "/tmp/canary-empty-XXXXXX";
+  write_temp_file (empty_filename, NULL, 0);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+
+  const char *filenames[] = { wasm_filename, precompiled_filename };
+  for (int i = 0; i < 2; i++)
+    {
+      canary_script_t *script;
+      assert_true (
+          mdo_result_success (canary_script_create (&script, runtime)));
+
+      /* missing and empty files fail without loading anything */
+      assert_false (mdo_result_success (
+          canary_script_load (script, "/tmp/canary-missing.wasm")));
+      assert_false (mdo_result_success (
+          canary_script_load_precompiled (script, empty_filename)));
+      assert_false (mdo_result_success (
+          canary_script_load (script, empty_filename)));
+
+      mdo_result_t result
+          = i ? canary_script_load_precompiled (script, filenames[i])
+              : canary_script_load (script, filenames[i]);
+      assert_true (mdo_result_success (result));
+
+      canary_panel_key_t panel_key;
+      assert_int_equal (canary_script_bind_panel (script, panel, &panel_key),
+                        0);
+      assert_int_equal (canary_script_update (script, 0.5),
+                        CANARY_SCRIPT_OK);
+
+      float size[2];
+      canary_panel_get_size (panel, size);
+      assert_true (size[0] == 0.5f);
+      assert_true (size[1] == 0.5f);
+
+      const float zero_size[2] = { 0.0, 0.0 };
+      canary_panel_set_size (panel, zero_size);
+      canary_script_delete (script);
+    }
+
+  canary_panel_delete (panel);
+  canary_runtime_delete (runtime);
+  unlink (wasm_filename);
+  unlink (precompiled_filename);
+  unlink (empty_filename);
+}
+
+static void
+test_queued_input (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create (&runtime, alloc)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+  assert_true (mdo_result_success (load_wat (script, INPUT_MODULE)));
+
+  /* the panels share a draw list, so it logs callbacks in order */
+  canary_draw_list_t *draw_list;
+  canary_draw_list_create (&draw_list, alloc);
+
+  canary_panel_t *panels[3];
+  canary_panel_key_t keys[3];
+  for (int i = 0; i < 3; i++)
+    {
+      canary_panel_create (&panels[i], alloc);
+      canary_panel_set_draw_list (panels[i], draw_list);
+      assert_int_equal (canary_script_bind_panel (script, panels[i], &keys[i]),
+                        0);
+    }
+
+  canary_script_set_input_mode (script, CANARY_INPUT_QUEUED);
+
+  static const struct
+  {
+    int panel;
+    canary_input_event_t event;
+    float coords[2];
+  } EVENTS[] = {
+    /* consecutive moves on one panel collapse into the last */
+    { 0, CANARY_HOVER, { 1.0, 1.0 } },
+    { 0, CANARY_HOVER, { 2.0, 2.0 } },
+    { 0, CANARY_HOVER, { 3.0, 3.0 } },
+
+    /* but not across panels, or once interleaved */
+    { 1, CANARY_HOVER, { 4.0, 4.0 } },
+    { 0, CANARY_HOVER, { 5.0, 5.0 } },
+    { 0, CANARY_DRAG, { 6.0, 6.0 } },
+    { 0, CANARY_DRAG, { 7.0, 7.0 } },
+
+    /* and never for selects */
+    { 0, CANARY_SELECT, { 8.0, 8.0 } },
+    { 0, CANARY_SELECT, { 9.0, 9.0 } },
+
+    /* for a panel unbound before the flush */
+    { 2, CANARY_HOVER, { 10.0, 10.0 } },
+  };
+
+  size_t event_num = sizeof (EVENTS) / sizeof (EVENTS[0]);
+  for (size_t i = 0; i < event_num; i++)
+    assert_int_equal (canary_script_on_input (script, keys[EVENTS[i].panel],
+                                              EVENTS[i].event,
+                                              EVENTS[i].coords),
+                      CANARY_SCRIPT_OK);
+
+  assert_int_equal (canary_script_get_coalesced_input (script), 3);
+  assert_int_equal (canary_draw_list_vertex_count (draw_list), 0);
+
+  canary_script_unbind_panel (script, keys[2]);
+  assert_int_equal (canary_script_flush_input (script), CANARY_SCRIPT_OK);
+
+  assert_int_equal (canary_draw_list_vertex_count (draw_list), 6 * 4);
+  assert_logged (draw_list, 0, LOG_HOVER, keys[0], 3.0, 3.0);
+  assert_logged (draw_list, 1, LOG_HOVER, keys[1], 4.0, 4.0);
+  assert_logged (draw_list, 2, LOG_HOVER, keys[0], 5.0, 5.0);
+  assert_logged (draw_list, 3, LOG_DRAG, keys[0], 7.0, 7.0);
+  assert_logged (draw_list, 4, LOG_SELECT, keys[0], 8.0, 8.0);
+  assert_logged (draw_list, 5, LOG_SELECT, keys[0], 9.0, 9.0);
+
+  /* a lone move isn't coalesced, and the update flushes it */
+  canary_draw_list_clear (draw_list);
+  const float coords[2] = { 11.0, 11.0 };
+  canary_script_on_input (script, keys[0], CANARY_DRAG, coords);
+  assert_int_equal (canary_script_update (script, 0.0), CANARY_SCRIPT_OK);
+
+  assert_int_equal (canary_script_get_coalesced_input (script), 3);
+  assert_int_equal (canary_draw_list_vertex_count (draw_list), 4);
+  assert_logged (draw_list, 0, LOG_DRAG, keys[0], 11.0, 11.0);
+
+  canary_script_delete (script);
+  for (int i = 0; i < 3; i++)
+    canary_panel_delete (panels[i]);
+  canary_draw_list_delete (draw_list);
+  canary_runtime_delete (runtime);
+}
+
+static void
+test_hover_regions (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_runtime_t *runtime;
+  assert_true (mdo_result_success (canary_runtime_create (&runtime, alloc)));
+
+  canary_script_t *script;
+  assert_true (mdo_result_success (canary_script_create (&script, runtime)));
+  assert_true (mdo_result_success (load_wat (script, HOVER_MODULE)));
+
+  canary_draw_list_t *draw_list;
+  canary_draw_list_create (&draw_list, alloc);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_draw_list (panel, draw_list);
+
+  canary_panel_key_t key;
+  assert_int_equal (canary_script_bind_panel (script, panel, &key), 0);
+
+  const float size[2] = { 10.0, 10.0 };
+  const float left[2] = { 0.0, 0.0 };
+  const float right[2] = { 20.0, 0.0 };
+  canary_hit_grid_t *grid = canary_panel_get_hit_grid (panel);
+  canary_hit_grid_add_rect (grid, 7, left, size);
+  canary_hit_grid_add_rect (grid, 9, right, size);
+
+  static const float MOVES[][2] = {
+    /* idle, outside every region */
+    { 50.0, 50.0 },
+
+    /* into the left region, within it, across to the right, and out */
+    { 5.0, 5.0 },
+    { 6.0, 6.0 },
+    { 25.0, 5.0 },
+    { 50.0, 50.0 },
+
+    /* idle again, then back into the left region */
+    { 60.0, 60.0 },
+    { 5.0, 5.0 },
+  };
+
+  size_t move_num = sizeof (MOVES) / sizeof (MOVES[0]);
+  for (size_t i = 0; i < move_num; i++)
+    assert_int_equal (
+        canary_script_on_input (script, key, CANARY_HOVER, MOVES[i]),
+        CANARY_SCRIPT_OK);
+
+  /* idle motion never entered the script, not even on_hover */
+  assert_int_equal (canary_draw_list_vertex_count (draw_list), 9 * 4);
+  assert_logged (draw_list, 0, LOG_ENTER, key, 0.0, 0.0);
+  assert_int_equal (logged_region (draw_list, 0), 7);
+  assert_logged (draw_list, 1, LOG_REGION_HOVER, key, 5.0, 5.0);
+  assert_int_equal (logged_region (draw_list, 1), 7);
+  assert_logged (draw_list, 2, LOG_REGION_HOVER, key, 6.0, 6.0);
+  assert_int_equal (logged_region (draw_list, 2), 7);
+  assert_logged (draw_list, 3, LOG_LEAVE, key, 0.0, 0.0);
+  assert_int_equal (logged_region (draw_list, 3), 7);
+  assert_logged (draw_list, 4, LOG_ENTER, key, 0.0, 0.0);
+  assert_int_equal (logged_region (draw_list, 4), 9);
+  assert_logged (draw_list, 5, LOG_REGION_HOVER, key, 25.0, 5.0);
+  assert_int_equal (logged_region (draw_list, 5), 9);
+  assert_logged (draw_list, 6, LOG_LEAVE, key, 0.0, 0.0);
+  assert_int_equal (logged_region (draw_list, 6), 9);
+  assert_logged (draw_list, 7, LOG_ENTER, key, 0.0, 0.0);
+  assert_int_equal (logged_region (draw_list, 7), 7);
+  assert_logged (draw_list, 8, LOG_REGION_HOVER, key, 5.0, 5.0);
+
+  /* the script clears its regions while the pointer is in one, so the
+   * next hover still owes it a leave before falling back to on_hover */
+  canary_draw_list_clear (draw_list);
+  const float inside[2] = { 5.0, 5.0 };
+  canary_script_on_input (script, key, CANARY_SELECT, inside);
+  canary_script_on_input (script, key, CANARY_HOVER, inside);
+  canary_script_on_input (script, key, CANARY_HOVER, inside);
+
+  assert_int_equal (canary_draw_list_vertex_count (draw_list), 4 * 4);
+  assert_logged (draw_list, 0, LOG_SELECT, key, 5.0, 5.0);
+  assert_logged (draw_list, 1, LOG_LEAVE, key, 0.0, 0.0);
+  assert_int_equal (logged_region (draw_list, 1), 7);
+  assert_logged (draw_list, 2, LOG_HOVER, key, 5.0, 5.0);
+  assert_logged (draw_list, 3, LOG_HOVER, key, 5.0, 5.0);
+
+  canary_script_delete (script);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (draw_list);
+  canary_runtime_delete (runtime);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_budget_between_callbacks),
+    cmocka_unit_test (test_trap_after_budget),
+    cmocka_unit_test (test_trap_abandons_segment),
+    cmocka_unit_test (test_reload_invalidates_segments),
+    cmocka_unit_test (test_panel_keys),
+    cmocka_unit_test (test_panel_slot_max),
+    cmocka_unit_test (test_load_files),
+    cmocka_unit_test (test_queued_input),
+    cmocka_unit_test (test_hover_regions),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,386 @@
+/** @file test_shm_transport.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h> /* for fork, pipe */
+
+#include "shm_layout.h"
+#include "shm_reader.h"
+#include "shm_writer.h"
+#include "test_common.h"
+
+#define FRAME_NUM 2000
+#define CORRUPT_NUM 100000
+
+static const float WHITE[4] = { 1.0, 1.0, 1.0, 1.0 };
+
+/* a quad whose vertices all carry the frame's generation */
+static void
+draw_frame (canary_draw_list_t *ui_draw, uint64_t generation)
+{
+  canary_draw_list_clear (ui_draw);
+
+  canary_draw_vertex_t vertex = { { 0.0, 0.0 }, { 1.0, 1.0, 1.0, 1.0 } };
+  vertex.position[0] = generation;
+
+  for (int i = 0; i < 4; i++)
+    {
+      vertex.position[1] = i;
+      canary_draw_vertex (ui_draw, &vertex);
+    }
+
+  canary_draw_triangle (ui_draw, 0, 1, 2);
+  canary_draw_triangle (ui_draw, 2, 1, 3);
+}
+
+/* returns zero if the panel holds an intact frame from draw_frame */
+static int
+check_panel (const canary_shm_panel_t *panel, uint64_t generation)
+{
+  if (panel->format != CANARY_DRAW_FORMAT_FLOAT || panel->vertex_num != 4
+      || panel->index_size != sizeof (canary_draw_index_t)
+      || panel->index_num != 6)
+    return -1;
+
+  const canary_draw_vertex_t *vertices = panel->vertices;
+  const canary_draw_index_t *indices = panel->indices;
+
+  for (int i = 0; i < 4; i++)
+    {
+      if (vertices[i].position[0] != generation
+          || vertices[i].position[1] != i)
+        return -1;
+    }
+
+  if (indices[3] != 2 || indices[5] != 3)
+    return -1;
+
+  return 0;
+}
+
+static void
+test_frames (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_shm_writer_t *writer;
+  assert_true (mdo_result_success (
+      canary_shm_writer_create (&writer, alloc, 4096, 3)));
+
+  canary_shm_reader_t *reader;
+  assert_true (mdo_result_success (canary_shm_reader_create (
+      &reader, alloc, canary_shm_writer_get_fd (writer))));
+
+  canary_shm_frame_t frame;
+  assert_int_not_equal (canary_shm_reader_acquire (reader, &frame), 0);
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create (&ui_draw, alloc);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_color (panel, WHITE);
+  canary_panel_set_draw_list (panel, ui_draw);
+
+  draw_frame (ui_draw, 1);
+  canary_shm_writer_begin_frame (writer);
+  assert_int_equal (canary_shm_writer_write_panel (writer, 7, panel), 0);
+  assert_int_equal (canary_shm_writer_write_panel (writer, 8, panel), 0);
+  canary_shm_writer_end_frame (writer);
+
+  assert_int_equal (canary_shm_reader_acquire (reader, &frame), 0);
+  assert_int_equal (frame.generation, 1);
+  assert_int_equal (frame.panel_num, 2);
+
+  canary_shm_panel_t view;
+  assert_int_equal (canary_shm_reader_get_panel (reader, &frame, 1, &view),
+                    0);
+  assert_int_equal (view.id, 8);
+  assert_true (view.color[3] == 1.0f);
+  assert_int_equal (check_panel (&view, 1), 0);
+  assert_int_not_equal (
+      canary_shm_reader_get_panel (reader, &frame, 2, &view), 0);
+
+  /* the frame survives the writer starting on the next slot */
+  canary_shm_writer_begin_frame (writer);
+  canary_shm_writer_end_frame (writer);
+  assert_true (canary_shm_reader_release (reader, &frame));
+
+  /* but not the writer lapping the ring */
+  canary_shm_reader_acquire (reader, &frame);
+  for (int i = 0; i < 3; i++)
+    {
+      canary_shm_writer_begin_frame (writer);
+      canary_shm_writer_end_frame (writer);
+    }
+
+  assert_false (canary_shm_reader_release (reader, &frame));
+
+  /* panels that don't fit are left out */
+  for (int i = 0; i < 200; i++)
+    canary_draw_vertex (ui_draw, &(canary_draw_vertex_t){ 0 });
+
+  canary_shm_writer_begin_frame (writer);
+  assert_int_not_equal (canary_shm_writer_write_panel (writer, 9, panel), 0);
+  canary_shm_writer_end_frame (writer);
+
+  assert_int_equal (canary_shm_reader_acquire (reader, &frame), 0);
+  assert_int_equal (frame.panel_num, 0);
+
+  canary_shm_reader_delete (reader);
+  canary_shm_writer_delete (writer);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (ui_draw);
+}
+
+/* flips a record between its valid contents and ones that fail every
+ * check, field by field, until told to stop */
+typedef struct corrupt_args_s
+{
+  shm_panel_t *record;
+  shm_panel_t valid;
+  int stop;
+} corrupt_args_t;
+
+static void *
+corrupt_record (void *data)
+{
+  corrupt_args_t *args = data;
+  shm_panel_t *record = args->record;
+
+  for (uint64_t i = 0; !__atomic_load_n (&args->stop, __ATOMIC_RELAXED);
+       i++)
+    {
+      bool valid = i & 1;
+
+      __atomic_store_n (&record->format,
+                        valid ? args->valid.format : 0xffff,
+                        __ATOMIC_RELAXED);
+      __atomic_store_n (&record->index_size,
+                        valid ? args->valid.index_size : 3, __ATOMIC_RELAXED);
+      __atomic_store_n (&record->vertex_offset,
+                        valid ? args->valid.vertex_offset : 1ull << 40,
+                        __ATOMIC_RELAXED);
+      __atomic_store_n (&record->vertex_num,
+                        valid ? args->valid.vertex_num : 1ull << 40,
+                        __ATOMIC_RELAXED);
+      __atomic_store_n (&record->index_offset,
+                        valid ? args->valid.index_offset : 1ull << 40,
+                        __ATOMIC_RELAXED);
+      __atomic_store_n (&record->index_num,
+                        valid ? args->valid.index_num : 1ull << 40,
+                        __ATOMIC_RELAXED);
+    }
+
+  return NULL;
+}
+
+static void
+test_corrupt_record (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+  const size_t slot_size = 4096;
+
+  canary_shm_writer_t *writer;
+  assert_true (mdo_result_success (
+      canary_shm_writer_create (&writer, alloc, slot_size, 2)));
+
+  int fd = canary_shm_writer_get_fd (writer);
+
+  canary_shm_reader_t *reader;
+  assert_true (mdo_result_success (
+      canary_shm_reader_create (&reader, alloc, fd)));
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create (&ui_draw, alloc);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_draw_list (panel, ui_draw);
+
+  draw_frame (ui_draw, 1);
+  canary_shm_writer_begin_frame (writer);
+  assert_int_equal (canary_shm_writer_write_panel (writer, 1, panel), 0);
+  canary_shm_writer_end_frame (writer);
+
+  canary_shm_frame_t frame;
+  assert_int_equal (canary_shm_reader_acquire (reader, &frame), 0);
+
+  canary_shm_panel_t valid;
+  assert_int_equal (canary_shm_reader_get_panel (reader, &frame, 0, &valid),
+                    0);
+
+  /* a second, writable mapping stands in for a misbehaving writer */
+  size_t mapping_size
+      = SHM_SLOT_OFFSET (slot_size, frame.slot) + slot_size;
+  uint8_t *mapping
+      = mmap (NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  assert_true (mapping != MAP_FAILED);
+
+  corrupt_args_t args;
+  args.record = (shm_panel_t *)(mapping + mapping_size
+                                - sizeof (shm_panel_t));
+  args.valid = *args.record;
+  args.stop = 0;
+
+  pthread_t thread;
+  assert_int_equal (
+      pthread_create (&thread, NULL, corrupt_record, &args), 0);
+
+  /* whatever mix of fields is read, a view is either rejected or exactly
+   * the one that was validated */
+  for (int i = 0; i < CORRUPT_NUM; i++)
+    {
+      canary_shm_panel_t view;
+      if (canary_shm_reader_get_panel (reader, &frame, 0, &view))
+        continue;
+
+      assert_int_equal (view.format, valid.format);
+      assert_true (view.vertices == valid.vertices);
+      assert_int_equal (view.vertex_num, valid.vertex_num);
+      assert_int_equal (view.index_size, valid.index_size);
+      assert_true (view.indices == valid.indices);
+      assert_int_equal (view.index_num, valid.index_num);
+    }
+
+  __atomic_store_n (&args.stop, 1, __ATOMIC_RELAXED);
+  assert_int_equal (pthread_join (thread, NULL), 0);
+
+  /* left corrupt, the record is always rejected */
+  *args.record = args.valid;
+  args.record->index_size = 3;
+
+  canary_shm_panel_t view;
+  assert_int_not_equal (
+      canary_shm_reader_get_panel (reader, &frame, 0, &view), 0);
+
+  *args.record = args.valid;
+  args.record->vertex_offset = slot_size;
+  args.record->vertex_num = 1;
+  assert_int_not_equal (
+      canary_shm_reader_get_panel (reader, &frame, 0, &view), 0);
+
+  munmap (mapping, mapping_size);
+  canary_shm_reader_delete (reader);
+  canary_shm_writer_delete (writer);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (ui_draw);
+}
+
+/* runs in the child, without cmocka, which can't report across a fork */
+static int
+read_frames (int fd, int ready)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_shm_reader_t *reader;
+  if (!mdo_result_success (canary_shm_reader_create (&reader, alloc, fd)))
+    return 1;
+
+  char byte = 0;
+  if (write (ready, &byte, 1) != 1)
+    return 1;
+
+  uint64_t last = 0;
+  size_t intact = 0;
+
+  while (last < FRAME_NUM)
+    {
+      canary_shm_frame_t frame;
+      if (canary_shm_reader_acquire (reader, &frame))
+        continue;
+
+      if (frame.generation < last)
+        return 1;
+
+      last = frame.generation;
+
+      canary_shm_panel_t panel;
+      int invalid = frame.panel_num != 1
+                    || canary_shm_reader_get_panel (reader, &frame, 0, &panel)
+                    || check_panel (&panel, frame.generation);
+
+      /* a frame may only look wrong if it was overwritten */
+      if (!canary_shm_reader_release (reader, &frame))
+        continue;
+
+      if (invalid)
+        return 1;
+
+      intact++;
+    }
+
+  canary_shm_reader_delete (reader);
+  return intact > 0 ? 0 : 1;
+}
+
+static void
+test_processes (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  /* two slots, so that the reader is lapped as often as possible */
+  canary_shm_writer_t *writer;
+  assert_true (mdo_result_success (
+      canary_shm_writer_create (&writer, alloc, 1024, 2)));
+
+  int ready[2];
+  assert_int_equal (pipe (ready), 0);
+
+  pid_t child = fork ();
+  assert_true (child >= 0);
+
+  if (child == 0)
+    {
+      close (ready[0]);
+      _exit (read_frames (canary_shm_writer_get_fd (writer), ready[1]));
+    }
+
+  close (ready[1]);
+
+  char byte;
+  assert_int_equal (read (ready[0], &byte, 1), 1);
+  close (ready[0]);
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create (&ui_draw, alloc);
+
+  canary_panel_t *panel;
+  canary_panel_create (&panel, alloc);
+  canary_panel_set_color (panel, WHITE);
+  canary_panel_set_draw_list (panel, ui_draw);
+
+  for (uint64_t generation = 1; generation <= FRAME_NUM; generation++)
+    {
+      draw_frame (ui_draw, generation);
+
+      canary_shm_writer_begin_frame (writer);
+      assert_int_equal (canary_shm_writer_write_panel (writer, 1, panel), 0);
+      canary_shm_writer_end_frame (writer);
+    }
+
+  int status;
+  assert_int_equal (waitpid (child, &status, 0), child);
+  assert_true (WIFEXITED (status));
+  assert_int_equal (WEXITSTATUS (status), 0);
+
+  canary_shm_writer_delete (writer);
+  canary_panel_delete (panel);
+  canary_draw_list_delete (ui_draw);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_frames),
+    cmocka_unit_test (test_corrupt_record),
+    cmocka_unit_test (test_processes),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,163 @@
+/** @file test_soft_renderer.c
+ */
+
+#include "soft_renderer.h"
+#include "test_common.h"
+
+#define WIDTH 67
+#define HEIGHT 45
+
+static void
+draw_quad (canary_draw_list_t *ui_draw, float x0, float y0, float x1,
+           float y1, const float color[4])
+{
+  canary_draw_vertex_t vertex;
+  memcpy (vertex.color, color, sizeof (float) * 4);
+
+  canary_draw_index_t indices[4];
+  for (int i = 0; i < 4; i++)
+    {
+      vertex.position[0] = i & 1 ? x1 : x0;
+      vertex.position[1] = i & 2 ? y1 : y0;
+      indices[i] = canary_draw_vertex (ui_draw, &vertex);
+    }
+
+  canary_draw_triangle (ui_draw, indices[0], indices[1], indices[2]);
+  canary_draw_triangle (ui_draw, indices[2], indices[1], indices[3]);
+}
+
+static const uint8_t *
+get_pixel (soft_renderer_t *ren, int x, int y)
+{
+  return &soft_renderer_get_framebuffer (ren)[(y * WIDTH + x) * 4];
+}
+
+static void
+test_blend (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  mdo_result_t result = canary_draw_list_create (&ui_draw, alloc);
+  assert_true (mdo_result_success (result));
+
+  const float red[4] = { 1.0, 0.0, 0.0, 1.0 };
+  const float blue[4] = { 0.0, 0.0, 1.0, 0.5 };
+  draw_quad (ui_draw, -1.0, -1.0, 1.0, 1.0, red);
+  draw_quad (ui_draw, -1.0, -1.0, 0.0, 1.0, blue);
+
+  soft_renderer_t *ren;
+  assert_int_equal (soft_renderer_create (&ren, NULL, WIDTH, HEIGHT, 1), 0);
+  soft_renderer_render_draw_list (ren, ui_draw);
+
+  /* both quads share a diagonal; it must not be blended twice */
+  const uint8_t left[4] = { 128, 0, 128, 191 };
+  const uint8_t right[4] = { 255, 0, 0, 255 };
+
+  for (int y = 0; y < HEIGHT; y++)
+    for (int x = 0; x < WIDTH; x++)
+      {
+        /* the center line lands on x = 33.5, which belongs to the right */
+        const uint8_t *expected = x < WIDTH / 2 ? left : right;
+        assert_memory_equal (get_pixel (ren, x, y), expected, 4);
+      }
+
+  soft_renderer_delete (ren);
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+test_compact (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  mdo_result_t result = canary_draw_list_create_with_format (
+      &ui_draw, alloc, CANARY_DRAW_FORMAT_COMPACT);
+  assert_true (mdo_result_success (result));
+
+  const float red[4] = { 1.0, 0.0, 0.0, 1.0 };
+  const float blue[4] = { 0.0, 0.0, 1.0, 0.5 };
+  draw_quad (ui_draw, -1.0, -1.0, 1.0, 1.0, red);
+  draw_quad (ui_draw, -1.0, -1.0, 0.0, 1.0, blue);
+
+  soft_renderer_t *ren;
+  assert_int_equal (soft_renderer_create (&ren, NULL, WIDTH, HEIGHT, 1), 0);
+  soft_renderer_render_draw_list (ren, ui_draw);
+
+  /* same scene as test_blend, give or take the quantized alpha */
+  const uint8_t left[4] = { 128, 0, 128, 191 };
+  const uint8_t right[4] = { 255, 0, 0, 255 };
+
+  for (int y = 0; y < HEIGHT; y++)
+    for (int x = 0; x < WIDTH; x++)
+      {
+        const uint8_t *expected = x < WIDTH / 2 ? left : right;
+        const uint8_t *pixel = get_pixel (ren, x, y);
+
+        for (int c = 0; c < 4; c++)
+          assert_in_range (pixel[c], expected[c] - 1, expected[c] + 1);
+      }
+
+  soft_renderer_delete (ren);
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+test_threads_match (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  mdo_result_t result = canary_draw_list_create (&ui_draw, alloc);
+  assert_true (mdo_result_success (result));
+
+  uint32_t seed = 1;
+  for (int i = 0; i < 500; i++)
+    {
+      float values[8];
+      for (int j = 0; j < 8; j++)
+        {
+          seed = seed * 1664525 + 1013904223;
+          values[j] = (seed >> 8) / (float)(1 << 24);
+        }
+
+      const float color[4] = { values[4], values[5], values[6], values[7] };
+      draw_quad (ui_draw, values[0] * 2.4 - 1.2, values[1] * 2.4 - 1.2,
+                 values[2] * 2.4 - 1.2, values[3] * 2.4 - 1.2, color);
+    }
+
+  soft_renderer_t *single;
+  assert_int_equal (soft_renderer_create (&single, NULL, WIDTH, HEIGHT, 1),
+                    0);
+  soft_renderer_render_draw_list (single, ui_draw);
+
+  soft_renderer_t *multi;
+  assert_int_equal (soft_renderer_create (&multi, NULL, WIDTH, HEIGHT, 4),
+                    0);
+
+  /* render more than once to make sure workers pick up every frame */
+  for (int i = 0; i < 3; i++)
+    {
+      soft_renderer_render_draw_list (multi, ui_draw);
+      assert_memory_equal (soft_renderer_get_framebuffer (single),
+                           soft_renderer_get_framebuffer (multi),
+                           WIDTH * HEIGHT * 4);
+    }
+
+  soft_renderer_delete (multi);
+  soft_renderer_delete (single);
+  canary_draw_list_delete (ui_draw);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_blend),
+    cmocka_unit_test (test_compact),
+    cmocka_unit_test (test_threads_match),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,127 @@
+/** @file test_tessellate.c
+ */
+
+#include <math.h>
+
+#include "tessellate.h"
+#include "test_common.h"
+
+static const float WHITE[4] = { 1.0, 1.0, 1.0, 1.0 };
+
+static void
+test_segments (void **state)
+{
+  uint32_t last = 0;
+
+  /* bigger circles on screen get more segments, in whole quarters */
+  for (float radius = 0.0; radius < 16.0; radius += 0.01)
+    {
+      uint32_t segments = canary_tessellate_segments (radius, 256.0);
+      assert_int_equal (segments % 4, 0);
+      assert_true (segments >= last);
+      assert_true (segments <= CANARY_TESSELLATE_MAX_SEGMENTS);
+      last = segments;
+    }
+
+  assert_int_equal (last, CANARY_TESSELLATE_MAX_SEGMENTS);
+  assert_true (canary_tessellate_segments (0.05, 256.0) < 64);
+}
+
+static void
+test_circle (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create (&ui_draw, alloc);
+
+  const float center[2] = { 0.25, -0.5 };
+  canary_draw_circle (ui_draw, center, 0.5, WHITE, 64);
+
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 65);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), 64 * 3);
+
+  canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (ui_draw);
+  for (int i = 1; i < 65; i++)
+    {
+      float dx = vertices[i].position[0] - center[0];
+      float dy = vertices[i].position[1] - center[1];
+      assert_true (fabsf (sqrtf (dx * dx + dy * dy) - 0.5f) < 1e-4f);
+    }
+
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+test_rounded_rect (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create (&ui_draw, alloc);
+
+  /* the radius is clamped to half of the height */
+  const float position[2] = { -1.0, -0.25 };
+  const float size[2] = { 2.0, 0.5 };
+  canary_draw_rounded_rect (ui_draw, position, size, 1.0, WHITE, 32);
+
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 4 * 9 + 1);
+
+  canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (ui_draw);
+  float min[2] = { INFINITY, INFINITY };
+  float max[2] = { -INFINITY, -INFINITY };
+
+  for (size_t i = 0; i < 4 * 9 + 1; i++)
+    for (int j = 0; j < 2; j++)
+      {
+        min[j] = fminf (min[j], vertices[i].position[j]);
+        max[j] = fmaxf (max[j], vertices[i].position[j]);
+      }
+
+  for (int j = 0; j < 2; j++)
+    {
+      assert_true (fabsf (min[j] - position[j]) < 1e-5f);
+      assert_true (fabsf (max[j] - (position[j] + size[j])) < 1e-5f);
+    }
+
+  canary_draw_list_delete (ui_draw);
+}
+
+static void
+test_polyline (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_draw_list_t *ui_draw;
+  canary_draw_list_create (&ui_draw, alloc);
+
+  /* a right angle, so the corner's miter is sqrt(2) times half the width */
+  const float points[] = { 0.0, 0.0, 1.0, 0.0, 1.0, 1.0 };
+  canary_draw_polyline (ui_draw, points, 3, 0.2, false, WHITE);
+
+  assert_int_equal (canary_draw_list_vertex_count (ui_draw), 6);
+  assert_int_equal (canary_draw_list_index_count (ui_draw), 12);
+
+  canary_draw_vertex_t *vertices = canary_draw_list_vertex_buffer (ui_draw);
+  assert_true (fabsf (vertices[0].position[1] - 0.1f) < 1e-6f);
+  assert_true (fabsf (vertices[1].position[1] + 0.1f) < 1e-6f);
+  assert_true (fabsf (vertices[2].position[0] - 0.9f) < 1e-6f);
+  assert_true (fabsf (vertices[2].position[1] - 0.1f) < 1e-6f);
+  assert_true (fabsf (vertices[3].position[0] - 1.1f) < 1e-6f);
+  assert_true (fabsf (vertices[3].position[1] + 0.1f) < 1e-6f);
+
+  canary_draw_list_delete (ui_draw);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_segments),
+    cmocka_unit_test (test_circle),
+    cmocka_unit_test (test_rounded_rect),
+    cmocka_unit_test (test_polyline),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,153 @@
+/** @file test_trace.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> /* for strncmp, strstr */
+#include <unistd.h> /* for unlink */
+
+#include "test_common.h"
+#include "trace.h"
+
+#define THREAD_NUM 4
+
+static char *
+read_file (const char *filename)
+{
+  FILE *f = fopen (filename, "rb");
+  assert_non_null (f);
+
+  fseek (f, 0, SEEK_END);
+  size_t size = ftell (f);
+  fseek (f, 0, SEEK_SET);
+
+  char *contents = malloc (size + 1);
+  assert_int_equal (fread (contents, 1, size, f), size);
+  contents[size] = '\0';
+  fclose (f);
+
+  return contents;
+}
+
+static size_t
+count (const char *haystack, const char *needle)
+{
+  size_t found = 0;
+  while ((haystack = strstr (haystack, needle)))
+    {
+      found++;
+      haystack++;
+    }
+
+  return found;
+}
+
+static char *
+write_trace (canary_trace_t *trace)
+{
+  char filename[] = "/tmp/canary-trace-XXXXXX";
+  int fd = mkstemp (filename);
+  assert_true (fd >= 0);
+  close (fd);
+
+  assert_int_equal (canary_trace_write_json (trace, filename), 0);
+
+  char *json = read_file (filename);
+  unlink (filename);
+
+  assert_int_equal (strncmp (json, "{\"traceEvents\":[", 16), 0);
+  return json;
+}
+
+static void
+test_ring (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_trace_t *trace;
+  mdo_result_t result = canary_trace_create (&trace, alloc, 16);
+  assert_true (mdo_result_success (result));
+
+  canary_trace_begin (trace, "first");
+  canary_trace_end (trace, "first");
+
+  char *json = write_trace (trace);
+  assert_int_equal (count (json, "\"name\":\"first\""), 2);
+  assert_int_equal (count (json, "\"ph\":\"B\""), 1);
+  assert_int_equal (count (json, "\"ph\":\"E\""), 1);
+  free (json);
+
+  /* only the latest events are kept once the ring wraps around */
+  for (int i = 0; i < 20; i++)
+    {
+      canary_trace_begin (trace, "wrapped");
+      canary_trace_end (trace, "wrapped");
+    }
+
+  json = write_trace (trace);
+  assert_int_equal (count (json, "\"name\":\"first\""), 0);
+  assert_in_range (count (json, "\"name\":\"wrapped\""), 1, 16);
+  free (json);
+
+  canary_trace_delete (trace);
+}
+
+static void *
+record_events (void *arg)
+{
+  canary_trace_t *trace = arg;
+
+  for (int i = 0; i < 10; i++)
+    {
+      canary_trace_begin (trace, "worker");
+      canary_trace_end (trace, "worker");
+    }
+
+  return NULL;
+}
+
+static void
+test_threads (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_trace_t *trace;
+  mdo_result_t result = canary_trace_create (&trace, alloc, 64);
+  assert_true (mdo_result_success (result));
+
+  pthread_t threads[THREAD_NUM];
+  for (int i = 0; i < THREAD_NUM; i++)
+    assert_int_equal (
+        pthread_create (&threads[i], NULL, record_events, trace), 0);
+
+  for (int i = 0; i < THREAD_NUM; i++)
+    pthread_join (threads[i], NULL);
+
+  /* each thread gets its own ring, so none of them lose events */
+  char *json = write_trace (trace);
+  assert_int_equal (count (json, "\"name\":\"worker\""), THREAD_NUM * 20);
+
+  for (int i = 1; i <= THREAD_NUM; i++)
+    {
+      char tid[16];
+      snprintf (tid, sizeof (tid), "\"tid\":%d}", i);
+      assert_int_equal (count (json, tid), 20);
+    }
+
+  free (json);
+  canary_trace_delete (trace);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_ring),
+    cmocka_unit_test (test_threads),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,121 @@
+/** @file test_watchdog.c
+ */
+
+#include <string.h> /* for strlen */
+
+#include "test_common.h"
+#include "watchdog.h"
+
+static const char *MODULE
+    = "(module"
+      "  (func (export \"spin\") (loop $forever (br $forever)))"
+      "  (func (export \"nop\")))";
+
+typedef struct fixture_s
+{
+  wasm_engine_t *engine;
+  wasmtime_store_t *store;
+  wasmtime_context_t *context;
+  wasmtime_module_t *module;
+  wasmtime_instance_t instance;
+} fixture_t;
+
+static void
+create_fixture (fixture_t *fixture)
+{
+  wasm_config_t *config = wasm_config_new ();
+  wasmtime_config_interruptable_set (config, true);
+  fixture->engine = wasm_engine_new_with_config (config);
+
+  fixture->store = wasmtime_store_new (fixture->engine, NULL, NULL);
+  fixture->context = wasmtime_store_context (fixture->store);
+
+  wasm_byte_vec_t wasm;
+  assert_null (wasmtime_wat2wasm (MODULE, strlen (MODULE), &wasm));
+  assert_null (wasmtime_module_new (fixture->engine,
+                                    (const uint8_t *)wasm.data, wasm.size,
+                                    &fixture->module));
+  wasm_byte_vec_delete (&wasm);
+
+  wasm_trap_t *trap = NULL;
+  assert_null (wasmtime_instance_new (fixture->context, fixture->module, NULL,
+                                      0, &fixture->instance, &trap));
+  assert_null (trap);
+}
+
+static void
+delete_fixture (fixture_t *fixture)
+{
+  wasmtime_module_delete (fixture->module);
+  wasmtime_store_delete (fixture->store);
+  wasm_engine_delete (fixture->engine);
+}
+
+/* returns true if the export trapped */
+static bool
+call (fixture_t *fixture, const char *name)
+{
+  wasmtime_extern_t func;
+  assert_true (wasmtime_instance_export_get (
+      fixture->context, &fixture->instance, name, strlen (name), &func));
+
+  wasm_trap_t *trap = NULL;
+  assert_null (wasmtime_func_call (fixture->context, &func.of.func, NULL, 0,
+                                   NULL, 0, &trap));
+
+  if (!trap)
+    return false;
+
+  wasm_trap_delete (trap);
+  return true;
+}
+
+static void
+test_interrupt (void **state)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  fixture_t fixture;
+  create_fixture (&fixture);
+
+  canary_watchdog_t *watchdog;
+  mdo_result_t result = canary_watchdog_create (&watchdog, alloc);
+  assert_true (mdo_result_success (result));
+
+  wasmtime_interrupt_handle_t *handle
+      = wasmtime_interrupt_handle_new (fixture.context);
+  assert_non_null (handle);
+
+  canary_watchdog_timer_t *timer;
+  result = canary_watchdog_timer_create (&timer, watchdog, handle);
+  assert_true (mdo_result_success (result));
+
+  /* calls that finish in time aren't interrupted */
+  canary_watchdog_timer_arm (timer, 1.0);
+  assert_false (call (&fixture, "nop"));
+  assert_false (canary_watchdog_timer_fired (timer));
+  assert_false (canary_watchdog_timer_disarm (timer));
+
+  /* and the ones that don't finish are */
+  canary_watchdog_timer_arm (timer, 0.01);
+  assert_true (call (&fixture, "spin"));
+  assert_true (canary_watchdog_timer_fired (timer));
+  assert_true (canary_watchdog_timer_disarm (timer));
+
+  /* the store is still usable afterwards */
+  assert_false (call (&fixture, "nop"));
+
+  canary_watchdog_timer_delete (timer);
+  canary_watchdog_delete (watchdog);
+  delete_fixture (&fixture);
+}
+
+int
+main ()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test (test_interrupt),
+  };
+
+  return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,256 @@
+/** @file canary_replay.c
+ * Streams a draw list capture into a consumer as fast as it can and
+ * reports throughput.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h> /* for strtoul */
+#include <string.h>
+#include <time.h>
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+#include "checksum.h"
+#include "draw_list.h"
+#include "replay.h"
+
+typedef struct consumer_s
+{
+  const char *name;
+
+  /* optional; the returned state is passed to the other callbacks */
+  void *(*create) (const mdo_allocator_t *);
+  void (*consume) (void *, const canary_replay_panel_t *);
+  void (*end_frame) (void *);
+  void (*report) (void *);
+  void (*delete) (void *);
+} consumer_t;
+
+static double
+now_ns ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* touches nothing but the panel headers, to measure the replay alone */
+static void
+null_consume (void *state, const canary_replay_panel_t *panel)
+{
+}
+
+/* hashes every buffer, so that two captures can be compared */
+static void *
+checksum_create (const mdo_allocator_t *alloc)
+{
+  uint64_t *hash = mdo_allocator_malloc (alloc, sizeof (uint64_t));
+  *hash = CHECKSUM_INIT;
+  return hash;
+}
+
+static void
+checksum_consume (void *state, const canary_replay_panel_t *panel)
+{
+  checksum_bytes (state, panel->color, sizeof (panel->color));
+  checksum_bytes (state, panel->size, sizeof (panel->size));
+  checksum_bytes (state, panel->vertices,
+                  panel->vertex_num * sizeof (canary_draw_vertex_t));
+  checksum_bytes (state, panel->indices,
+                  panel->index_num * sizeof (canary_draw_index_t));
+}
+
+static void
+checksum_report (void *state)
+{
+  printf ("checksum: %016llx\n", (unsigned long long)*(uint64_t *)state);
+}
+
+/* copies each panel into a draw list, like a renderer's upload would */
+static void *
+draw_list_create (const mdo_allocator_t *alloc)
+{
+  canary_draw_list_t *draw_list;
+  canary_draw_list_create (&draw_list, alloc);
+  return draw_list;
+}
+
+static void
+draw_list_consume (void *state, const canary_replay_panel_t *panel)
+{
+  if (canary_draw_buffers (state, panel->vertices, panel->vertex_num,
+                           panel->indices, panel->index_num))
+    LOG_ERR ("panel %u has out-of-range indices", panel->id);
+}
+
+static void
+draw_list_end_frame (void *state)
+{
+  canary_draw_list_clear (state);
+}
+
+static void
+draw_list_delete (void *state)
+{
+  canary_draw_list_delete (state);
+}
+
+static const consumer_t CONSUMERS[] = {
+  { "null", NULL, null_consume, NULL, NULL, NULL },
+  { "checksum", checksum_create, checksum_consume, NULL, checksum_report,
+    NULL },
+  { "draw-list", draw_list_create, draw_list_consume, draw_list_end_frame,
+    NULL, draw_list_delete },
+};
+
+static const consumer_t *
+find_consumer (const char *name)
+{
+  for (size_t i = 0; i < sizeof (CONSUMERS) / sizeof (CONSUMERS[0]); i++)
+    {
+      if (!strcmp (CONSUMERS[i].name, name))
+        return &CONSUMERS[i];
+    }
+
+  return NULL;
+}
+
+static int
+run_replay (const char *filename, const consumer_t *consumer,
+            unsigned long loops)
+{
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_replay_t *replay;
+  mdo_result_t result = canary_replay_create (&replay, alloc, filename);
+  if (!mdo_result_success (result))
+    {
+      LOG_ERR ("failed to open capture %s", filename);
+      canary_replay_delete (replay);
+      return 1;
+    }
+
+  void *state = NULL;
+  if (consumer->create)
+    state = consumer->create (alloc);
+
+  int error_code = 0;
+  size_t frame_num = canary_replay_get_frame_num (replay);
+
+  size_t frames = 0;
+  size_t panels = 0;
+  size_t vertices = 0;
+  size_t indices = 0;
+
+  double start = now_ns ();
+
+  for (unsigned long loop = 0; loop < loops && !error_code; loop++)
+    {
+      for (size_t i = 0; i < frame_num; i++)
+        {
+          canary_replay_frame_t frame;
+          if (canary_replay_get_frame (replay, i, &frame))
+            {
+              LOG_ERR ("frame %zu is corrupt", i);
+              error_code = 1;
+              break;
+            }
+
+          for (size_t j = 0; j < frame.panel_num; j++)
+            {
+              canary_replay_panel_t panel;
+              if (canary_replay_get_panel (replay, &frame, j, &panel))
+                {
+                  LOG_ERR ("panel %zu of frame %zu is corrupt", j, i);
+                  error_code = 1;
+                  break;
+                }
+
+              consumer->consume (state, &panel);
+
+              vertices += panel.vertex_num;
+              indices += panel.index_num;
+            }
+
+          if (consumer->end_frame)
+            consumer->end_frame (state);
+
+          frames++;
+          panels += frame.panel_num;
+        }
+    }
+
+  double seconds = (now_ns () - start) / 1e9;
+  double bytes = vertices * sizeof (canary_draw_vertex_t)
+                 + indices * sizeof (canary_draw_index_t);
+
+  printf ("frames:   %zu\n", frames);
+  printf ("panels:   %zu\n", panels);
+  printf ("vertices: %zu\n", vertices);
+  printf ("indices:  %zu\n", indices);
+  printf ("seconds:  %.6f\n", seconds);
+
+  if (seconds > 0.0)
+    {
+      printf ("frames/s: %.1f\n", frames / seconds);
+      printf ("MB/s:     %.1f\n", bytes / seconds / 1e6);
+    }
+
+  if (consumer->report)
+    consumer->report (state);
+
+  if (consumer->delete)
+    consumer->delete (state);
+  else if (state)
+    mdo_allocator_free (alloc, state);
+
+  canary_replay_delete (replay);
+  return error_code;
+}
+
+int
+main (int argc, const char *argv[])
+{
+  const char *filename = NULL;
+  const consumer_t *consumer = &CONSUMERS[0];
+  unsigned long loops = 1;
+
+  for (int i = 1; i < argc; i++)
+    {
+      if (!strcmp (argv[i], "--consumer") && i + 1 < argc)
+        {
+          consumer = find_consumer (argv[++i]);
+          if (!consumer)
+            {
+              fprintf (stderr, "unknown consumer %s\n", argv[i]);
+              return 1;
+            }
+        }
+      else if (!strcmp (argv[i], "--loops") && i + 1 < argc)
+        loops = strtoul (argv[++i], NULL, 10);
+      else if (!filename && argv[i][0] != '-')
+        filename = argv[i];
+      else
+        {
+          filename = NULL;
+          break;
+        }
+    }
+
+  if (!filename)
+    {
+      fprintf (stderr,
+               "Usage:\n  %s capture [--consumer null|checksum|draw-list]"
+               " [--loops n]\n",
+               argv[0]);
+      return 1;
+    }
+
+  int result = run_replay (filename, consumer, loops);
+  mdo_result_cleanup ();
+
+  return result;
+}
@@ -0,0 +1,449 @@
+/** @file canary_trace_runner.c
+ * Replays the calls a host made into a script, recorded with a
+ * canary_recorder_t, as fast as it can and without a window. Reports the
+ * CPU time and draw list size of every frame, and checksums the draw lists
+ * so that changes to a script's output show up as well as slowdowns.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h> /* for qsort, strtoull */
+#include <string.h>
+#include <time.h>
+
+#include <mdo-utils/allocator.h>
+#include <mdo-utils/result.h>
+
+#include "checksum.h"
+#include "draw_list.h"
+#include "panel.h"
+#include "recording.h"
+#include "runtime.h"
+#include "script.h"
+
+typedef struct runner_panel_s
+{
+  uint32_t recorded_key;
+  canary_panel_key_t panel_key;
+  canary_panel_t *panel;
+  canary_draw_list_t *draw_list;
+} runner_panel_t;
+
+typedef struct runner_frame_s
+{
+  double cpu_ns;
+  size_t vertex_num;
+  size_t index_num;
+  uint64_t checksum;
+} runner_frame_t;
+
+typedef struct runner_s
+{
+  const mdo_allocator_t *alloc;
+  canary_script_t *script;
+
+  struct
+  {
+    runner_panel_t *vals;
+    size_t size;
+    size_t capacity;
+  } panels;
+
+  struct
+  {
+    runner_frame_t *vals;
+    size_t size;
+    size_t capacity;
+  } frames;
+
+  size_t failed_updates;
+} runner_t;
+
+static double
+cpu_ns ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* grows a vector in the runner by doubling */
+static void *
+grow (const mdo_allocator_t *alloc, void *vals, size_t *capacity,
+      size_t size, size_t element_size)
+{
+  if (size < *capacity)
+    return vals;
+
+  size_t new_capacity = *capacity ? *capacity << 1 : 64;
+
+  if (vals)
+    vals = mdo_allocator_realloc (alloc, vals, new_capacity * element_size);
+  else
+    vals = mdo_allocator_malloc (alloc, new_capacity * element_size);
+
+  *capacity = new_capacity;
+  return vals;
+}
+
+static runner_panel_t *
+find_panel (runner_t *runner, uint32_t recorded_key)
+{
+  for (size_t i = 0; i < runner->panels.size; i++)
+    {
+      if (runner->panels.vals[i].recorded_key == recorded_key)
+        return &runner->panels.vals[i];
+    }
+
+  return NULL;
+}
+
+/* keys the replay has never seen stay invalid instead of aliasing a panel */
+static canary_panel_key_t
+map_key (runner_t *runner, uint32_t recorded_key)
+{
+  runner_panel_t *entry = find_panel (runner, recorded_key);
+  return entry ? entry->panel_key : 0;
+}
+
+static void
+delete_panel (runner_panel_t *entry)
+{
+  canary_panel_delete (entry->panel);
+  canary_draw_list_delete (entry->draw_list);
+}
+
+static int
+bind_panel (runner_t *runner, const canary_recording_event_t *event)
+{
+  runner->panels.vals
+      = grow (runner->alloc, runner->panels.vals, &runner->panels.capacity,
+              runner->panels.size, sizeof (runner_panel_t));
+
+  runner_panel_t *entry = &runner->panels.vals[runner->panels.size];
+  entry->recorded_key = event->panel_key;
+
+  if (!mdo_result_success (canary_panel_create (&entry->panel, runner->alloc)))
+    return -1;
+
+  canary_draw_list_create (&entry->draw_list, runner->alloc);
+  canary_panel_set_draw_list (entry->panel, entry->draw_list);
+
+  canary_panel_set_color (entry->panel, event->color);
+  canary_panel_set_size (entry->panel, event->size);
+  canary_panel_set_pixel_scale (entry->panel, event->pixel_scale);
+
+  if (canary_script_bind_panel (runner->script, entry->panel,
+                                &entry->panel_key))
+    {
+      delete_panel (entry);
+      return -1;
+    }
+
+  runner->panels.size++;
+  return 0;
+}
+
+static void
+unbind_panel (runner_t *runner, uint32_t recorded_key)
+{
+  runner_panel_t *entry = find_panel (runner, recorded_key);
+  if (!entry)
+    return;
+
+  canary_script_unbind_panel (runner->script, entry->panel_key);
+  delete_panel (entry);
+
+  *entry = runner->panels.vals[--runner->panels.size];
+}
+
+static void
+run_update (runner_t *runner, float dt, double start)
+{
+  if (canary_script_update (runner->script, dt) != CANARY_SCRIPT_OK)
+    runner->failed_updates++;
+
+  double end = cpu_ns ();
+
+  runner->frames.vals
+      = grow (runner->alloc, runner->frames.vals, &runner->frames.capacity,
+              runner->frames.size, sizeof (runner_frame_t));
+
+  runner_frame_t *frame = &runner->frames.vals[runner->frames.size++];
+  frame->cpu_ns = end - start;
+  frame->vertex_num = 0;
+  frame->index_num = 0;
+  frame->checksum = CHECKSUM_INIT;
+
+  for (size_t i = 0; i < runner->panels.size; i++)
+    {
+      canary_draw_list_t *draw_list = runner->panels.vals[i].draw_list;
+      size_t vertex_num = canary_draw_list_vertex_count (draw_list);
+      size_t index_num = canary_draw_list_index_count (draw_list);
+
+      frame->vertex_num += vertex_num;
+      frame->index_num += index_num;
+
+      checksum_bytes (&frame->checksum,
+                      canary_draw_list_vertex_buffer (draw_list),
+                      vertex_num * sizeof (canary_draw_vertex_t));
+      checksum_bytes (&frame->checksum,
+                      canary_draw_list_index_buffer (draw_list),
+                      index_num * sizeof (canary_draw_index_t));
+
+      /* hosts start every frame from an empty list */
+      canary_draw_list_clear (draw_list);
+    }
+}
+
+static int
+run_recording (runner_t *runner, canary_recording_t *recording)
+{
+  size_t event_num = canary_recording_get_event_num (recording);
+
+  /* everything since the last update counts towards the next frame */
+  double start = cpu_ns ();
+
+  for (size_t i = 0; i < event_num; i++)
+    {
+      canary_recording_event_t event;
+      if (canary_recording_get_event (recording, i, &event))
+        {
+          LOG_ERR ("event %zu is corrupt", i);
+          return -1;
+        }
+
+      switch (event.type)
+        {
+        case CANARY_RECORDING_BIND_PANEL:
+          if (bind_panel (runner, &event))
+            {
+              LOG_ERR ("failed to bind panel at event %zu", i);
+              return -1;
+            }
+          break;
+        case CANARY_RECORDING_UNBIND_PANEL:
+          unbind_panel (runner, event.panel_key);
+          break;
+        case CANARY_RECORDING_INPUT:
+          canary_script_on_input (runner->script,
+                                  map_key (runner, event.panel_key),
+                                  event.input_event, event.coords);
+          break;
+        case CANARY_RECORDING_SET_INPUT_MODE:
+          canary_script_set_input_mode (runner->script, event.input_mode);
+          break;
+        case CANARY_RECORDING_FLUSH_INPUT:
+          canary_script_flush_input (runner->script);
+          break;
+        case CANARY_RECORDING_UPDATE:
+          run_update (runner, event.dt, start);
+          start = cpu_ns ();
+          break;
+        }
+    }
+
+  return 0;
+}
+
+static int
+compare_doubles (const void *a, const void *b)
+{
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+static double
+percentile (const double *sorted, size_t num, double p)
+{
+  size_t index = (size_t)(p * (num - 1) + 0.5);
+  return sorted[index];
+}
+
+static uint64_t
+report (runner_t *runner, FILE *frames_out)
+{
+  size_t frame_num = runner->frames.size;
+  uint64_t checksum = CHECKSUM_INIT;
+
+  double total_ns = 0.0;
+  size_t total_vertices = 0;
+  size_t total_indices = 0;
+  size_t max_vertices = 0;
+  size_t max_indices = 0;
+
+  if (frames_out)
+    fprintf (frames_out, "frame,cpu_us,vertices,indices,checksum\n");
+
+  double *samples = mdo_allocator_calloc (runner->alloc, frame_num + 1,
+                                          sizeof (double));
+
+  for (size_t i = 0; i < frame_num; i++)
+    {
+      const runner_frame_t *frame = &runner->frames.vals[i];
+
+      checksum_bytes (&checksum, &frame->checksum, sizeof (uint64_t));
+
+      samples[i] = frame->cpu_ns;
+      total_ns += frame->cpu_ns;
+      total_vertices += frame->vertex_num;
+      total_indices += frame->index_num;
+
+      if (frame->vertex_num > max_vertices)
+        max_vertices = frame->vertex_num;
+
+      if (frame->index_num > max_indices)
+        max_indices = frame->index_num;
+
+      if (frames_out)
+        fprintf (frames_out, "%zu,%.3f,%zu,%zu,%016llx\n", i,
+                 frame->cpu_ns / 1e3, frame->vertex_num, frame->index_num,
+                 (unsigned long long)frame->checksum);
+    }
+
+  printf ("frames:         %zu\n", frame_num);
+  printf ("failed updates: %zu\n", runner->failed_updates);
+
+  if (frame_num > 0)
+    {
+      qsort (samples, frame_num, sizeof (double), compare_doubles);
+
+      printf ("cpu total ms:   %.3f\n", total_ns / 1e6);
+      printf ("cpu us/frame:   mean %.3f, p50 %.3f, p99 %.3f, max %.3f\n",
+              total_ns / frame_num / 1e3,
+              percentile (samples, frame_num, 0.5) / 1e3,
+              percentile (samples, frame_num, 0.99) / 1e3,
+              samples[frame_num - 1] / 1e3);
+      printf ("vertices/frame: mean %.1f, max %zu\n",
+              (double)total_vertices / frame_num, max_vertices);
+      printf ("indices/frame:  mean %.1f, max %zu\n",
+              (double)total_indices / frame_num, max_indices);
+    }
+
+  printf ("checksum:       %016llx\n", (unsigned long long)checksum);
+
+  mdo_allocator_free (runner->alloc, samples);
+  return checksum;
+}
+
+static void
+cleanup_runner (runner_t *runner)
+{
+  for (size_t i = 0; i < runner->panels.size; i++)
+    {
+      canary_script_unbind_panel (runner->script,
+                                  runner->panels.vals[i].panel_key);
+      delete_panel (&runner->panels.vals[i]);
+    }
+
+  if (runner->panels.vals)
+    mdo_allocator_free (runner->alloc, runner->panels.vals);
+
+  if (runner->frames.vals)
+    mdo_allocator_free (runner->alloc, runner->frames.vals);
+}
+
+int
+main (int argc, const char *argv[])
+{
+  const char *script_filename = NULL;
+  const char *recording_filename = NULL;
+  const char *frames_filename = NULL;
+  const char *expected = NULL;
+
+  for (int i = 1; i < argc; i++)
+    {
+      if (!strcmp (argv[i], "--frames") && i + 1 < argc)
+        frames_filename = argv[++i];
+      else if (!strcmp (argv[i], "--expect") && i + 1 < argc)
+        expected = argv[++i];
+      else if (!script_filename && argv[i][0] != '-')
+        script_filename = argv[i];
+      else if (!recording_filename && argv[i][0] != '-')
+        recording_filename = argv[i];
+      else
+        {
+          recording_filename = NULL;
+          break;
+        }
+    }
+
+  if (!recording_filename)
+    {
+      fprintf (stderr,
+               "Usage:\n  %s script.wasm recording [--frames out.csv]"
+               " [--expect checksum]\n",
+               argv[0]);
+      return 1;
+    }
+
+  int error_code = 0;
+  const mdo_allocator_t *alloc = mdo_default_allocator ();
+
+  canary_runtime_t *runtime = NULL;
+  canary_recording_t *recording = NULL;
+  FILE *frames_out = NULL;
+
+  runner_t runner;
+  memset (&runner, 0, sizeof (runner));
+  runner.alloc = alloc;
+
+  if (!mdo_result_success (
+          canary_recording_create (&recording, alloc, recording_filename)))
+    {
+      error_code = 1;
+      goto error;
+    }
+
+  if (frames_filename)
+    {
+      frames_out = fopen (frames_filename, "w");
+      if (!frames_out)
+        {
+          LOG_ERR ("failed to open %s", frames_filename);
+          error_code = 1;
+          goto error;
+        }
+    }
+
+  if (!mdo_result_success (canary_runtime_create (&runtime, alloc))
+      || !mdo_result_success (canary_script_create (&runner.script, runtime))
+      || !mdo_result_success (
+          canary_script_load (runner.script, script_filename)))
+    {
+      LOG_ERR ("failed to load %s", script_filename);
+      error_code = 1;
+      goto error;
+    }
+
+  if (run_recording (&runner, recording))
+    error_code = 1;
+
+  uint64_t checksum = report (&runner, frames_out);
+
+  if (expected && strtoull (expected, NULL, 16) != checksum)
+    {
+      LOG_ERR ("checksum doesn't match the expected %s", expected);
+      error_code = 1;
+    }
+
+error:
+  cleanup_runner (&runner);
+
+  if (runner.script)
+    canary_script_delete (runner.script);
+
+  if (runtime)
+    canary_runtime_delete (runtime);
+
+  if (recording)
+    canary_recording_delete (recording);
+
+  if (frames_out)
+    fclose (frames_out);
+
+  mdo_result_cleanup ();
+  return error_code;
+}
@@ -0,0 +1,16 @@
+/** @file checksum.c
+ */
+
+#include "checksum.h"
+
+void
+checksum_bytes (uint64_t *hash, const void *data, size_t size)
+{
+  const uint8_t *bytes = data;
+
+  for (size_t i = 0; i < size; i++)
+    {
+      *hash ^= bytes[i];
+      *hash *= 0x100000001b3;
+    }
+}
@@ -0,0 +1,17 @@
+/** @file checksum.h
+ * FNV-1a, for telling at a glance whether two runs drew the same thing.
+ */
+
+#pragma once
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint64_t */
+
+#define CHECKSUM_INIT 0xcbf29ce484222325
+
+/** @function checksum_bytes
+ * @param hash Starts at #CHECKSUM_INIT.
+ * @param data
+ * @param size
+ */
+void checksum_bytes (uint64_t *, const void *, size_t);